@@ -2,23 +2,30 @@
 
 TAX_RATE=0.08875
 
-# start kanabo as a named coprocess, in interactive mode loading the file from the 1st argument
-coproc kanabo { kanabo $1 ;}
+# start kanabo as a named coprocess, in interactive mode loading the file from the 1st argument, with each response
+# preceded by a header line of: status, number of nodes and length in bytes
+coproc kanabo { kanabo --framing $1 ;}
+
+# the length is in bytes, so `read -N' must count bytes too
+export LC_ALL=C
 
 # create an empty array to hold the bookstore menu items
 choices=()
 # send the query to the coprocess' stdin fd
 echo '$.store.book.*' >&${kanabo[1]}
-while read -ru ${kanabo[0]} line
+# read the header, then the whole response at once
+read -ru ${kanabo[0]} status count length
+read -rN ${length} -u ${kanabo[0]} response
+if [ "OK" != "$status" ]; then
+    echo "error: ${response}" >&2
+    exit 1
+fi
+while read -r line
 do
-  # EOD is the sentinal value printed on a line by itself after all other data is printed
-  if [ "EOD" == "$line" ]; then
-      break
-  fi
   declare -A book="$line"
   # for each book, format a menu item for use later by select
   choices+=("\"${book[title]}\" by ${book[author]}: \$${book[price]}")
-done
+done <<< "${response%$'\n'}"
 
 echo
 echo "Welcome to our bookstore!"
@@ -29,6 +36,7 @@ select book in "${choices[@]}"
 do
     # query for the price of the selected book
     echo "\$.store.book[$((REPLY - 1))].price" >&${kanabo[1]}
+    read -ru ${kanabo[0]} status count length
     read -ru ${kanabo[0]} price
     echo
     # bash doesn't support floating point arithmetic, so we use bc
@@ -46,7 +46,7 @@ TEST_DEPENDENCIES = check
 CFLAGS = -std=c11 -fstrict-aliasing -Wall -Wextra -Werror -Wformat -Wformat-security -Wformat-y2k -Winit-self -Wmissing-include-dirs -Wswitch-default -Wfloat-equal -Wundef -Wshadow -Wpointer-arith -Wbad-function-cast -Wconversion -Wstrict-prototypes -Wold-style-definition -Wmissing-prototypes -Wmissing-declarations -Wredundant-decls -Wnested-externs -Wunreachable-code -Wno-switch-default -Wno-unknown-pragmas -Wno-gnu
 debug_CFLAGS = -DUSE_LOGGING -fsanitize=address,integer,undefined -fno-sanitize=unsigned-integer-overflow
 release_CFLAGS = -O3 -flto
-LIBS = -lm
+LIBS = -lm -pthread
 TEST_LIBS =
 TEST_LDFLAGS = -fsanitize=address,integer,undefined -fno-sanitize=unsigned-integer-overflow -flto
 release_LDFLAGS = -flto
@@ -69,3 +69,14 @@ $(CONFIG_H): $(GENERATED_HEADERS_DIR)
 generate-version-header: $(VERSION_H)
 generate-config-header: $(CONFIG_H)
 GENERATE_SOURCES_HOOKS = generate-version-header generate-config-header
+
+BENCH_SOURCE_DIR = src/bench/c
+BENCH_INCLUDE_DIR = $(BENCH_SOURCE_DIR)/include
+
+bench: target
+	@mkdir -p $(TARGET_DIR)/bench
+	@for source in $(BENCH_SOURCE_DIR)/*.c; do \
+	  program=$(TARGET_DIR)/bench/`basename $$source .c`; \
+	  echo " -- Running benchmark $$program"; \
+	  $(CC) -I$(BENCH_INCLUDE_DIR) $(CFLAGS) $(LDFLAGS) -L$(TARGET_DIR) $$source -l$(LIBRARY_NAME_BASE) $(LDLIBS) -o $$program && $$program || exit 1; \
+	done
@@ -0,0 +1,180 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L /* for clock_gettime */
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "loader.h"
+#include "evaluator.h"
+#include "bench.h"
+
+/*
+ * Measures the cost per selected node of evaluating typical paths over
+ * the inventory fixture, repeated under a top level sequence so that the
+ * evaluator dominates.  The recursive name queries are measured again once
+ * the name index has been built.
+ */
+
+static const char * const FIXTURE = "src/test/resources/inventory.json";
+static const size_t COPIES = 10000;
+static const size_t SELECTIONS = 5000000ul;
+
+static const char * const PATHS[] =
+{
+    "$.stores[*].store.book[*].author",
+    "$.stores[*].store.*",
+    "$..author",
+    "$..book[1:3]",
+    "$..number()",
+    "$..*",
+};
+
+static const char * const INDEXED_PATHS[] =
+{
+    "$..author",
+    "$.stores[*]..price",
+    "$..book[1:3]",
+};
+
+static uint8_t *make_input(size_t *length);
+static void run(const DocumentModel *model, const char *expression, const char *prefix);
+
+static uint8_t *make_input(size_t *length)
+{
+    FILE *file = fopen(FIXTURE, "r");
+    if(NULL == file)
+    {
+        perror(FIXTURE);
+        return NULL;
+    }
+    char fixture[4096];
+    size_t size = fread(fixture, 1, sizeof fixture, file);
+    fclose(file);
+
+    const char *prefix = "{\"stores\": [";
+    size_t prefix_length = strlen(prefix);
+    uint8_t *input = malloc(prefix_length + COPIES * (size + 1) + 2);
+    uint8_t *cursor = input;
+    memcpy(cursor, prefix, prefix_length);
+    cursor += prefix_length;
+    for(size_t i = 0; i < COPIES; i++)
+    {
+        memcpy(cursor, fixture, size);
+        cursor += size;
+        *cursor++ = i + 1 < COPIES ? ',' : ']';
+    }
+    *cursor++ = '}';
+    *length = (size_t)(cursor - input);
+    return input;
+}
+
+static void run(const DocumentModel *model, const char *expression, const char *prefix)
+{
+    parser_context *parser = make_parser((const uint8_t *)expression, strlen(expression));
+    jsonpath *path = parse(parser);
+    if(NULL == path)
+    {
+        fprintf(stderr, "%s: %s\n", expression, parser_status_message(parser));
+        parser_free(parser);
+        return;
+    }
+
+    size_t selected = 0, iterations = 0;
+    double start = bench_now();
+    while(selected < SELECTIONS)
+    {
+        MaybeNodelist result = evaluate(model, path);
+        if(NOTHING == result.tag)
+        {
+            fprintf(stderr, "%s: %s\n", expression, result.nothing.message);
+            break;
+        }
+        selected += nodelist_length(result.just);
+        bench_sink = result.just;
+        iterations++;
+        nodelist_free(result.just);
+    }
+    double elapsed = bench_now() - start;
+
+    char label[64];
+    snprintf(label, sizeof label, "%s%s (%zu)", prefix, expression, selected / (0 == iterations ? 1 : iterations));
+    bench_report(label, selected, elapsed);
+
+    path_free(path);
+    parser_free(parser);
+}
+
+int main(void)
+{
+    size_t length = 0;
+    uint8_t *input = make_input(&length);
+    if(NULL == input)
+    {
+        return EXIT_FAILURE;
+    }
+    MaybeDocument document = load_string(input, length, DUPE_CLOBBER);
+    if(NOTHING == document.tag)
+    {
+        fprintf(stderr, "%s\n", document.nothing.message);
+        return EXIT_FAILURE;
+    }
+
+    for(size_t i = 0; i < sizeof(PATHS) / sizeof(PATHS[0]); i++)
+    {
+        run(document.just, PATHS[i], "");
+    }
+    for(size_t i = 0; i < sizeof(INDEXED_PATHS) / sizeof(INDEXED_PATHS[0]); i++)
+    {
+        run(document.just, INDEXED_PATHS[i], "");
+    }
+
+    double start = bench_now();
+    model_use_name_index(document.just, true);
+    bench_report("build name index", 1, bench_now() - start);
+    for(size_t i = 0; i < sizeof(INDEXED_PATHS) / sizeof(INDEXED_PATHS[0]); i++)
+    {
+        run(document.just, INDEXED_PATHS[i], "indexed ");
+    }
+
+    model_free(document.just);
+    free(input);
+    return EXIT_SUCCESS;
+}
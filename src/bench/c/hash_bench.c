@@ -0,0 +1,117 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L /* for clock_gettime */
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "bench.h"
+
+/*
+ * Measures the throughput of each string hash function across key lengths,
+ * from short mapping keys up to URL and UUID sized ones and beyond.
+ */
+
+typedef hashcode (*buffer_hash)(const uint8_t *key, size_t length);
+
+struct candidate_s
+{
+    const char  *name;
+    buffer_hash  function;
+};
+
+static const struct candidate_s CANDIDATES[] =
+{
+    {"shift-add-xor", shift_add_xor_string_buffer_hash},
+    {"sdbm",          sdbm_string_buffer_hash},
+    {"fnv1",          fnv1_string_buffer_hash},
+    {"fnv1a",         fnv1a_string_buffer_hash},
+    {"djb",           djb_string_buffer_hash},
+    {"wyhash",        wyhash_string_buffer_hash},
+};
+
+static const size_t LENGTHS[] = {4, 8, 16, 36, 64, 256, 4096};
+
+static const size_t BYTES = 256 * 1024 * 1024ul;
+
+static void run(const struct candidate_s *candidate, const uint8_t *buffer, size_t length);
+
+static void run(const struct candidate_s *candidate, const uint8_t *buffer, size_t length)
+{
+    size_t iterations = BYTES / length;
+    hashcode sum = 0;
+    double start = bench_now();
+    for(size_t i = 0; i < iterations; i++)
+    {
+        // N.B. - vary the key so the hash can't be hoisted out of the loop
+        sum += candidate->function(buffer + (i & 63), length);
+    }
+    double elapsed = bench_now() - start;
+    bench_sink = (const void *)sum;
+
+    char label[64];
+    snprintf(label, sizeof label, "%s, %zu bytes", candidate->name, length);
+    bench_report_bytes(label, iterations, iterations * length, elapsed);
+}
+
+int main(void)
+{
+    uint8_t *buffer = malloc(4096 + 64);
+    if(NULL == buffer)
+    {
+        return EXIT_FAILURE;
+    }
+    for(size_t i = 0; i < 4096 + 64; i++)
+    {
+        buffer[i] = (uint8_t)('a' + (i * 7) % 26);
+    }
+
+    for(size_t i = 0; i < sizeof(CANDIDATES) / sizeof(CANDIDATES[0]); i++)
+    {
+        for(size_t j = 0; j < sizeof(LENGTHS) / sizeof(LENGTHS[0]); j++)
+        {
+            run(CANDIDATES + i, buffer, LENGTHS[j]);
+        }
+    }
+
+    free(buffer);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L /* for clock_gettime */
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashtable.h"
+#include "bench.h"
+
+/*
+ * Measures put, get (hits and misses) and iteration over string keyed
+ * tables of 8, 1K and 1M entries, as used by mapping nodes.
+ */
+
+static const size_t OPERATIONS = 4 * 1024 * 1024ul;
+static const size_t NAME_SIZE = 24;
+
+static char *make_names(size_t count, const char *prefix);
+static Hashtable *make_fixture(size_t size, char *names);
+static bool count_entry(void *key, void *value, void *context);
+static void run(size_t size);
+
+static char *make_names(size_t count, const char *prefix)
+{
+    char *names = calloc(count, NAME_SIZE);
+    for(size_t i = 0; i < count; i++)
+    {
+        snprintf(names + i * NAME_SIZE, NAME_SIZE, "%s-%zu", prefix, i);
+    }
+    return names;
+}
+
+static Hashtable *make_fixture(size_t size, char *names)
+{
+    Hashtable *table = make_hashtable_with_function(string_comparitor, shift_add_xor_string_hash);
+    for(size_t i = 0; i < size; i++)
+    {
+        hashtable_put(table, names + i * NAME_SIZE, names + i * NAME_SIZE);
+    }
+    return table;
+}
+
+static bool count_entry(void *key __attribute__((unused)), void *value, void *context)
+{
+    (*(size_t *)context) += NULL != value;
+    return true;
+}
+
+static void run(size_t size)
+{
+    char *names = make_names(size, "key");
+    char *missing = make_names(size, "absent");
+    size_t rounds = OPERATIONS / size > 0 ? OPERATIONS / size : 1;
+    // N.B. - a stride coprime to the size visits the keys out of insertion order
+    size_t stride = 7919;
+    char label[64];
+
+    double start = bench_now();
+    for(size_t i = 0; i < rounds; i++)
+    {
+        hashtable_free(make_fixture(size, names));
+    }
+    snprintf(label, sizeof label, "put, %zu keys", size);
+    bench_report(label, rounds * size, bench_now() - start);
+
+    Hashtable *table = make_fixture(size, names);
+    size_t lookups = rounds * size;
+
+    start = bench_now();
+    for(size_t i = 0, j = 0; i < lookups; i++, j = (j + stride) % size)
+    {
+        bench_sink = hashtable_get(table, names + j * NAME_SIZE);
+    }
+    snprintf(label, sizeof label, "get hit, %zu keys", size);
+    bench_report(label, lookups, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0, j = 0; i < lookups; i++, j = (j + stride) % size)
+    {
+        bench_sink = hashtable_get(table, missing + j * NAME_SIZE);
+    }
+    snprintf(label, sizeof label, "get miss, %zu keys", size);
+    bench_report(label, lookups, bench_now() - start);
+
+    size_t count = 0;
+    start = bench_now();
+    for(size_t i = 0; i < rounds; i++)
+    {
+        hashtable_iterate(table, count_entry, &count);
+    }
+    snprintf(label, sizeof label, "iterate, %zu keys", size);
+    bench_report(label, count, bench_now() - start);
+
+    hashtable_free(table);
+    free(names);
+    free(missing);
+}
+
+int main(void)
+{
+    run(8);
+    run(1024);
+    run(1024 * 1024);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L /* for clock_gettime */
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "model.h"
+#include "bench.h"
+
+/*
+ * Measures the per-lookup cost of `mapping_get' against the previous
+ * approach of building, hashing and freeing a temporary key scalar.
+ */
+
+static const size_t LOOKUPS = 10000000ul;
+
+static Mapping *make_fixture(size_t size, uint8_t names[][16]);
+static Node *allocating_get(const Mapping *map, uint8_t *value, size_t length);
+static void run(size_t size);
+
+static Mapping *make_fixture(size_t size, uint8_t names[][16])
+{
+    Mapping *map = make_mapping_node();
+    for(size_t i = 0; i < size; i++)
+    {
+        int length = snprintf((char *)names[i], 16, "key-%zu", i);
+        Scalar *value = make_scalar_node(names[i], (size_t)length, SCALAR_STRING);
+        mapping_put(map, names[i], (size_t)length, node(value));
+    }
+    return map;
+}
+
+static Node *allocating_get(const Mapping *map, uint8_t *value, size_t length)
+{
+    Scalar *key = make_scalar_node(value, length, SCALAR_STRING);
+    Node *result = hashtable_get(map->values, key);
+    node_free(key);
+
+    return result;
+}
+
+static void run(size_t size)
+{
+    uint8_t (*names)[16] = calloc(size, sizeof *names);
+    Mapping *map = make_fixture(size, names);
+    char label[64];
+
+    double start = bench_now();
+    for(size_t i = 0; i < LOOKUPS; i++)
+    {
+        uint8_t *name = names[i % size];
+        bench_sink = allocating_get(map, name, strlen((char *)name));
+    }
+    snprintf(label, sizeof label, "allocating key, %zu keys", size);
+    bench_report(label, LOOKUPS, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < LOOKUPS; i++)
+    {
+        uint8_t *name = names[i % size];
+        bench_sink = mapping_get(map, name, strlen((char *)name));
+    }
+    snprintf(label, sizeof label, "mapping_get, %zu keys", size);
+    bench_report(label, LOOKUPS, bench_now() - start);
+
+    node_free(map);
+    free(names);
+}
+
+int main(void)
+{
+    run(8);
+    run(1024);
+    run(1024 * 64);
+
+    return EXIT_SUCCESS;
+}
@@ -35,40 +35,52 @@
  * [license]: http://www.opensource.org/licenses/ncsa
  */
 
-#include <stdio.h>
-
 #include "emit/bash.h"
 #include "emit/shell.h"
 #include "log.h"
 
 static bool emit_mapping_item(Node *key, Node *value, void *context);
+static bool emit_bash_node(Emitter *emitter, Node *each);
 
-bool emit_bash(const nodelist *list)
+bool emit_bash(const nodelist *list, Writer *output)
 {
     log_debug("bash", "emitting %zd items...", nodelist_length(list));
-    emit_context context = {
-            .emit_mapping_item = emit_mapping_item,
-            .wrap_collections = true
-    };
+    Emitter emitter = make_bash_emitter(output);
+    return emit_nodelist(&emitter, list);
+}
 
-    return nodelist_iterate(list, emit_node, &context);
+Emitter make_bash_emitter(Writer *output)
+{
+    return (Emitter){.emit = emit_bash_node, .output = output};
+}
+
+static bool emit_bash_node(Emitter *emitter, Node *each)
+{
+    emit_context context =
+        {
+            .emit_mapping_item = emit_mapping_item,
+            .wrap_collections = true,
+            .output = emitter->output
+        };
+    return emit_node(each, &context);
 }
 
-static bool emit_mapping_item(Node *key, Node *value, void *context __attribute__((unused)))
+static bool emit_mapping_item(Node *key, Node *value, void *argument)
 {
+    emit_context *context = (emit_context *)argument;
     if(is_scalar(value))
     {
         log_trace("bash", "emitting mapping item");
         EMIT("[");
         log_trace("bash", "emitting mapping item key");
-        if(!emit_raw_scalar(scalar(key)))
+        if(!emit_raw_scalar(scalar(key), context))
         {
             log_error("bash", "uh oh! couldn't emit mapping key");
             return false;
         }
         EMIT("]=");
         log_trace("bash", "emitting mapping item value");
-        if(!emit_scalar(scalar(value)))
+        if(!emit_scalar(scalar(value), context))
         {
             log_error("bash", "uh oh! couldn't emit mapping value");
             return false;
@@ -0,0 +1,219 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "emit/binary.h"
+#include "log.h"
+
+
+#define component "binary"
+
+/* longer than any integer or real that can be read natively */
+#define NUMBER_BUFFER_SIZE 64
+
+
+struct binary_items
+{
+    const BinaryFormat *format;
+    Writer             *output;
+};
+
+static bool emit_binary_scalar(const BinaryFormat *format, const Scalar *each, Writer *output);
+static bool emit_binary_integer(const BinaryFormat *format, const char *value, Writer *output);
+static bool emit_binary_real(const BinaryFormat *format, const char *value, Writer *output);
+static bool emit_binary_sequence_item(Node *each, void *context);
+static bool emit_binary_mapping_item(Node *key, Node *value, void *context);
+
+
+bool emit_binary_node(const BinaryFormat *format, Node *each, Writer *output)
+{
+    struct binary_items items = {format, output};
+    switch(node_kind(each))
+    {
+        case DOCUMENT:
+            log_trace(format->name, "emitting document");
+            return emit_binary_node(format, document_root(document(each)), output);
+        case SCALAR:
+            return emit_binary_scalar(format, scalar(each), output);
+        case SEQUENCE:
+            log_trace(format->name, "emitting seqence");
+            return format->array(output, node_size(each)) &&
+                sequence_iterate(sequence(each), emit_binary_sequence_item, &items);
+        case MAPPING:
+            log_trace(format->name, "emitting mapping");
+            return format->map(output, node_size(each)) &&
+                mapping_iterate(mapping(each), emit_binary_mapping_item, &items);
+        case ALIAS:
+            log_trace(format->name, "resolving alias");
+            return emit_binary_node(format, alias_target(alias(each)), output);
+    }
+
+    return false;
+}
+
+bool emit_binary_header(Writer *output, uint8_t prefix, uint64_t value, size_t width)
+{
+    uint8_t header[9] = {prefix};
+    for(size_t i = width; 0 < i; i--)
+    {
+        header[i] = (uint8_t)(value & 0xFF);
+        value >>= 8;
+    }
+
+    return writer_write(output, header, width + 1);
+}
+
+static bool emit_binary_sequence_item(Node *each, void *context)
+{
+    struct binary_items *items = (struct binary_items *)context;
+    return emit_binary_node(items->format, each, items->output);
+}
+
+static bool emit_binary_mapping_item(Node *key, Node *value, void *context)
+{
+    struct binary_items *items = (struct binary_items *)context;
+    // N.B. - keys are always strings, as they are in JSON
+    return items->format->string(items->output, scalar_value(scalar(key)), node_size(key)) &&
+        emit_binary_node(items->format, value, items->output);
+}
+
+static bool emit_binary_scalar(const BinaryFormat *format, const Scalar *each, Writer *output)
+{
+    const uint8_t *value = scalar_value(each);
+    size_t length = node_size(each);
+    char number[NUMBER_BUFFER_SIZE];
+    switch(scalar_kind(each))
+    {
+        case SCALAR_STRING:
+        case SCALAR_TIMESTAMP:
+            break;
+        case SCALAR_INTEGER:
+        case SCALAR_REAL:
+            if(0 == length || sizeof(number) <= length)
+            {
+                break;
+            }
+            // N.B. - scalar values aren't terminated, and strtoll/strtod need them to be
+            memcpy(number, value, length);
+            number[length] = '\0';
+            if(SCALAR_INTEGER == scalar_kind(each) ? emit_binary_integer(format, number, output)
+                                                   : emit_binary_real(format, number, output))
+            {
+                return true;
+            }
+            // N.B. - the writer may have failed, rather than the number
+            if(output->failed)
+            {
+                return false;
+            }
+            break;
+        case SCALAR_BOOLEAN:
+            return format->boolean(output, scalar_boolean_is_true(each));
+        case SCALAR_NULL:
+            return format->null(output);
+    }
+
+    log_trace(format->name, "emitting string");
+    return format->string(output, value, length);
+}
+
+static bool emit_binary_integer(const BinaryFormat *format, const char *value, Writer *output)
+{
+    char *end = NULL;
+    errno = 0;
+    long long result = strtoll(value, &end, 10);
+    if(0 == errno && '\0' == *end)
+    {
+        return result < 0 ? format->integer(output, (int64_t)result) : format->unsigned_integer(output, (uint64_t)result);
+    }
+    if(ERANGE == errno && '-' != value[0])
+    {
+        errno = 0;
+        unsigned long long large = strtoull(value, &end, 10);
+        if(0 == errno && '\0' == *end)
+        {
+            return format->unsigned_integer(output, (uint64_t)large);
+        }
+    }
+    if(ERANGE == errno)
+    {
+        // N.B. - like a JSON parser would, an integer too big for 64 bits becomes a real
+        return emit_binary_real(format, value, output);
+    }
+
+    // N.B. - a tagged integer may be written in hex or octal
+    errno = 0;
+    result = strtoll(value, &end, 0);
+    if(0 == errno && '\0' == *end)
+    {
+        return result < 0 ? format->integer(output, (int64_t)result) : format->unsigned_integer(output, (uint64_t)result);
+    }
+
+    return false;
+}
+
+static bool emit_binary_real(const BinaryFormat *format, const char *value, Writer *output)
+{
+    char *end = NULL;
+    double result = strtod(value, &end);
+    if('\0' == *end)
+    {
+        return format->real(output, result);
+    }
+
+    // N.B. - a tagged real may be one of YAML's special values
+    const char *special = '-' == value[0] || '+' == value[0] ? value + 1 : value;
+    if(0 == strcasecmp(".inf", special))
+    {
+        return format->real(output, '-' == value[0] ? -INFINITY : INFINITY);
+    }
+    if(0 == strcasecmp(".nan", special))
+    {
+        return format->real(output, NAN);
+    }
+
+    return false;
+}
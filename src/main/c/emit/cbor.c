@@ -0,0 +1,179 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include <string.h>
+
+#include "emit/cbor.h"
+#include "emit/binary.h"
+#include "log.h"
+
+
+#define component "cbor"
+
+enum cbor_major_type
+{
+    CBOR_UNSIGNED = 0,
+    CBOR_NEGATIVE = 1,
+    CBOR_TEXT     = 3,
+    CBOR_ARRAY    = 4,
+    CBOR_MAP      = 5,
+    CBOR_SIMPLE   = 7
+};
+
+
+static bool emit_cbor_item(Emitter *emitter, Node *each);
+static bool emit_cbor_head(Writer *output, enum cbor_major_type type, uint64_t argument);
+static bool emit_cbor_array(Writer *output, size_t count);
+static bool emit_cbor_map(Writer *output, size_t count);
+static bool emit_cbor_string(Writer *output, const uint8_t *value, size_t length);
+static bool emit_cbor_integer(Writer *output, int64_t value);
+static bool emit_cbor_unsigned(Writer *output, uint64_t value);
+static bool emit_cbor_real(Writer *output, double value);
+static bool emit_cbor_boolean(Writer *output, bool value);
+static bool emit_cbor_null(Writer *output);
+
+static const BinaryFormat CBOR_FORMAT =
+{
+    .name = component,
+    .array = emit_cbor_array,
+    .map = emit_cbor_map,
+    .string = emit_cbor_string,
+    .integer = emit_cbor_integer,
+    .unsigned_integer = emit_cbor_unsigned,
+    .real = emit_cbor_real,
+    .boolean = emit_cbor_boolean,
+    .null = emit_cbor_null
+};
+
+
+bool emit_cbor(const nodelist *list, Writer *output)
+{
+    log_debug(component, "emitting...");
+    Emitter emitter = make_cbor_emitter(output);
+    return emit_nodelist(&emitter, list);
+}
+
+/*
+ * The result is a CBOR sequence (RFC 8742), one data item for each node,
+ * rather than an array, like the MessagePack emitter.
+ */
+Emitter make_cbor_emitter(Writer *output)
+{
+    return (Emitter){.emit = emit_cbor_item, .output = output};
+}
+
+static bool emit_cbor_item(Emitter *emitter, Node *each)
+{
+    return emit_binary_node(&CBOR_FORMAT, each, emitter->output);
+}
+
+/*
+ * Every data item starts with its major type in the top three bits, then
+ * either the argument itself, when it is less than 24, or the width of the
+ * argument that follows.
+ */
+static bool emit_cbor_head(Writer *output, enum cbor_major_type type, uint64_t argument)
+{
+    uint8_t major = (uint8_t)(type << 5);
+    if(24 > argument)
+    {
+        uint8_t head = (uint8_t)(major | argument);
+        return writer_write(output, &head, 1);
+    }
+    if(UINT8_MAX >= argument)
+    {
+        return emit_binary_header(output, major | 24, argument, 1);
+    }
+    if(UINT16_MAX >= argument)
+    {
+        return emit_binary_header(output, major | 25, argument, 2);
+    }
+    if(UINT32_MAX >= argument)
+    {
+        return emit_binary_header(output, major | 26, argument, 4);
+    }
+    return emit_binary_header(output, major | 27, argument, 8);
+}
+
+static bool emit_cbor_array(Writer *output, size_t count)
+{
+    return emit_cbor_head(output, CBOR_ARRAY, count);
+}
+
+static bool emit_cbor_map(Writer *output, size_t count)
+{
+    return emit_cbor_head(output, CBOR_MAP, count);
+}
+
+static bool emit_cbor_string(Writer *output, const uint8_t *value, size_t length)
+{
+    return emit_cbor_head(output, CBOR_TEXT, length) && writer_write(output, value, length);
+}
+
+static bool emit_cbor_integer(Writer *output, int64_t value)
+{
+    if(0 <= value)
+    {
+        return emit_cbor_head(output, CBOR_UNSIGNED, (uint64_t)value);
+    }
+    // N.B. - a negative integer is encoded as -1 minus its argument
+    return emit_cbor_head(output, CBOR_NEGATIVE, (uint64_t)(-(value + 1)));
+}
+
+static bool emit_cbor_unsigned(Writer *output, uint64_t value)
+{
+    return emit_cbor_head(output, CBOR_UNSIGNED, value);
+}
+
+static bool emit_cbor_real(Writer *output, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return emit_binary_header(output, (uint8_t)(CBOR_SIMPLE << 5) | 27, bits, 8);
+}
+
+static bool emit_cbor_boolean(Writer *output, bool value)
+{
+    uint8_t head = (uint8_t)(CBOR_SIMPLE << 5) | (value ? 21 : 20);
+    return writer_write(output, &head, 1);
+}
+
+static bool emit_cbor_null(Writer *output)
+{
+    uint8_t head = (uint8_t)(CBOR_SIMPLE << 5) | 22;
+    return writer_write(output, &head, 1);
+}
@@ -0,0 +1,134 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdint.h>
+#include <unistd.h>
+
+#include "emit/frame.h"
+
+
+bool open_frame(struct frame *response)
+{
+    fflush(stdout);
+    response->buffer = tmpfile();
+    if(NULL == response->buffer)
+    {
+        return false;
+    }
+    response->output = dup(STDOUT_FILENO);
+    if(-1 == response->output)
+    {
+        fclose(response->buffer);
+        return false;
+    }
+
+    return true;
+}
+
+void close_frame(struct frame *response)
+{
+    fclose(response->buffer);
+    close(response->output);
+}
+
+bool begin_frame(struct frame *response)
+{
+    response->matches = 0;
+    response->failed = false;
+    fflush(stdout);
+
+    return -1 != dup2(fileno(response->buffer), STDOUT_FILENO);
+}
+
+void fail_frame(struct frame *response)
+{
+    // N.B. - the response to a failed command is only its error messages
+    fflush(stdout);
+    if(!response->failed && 0 == ftruncate(STDOUT_FILENO, 0))
+    {
+        lseek(STDOUT_FILENO, 0, SEEK_SET);
+    }
+    response->failed = true;
+}
+
+bool copy_frame(int from, int to, off_t length)
+{
+    char buffer[65536];
+    while(0 < length)
+    {
+        size_t want = (size_t)length < sizeof(buffer) ? (size_t)length : sizeof(buffer);
+        ssize_t count = read(from, buffer, want);
+        if(0 >= count)
+        {
+            return false;
+        }
+        for(ssize_t written = 0; written < count;)
+        {
+            ssize_t n = write(to, buffer + written, (size_t)(count - written));
+            if(-1 == n)
+            {
+                return false;
+            }
+            written += n;
+        }
+        length -= count;
+    }
+
+    return true;
+}
+
+bool end_frame(struct frame *response)
+{
+    fflush(stdout);
+    int buffer = fileno(response->buffer);
+    off_t length = lseek(buffer, 0, SEEK_CUR);
+    if(-1 == length || -1 == dup2(response->output, STDOUT_FILENO))
+    {
+        return false;
+    }
+
+    // N.B. - the header is a line of the status, the number of selected nodes and the length of the response in bytes
+    fprintf(stdout, "%s %zu %jd\n", response->failed ? "ERR" : "OK", response->failed ? 0 : response->matches, (intmax_t)length);
+    fflush(stdout);
+    bool result = 0 == lseek(buffer, 0, SEEK_SET) && copy_frame(buffer, STDOUT_FILENO, length);
+
+    return 0 == ftruncate(buffer, 0) && 0 == lseek(buffer, 0, SEEK_SET) && result;
+}
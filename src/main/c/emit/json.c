@@ -35,8 +35,12 @@
  * [license]: http://www.opensource.org/licenses/ncsa
  */
 
-
-#include <stdio.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 #include "emit/json.h"
 #include "log.h"
@@ -44,53 +48,190 @@
 
 #define component "json"
 
-#define EMIT(STR) if(EOF == fputs((STR), stdout))                       \
+#define EMIT(STR) if(!writer_puts(output, (STR)))                       \
     {                                                                   \
         log_error(component, "uh oh! couldn't emit literal %s", (STR)); \
         return false;                                                   \
     }
 
-#define QEMIT(STR) if(EOF == fputs((STR), stdout))                      \
-    {                                                                   \
-        log_error(component, "uh oh! couldn't emit literal %s", (STR)); \
-    }
+/* the items of a collection are separated by commas */
+struct json_items
+{
+    Writer *output;
+    size_t  count;
+};
 
 
-static bool emit_json_node(Node *each, void *context __attribute__((unused)));
+static inline size_t find_escape(const uint8_t *value, size_t offset, size_t length);
+static bool emit_json_escape(uint8_t character, Writer *output);
+static bool start_json(Emitter *emitter);
+static bool emit_json_item(Emitter *emitter, Node *each);
+static bool finish_json(Emitter *emitter);
 
 
 static bool emit_json_sequence_item(Node *each, void *context)
 {
     log_trace(component, "emitting sequence item");
-    size_t *count = (size_t *)context;
-    if(0 != (*count)++)
+    struct json_items *items = (struct json_items *)context;
+    Writer *output = items->output;
+    if(0 != items->count++)
     {
         EMIT(",");
     }
-    return emit_json_node(each, NULL);
+    return emit_json_node(each, output);
 }
 
-bool emit_json(const nodelist *list)
+bool emit_json(const nodelist *list, Writer *output)
 {
     log_debug(component, "emitting...");
-    size_t count = 0;
-    QEMIT("[");
-    bool result = nodelist_iterate(list, emit_json_sequence_item, &count);
-    QEMIT("]");
-    QEMIT("\n");
+    Emitter emitter = make_json_emitter(output);
+    return emit_nodelist(&emitter, list);
+}
 
-    return result;
+Emitter make_json_emitter(Writer *output)
+{
+    return (Emitter){.start = start_json, .emit = emit_json_item, .finish = finish_json, .output = output};
+}
+
+static bool start_json(Emitter *emitter)
+{
+    Writer *output = emitter->output;
+    EMIT("[");
+    return true;
+}
+
+static bool emit_json_item(Emitter *emitter, Node *each)
+{
+    // N.B. - the count is only advanced once the node has been emitted
+    struct json_items items = {emitter->output, emitter->count};
+    return emit_json_sequence_item(each, &items);
+}
+
+static bool finish_json(Emitter *emitter)
+{
+    Writer *output = emitter->output;
+    EMIT("]\n");
+    return true;
+}
+
+static bool emit_json_raw_scalar(const Scalar *each, Writer *output)
+{
+    return writer_write(output, scalar_value(each), node_size(each));
+}
+
+bool emit_json_string(const uint8_t *value, size_t length, Writer *output)
+{
+    size_t offset = 0;
+    while(true)
+    {
+        // N.B. - the runs between the escapes are copied as they are
+        size_t end = find_escape(value, offset, length);
+        if(!writer_write(output, value + offset, end - offset))
+        {
+            return false;
+        }
+        if(end == length)
+        {
+            return true;
+        }
+        if(!emit_json_escape(value[end], output))
+        {
+            return false;
+        }
+        offset = end + 1;
+    }
+}
+
+/*
+ * Finds the next quote, backslash or control character, which are the only
+ * bytes that must be escaped in a JSON string.  Non-ASCII bytes are copied
+ * as they are, so a mostly clean string is scanned a vector at a time.
+ */
+static inline size_t find_escape(const uint8_t *value, size_t offset, size_t length)
+{
+#ifdef __AVX2__
+    const __m256i wide_quote = _mm256_set1_epi8('"');
+    const __m256i wide_backslash = _mm256_set1_epi8('\\');
+    const __m256i wide_control = _mm256_set1_epi8(0x1F);
+    for(; offset + 32 <= length; offset += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(const void *)(value + offset));
+        // N.B. - there is no unsigned comparison, but a byte is a control character when it is its own minimum with 0x1F
+        __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, wide_quote), _mm256_cmpeq_epi8(chunk, wide_backslash)),
+                                          _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, wide_control), chunk));
+        unsigned int bits = (unsigned int)_mm256_movemask_epi8(special);
+        if(0 != bits)
+        {
+            return offset + (size_t)__builtin_ctz(bits);
+        }
+    }
+#endif
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for(; offset + 16 <= length; offset += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(const void *)(value + offset));
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                       _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+        int bits = _mm_movemask_epi8(special);
+        if(0 != bits)
+        {
+            return offset + (size_t)__builtin_ctz((unsigned int)bits);
+        }
+    }
+#endif
+    for(; offset < length; offset++)
+    {
+        uint8_t current = value[offset];
+        if('"' == current || '\\' == current || 0x20 > current)
+        {
+            break;
+        }
+    }
+    return offset;
 }
 
-static bool emit_json_raw_scalar(const Scalar *each)
+static bool emit_json_escape(uint8_t character, Writer *output)
 {
-    return 1 == fwrite(scalar_value(each), node_size(each), 1, stdout);
+    static const char * const HEX_DIGITS = "0123456789abcdef";
+    char escape[7] = {'\\', (char)character, '\0'};
+    switch(character)
+    {
+        case '"':
+        case '\\':
+            break;
+        case '\b':
+            escape[1] = 'b';
+            break;
+        case '\f':
+            escape[1] = 'f';
+            break;
+        case '\n':
+            escape[1] = 'n';
+            break;
+        case '\r':
+            escape[1] = 'r';
+            break;
+        case '\t':
+            escape[1] = 't';
+            break;
+        default:
+            escape[1] = 'u';
+            escape[2] = '0';
+            escape[3] = '0';
+            escape[4] = HEX_DIGITS[character >> 4];
+            escape[5] = HEX_DIGITS[character & 0xF];
+            break;
+    }
+    return writer_puts(output, escape);
 }
 
-static bool emit_json_quoted_scalar(const Scalar *each)
+static bool emit_json_quoted_scalar(const Scalar *each, Writer *output)
 {
     EMIT("\"");
-    if(!emit_json_raw_scalar(each))
+    if(!emit_json_string(scalar_value(each), node_size(each), output))
     {
         log_error(component, "uh oh! couldn't emit quoted scalar");
         return false;
@@ -100,66 +241,66 @@ static bool emit_json_quoted_scalar(const Scalar *each)
     return true;
 }
 
-static bool emit_json_scalar(const Scalar *each)
+static bool emit_json_scalar(const Scalar *each, Writer *output)
 {
     if(SCALAR_STRING == scalar_kind(each) ||
        SCALAR_TIMESTAMP == scalar_kind(each))
     {
         log_trace(component, "emitting quoted scalar");
-        return emit_json_quoted_scalar(each);
+        return emit_json_quoted_scalar(each, output);
     }
     else
     {
         log_trace(component, "emitting raw scalar");
-        return emit_json_raw_scalar(each);
+        return emit_json_raw_scalar(each, output);
     }
 }
 
 static bool emit_json_mapping_item(Node *key, Node *value, void *context)
 {
     log_trace(component, "emitting mapping item");
-    size_t *count = (size_t *)context;
-    if(0 != (*count)++)
+    struct json_items *items = (struct json_items *)context;
+    Writer *output = items->output;
+    if(0 != items->count++)
     {
         EMIT(",");
     }
-    if(!emit_json_quoted_scalar(scalar(key)))
+    if(!emit_json_quoted_scalar(scalar(key), output))
     {
         return false;
     }
     EMIT(":");
-    return emit_json_node(value, NULL);
+    return emit_json_node(value, output);
 }
 
-static bool emit_json_node(Node *each, void *context __attribute__((unused)))
+bool emit_json_node(Node *each, Writer *output)
 {
     bool result = true;
-    size_t sequence_count = 0;
-    size_t mapping_count = 0;
+    struct json_items items = {output, 0};
     switch(node_kind(each))
     {
         case DOCUMENT:
             log_trace(component, "emitting document");
-            result = emit_json_node(document_root(document(each)), context);
+            result = emit_json_node(document_root(document(each)), output);
             break;
         case SCALAR:
-            result = emit_json_scalar(scalar(each));
+            result = emit_json_scalar(scalar(each), output);
             break;
         case SEQUENCE:
             log_trace(component, "emitting seqence");
             EMIT("[");
-            result = sequence_iterate(sequence(each), emit_json_sequence_item, &sequence_count);
+            result = sequence_iterate(sequence(each), emit_json_sequence_item, &items);
             EMIT("]");
             break;
         case MAPPING:
             log_trace(component, "emitting mapping");
             EMIT("{");
-            result = mapping_iterate(mapping(each), emit_json_mapping_item, &mapping_count);
+            result = mapping_iterate(mapping(each), emit_json_mapping_item, &items);
             EMIT("}");
             break;
         case ALIAS:
             log_trace(component, "resolving alias");
-            result = emit_json_node(alias_target(alias(each)), context);
+            result = emit_json_node(alias_target(alias(each)), output);
             break;
     }
 
@@ -0,0 +1,201 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include <string.h>
+
+#include "emit/msgpack.h"
+#include "emit/binary.h"
+#include "log.h"
+
+
+#define component "msgpack"
+
+
+static bool emit_msgpack_item(Emitter *emitter, Node *each);
+static bool emit_msgpack_length(Writer *output, size_t count, uint8_t fixed, size_t fixed_limit, uint8_t prefix);
+static bool emit_msgpack_array(Writer *output, size_t count);
+static bool emit_msgpack_map(Writer *output, size_t count);
+static bool emit_msgpack_string(Writer *output, const uint8_t *value, size_t length);
+static bool emit_msgpack_integer(Writer *output, int64_t value);
+static bool emit_msgpack_unsigned(Writer *output, uint64_t value);
+static bool emit_msgpack_real(Writer *output, double value);
+static bool emit_msgpack_boolean(Writer *output, bool value);
+static bool emit_msgpack_null(Writer *output);
+
+static const BinaryFormat MSGPACK_FORMAT =
+{
+    .name = component,
+    .array = emit_msgpack_array,
+    .map = emit_msgpack_map,
+    .string = emit_msgpack_string,
+    .integer = emit_msgpack_integer,
+    .unsigned_integer = emit_msgpack_unsigned,
+    .real = emit_msgpack_real,
+    .boolean = emit_msgpack_boolean,
+    .null = emit_msgpack_null
+};
+
+
+bool emit_msgpack(const nodelist *list, Writer *output)
+{
+    log_debug(component, "emitting...");
+    Emitter emitter = make_msgpack_emitter(output);
+    return emit_nodelist(&emitter, list);
+}
+
+/*
+ * The result is a stream of MessagePack values, one for each node, rather
+ * than an array, as the number of nodes isn't known until the last one.
+ */
+Emitter make_msgpack_emitter(Writer *output)
+{
+    return (Emitter){.emit = emit_msgpack_item, .output = output};
+}
+
+static bool emit_msgpack_item(Emitter *emitter, Node *each)
+{
+    return emit_binary_node(&MSGPACK_FORMAT, each, emitter->output);
+}
+
+/*
+ * Arrays, maps and strings share a layout: a fixed form with the length in
+ * the low bits of the type byte, then forms with an 8 (strings only), 16 or
+ * 32 bit length, whose type bytes follow `prefix' in that order.
+ */
+static bool emit_msgpack_length(Writer *output, size_t count, uint8_t fixed, size_t fixed_limit, uint8_t prefix)
+{
+    if(fixed_limit > count)
+    {
+        uint8_t type = (uint8_t)(fixed | count);
+        return writer_write(output, &type, 1);
+    }
+    if(0xD9 == prefix && UINT8_MAX >= count)
+    {
+        return emit_binary_header(output, prefix, count, 1);
+    }
+    if(0xD9 == prefix)
+    {
+        prefix++;
+    }
+    if(UINT16_MAX >= count)
+    {
+        return emit_binary_header(output, prefix, count, 2);
+    }
+    return emit_binary_header(output, (uint8_t)(prefix + 1), count, 4);
+}
+
+static bool emit_msgpack_array(Writer *output, size_t count)
+{
+    return emit_msgpack_length(output, count, 0x90, 16, 0xDC);
+}
+
+static bool emit_msgpack_map(Writer *output, size_t count)
+{
+    return emit_msgpack_length(output, count, 0x80, 16, 0xDE);
+}
+
+static bool emit_msgpack_string(Writer *output, const uint8_t *value, size_t length)
+{
+    return emit_msgpack_length(output, length, 0xA0, 32, 0xD9) && writer_write(output, value, length);
+}
+
+static bool emit_msgpack_integer(Writer *output, int64_t value)
+{
+    if(0 <= value)
+    {
+        return emit_msgpack_unsigned(output, (uint64_t)value);
+    }
+    if(-32 <= value)
+    {
+        uint8_t type = (uint8_t)(int8_t)value;
+        return writer_write(output, &type, 1);
+    }
+    if(INT8_MIN <= value)
+    {
+        return emit_binary_header(output, 0xD0, (uint64_t)value, 1);
+    }
+    if(INT16_MIN <= value)
+    {
+        return emit_binary_header(output, 0xD1, (uint64_t)value, 2);
+    }
+    if(INT32_MIN <= value)
+    {
+        return emit_binary_header(output, 0xD2, (uint64_t)value, 4);
+    }
+    return emit_binary_header(output, 0xD3, (uint64_t)value, 8);
+}
+
+static bool emit_msgpack_unsigned(Writer *output, uint64_t value)
+{
+    if(0x80 > value)
+    {
+        uint8_t type = (uint8_t)value;
+        return writer_write(output, &type, 1);
+    }
+    if(UINT8_MAX >= value)
+    {
+        return emit_binary_header(output, 0xCC, value, 1);
+    }
+    if(UINT16_MAX >= value)
+    {
+        return emit_binary_header(output, 0xCD, value, 2);
+    }
+    if(UINT32_MAX >= value)
+    {
+        return emit_binary_header(output, 0xCE, value, 4);
+    }
+    return emit_binary_header(output, 0xCF, value, 8);
+}
+
+static bool emit_msgpack_real(Writer *output, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return emit_binary_header(output, 0xCB, bits, 8);
+}
+
+static bool emit_msgpack_boolean(Writer *output, bool value)
+{
+    uint8_t type = value ? 0xC3 : 0xC2;
+    return writer_write(output, &type, 1);
+}
+
+static bool emit_msgpack_null(Writer *output)
+{
+    uint8_t type = 0xC0;
+    return writer_write(output, &type, 1);
+}
@@ -0,0 +1,78 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include "emit/ndjson.h"
+#include "emit/json.h"
+#include "log.h"
+
+
+#define component "ndjson"
+
+
+static bool emit_ndjson_item(Emitter *emitter, Node *each);
+
+
+bool emit_ndjson(const nodelist *list, Writer *output)
+{
+    log_debug(component, "emitting...");
+    Emitter emitter = make_ndjson_emitter(output);
+    return emit_nodelist(&emitter, list);
+}
+
+Emitter make_ndjson_emitter(Writer *output)
+{
+    return (Emitter){.emit = emit_ndjson_item, .output = output};
+}
+
+/*
+ * Each node is a compact JSON value on a line of its own, rather than an
+ * item of one array, and it is flushed as soon as it is written, so that a
+ * consumer can start on the first result while the rest are still being
+ * selected.
+ */
+static bool emit_ndjson_item(Emitter *emitter, Node *each)
+{
+    log_trace(component, "emitting line");
+    Writer *output = emitter->output;
+    if(!emit_json_node(each, output) || !writer_puts(output, "\n"))
+    {
+        log_error(component, "uh oh! couldn't emit line");
+        return false;
+    }
+
+    return writer_flush(output);
+}
@@ -0,0 +1,121 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include "emit/raw.h"
+#include "emit/json.h"
+#include "log.h"
+
+
+#define component "raw"
+
+#define EMIT(STR) if(!writer_puts(output, (STR)))                       \
+    {                                                                   \
+        log_error(component, "uh oh! couldn't emit literal %s", (STR)); \
+        return false;                                                   \
+    }
+
+
+static bool start_raw(Emitter *emitter);
+static bool emit_raw_item(Emitter *emitter, Node *each);
+static bool finish_raw(Emitter *emitter);
+static bool emit_raw_node(Node *each, Writer *output, const DocumentModel *model);
+
+
+bool emit_raw(const nodelist *list, Writer *output, const DocumentModel *model)
+{
+    log_debug(component, "emitting...");
+    Emitter emitter = make_raw_emitter(output, model);
+    return emit_nodelist(&emitter, list);
+}
+
+Emitter make_raw_emitter(Writer *output, const DocumentModel *model)
+{
+    // N.B. - the model is only read, the state is just where the emitter keeps it
+    return (Emitter){.start = start_raw, .emit = emit_raw_item, .finish = finish_raw, .state = (void *)model, .output = output};
+}
+
+static bool start_raw(Emitter *emitter)
+{
+    Writer *output = emitter->output;
+    EMIT("[");
+    return true;
+}
+
+static bool emit_raw_item(Emitter *emitter, Node *each)
+{
+    Writer *output = emitter->output;
+    if(0 != emitter->count)
+    {
+        EMIT(",");
+    }
+    return emit_raw_node(each, output, (const DocumentModel *)emitter->state);
+}
+
+static bool finish_raw(Emitter *emitter)
+{
+    Writer *output = emitter->output;
+    EMIT("]\n");
+    return true;
+}
+
+/*
+ * The text of a large container is written from the mapping without being
+ * copied into the writer's buffer, so the cost of a result is the size of
+ * its text, not the number of its nodes.
+ */
+static bool emit_raw_node(Node *each, Writer *output, const DocumentModel *model)
+{
+    if(is_document(each))
+    {
+        return emit_raw_node(document_root(document(each)), output, model);
+    }
+    if(is_alias(each))
+    {
+        return emit_raw_node(alias_target(alias(each)), output, model);
+    }
+
+    SourceSpan span;
+    if(NULL != model && NULL != model->source.data && node_source(each, &span)
+       && span.offset < model->source.length && span.length <= model->source.length - span.offset)
+    {
+        log_trace(component, "copying %zu bytes of %s from the input", span.length, node_kind_name(each));
+        return writer_write(output, model->source.data + span.offset, span.length);
+    }
+
+    log_trace(component, "no source text for %s, emitting it as json", node_kind_name(each));
+    return emit_json_node(each, output);
+}
@@ -37,7 +37,6 @@
 
 
 #include <ctype.h>
-#include <stdio.h>
 
 #include "emit/shell.h"
 #include "log.h"
@@ -58,29 +57,29 @@ bool emit_node(Node *each, void *argument)
     {
         case DOCUMENT:
             log_trace("shell", "emitting document");
-            result = emit_node(document_root(document(each)), NULL);
+            result = emit_node(document_root(document(each)), argument);
             break;
         case SCALAR:
-            result = emit_scalar(scalar(each));
+            result = emit_scalar(scalar(each), context);
             EMIT("\n");
             break;
         case SEQUENCE:
             log_trace("shell", "emitting seqence");
             MAYBE_EMIT("(");
-            result = sequence_iterate(sequence(each), emit_sequence_item, NULL);
+            result = sequence_iterate(sequence(each), emit_sequence_item, context);
             MAYBE_EMIT(")");
             EMIT("\n");
             break;
         case MAPPING:
             log_trace("shell", "emitting mapping");
             MAYBE_EMIT("(");
-            result = mapping_iterate(mapping(each), context->emit_mapping_item, NULL);
+            result = mapping_iterate(mapping(each), context->emit_mapping_item, context);
             MAYBE_EMIT(")");
             EMIT("\n");
             break;
         case ALIAS:
             log_trace("shell", "resolving alias");
-            result = emit_node(alias_target(alias(each)), NULL);
+            result = emit_node(alias_target(alias(each)), argument);
             break;
     }
 
@@ -101,24 +100,24 @@ static bool scalar_contains_space(const Scalar *each)
     return false;
 }
 
-bool emit_scalar(const Scalar *each)
+bool emit_scalar(const Scalar *each, emit_context *context)
 {
     if(SCALAR_STRING == scalar_kind(each) && scalar_contains_space(each))
     {
         log_trace("shell", "emitting quoted scalar");
-        return emit_quoted_scalar(each);
+        return emit_quoted_scalar(each, context);
     }
     else
     {
         log_trace("shell", "emitting raw scalar");
-        return emit_raw_scalar(each);
+        return emit_raw_scalar(each, context);
     }
 }
 
-bool emit_quoted_scalar(const Scalar *each)
+bool emit_quoted_scalar(const Scalar *each, emit_context *context)
 {
     EMIT("'");
-    if(!emit_raw_scalar(each))
+    if(!emit_raw_scalar(each, context))
     {
         log_error("shell", "uh oh! couldn't emit quoted scalar");
         return false;
@@ -128,17 +127,18 @@ bool emit_quoted_scalar(const Scalar *each)
     return true;
 }
 
-bool emit_raw_scalar(const Scalar *each)
+bool emit_raw_scalar(const Scalar *each, emit_context *context)
 {
-    return 1 == fwrite(scalar_value(each), node_size(each), 1, stdout);
+    return writer_write(context->output, scalar_value(each), node_size(each));
 }
 
-bool emit_sequence_item(Node *each, void *context __attribute__((unused)))
+bool emit_sequence_item(Node *each, void *argument)
 {
+    emit_context *context = (emit_context *)argument;
     if(is_scalar(each))
     {
         log_trace("shell", "emitting sequence item");
-        if(!emit_scalar(scalar(each)))
+        if(!emit_scalar(scalar(each), context))
         {
             return false;
         }
@@ -0,0 +1,144 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+
+#include "emit/writer.h"
+#include "log.h"
+#include "conditions.h"
+
+static bool write_vectors(Writer *writer, struct iovec *vectors, int count);
+
+
+Writer *make_writer(int fd)
+{
+    Writer *writer = malloc(sizeof(Writer));
+    if(NULL == writer)
+    {
+        return NULL;
+    }
+    writer->fd = fd;
+    writer->length = 0;
+    writer->failed = false;
+
+    return writer;
+}
+
+void writer_free(Writer *writer)
+{
+    free(writer);
+}
+
+bool writer_write_through(Writer *writer, const uint8_t *data, size_t length)
+{
+    PRECOND_NONNULL_ELSE_FALSE(writer);
+
+    // N.B. - small writes are still buffered, once the buffer has been emptied
+    if(length < WRITER_BUFFER_SIZE / 2)
+    {
+        if(!writer_flush(writer))
+        {
+            return false;
+        }
+        memcpy(writer->buffer, data, length);
+        writer->length = length;
+        return true;
+    }
+
+    struct iovec vectors[] =
+    {
+        {.iov_base = writer->buffer, .iov_len = writer->length},
+        {.iov_base = (void *)data, .iov_len = length}
+    };
+    writer->length = 0;
+    return write_vectors(writer, vectors, 2);
+}
+
+bool writer_flush(Writer *writer)
+{
+    PRECOND_NONNULL_ELSE_FALSE(writer);
+
+    struct iovec vectors[] = {{.iov_base = writer->buffer, .iov_len = writer->length}};
+    writer->length = 0;
+    return write_vectors(writer, vectors, 1);
+}
+
+static bool write_vectors(Writer *writer, struct iovec *vectors, int count)
+{
+    if(writer->failed)
+    {
+        return false;
+    }
+
+    while(0 < count)
+    {
+        if(0 == vectors->iov_len)
+        {
+            vectors++;
+            count--;
+            continue;
+        }
+        ssize_t written = writev(writer->fd, vectors, count);
+        if(-1 == written)
+        {
+            if(EINTR == errno)
+            {
+                continue;
+            }
+            log_error("writer", "uh oh! couldn't write to file descriptor %d: %s", writer->fd, strerror(errno));
+            writer->failed = true;
+            return false;
+        }
+        // N.B. - a short write leaves the rest of the vectors to go again
+        size_t remaining = (size_t)written;
+        while(0 < count && remaining >= vectors->iov_len)
+        {
+            remaining -= vectors->iov_len;
+            vectors++;
+            count--;
+        }
+        if(0 < count)
+        {
+            vectors->iov_base = (uint8_t *)vectors->iov_base + remaining;
+            vectors->iov_len -= remaining;
+        }
+    }
+
+    return true;
+}
@@ -35,7 +35,7 @@
  * [license]: http://www.opensource.org/licenses/ncsa
  */
 
-#include <stdio.h>
+#include <stdlib.h>
 #include <yaml.h>
 
 #include "emit/yaml.h"
@@ -47,6 +47,10 @@
 
 
 static bool emit_node(Node *each, void *context);
+static bool start_yaml(Emitter *self);
+static bool emit_yaml_item(Emitter *self, Node *each);
+static bool finish_yaml(Emitter *self);
+static int write_yaml(void *data, unsigned char *buffer, size_t size);
 
 
 static bool emit_document(Document *value, void *context)
@@ -210,57 +214,78 @@ static bool emit_node(Node *each, void *context)
     return result;
 }
 
-static bool emit_nodelist(const nodelist *list, yaml_emitter_t *emitter)
+static bool emit_event(yaml_emitter_t *emitter, yaml_event_t *event)
 {
-    log_trace(component, "emitting nodelist");
-    yaml_event_t event;
-
-    log_trace(component, "seqence start");
-    yaml_sequence_start_event_initialize(&event, NULL, (yaml_char_t *)YAML_DEFAULT_SEQUENCE_TAG, 1, YAML_BLOCK_SEQUENCE_STYLE);
-    if (!yaml_emitter_emit(emitter, &event))
-        return false;
-
-    if(!nodelist_iterate(list, emit_sequence_item, emitter))
-    {
-        return false;
-    }
+    return 1 == yaml_emitter_emit(emitter, event);
+}
 
-    log_trace(component, "seqence end");
-    yaml_sequence_end_event_initialize(&event);
-    if (!yaml_emitter_emit(emitter, &event))
-        return false;
+bool emit_yaml(const nodelist *list, Writer *output)
+{
+    log_debug(component, "emitting...");
+    Emitter emitter = make_yaml_emitter(output);
+    return emit_nodelist(&emitter, list);
+}
 
-    return true;
+Emitter make_yaml_emitter(Writer *output)
+{
+    return (Emitter){.start = start_yaml, .emit = emit_yaml_item, .finish = finish_yaml, .output = output};
 }
 
-bool emit_yaml(const nodelist *list)
+/*
+ * The result is written as a sequence, in a single document, the libyaml
+ * emitter is kept as the state between the nodes.
+ */
+static bool start_yaml(Emitter *self)
 {
-    log_debug(component, "emitting...");
-    yaml_emitter_t emitter;
+    yaml_emitter_t *emitter = calloc(1, sizeof(yaml_emitter_t));
+    if(NULL == emitter)
+    {
+        return false;
+    }
+    self->state = emitter;
     yaml_event_t event;
-    bool result = true;
 
-    yaml_emitter_initialize(&emitter);
-    yaml_emitter_set_output_file(&emitter, stdout);
-    yaml_emitter_set_unicode(&emitter, 1);
+    yaml_emitter_initialize(emitter);
+    yaml_emitter_set_output(emitter, write_yaml, self->output);
+    yaml_emitter_set_unicode(emitter, 1);
 
     log_trace(component, "stream start");
     yaml_stream_start_event_initialize(&event, YAML_UTF8_ENCODING);
-    if (!yaml_emitter_emit(&emitter, &event))
+    if(!emit_event(emitter, &event))
     {
-        result = false;
-        goto end;
+        return false;
     }
 
     log_trace(component, "document start");
     yaml_document_start_event_initialize(&event, &(yaml_version_directive_t){1, 1}, NULL, NULL, 0);
-    if (!yaml_emitter_emit(&emitter, &event))
+    if(!emit_event(emitter, &event))
     {
-        result = false;
-        goto end;
+        return false;
+    }
+
+    log_trace(component, "seqence start");
+    yaml_sequence_start_event_initialize(&event, NULL, (yaml_char_t *)YAML_DEFAULT_SEQUENCE_TAG, 1, YAML_BLOCK_SEQUENCE_STYLE);
+    return emit_event(emitter, &event);
+}
+
+static bool emit_yaml_item(Emitter *self, Node *each)
+{
+    return emit_sequence_item(each, self->state);
+}
+
+static bool finish_yaml(Emitter *self)
+{
+    yaml_emitter_t *emitter = (yaml_emitter_t *)self->state;
+    if(NULL == emitter)
+    {
+        return false;
     }
+    yaml_event_t event;
+    bool result = true;
 
-    if(!emit_nodelist(list, &emitter))
+    log_trace(component, "seqence end");
+    yaml_sequence_end_event_initialize(&event);
+    if(!emit_event(emitter, &event))
     {
         result = false;
         goto end;
@@ -268,7 +293,7 @@ bool emit_yaml(const nodelist *list)
 
     log_trace(component, "document end");
     yaml_document_end_event_initialize(&event, 1);
-    if (!yaml_emitter_emit(&emitter, &event))
+    if(!emit_event(emitter, &event))
     {
         result = false;
         goto end;
@@ -276,12 +301,19 @@ bool emit_yaml(const nodelist *list)
 
     log_trace(component, "stream end");
     yaml_stream_end_event_initialize(&event);
-    if (!yaml_emitter_emit(&emitter, &event))
+    if(!emit_event(emitter, &event))
     {
         result = false;
     }
 
   end:
-    yaml_emitter_delete(&emitter);
+    yaml_emitter_delete(emitter);
+    free(emitter);
+    self->state = NULL;
     return result;
 }
+
+static int write_yaml(void *data, unsigned char *buffer, size_t size)
+{
+    return writer_write((Writer *)data, buffer, size) ? 1 : 0;
+}
@@ -35,38 +35,49 @@
  * [license]: http://www.opensource.org/licenses/ncsa
  */
 
-#include <stdio.h>
-
 #include "emit/zsh.h"
 #include "emit/shell.h"
 #include "log.h"
 
 static bool emit_mapping_item(Node *key, Node *value, void *context);
+static bool emit_zsh_node(Emitter *emitter, Node *each);
 
-bool emit_zsh(const nodelist *list)
+bool emit_zsh(const nodelist *list, Writer *output)
 {
     log_debug("zsh", "emitting...");
+    Emitter emitter = make_zsh_emitter(output);
+    return emit_nodelist(&emitter, list);
+}
+
+Emitter make_zsh_emitter(Writer *output)
+{
+    return (Emitter){.emit = emit_zsh_node, .output = output};
+}
+
+static bool emit_zsh_node(Emitter *emitter, Node *each)
+{
     emit_context context =
         {
             .emit_mapping_item = emit_mapping_item,
-            .wrap_collections = false
+            .wrap_collections = false,
+            .output = emitter->output
         };
-
-    return nodelist_iterate(list, emit_node, &context);
+    return emit_node(each, &context);
 }
 
-static bool emit_mapping_item(Node *key, Node *value, void * context __attribute__((unused)))
+static bool emit_mapping_item(Node *key, Node *value, void *argument)
 {
+    emit_context *context = (emit_context *)argument;
     if(is_scalar(value))
     {
         log_trace("zsh", "emitting mapping item");
-        if(!emit_scalar(scalar(key)))
+        if(!emit_scalar(scalar(key), context))
         {
             log_error("zsh", "uh oh! couldn't emit mapping key");
             return false;
         }
         EMIT(" ");
-        if(!emit_scalar(scalar(value)))
+        if(!emit_scalar(scalar(value), context))
         {
             log_error("zsh", "uh oh! couldn't emit mapping value");
             return false;
@@ -36,6 +36,7 @@
  */
 
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "evaluator/private.h"
@@ -48,8 +49,31 @@
 #define PRECOND_NONNULL_ELSE_NOTHING(VALUE, CODE) ENSURE_NONNULL(nothing(CODE), EINVAL, (VALUE))
 #define PRECOND_NONZERO_ELSE_NOTHING(VALUE, CODE) ENSURE_THAT(nothing(CODE), EINVAL, 0 != (VALUE))
 
+#define no_batch(CODE) (MaybeBatch){.tag=NOTHING, .nothing={(CODE), evaluator_status_message((CODE))}}
+
+#define PRECOND_ELSE_NO_BATCH(COND, CODE) ENSURE_THAT(no_batch(CODE), EINVAL, (COND))
+#define PRECOND_NONNULL_ELSE_NO_BATCH(VALUE, CODE) ENSURE_NONNULL(no_batch(CODE), EINVAL, (VALUE))
+
 
 MaybeNodelist evaluate(const DocumentModel *model, const jsonpath *path)
+{
+    return evaluate_with_limit(model, path, 0);
+}
+
+MaybeNodelist evaluate_with_limit(const DocumentModel *model, const jsonpath *path, size_t limit)
+{
+    return evaluate_with_threads(model, path, limit, 1);
+}
+
+MaybeNodelist evaluate_with_threads(const DocumentModel *model, const jsonpath *path, size_t limit, size_t threads)
+{
+    evaluator_options options = EVALUATOR_DEFAULTS;
+    options.limit = limit;
+    options.threads = threads;
+    return evaluate_with_options(model, path, &options);
+}
+
+MaybeNodelist evaluate_with_options(const DocumentModel *model, const jsonpath *path, const evaluator_options *options)
 {
     PRECOND_NONNULL_ELSE_NOTHING(model, ERR_MODEL_IS_NULL);
     PRECOND_NONNULL_ELSE_NOTHING(path, ERR_PATH_IS_NULL);
@@ -59,7 +83,7 @@ MaybeNodelist evaluate(const DocumentModel *model, const jsonpath *path)
     PRECOND_NONZERO_ELSE_NOTHING(path_length(path), ERR_PATH_IS_EMPTY);
 
     nodelist *list = NULL;
-    evaluator_status_code code = evaluate_steps(model, path, &list);
+    evaluator_status_code code = evaluate_steps(model, path, options, &list);
     if(EVALUATOR_SUCCESS != code)
     {
         nodelist_free(list);
@@ -67,3 +91,49 @@ MaybeNodelist evaluate(const DocumentModel *model, const jsonpath *path)
     }
     return just(list);
 }
+
+MaybeBatch evaluate_batch(const DocumentModel *model, jsonpath * const *paths, size_t count, const evaluator_options *options)
+{
+    PRECOND_NONNULL_ELSE_NO_BATCH(model, ERR_MODEL_IS_NULL);
+    PRECOND_NONNULL_ELSE_NO_BATCH(paths, ERR_PATH_IS_NULL);
+    PRECOND_NONNULL_ELSE_NO_BATCH(model_document(model, 0), ERR_NO_DOCUMENT_IN_MODEL);
+    PRECOND_NONNULL_ELSE_NO_BATCH(model_document_root(model, 0), ERR_NO_ROOT_IN_DOCUMENT);
+    for(size_t i = 0; i < count; i++)
+    {
+        PRECOND_NONNULL_ELSE_NO_BATCH(paths[i], ERR_PATH_IS_NULL);
+        PRECOND_ELSE_NO_BATCH(ABSOLUTE_PATH == path_kind(paths[i]), ERR_PATH_IS_NOT_ABSOLUTE);
+        PRECOND_ELSE_NO_BATCH(0 != path_length(paths[i]), ERR_PATH_IS_EMPTY);
+    }
+
+    Batch *batch = calloc(1, sizeof(Batch) + count * sizeof(nodelist *));
+    if(NULL == batch)
+    {
+        return no_batch(ERR_EVALUATOR_OUT_OF_MEMORY);
+    }
+    batch->count = count;
+    if(0 == count)
+    {
+        return (MaybeBatch){.tag=JUST, .just=batch};
+    }
+
+    evaluator_status_code code = evaluate_batch_steps(model, paths, count, options, batch->results);
+    if(EVALUATOR_SUCCESS != code)
+    {
+        free(batch);
+        return no_batch(code);
+    }
+    return (MaybeBatch){.tag=JUST, .just=batch};
+}
+
+void batch_free(Batch *batch)
+{
+    if(NULL == batch)
+    {
+        return;
+    }
+    for(size_t i = 0; i < batch->count; i++)
+    {
+        nodelist_free(batch->results[i]);
+    }
+    free(batch);
+}
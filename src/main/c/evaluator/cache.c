@@ -0,0 +1,374 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "evaluator/private.h"
+#include "hashtable.h"
+#include "conditions.h"
+
+/*
+ * The results are keyed by the canonical form of the path and the options
+ * that change which nodes are selected.  Like the path cache, the entries
+ * are kept in a hashtable and in a list from the most to the least recently
+ * used, and the least recently used are evicted until the nodes of the
+ * entries fit in the capacity.  Each entry costs its nodes plus one, so that
+ * even empty results are bounded.
+ */
+
+struct result_entry
+{
+    char                *path;
+    size_t               length;
+    hashcode             hash;
+    size_t               limit;
+    size_t               first_document;
+    size_t               last_document;
+    nodelist            *list;
+    size_t               cost;
+    size_t               hits;
+    struct result_entry *newer;
+    struct result_entry *older;
+};
+
+typedef struct result_entry ResultEntry;
+
+struct result_cache
+{
+    Hashtable   *entries;
+    ResultEntry *newest;
+    ResultEntry *oldest;
+    /** the generation of the model whose results are cached */
+    size_t       generation;
+    size_t       size;
+    size_t       cost;
+    size_t       capacity;
+    size_t       hits;
+    size_t       misses;
+    size_t       evictions;
+};
+
+static ResultEntry *find_entry(ResultCache *cache, const DocumentModel *model, const ResultEntry *probe);
+static bool make_probe(ResultEntry *probe, const jsonpath *path, const evaluator_options *options);
+static hashcode entry_hash(const void *key);
+static bool entry_comparitor(const void *key1, const void *key2);
+static void unlink_entry(ResultCache *cache, ResultEntry *entry);
+static void link_entry(ResultCache *cache, ResultEntry *entry);
+static void evict_oldest(ResultCache *cache);
+
+
+ResultCache *make_result_cache(size_t capacity)
+{
+    ResultCache *cache = calloc(1, sizeof(ResultCache));
+    if(NULL == cache)
+    {
+        return NULL;
+    }
+    cache->entries = make_hashtable_with_function(entry_comparitor, entry_hash);
+    if(NULL == cache->entries)
+    {
+        free(cache);
+        return NULL;
+    }
+    cache->capacity = capacity;
+
+    return cache;
+}
+
+void result_cache_free(ResultCache *cache)
+{
+    if(NULL == cache)
+    {
+        return;
+    }
+    result_cache_clear(cache);
+    hashtable_free(cache->entries);
+    free(cache);
+}
+
+nodelist *result_cache_get(ResultCache *cache, const DocumentModel *model, const jsonpath *path, const evaluator_options *options)
+{
+    PRECOND_NONNULL_ELSE_NULL(cache, model, path, options);
+
+    ResultEntry probe;
+    if(!make_probe(&probe, path, options))
+    {
+        return NULL;
+    }
+    ResultEntry *entry = find_entry(cache, model, &probe);
+    free(probe.path);
+    if(NULL == entry)
+    {
+        cache->misses++;
+        return NULL;
+    }
+
+    cache->hits++;
+    entry->hits++;
+    if(cache->newest != entry)
+    {
+        unlink_entry(cache, entry);
+        link_entry(cache, entry);
+    }
+    return entry->list;
+}
+
+bool result_cache_put(ResultCache *cache, const DocumentModel *model, const jsonpath *path, const evaluator_options *options, nodelist *list)
+{
+    PRECOND_NONNULL_ELSE_FALSE(cache, model, path, options, list);
+
+    size_t cost = nodelist_length(list) + 1;
+    if(cost > cache->capacity)
+    {
+        evaluator_debug("result cache: %zd nodes won't fit in the cache, not keeping them", nodelist_length(list));
+        return false;
+    }
+    ResultEntry *entry = calloc(1, sizeof(ResultEntry));
+    if(NULL == entry)
+    {
+        return false;
+    }
+    if(!make_probe(entry, path, options) || NULL != find_entry(cache, model, entry))
+    {
+        free(entry->path);
+        free(entry);
+        return false;
+    }
+    while(cache->cost + cost > cache->capacity)
+    {
+        evict_oldest(cache);
+    }
+
+    entry->list = list;
+    entry->cost = cost;
+    errno = 0;
+    hashtable_put(cache->entries, entry, entry);
+    if(0 != errno)
+    {
+        free(entry->path);
+        free(entry);
+        return false;
+    }
+    link_entry(cache, entry);
+    cache->size++;
+    cache->cost += cost;
+
+    return true;
+}
+
+void result_cache_clear(ResultCache *cache)
+{
+    if(NULL == cache)
+    {
+        return;
+    }
+    while(NULL != cache->oldest)
+    {
+        evict_oldest(cache);
+    }
+}
+
+void result_cache_resize(ResultCache *cache, size_t capacity)
+{
+    if(NULL == cache)
+    {
+        return;
+    }
+    while(cache->cost > capacity)
+    {
+        evict_oldest(cache);
+    }
+    cache->capacity = capacity;
+}
+
+bool result_cache_iterate(const ResultCache *cache, result_cache_iterator iterator, void *context)
+{
+    PRECOND_NONNULL_ELSE_FALSE(cache, iterator);
+
+    for(const ResultEntry *each = cache->newest; NULL != each; each = each->older)
+    {
+        evaluator_options options = EVALUATOR_DEFAULTS;
+        options.limit = each->limit;
+        options.first_document = each->first_document;
+        options.last_document = each->last_document;
+        if(!iterator(each->path, &options, nodelist_length(each->list), each->hits, context))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t result_cache_size(const ResultCache *cache)
+{
+    PRECOND_NONNULL_ELSE_ZERO(cache);
+    return cache->size;
+}
+
+size_t result_cache_cost(const ResultCache *cache)
+{
+    PRECOND_NONNULL_ELSE_ZERO(cache);
+    return cache->cost;
+}
+
+size_t result_cache_capacity(const ResultCache *cache)
+{
+    PRECOND_NONNULL_ELSE_ZERO(cache);
+    return cache->capacity;
+}
+
+size_t result_cache_hits(const ResultCache *cache)
+{
+    PRECOND_NONNULL_ELSE_ZERO(cache);
+    return cache->hits;
+}
+
+size_t result_cache_misses(const ResultCache *cache)
+{
+    PRECOND_NONNULL_ELSE_ZERO(cache);
+    return cache->misses;
+}
+
+size_t result_cache_evictions(const ResultCache *cache)
+{
+    PRECOND_NONNULL_ELSE_ZERO(cache);
+    return cache->evictions;
+}
+
+/*
+ * N.B. - the results of another model, or of this one before it changed,
+ * are all stale, so they are dropped before looking for a new one
+ */
+static ResultEntry *find_entry(ResultCache *cache, const DocumentModel *model, const ResultEntry *probe)
+{
+    if(cache->generation != model_generation(model))
+    {
+        evaluator_debug("result cache: the model has changed, dropping %zd results", cache->size);
+        result_cache_clear(cache);
+        cache->generation = model_generation(model);
+        return NULL;
+    }
+    return hashtable_get(cache->entries, probe);
+}
+
+static bool make_probe(ResultEntry *probe, const jsonpath *path, const evaluator_options *options)
+{
+    memset(probe, 0, sizeof(ResultEntry));
+    probe->path = path_canonical_form(path);
+    if(NULL == probe->path)
+    {
+        return false;
+    }
+    probe->length = strlen(probe->path);
+    probe->limit = options->limit;
+    probe->first_document = options->first_document;
+    probe->last_document = options->last_document;
+    probe->hash = wyhash_string_buffer_hash((const uint8_t *)probe->path, probe->length)
+        ^ (probe->limit * 31 + probe->first_document * 17 + probe->last_document);
+
+    return true;
+}
+
+static hashcode entry_hash(const void *key)
+{
+    return ((const ResultEntry *)key)->hash;
+}
+
+static bool entry_comparitor(const void *key1, const void *key2)
+{
+    const ResultEntry *one = (const ResultEntry *)key1;
+    const ResultEntry *two = (const ResultEntry *)key2;
+    return one->length == two->length && one->limit == two->limit &&
+        one->first_document == two->first_document && one->last_document == two->last_document &&
+        0 == memcmp(one->path, two->path, one->length);
+}
+
+static void unlink_entry(ResultCache *cache, ResultEntry *entry)
+{
+    if(NULL == entry->newer)
+    {
+        cache->newest = entry->older;
+    }
+    else
+    {
+        entry->newer->older = entry->older;
+    }
+    if(NULL == entry->older)
+    {
+        cache->oldest = entry->newer;
+    }
+    else
+    {
+        entry->older->newer = entry->newer;
+    }
+    entry->newer = NULL;
+    entry->older = NULL;
+}
+
+static void link_entry(ResultCache *cache, ResultEntry *entry)
+{
+    entry->older = cache->newest;
+    entry->newer = NULL;
+    if(NULL != cache->newest)
+    {
+        cache->newest->newer = entry;
+    }
+    cache->newest = entry;
+    if(NULL == cache->oldest)
+    {
+        cache->oldest = entry;
+    }
+}
+
+static void evict_oldest(ResultCache *cache)
+{
+    ResultEntry *entry = cache->oldest;
+    if(NULL == entry)
+    {
+        return;
+    }
+    evaluator_trace("result cache: evicting '%s' (%zd nodes, %zd hits)", entry->path, nodelist_length(entry->list), entry->hits);
+    unlink_entry(cache, entry);
+    hashtable_remove(cache->entries, entry);
+    cache->cost -= entry->cost;
+    cache->size--;
+    cache->evictions++;
+    nodelist_free(entry->list);
+    free(entry->path);
+    free(entry);
+}
@@ -0,0 +1,323 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "evaluator/private.h"
+#include "conditions.h"
+
+struct compiler_context
+{
+    Program *program;
+};
+
+typedef struct compiler_context compiler_context;
+
+struct merger
+{
+    Program        *batch;
+    Program * const *programs;
+    /** the queries that share the branch being merged, reordered so that those sharing its next instruction are together */
+    size_t         *members;
+};
+
+typedef struct merger merger;
+
+static bool compile_step(step *each, void *context);
+static void compile_test(const step *each, Instruction *instruction);
+static void compile_predicate(const predicate *each, Instruction *instruction);
+static void link_program(Program *program);
+static size_t merge_branches(merger *context, size_t first, size_t count, size_t depth);
+static bool same_instruction(const Instruction *one, const Instruction *two);
+static bool same_slice(const predicate *one, const predicate *two);
+
+static const char * const OPCODE_NAMES[] =
+{
+    "ROOT",
+    "NAME",
+    "WILDCARD",
+    "TYPE",
+    "RECURSE_NAME",
+    "RECURSE_WILDCARD",
+    "RECURSE_TYPE",
+    "ALL",
+    "SUBSCRIPT",
+    "SLICE",
+    "JOIN",
+    "HALT"
+};
+
+
+const char *opcode_name(enum opcode value)
+{
+    return OPCODE_NAMES[value];
+}
+
+Program *compile_path(const jsonpath *path)
+{
+    PRECOND_NONNULL_ELSE_NULL(path);
+
+    // N.B. - at most one test and one predicate per step, plus the halt
+    size_t limit = path_length(path) * 2 + 1;
+    Program *program = calloc(1, sizeof(Program) + limit * sizeof(Instruction));
+    if(NULL == program)
+    {
+        evaluator_error("compiler: uh oh! out of memory, can't allocate a program of %zd instructions", limit);
+        return NULL;
+    }
+
+    compiler_context context = {program};
+    path_iterate(path, compile_step, &context);
+    program->instructions[program->length++].opcode = OP_HALT;
+    link_program(program);
+
+    evaluator_debug("compiler: emitted %zd instructions for %zd steps", program->length, path_length(path));
+    return program;
+}
+
+/*
+ * The paths are compiled one at a time and then merged, a level at a time,
+ * by grouping the queries whose next instructions are the same.  The
+ * branches are emitted in the order of the first query in each group.
+ */
+Program *compile_batch(jsonpath * const *paths, size_t count)
+{
+    PRECOND_NONNULL_ELSE_NULL(paths);
+    PRECOND_ELSE_NULL(0 != count);
+
+    Program **programs = calloc(count, sizeof(Program *));
+    size_t *members = calloc(count, sizeof(size_t));
+    Program *batch = NULL;
+    size_t limit = 0;
+    for(size_t i = 0; NULL != programs && NULL != members && i < count; i++)
+    {
+        programs[i] = compile_path(paths[i]);
+        if(NULL == programs[i])
+        {
+            goto cleanup;
+        }
+        members[i] = i;
+        limit += programs[i]->length;
+    }
+    if(NULL == programs || NULL == members)
+    {
+        evaluator_error("compiler: uh oh! out of memory, can't allocate a batch of %zd programs", count);
+        goto cleanup;
+    }
+
+    batch = calloc(1, sizeof(Program) + limit * sizeof(Instruction));
+    if(NULL == batch)
+    {
+        evaluator_error("compiler: uh oh! out of memory, can't allocate a batch of %zd instructions", limit);
+        goto cleanup;
+    }
+    merger context = {batch, programs, members};
+    merge_branches(&context, 0, count, 0);
+    evaluator_debug("compiler: merged %zd instructions for %zd paths into %zd", limit, count, batch->length);
+
+  cleanup:
+    for(size_t i = 0; NULL != programs && i < count; i++)
+    {
+        program_free(programs[i]);
+    }
+    free(programs);
+    free(members);
+    return batch;
+}
+
+void program_free(Program *program)
+{
+    free(program);
+}
+
+static bool compile_step(step *each, void *argument)
+{
+    compiler_context *context = (compiler_context *)argument;
+    Program *program = context->program;
+
+    compile_test(each, &program->instructions[program->length]);
+    evaluator_trace("compiler: %zd: %s", program->length, opcode_name(program->instructions[program->length].opcode));
+    program->length++;
+
+    if(step_has_predicate(each))
+    {
+        compile_predicate(step_predicate(each), &program->instructions[program->length]);
+        evaluator_trace("compiler: %zd: %s", program->length, opcode_name(program->instructions[program->length].opcode));
+        program->length++;
+    }
+    return true;
+}
+
+static void compile_test(const step *each, Instruction *instruction)
+{
+    if(ROOT == step_kind(each))
+    {
+        instruction->opcode = OP_ROOT;
+        return;
+    }
+
+    bool recursive = RECURSIVE == step_kind(each);
+    switch(step_test_kind(each))
+    {
+        case WILDCARD_TEST:
+            instruction->opcode = recursive ? OP_RECURSE_WILDCARD : OP_WILDCARD;
+            break;
+        case TYPE_TEST:
+            instruction->opcode = recursive ? OP_RECURSE_TYPE : OP_TYPE;
+            instruction->operand.type = type_test_step_kind(each);
+            break;
+        case NAME_TEST:
+            instruction->opcode = recursive ? OP_RECURSE_NAME : OP_NAME;
+            instruction->operand.name.value = name_test_step_name(each);
+            instruction->operand.name.length = name_test_step_length(each);
+            instruction->operand.name.hash = mapping_hash_key(instruction->operand.name.value,
+                                                              instruction->operand.name.length);
+            break;
+    }
+}
+
+static void compile_predicate(const predicate *each, Instruction *instruction)
+{
+    switch(predicate_kind(each))
+    {
+        case WILDCARD:
+            instruction->opcode = OP_ALL;
+            break;
+        case SUBSCRIPT:
+            instruction->opcode = OP_SUBSCRIPT;
+            instruction->operand.index = subscript_predicate_index(each);
+            break;
+        case SLICE:
+            instruction->opcode = OP_SLICE;
+            instruction->operand.slice = each;
+            break;
+        case JOIN:
+            instruction->opcode = OP_JOIN;
+            break;
+    }
+}
+
+static void link_program(Program *program)
+{
+    for(size_t i = 0; i < program->length; i++)
+    {
+        Instruction *instruction = &program->instructions[i];
+        instruction->branches = OP_HALT == instruction->opcode ? 0 : 1;
+        instruction->extent = program->length - i;
+    }
+}
+
+static size_t merge_branches(merger *context, size_t first, size_t count, size_t depth)
+{
+    size_t *members = context->members;
+    Program *batch = context->batch;
+    size_t branches = 0;
+
+    for(size_t i = first; i < first + count;)
+    {
+        const Instruction *lead = &context->programs[members[i]]->instructions[depth];
+        size_t end = i + 1;
+        // N.B. - every query keeps its own halt, so that its nodes are collected separately
+        for(size_t j = end; OP_HALT != lead->opcode && j < first + count; j++)
+        {
+            if(same_instruction(lead, &context->programs[members[j]]->instructions[depth]))
+            {
+                size_t member = members[j];
+                memmove(&members[end + 1], &members[end], (j - end) * sizeof(size_t));
+                members[end++] = member;
+            }
+        }
+
+        size_t index = batch->length++;
+        batch->instructions[index] = *lead;
+        if(OP_HALT == lead->opcode)
+        {
+            batch->instructions[index].branches = 0;
+            batch->instructions[index].operand.query = members[i];
+        }
+        else
+        {
+            batch->instructions[index].branches = merge_branches(context, i, end - i, depth + 1);
+        }
+        batch->instructions[index].extent = batch->length - index;
+        evaluator_trace("compiler: %zd: %s, %zd branches shared by %zd paths", index, opcode_name(lead->opcode),
+                        batch->instructions[index].branches, end - i);
+
+        branches++;
+        i = end;
+    }
+    return branches;
+}
+
+static bool same_instruction(const Instruction *one, const Instruction *two)
+{
+    if(one->opcode != two->opcode)
+    {
+        return false;
+    }
+    switch(one->opcode)
+    {
+        case OP_NAME:
+        case OP_RECURSE_NAME:
+            return one->operand.name.hash == two->operand.name.hash &&
+                one->operand.name.length == two->operand.name.length &&
+                0 == memcmp(one->operand.name.value, two->operand.name.value, one->operand.name.length);
+        case OP_TYPE:
+        case OP_RECURSE_TYPE:
+            return one->operand.type == two->operand.type;
+        case OP_SUBSCRIPT:
+            return one->operand.index == two->operand.index;
+        case OP_SLICE:
+            return same_slice(one->operand.slice, two->operand.slice);
+        case OP_JOIN:
+        case OP_HALT:
+            return false;
+        default:
+            return true;
+    }
+}
+
+static bool same_slice(const predicate *one, const predicate *two)
+{
+    return slice_predicate_has_from(one) == slice_predicate_has_from(two) &&
+        slice_predicate_has_to(one) == slice_predicate_has_to(two) &&
+        slice_predicate_has_step(one) == slice_predicate_has_step(two) &&
+        (!slice_predicate_has_from(one) || slice_predicate_from(one) == slice_predicate_from(two)) &&
+        (!slice_predicate_has_to(one) || slice_predicate_to(one) == slice_predicate_to(two)) &&
+        (!slice_predicate_has_step(one) || slice_predicate_step(one) == slice_predicate_step(two));
+}
@@ -57,44 +57,90 @@
 #include "log.h"
 #include "conditions.h"
 
+#if defined(__GNUC__) || defined(__clang__)
+#define USE_COMPUTED_GOTO
+#endif
+
 struct meta_context
 {
     evaluator_context *context;
-    nodelist *target;
+    const Instruction *instruction;
 };
 
 typedef struct meta_context meta_context;
 
-static bool evaluate_step(step* each, void *context);
-static bool evaluate_root_step(evaluator_context *context);
-static bool evaluate_single_step(evaluator_context *context);
-static bool evaluate_recursive_step(evaluator_context *context);
-static bool evaluate_predicate(evaluator_context *context);
+struct piece
+{
+    Node *node;
+    /** when false only the node itself is tested, its children are separate pieces */
+    bool  walk;
+};
+
+typedef struct piece Piece;
+
+struct region;
+
+/* runs the parts of a region numbered `from' up to but not including `to' */
+typedef bool (*region_function)(evaluator_context *context, const struct region *region, size_t from, size_t to);
+
+struct region
+{
+    const Instruction *instruction;
+    region_function    function;
+    /** the parts of a subtree, or NULL when the parts are the documents from `first' on */
+    const Piece       *pieces;
+    size_t             first;
+    size_t             length;
+    size_t             tasks;
+    evaluator_context *results;
+};
+
+typedef struct region Region;
+
+/* enough pieces per thread that an uneven split still keeps every thread busy */
+static const size_t TASKS_PER_THREAD = 16;
+
+static Region document_region(const evaluator_context *context, const evaluator_options *options);
 
-static bool apply_node_test(Node *each, void *argument, nodelist *target);
-static bool apply_recursive_node_test(Node *each, void *argument, nodelist *target);
+static bool execute(evaluator_context *context, const Instruction *instruction, Node *each);
+static inline bool advance(evaluator_context *context, const Instruction *instruction, Node *value);
+
+static bool execute_root(evaluator_context *context, const Instruction *instruction, Node *each);
+static bool execute_name(evaluator_context *context, const Instruction *instruction, Node *each);
+static bool execute_wildcard(evaluator_context *context, const Instruction *instruction, Node *each);
+static bool execute_type(evaluator_context *context, const Instruction *instruction, Node *each);
+static bool execute_recursive(evaluator_context *context, const Instruction *instruction, Node *each);
+static bool execute_all(evaluator_context *context, const Instruction *instruction, Node *each);
+static bool execute_subscript(evaluator_context *context, const Instruction *instruction, Node *each);
+static bool execute_slice(evaluator_context *context, const Instruction *instruction, Node *each);
+static bool execute_join(evaluator_context *context, const Instruction *instruction, Node *each);
+static bool execute_halt(evaluator_context *context, const Instruction *instruction, Node *each);
+
+static bool apply_recursive_test(meta_context *meta, Node *each);
+static bool test_recursive_node(meta_context *meta, Node *each);
 static bool recursive_test_sequence_iterator(Node *each, void *context);
 static bool recursive_test_map_iterator(Node *key, Node *value, void *context);
-static bool apply_greedy_wildcard_test(const Node *each, void *argument, nodelist *target);
-static bool apply_recursive_wildcard_test(const Node *each, void *argument, nodelist *target);
-static bool apply_type_test(const Node *each, void *argument, nodelist *target);
-static bool apply_name_test(const Node *each, void *argument, nodelist *target);
+static bool apply_recursive_wildcard_test(evaluator_context *context, const Instruction *instruction, Node *each);
+static bool type_test_matches(enum type_test_kind kind, const Node *each);
 
-static bool apply_predicate(Node *value, void *argument, nodelist *target);
-static bool apply_wildcard_predicate(const Node *value, evaluator_context *context, nodelist *target);
-static bool apply_subscript_predicate(const Sequence *value, evaluator_context *context, nodelist *target);
-static bool apply_slice_predicate(const Sequence *value, evaluator_context *context, nodelist *target);
-static bool apply_join_predicate(const Node *value, evaluator_context *context, nodelist *target);
+static bool advance_sequence_item_iterator(Node *each, void *context);
+static bool advance_index_value_iterator(Node *value, void *context);
+static bool uses_opcode(const Program *program, enum opcode opcode);
+static const Instruction *splittable_step(const Program *program);
+static bool advance_mapping_value_iterator(Node *key, Node *value, void *context);
+static void normalize_interval(const Sequence *value, const predicate *slice, int *from, int *to, int *step);
 
-static bool add_to_nodelist_sequence_iterator(Node *each, void *context);
-static bool add_values_to_nodelist_map_iterator(Node *key, Node *value, void *context);
-static void normalize_interval(const Sequence *value, predicate *slice, int *from, int *to, int *step);
+static bool execute_parallel_recursive(evaluator_context *context, const Instruction *instruction, Node *each);
+static Piece *split_subtree(Node *start, size_t target, size_t *length);
+static bool split_value_iterator(Node *key, Node *value, void *context);
+static bool split_item_iterator(Node *each, void *context);
+static bool run_region(evaluator_context *context, Region *region);
+static bool run_region_task(size_t index, void *argument);
+static bool run_region_pieces(evaluator_context *context, const Region *region, size_t from, size_t to);
+static bool run_region_documents(evaluator_context *context, const Region *region, size_t from, size_t to);
 
-#define current_step(CONTEXT) path_get((CONTEXT)->path, (CONTEXT)->current_step)
-#define guard(EXPR) EXPR ? true : (context->code = ERR_EVALUATOR_OUT_OF_MEMORY, false)
 
-
-evaluator_status_code evaluate_steps(const DocumentModel *model, const jsonpath *path, nodelist **list)
+evaluator_status_code evaluate_steps(const DocumentModel *model, const jsonpath *path, const evaluator_options *options, nodelist **list)
 {
     evaluator_debug("beginning evaluation of %d steps", path_length(path));
 
@@ -102,21 +148,47 @@ evaluator_status_code evaluate_steps(const DocumentModel *model, const jsonpath
     memset(&context, 0, sizeof(evaluator_context));
 
     *list = NULL;
+    context.program = compile_path(path);
     context.list = make_nodelist();
-    if(NULL == context.list)
+    if(NULL == context.program || NULL == context.list)
     {
-        evaluator_debug("uh oh! out of memory, can't allocate the result nodelist");
+        evaluator_debug("uh oh! out of memory, can't allocate the program or the result nodelist");
+        program_free((Program *)context.program);
+        nodelist_free(context.list);
         return ERR_EVALUATOR_OUT_OF_MEMORY;
     }
 
     context.model = model;
     context.path = path;
+    context.limit = options->limit;
+    context.threads = 0 == options->threads ? 1 : options->threads;
+    if(uses_opcode(context.program, OP_RECURSE_NAME))
+    {
+        // N.B. - the model is only changed to cache its name index, if one is wanted
+        context.names = model_name_index((DocumentModel *)model);
+    }
 
-    nodelist_add(context.list, model_document(model, 0));
-
-    if(!path_iterate(path, evaluate_step, &context))
+    Region documents = document_region(&context, options);
+    bool result = true;
+    if(1 == context.threads || 0 != context.limit)
     {
-        evaluator_error("aborted, step: %d, code: %d (%s)", context.current_step, context.code, evaluator_status_message(context.code));
+        result = run_region_documents(&context, &documents, 0, documents.length);
+    }
+    else if(1 == documents.length)
+    {
+        // N.B. - there is only one document to go around, so share its largest subtree instead
+        context.split = splittable_step(context.program);
+        result = run_region_documents(&context, &documents, 0, documents.length);
+    }
+    else
+    {
+        result = run_region(&context, &documents);
+    }
+    program_free((Program *)context.program);
+    if(!result && !context.done)
+    {
+        evaluator_error("aborted, code: %d (%s)", context.code, evaluator_status_message(context.code));
+        nodelist_free(context.list);
         return context.code;
     }
 
@@ -125,80 +197,416 @@ evaluator_status_code evaluate_steps(const DocumentModel *model, const jsonpath
     return context.code;
 }
 
-static bool evaluate_step(step* each, void *argument)
+/*
+ * A batch shares a single walk of each document among all of its paths, so
+ * it isn't split over threads, and a limit only stops each path from
+ * collecting more nodes, rather than stopping the walk.
+ */
+evaluator_status_code evaluate_batch_steps(const DocumentModel *model, jsonpath * const *paths, size_t count, const evaluator_options *options, nodelist **lists)
+{
+    evaluator_debug("beginning evaluation of a batch of %zd paths", count);
+
+    evaluator_context context;
+    memset(&context, 0, sizeof(evaluator_context));
+    memset(lists, 0, count * sizeof(nodelist *));
+
+    context.program = compile_batch(paths, count);
+    bool result = NULL != context.program;
+    for(size_t i = 0; result && i < count; i++)
+    {
+        lists[i] = make_nodelist();
+        result = NULL != lists[i];
+    }
+    if(!result)
+    {
+        evaluator_debug("uh oh! out of memory, can't allocate the program or the result nodelists");
+        context.code = ERR_EVALUATOR_OUT_OF_MEMORY;
+        goto cleanup;
+    }
+
+    context.model = model;
+    context.lists = lists;
+    context.limit = options->limit;
+    context.threads = 1;
+    if(uses_opcode(context.program, OP_RECURSE_NAME))
+    {
+        // N.B. - the model is only changed to cache its name index, if one is wanted
+        context.names = model_name_index((DocumentModel *)model);
+    }
+
+    Region documents = document_region(&context, options);
+    result = run_region_documents(&context, &documents, 0, documents.length);
+    if(!result)
+    {
+        evaluator_error("aborted, code: %d (%s)", context.code, evaluator_status_message(context.code));
+    }
+
+  cleanup:
+    program_free((Program *)context.program);
+    for(size_t i = 0; !result && i < count; i++)
+    {
+        nodelist_free(lists[i]);
+        lists[i] = NULL;
+    }
+    return context.code;
+}
+
+static Region document_region(const evaluator_context *context, const evaluator_options *options)
 {
-    evaluator_context *context = (evaluator_context *)argument;
-    evaluator_trace("step: %zd", context->current_step);
+    const DocumentModel *model = context->model;
+    size_t last = options->last_document < model_size(model) ? options->last_document : model_size(model);
+    size_t first = options->first_document < last ? options->first_document : last;
+    evaluator_debug("evaluating documents %zd to %zd of %zd", first, last, model_size(model));
 
+    return (Region){context->program->instructions, run_region_documents, NULL, first, last - first, 0, NULL};
+}
+
+/*
+ * Interpreter
+ * ===========
+ *
+ * Evaluation is a depth-first pipeline: every node selected by an
+ * instruction is handed straight to the next instruction, and only the
+ * nodes that reach `OP_HALT' are collected.  No intermediate nodelists are
+ * built, so the working set is bounded by the path length rather than by
+ * the width of the document.  Since each instruction maps its input in
+ * order, the results are in the same order as a step-at-a-time evaluation.
+ *
+ * When a limit is given, `OP_HALT' marks the context done once it has
+ * been reached and returns false, which unwinds every iterator without
+ * visiting the rest of the document.
+ *
+ * The program of a batch is a trie, and a node selected by an instruction
+ * is handed to each of its branches in turn.  Since every branch maps its
+ * input in order, the results of each path are still in the same order as
+ * an evaluation of that path alone.
+ */
+
+#ifdef USE_COMPUTED_GOTO
+#define DISPATCH() goto *dispatch_table[instruction->opcode];
+#define CASE(OPCODE) do_##OPCODE
+#else
+#define DISPATCH() switch(instruction->opcode)
+#define CASE(OPCODE) case OPCODE
+#endif
+
+static bool execute(evaluator_context *context, const Instruction *instruction, Node *each)
+{
+#ifdef USE_COMPUTED_GOTO
+    static const void * const dispatch_table[] =
+    {
+        [OP_ROOT]             = &&do_OP_ROOT,
+        [OP_NAME]             = &&do_OP_NAME,
+        [OP_WILDCARD]         = &&do_OP_WILDCARD,
+        [OP_TYPE]             = &&do_OP_TYPE,
+        [OP_RECURSE_NAME]     = &&do_OP_RECURSE_NAME,
+        [OP_RECURSE_WILDCARD] = &&do_OP_RECURSE_WILDCARD,
+        [OP_RECURSE_TYPE]     = &&do_OP_RECURSE_TYPE,
+        [OP_ALL]              = &&do_OP_ALL,
+        [OP_SUBSCRIPT]        = &&do_OP_SUBSCRIPT,
+        [OP_SLICE]            = &&do_OP_SLICE,
+        [OP_JOIN]             = &&do_OP_JOIN,
+        [OP_HALT]             = &&do_OP_HALT
+    };
+#endif
+    DISPATCH()
+    {
+        CASE(OP_ROOT):
+            return execute_root(context, instruction, each);
+        CASE(OP_NAME):
+            return execute_name(context, instruction, each);
+        CASE(OP_WILDCARD):
+            return execute_wildcard(context, instruction, each);
+        CASE(OP_TYPE):
+            return execute_type(context, instruction, each);
+        CASE(OP_RECURSE_NAME):
+        CASE(OP_RECURSE_WILDCARD):
+        CASE(OP_RECURSE_TYPE):
+            return execute_recursive(context, instruction, each);
+        CASE(OP_ALL):
+            return execute_all(context, instruction, each);
+        CASE(OP_SUBSCRIPT):
+            return execute_subscript(context, instruction, each);
+        CASE(OP_SLICE):
+            return execute_slice(context, instruction, each);
+        CASE(OP_JOIN):
+            return execute_join(context, instruction, each);
+        CASE(OP_HALT):
+            return execute_halt(context, instruction, each);
+    }
+    return true;
+}
+
+static inline bool advance(evaluator_context *context, const Instruction *instruction, Node *value)
+{
+    const Instruction *next = instruction + 1;
+    if(1 == instruction->branches)
+    {
+        return execute(context, next, value);
+    }
+    for(size_t i = 0; i < instruction->branches; i++, next += next->extent)
+    {
+        if(!execute(context, next, value))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool execute_root(evaluator_context *context, const Instruction *instruction, Node *each)
+{
+    Node *root = document_root(document(each));
+    evaluator_trace("root test: adding root node (%p) from document (%p)", root, each);
+    return advance(context, instruction, root);
+}
+
+static bool execute_name(evaluator_context *context, const Instruction *instruction, Node *each)
+{
+    if(!is_mapping(each))
+    {
+        evaluator_trace("name test: node is not a mapping type, cannot use a key on it (kind: %d), dropping (%p)", node_kind(each), each);
+        return true;
+    }
+    Node *value = mapping_get_with_hash(mapping(each), instruction->operand.name.hash,
+                                        instruction->operand.name.value, instruction->operand.name.length);
+    if(NULL == value)
+    {
+        trace_string("name test: key '%s' not found in mapping, dropping (%p)",
+                     instruction->operand.name.value, instruction->operand.name.length, each);
+        return true;
+    }
+    evaluator_trace("name test: match! adding node (%p)", value);
+    if(is_alias(value))
+    {
+        evaluator_trace("name test: resolved alias from: (%p) to: (%p)",
+                        value, alias_target(alias(value)));
+        value = alias_target(alias(value));
+    }
+    return advance(context, instruction, value);
+}
+
+static bool execute_wildcard(evaluator_context *context, const Instruction *instruction, Node *each)
+{
     bool result = false;
-    switch(step_kind(each))
+    switch(node_kind(each))
     {
-        case ROOT:
-            result = evaluate_root_step(context);
+        case MAPPING:
+            evaluator_trace("wildcard test: adding %zd mapping values (%p)",
+                            node_size(each), each);
+            result = mapping_iterate(mapping(each), advance_mapping_value_iterator,
+                                     &(meta_context){context, instruction});
             break;
-        case SINGLE:
-            result = evaluate_single_step(context);
+        case SEQUENCE:
+            evaluator_trace("wildcard test: adding %zd sequence items (%p)",
+                            node_size(each), each);
+            result = sequence_iterate(sequence(each), advance_sequence_item_iterator,
+                                      &(meta_context){context, instruction});
             break;
-        case RECURSIVE:
-            result = evaluate_recursive_step(context);
+        case SCALAR:
+            trace_string("wildcard test: adding scalar: '%s' (%p)",
+                         scalar_value(scalar(each)), node_size(each), each);
+            result = advance(context, instruction, each);
+            break;
+        case DOCUMENT:
+            evaluator_error("wildcard test: uh-oh! found a document node somehow (%p), aborting...", each);
+            context->code = ERR_UNEXPECTED_DOCUMENT_NODE;
+            break;
+        case ALIAS:
+            evaluator_trace("wildcard test: resolving alias (%p)", each);
+            result = execute_wildcard(context, instruction, alias_target(alias(each)));
             break;
     }
-    if(result && step_has_predicate(current_step(context)))
+    return result;
+}
+
+static bool execute_type(evaluator_context *context, const Instruction *instruction, Node *each)
+{
+    if(is_alias(each))
     {
-        result = evaluate_predicate(context);
+        evaluator_trace("type test: resolved alias from: (%p) to: (%p)",
+                        each, alias_target(alias(each)));
+        return execute_type(context, instruction, alias_target(alias(each)));
     }
-    if(result)
+    if(type_test_matches(instruction->operand.type, each))
     {
-        context->current_step++;
+        evaluator_trace("type test: match! adding node (%p)", each);
+        return advance(context, instruction, each);
+    }
+    else
+    {
+        const char *name = is_scalar(each) ? scalar_kind_name(scalar(each)) : node_kind_name(each);
+        evaluator_trace("type test: no match (actual: %s). dropping (%p)", name, each);
+        return true;
     }
-    return result;
 }
 
-static bool evaluate_root_step(evaluator_context *context)
+static bool execute_recursive(evaluator_context *context, const Instruction *instruction, Node *each)
 {
-    evaluator_trace("evaluating root step");
-    Document *doc = nodelist_get(context->list, 0);
-    Node *root = document_root(doc);
-    evaluator_trace("root test: adding root node (%p) from document (%p)", root, doc);
-    return nodelist_set(context->list, root, 0);
+    if(OP_RECURSE_NAME == instruction->opcode && NULL != context->names && name_index_covers(context->names, each))
+    {
+        trace_string("recursive step: looking up key '%s' in the name index", instruction->operand.name.value, instruction->operand.name.length);
+        return name_index_lookup(context->names, each,
+                                 instruction->operand.name.value, instruction->operand.name.length,
+                                 instruction->operand.name.hash,
+                                 advance_index_value_iterator, &(meta_context){context, instruction});
+    }
+    // N.B. - a limited query stops at its first matches, so it is never worth splitting up
+    if(instruction == context->split && 0 == context->limit)
+    {
+        return execute_parallel_recursive(context, instruction, each);
+    }
+    return apply_recursive_test(&(meta_context){context, instruction}, each);
 }
 
-#define evaluate_nodelist(NAME, TEST, FUNCTION)                         \
-    evaluator_trace("evaluating %s across %zd nodes", (NAME), nodelist_length(context->list)); \
-    nodelist *result = nodelist_map(context->list, (FUNCTION), context); \
-    evaluator_trace("%s: %s", (TEST), NULL == result ? "failed" : "completed"); \
-    evaluator_trace("%s: added %zd nodes", (NAME), nodelist_length(result)); \
-    return NULL == result ? false : (nodelist_free(context->list), context->list = result, true);
+static bool execute_all(evaluator_context *context, const Instruction *instruction, Node *each)
+{
+    bool result = false;
+    switch(node_kind(each))
+    {
+        case SCALAR:
+            trace_string("wildcard predicate: adding scalar '%s' (%p)",
+                         scalar_value(scalar(each)), node_size(each), each);
+            result = advance(context, instruction, each);
+            break;
+        case MAPPING:
+            evaluator_trace("wildcard predicate: adding mapping (%p)", each);
+            result = advance(context, instruction, each);
+            break;
+        case SEQUENCE:
+            evaluator_trace("wildcard predicate: adding %zd sequence (%p) items",
+                            node_size(each), each);
+            result = sequence_iterate(sequence(each), advance_sequence_item_iterator,
+                                      &(meta_context){context, instruction});
+            break;
+        case DOCUMENT:
+            evaluator_error("wildcard predicate: uh-oh! found a document node (%p), aborting...", each);
+            context->code = ERR_UNEXPECTED_DOCUMENT_NODE;
+            break;
+        case ALIAS:
+            evaluator_trace("wildcard predicate: resolving alias (%p)", each);
+            result = execute_all(context, instruction, alias_target(alias(each)));
+            break;
+    }
+    return result;
+}
 
-static bool evaluate_recursive_step(evaluator_context *context)
+static bool execute_subscript(evaluator_context *context, const Instruction *instruction, Node *each)
 {
-    evaluate_nodelist("recursive step",
-                      test_kind_name(step_test_kind(current_step(context))),
-                      apply_recursive_node_test);
+    size_t index = instruction->operand.index;
+    if(!is_sequence(each))
+    {
+        evaluator_trace("subscript predicate: node is not a sequence type, cannot use an index on it (kind: %d), dropping (%p)", node_kind(each), each);
+        return true;
+    }
+    if(index >= node_size(each))
+    {
+        evaluator_trace("subscript predicate: index %zd not valid for sequence (length: %zd), dropping (%p)",
+                        index, node_size(each), each);
+        return true;
+    }
+    Node *selected = sequence_get(sequence(each), index);
+    evaluator_trace("subscript predicate: adding index %zd (%p) from sequence (%p) of %zd items",
+                    index, selected, each, node_size(each));
+    return advance(context, instruction, selected);
 }
 
-static bool evaluate_single_step(evaluator_context *context)
+static bool execute_slice(evaluator_context *context, const Instruction *instruction, Node *each)
 {
-    evaluate_nodelist("step",
-                      test_kind_name(step_test_kind(current_step(context))),
-                      apply_node_test);
+    if(!is_sequence(each))
+    {
+        evaluator_trace("slice predicate: node is not a sequence type, cannot use a slice on it (kind: %d), dropping (%p)", node_kind(each), each);
+        return true;
+    }
+    const Sequence *value = sequence(each);
+    int from = 0, to = 0, increment = 0;
+    normalize_interval(value, instruction->operand.slice, &from, &to, &increment);
+    evaluator_trace("slice predicate: using normalized interval [%d:%d:%d]", from, to, increment);
+
+    for(int i = from; 0 > increment ? i >= to : i < to; i += increment)
+    {
+        Node *selected = sequence_get(value, (size_t)i);
+        evaluator_trace("slice predicate: adding index: %d (%p)", i, selected);
+        if(!advance(context, instruction, selected))
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
-static bool evaluate_predicate(evaluator_context *context)
+static bool execute_join(evaluator_context *context, const Instruction *instruction __attribute__((unused)), Node *each __attribute__((unused)))
 {
-    evaluate_nodelist("predicate",
-                      predicate_kind_name(predicate_kind(step_predicate(current_step(context)))),
-                      apply_predicate);
+    evaluator_trace("join predicate: evaluating axes (_, _)");
+
+    // xxx - implement me!
+    evaluator_error("join predicate: uh-oh! not implemented yet, aborting...");
+    context->code = ERR_UNSUPPORTED_PATH;
+    return false;
 }
 
-static bool apply_recursive_node_test(Node *each, void *argument, nodelist *target)
+static bool execute_halt(evaluator_context *context, const Instruction *instruction, Node *each)
 {
-    evaluator_context *context = (evaluator_context *)argument;
-    bool result = true;
-    if(!is_alias(each))
+    if(NULL != context->lists)
     {
-        result = apply_node_test(each, argument, target);
+        nodelist *list = context->lists[instruction->operand.query];
+        if(0 != context->limit && context->limit == nodelist_length(list))
+        {
+            evaluator_trace("halt: limit of %zd nodes reached for query %zd, dropping (%p)", context->limit, instruction->operand.query, each);
+            return true;
+        }
+        evaluator_trace("halt: adding result node (%p) for query %zd", each, instruction->operand.query);
+        if(!nodelist_add(list, each))
+        {
+            evaluator_error("halt: uh oh! out of memory, aborting...");
+            context->code = ERR_EVALUATOR_OUT_OF_MEMORY;
+            return false;
+        }
+        return true;
+    }
+
+    evaluator_trace("halt: adding result node (%p)", each);
+    if(!nodelist_add(context->list, each))
+    {
+        evaluator_error("halt: uh oh! out of memory, aborting...");
+        context->code = ERR_EVALUATOR_OUT_OF_MEMORY;
+        return false;
     }
+    if(0 != context->limit && context->limit == nodelist_length(context->list))
+    {
+        evaluator_debug("halt: limit of %zd nodes reached, stopping", context->limit);
+        context->done = true;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Recursive Tests
+ * ===============
+ */
+
+static bool test_recursive_node(meta_context *meta, Node *each)
+{
+    if(is_alias(each))
+    {
+        return true;
+    }
+    switch(meta->instruction->opcode)
+    {
+        case OP_RECURSE_NAME:
+            return execute_name(meta->context, meta->instruction, each);
+        case OP_RECURSE_TYPE:
+            return execute_type(meta->context, meta->instruction, each);
+        default:
+            return apply_recursive_wildcard_test(meta->context, meta->instruction, each);
+    }
+}
+
+static bool apply_recursive_test(meta_context *meta, Node *each)
+{
+    evaluator_context *context = meta->context;
+    bool result = test_recursive_node(meta, each);
     if(result)
     {
         switch(node_kind(each))
@@ -206,15 +614,12 @@ static bool apply_recursive_node_test(Node *each, void *argument, nodelist *targ
             case MAPPING:
                 evaluator_trace("recursive step: processing %zd mapping values (%p)",
                                 node_size(each), each);
-                result = mapping_iterate(mapping(each), recursive_test_map_iterator,
-
-&(meta_context){context, target});
+                result = mapping_iterate(mapping(each), recursive_test_map_iterator, meta);
                 break;
             case SEQUENCE:
                 evaluator_trace("recursive step: processing %zd sequence items (%p)",
                                 node_size(each), each);
-                result = sequence_iterate(sequence(each), recursive_test_sequence_iterator,
-                                          &(meta_context){context, target});
+                result = sequence_iterate(sequence(each), recursive_test_sequence_iterator, meta);
                 break;
             case SCALAR:
                 evaluator_trace("recursive step: found scalar, recursion finished on this path (%p)", each);
@@ -227,7 +632,7 @@ static bool apply_recursive_node_test(Node *each, void *argument, nodelist *targ
                 break;
             case ALIAS:
                 evaluator_trace("recursive step: resolving alias (%p)", each);
-                result = apply_recursive_node_test(alias_target(alias(each)), argument, target);
+                result = apply_recursive_test(meta, alias_target(alias(each)));
                 break;
         }
     }
@@ -237,97 +642,31 @@ static bool apply_recursive_node_test(Node *each, void *argument, nodelist *targ
 
 static bool recursive_test_sequence_iterator(Node *each, void *context)
 {
-    meta_context *iterator_context = (meta_context *)context;
-    return apply_recursive_node_test(each, iterator_context->context, iterator_context->target);
+    return apply_recursive_test((meta_context *)context, each);
 }
 
 static bool recursive_test_map_iterator(Node *key __attribute__((unused)), Node *value, void *context)
 {
-    meta_context *iterator_context = (meta_context *)context;
-    return apply_recursive_node_test(value, iterator_context->context, iterator_context->target);
-}
-
-static bool apply_node_test(Node *each, void *argument, nodelist *target)
-{
-    bool result = false;
-    evaluator_context *context = (evaluator_context *)argument;
-    switch(step_test_kind(current_step(context)))
-    {
-        case WILDCARD_TEST:
-            if(RECURSIVE == step_kind(current_step(context)))
-            {
-                result = apply_recursive_wildcard_test(each, argument, target);
-            }
-            else
-            {
-                result = apply_greedy_wildcard_test(each, argument, target);
-            }
-            break;
-        case TYPE_TEST:
-            result = apply_type_test(each, argument, target);
-            break;
-        case NAME_TEST:
-            result = apply_name_test(each, argument, target);
-            break;
-    }
-    return result;
-}
-
-static bool apply_greedy_wildcard_test(const Node *each, void *argument, nodelist *target)
-{
-    evaluator_context *context = (evaluator_context *)argument;
-    bool result = false;
-    switch(node_kind(each))
-    {
-        case MAPPING:
-            evaluator_trace("wildcard test: adding %zd mapping values (%p)",
-                            node_size(each), each);
-            result = guard(mapping_iterate(mapping((Node *)each),
-                                           add_values_to_nodelist_map_iterator,
-                                           &(meta_context){context, target}));
-            break;
-        case SEQUENCE:
-            evaluator_trace("wildcard test: adding %zd sequence items (%p)",
-                            node_size(each), each);
-            result = guard(sequence_iterate(sequence((Node *)each),
-                                            add_to_nodelist_sequence_iterator,
-                                            target));
-            break;
-        case SCALAR:
-            trace_string("wildcard test: adding scalar: '%s' (%p)",
-                         scalar_value(scalar((Node *)each)), node_size(each), each);
-            result = guard(nodelist_add(target, each));
-            break;
-        case DOCUMENT:
-            evaluator_error("wildcard test: uh-oh! found a document node somehow (%p), aborting...", each);
-            context->code = ERR_UNEXPECTED_DOCUMENT_NODE;
-            break;
-        case ALIAS:
-            evaluator_trace("wildcard test: resolving alias (%p)", each);
-            result = apply_greedy_wildcard_test(alias_target(alias((Node *)each)), argument, target);
-            break;
-    }
-    return result;
+    return apply_recursive_test((meta_context *)context, value);
 }
 
-static bool apply_recursive_wildcard_test(const Node *each, void *argument, nodelist *target)
+static bool apply_recursive_wildcard_test(evaluator_context *context, const Instruction *instruction, Node *each)
 {
-    evaluator_context *context = (evaluator_context *)argument;
     bool result = false;
     switch(node_kind(each))
     {
         case MAPPING:
             evaluator_trace("recurisve wildcard test: adding mapping node (%p)", each);
-            result = guard(nodelist_add(target, each));
+            result = advance(context, instruction, each);
             break;
         case SEQUENCE:
             evaluator_trace("recurisve wildcard test: adding sequence node (%p)", each);
-            result = guard(nodelist_add(target, each));
+            result = advance(context, instruction, each);
             break;
         case SCALAR:
             trace_string("recurisve wildcard test: adding scalar: '%s' (%p)",
-                         scalar_value(scalar((Node *)each)), node_size(each), each);
-            result = guard(nodelist_add(target, each));
+                         scalar_value(scalar(each)), node_size(each), each);
+            result = advance(context, instruction, each);
             break;
         case DOCUMENT:
             evaluator_error("recurisve wildcard test: uh oh! found a document node somehow (%p), aborting...", each);
@@ -335,210 +674,263 @@ static bool apply_recursive_wildcard_test(const Node *each, void *argument, node
             break;
         case ALIAS:
             evaluator_trace("recurisve wildcard test: resolving alias (%p)", each);
-            result = apply_recursive_wildcard_test(alias_target(alias((Node *)each)), argument, target);
+            result = apply_recursive_wildcard_test(context, instruction, alias_target(alias(each)));
             break;
     }
     return result;
 }
 
-static bool apply_type_test(const Node *each, void *argument, nodelist *target)
+static bool type_test_matches(enum type_test_kind kind, const Node *each)
 {
     bool match = false;
-    if(is_alias(each))
-    {
-        evaluator_trace("type test: resolved alias from: (%p) to: (%p)",
-                        each, alias_target((alias((Node *)each))));
-        return apply_type_test(alias_target(alias((Node *)each)), argument, target);
-    }
-    evaluator_context *context = (evaluator_context *)argument;
-    switch(type_test_step_kind(current_step(context)))
+    switch(kind)
     {
         case OBJECT_TEST:
-            evaluator_trace("type test: testing for an object");
             match = is_mapping(each);
             break;
         case ARRAY_TEST:
-            evaluator_trace("type test: testing for an array");
             match = is_sequence(each);
             break;
         case STRING_TEST:
-            evaluator_trace("type test: testing for a string");
             match = is_string((Node *)each);
             break;
         case NUMBER_TEST:
-            evaluator_trace("type test: testing for a number");
             match = is_number((Node *)each);
             break;
         case BOOLEAN_TEST:
-            evaluator_trace("type test: testing for a boolean");
             match = is_boolean((Node *)each);
             break;
         case NULL_TEST:
-            evaluator_trace("type test: testing for a null");
             match = is_null((Node *)each);
             break;
     }
-    if(match)
-    {
-        evaluator_trace("type test: match! adding node (%p)", each);
-        return nodelist_add(target, each) ? true : (context->code = ERR_EVALUATOR_OUT_OF_MEMORY, false);
-    }
-    else
+    return match;
+}
+
+/*
+ * Parallel Evaluation
+ * ===================
+ *
+ * Work is shared among the threads as a region: a sequence of independent
+ * parts whose results, concatenated in order, are the results of running
+ * the parts in turn.  Runs of consecutive parts become tasks, each
+ * collecting its results in its own nodelist, and the nodelists are
+ * appended in task order once every task is done, which restores the
+ * stream order.  The documents of a stream are one such region.
+ *
+ * A recursive walk tests its start node and then walks the subtree of each
+ * child in turn, so a walk of a container can be replaced by a test of the
+ * container followed by walks of its children without changing which nodes
+ * are visited, or their order.  The start node is split like this, a level
+ * at a time, into a sequence of pieces until there are enough to keep every
+ * thread busy, and the pieces are another region.
+ */
+
+static bool execute_parallel_recursive(evaluator_context *context, const Instruction *instruction, Node *each)
+{
+    size_t length = 0;
+    size_t target = context->threads * TASKS_PER_THREAD;
+    Piece *pieces = split_subtree(each, target, &length);
+    if(NULL == pieces)
     {
-        const char *name = is_scalar(each) ? scalar_kind_name(scalar((Node *)each)) : node_kind_name(each);
-        evaluator_trace("type test: no match (actual: %d). dropping (%p)", name, each);
-        return true;
+        evaluator_debug("parallel: unable to split the subtree (%p), walking it instead", each);
+        return apply_recursive_test(&(meta_context){context, instruction}, each);
     }
+
+    // N.B. - a subtree that ran out of containers before there was a piece for every thread is too small to share
+    Region region = {instruction, run_region_pieces, pieces, 0, length, 0, NULL};
+    bool result = length < context->threads
+        ? run_region_pieces(context, &region, 0, length)
+        : run_region(context, &region);
+    free(pieces);
+    return result;
 }
 
-static bool apply_name_test(const Node *each, void *argument, nodelist *target)
+struct splitter
 {
-    evaluator_context *context = (evaluator_context *)argument;
-    step *context_step = current_step(context);
-    trace_string("name test: using key '%s'", name_test_step_name(context_step), name_test_step_length(context_step));
+    Piece  *pieces;
+    size_t  length;
+};
 
-    if(!is_mapping(each))
-    {
-        evaluator_trace("name test: node is not a mapping type, cannot use a key on it (kind: %d), dropping (%p)", node_kind(each), each);
-        return true;
-    }
-    Mapping *map = mapping((Node *)each);
-    Node *value = mapping_get(map, name_test_step_name(context_step), name_test_step_length(context_step));
-    if(NULL == value)
+static Piece *split_subtree(Node *start, size_t target, size_t *length)
+{
+    Piece *pieces = malloc(sizeof(Piece));
+    if(NULL == pieces)
     {
-        evaluator_trace("name test: key not found in mapping, dropping (%p)", each);
-        return true;
+        return NULL;
     }
-    evaluator_trace("name test: match! adding node (%p)", value);
-    if(is_alias(value))
-    {
-        evaluator_trace("name test: resolved alias from: (%p) to: (%p)",
-                        value, alias_target(alias((Node *)value)));
-        value = alias_target(alias((Node *)value));
-    }
-    return nodelist_add(target, value) ? true : (context->code = ERR_EVALUATOR_OUT_OF_MEMORY, false);
-}
+    pieces[0] = (Piece){start, true};
+    size_t count = 1;
 
-static bool apply_predicate(Node *each, void *argument, nodelist *target)
-{
-    evaluator_context *context = (evaluator_context *)argument;
-    bool result = false;
-    switch(predicate_kind(step_predicate(current_step(context))))
+    while(count < target)
     {
-        case WILDCARD:
-            evaluator_trace("evaluating wildcard predicate");
-            result = apply_wildcard_predicate(each, context, target);
-            break;
-        case SUBSCRIPT:
-            evaluator_trace("evaluating subscript predicate");
-            if(!is_sequence(each))
+        size_t needed = 0;
+        bool splittable = false;
+        for(size_t i = 0; i < count; i++)
+        {
+            Node *each = pieces[i].node;
+            if(pieces[i].walk && (is_mapping(each) || is_sequence(each)))
             {
-                evaluator_trace("subscript predicate: node is not a sequence type, cannot use an index on it (kind: %d), dropping (%p)", node_kind(each), each);
-                result = true;
+                needed += 1 + node_size(each);
+                splittable = true;
             }
             else
             {
-                result = apply_subscript_predicate(sequence(each), context, target);
+                needed++;
             }
+        }
+        if(!splittable)
+        {
             break;
-        case SLICE:
-            evaluator_trace("evaluating slice predicate");
-            if(!is_sequence(each))
+        }
+
+        struct splitter next = {malloc(needed * sizeof(Piece)), 0};
+        if(NULL == next.pieces)
+        {
+            free(pieces);
+            return NULL;
+        }
+        for(size_t i = 0; i < count; i++)
+        {
+            Node *each = pieces[i].node;
+            if(!pieces[i].walk)
             {
-                evaluator_trace("slice predicate: node is not a sequence type, cannot use a slice on it (kind: %d), dropping (%p)", node_kind(each), each);
-                result = true;
+                next.pieces[next.length++] = pieces[i];
+            }
+            else if(is_mapping(each))
+            {
+                next.pieces[next.length++] = (Piece){each, false};
+                mapping_iterate(mapping(each), split_value_iterator, &next);
+            }
+            else if(is_sequence(each))
+            {
+                next.pieces[next.length++] = (Piece){each, false};
+                sequence_iterate(sequence(each), split_item_iterator, &next);
+            }
+            else if(is_alias(each))
+            {
+                // N.B. - an alias isn't tested, its target is walked in its place
+                next.pieces[next.length++] = (Piece){alias_target(alias(each)), true};
             }
             else
             {
-                result = apply_slice_predicate(sequence(each), context, target);
+                next.pieces[next.length++] = pieces[i];
             }
-            break;
-        case JOIN:
-            evaluator_trace("evaluating join predicate");
-            result = apply_join_predicate(each, context, target);
-            break;
+        }
+        free(pieces);
+        pieces = next.pieces;
+        count = next.length;
     }
-    return result;
+
+    *length = count;
+    return pieces;
 }
 
-static bool apply_wildcard_predicate(const Node *value, evaluator_context *context, nodelist *target)
+static bool split_value_iterator(Node *key __attribute__((unused)), Node *value, void *context)
 {
-    bool result = false;
-    switch(node_kind(value))
+    struct splitter *splitter = (struct splitter *)context;
+    splitter->pieces[splitter->length++] = (Piece){value, true};
+    return true;
+}
+
+static bool split_item_iterator(Node *each, void *context)
+{
+    struct splitter *splitter = (struct splitter *)context;
+    splitter->pieces[splitter->length++] = (Piece){each, true};
+    return true;
+}
+
+static bool run_region(evaluator_context *context, Region *region)
+{
+    region->tasks = context->threads * TASKS_PER_THREAD;
+    if(region->length < region->tasks)
     {
-        case SCALAR:
-            trace_string("wildcard predicate: adding scalar '%s' (%p)",
-                         scalar_value(scalar((Node *)value)), node_size(value), value);
-            result = guard(nodelist_add(target, value));
-            break;
-        case MAPPING:
-            evaluator_trace("wildcard predicate: adding mapping (%p)", value);
-            result = guard(nodelist_add(target, value));
-            break;
-        case SEQUENCE:
-            evaluator_trace("wildcard predicate: adding %zd sequence (%p) items",
-                            node_size(value), value);
-            result = guard(
-                sequence_iterate(sequence((Node *)value), add_to_nodelist_sequence_iterator, target));
-            break;
-        case DOCUMENT:
-            evaluator_error("wildcard predicate: uh-oh! found a document node (%p), aborting...", value);
-            context->code = ERR_UNEXPECTED_DOCUMENT_NODE;
-            break;
-        case ALIAS:
-            evaluator_trace("wildcard predicate: resolving alias (%p)", value);
-            result = apply_wildcard_predicate(alias_target(alias((Node *)value)), context, target);
-            break;
+        region->tasks = region->length;
+    }
+    region->results = calloc(region->tasks, sizeof(evaluator_context));
+    if(NULL == region->results)
+    {
+        evaluator_debug("parallel: unable to allocate %zd task contexts, running them in turn", region->tasks);
+        return region->function(context, region, 0, region->length);
+    }
+    for(size_t i = 0; i < region->tasks; i++)
+    {
+        // N.B. - the tasks share everything but their results, and never split their own work again
+        region->results[i] = *context;
+        region->results[i].list = NULL;
+        region->results[i].threads = 1;
+        region->results[i].split = NULL;
+    }
+
+    evaluator_debug("parallel: splitting %zd parts into %zd tasks over %zd threads", region->length, region->tasks, context->threads);
+    bool result = run_tasks(region->tasks, context->threads, run_region_task, region);
+
+    for(size_t i = 0; i < region->tasks; i++)
+    {
+        evaluator_context *each = &region->results[i];
+        if(EVALUATOR_SUCCESS != each->code)
+        {
+            if(EVALUATOR_SUCCESS == context->code)
+            {
+                context->code = each->code;
+            }
+            result = false;
+        }
+        if(result && NULL != each->list && !vector_add_all(context->list, each->list))
+        {
+            context->code = ERR_EVALUATOR_OUT_OF_MEMORY;
+            result = false;
+        }
+        nodelist_free(each->list);
     }
+    free(region->results);
+    region->results = NULL;
     return result;
 }
 
-static bool apply_subscript_predicate(const Sequence *value, evaluator_context *context, nodelist *target)
+static bool run_region_task(size_t index, void *argument)
 {
-    predicate *subscript = step_predicate(current_step(context));
-    size_t index = subscript_predicate_index(subscript);
-    if(index > node_size(value))
+    Region *region = (Region *)argument;
+    evaluator_context *context = &region->results[index];
+    context->list = make_nodelist();
+    if(NULL == context->list)
     {
-        evaluator_trace("subscript predicate: index %zd not valid for sequence (length: %zd), dropping (%p)",
-                        index, node_size(value), value);
-        return true;
+        context->code = ERR_EVALUATOR_OUT_OF_MEMORY;
+        return false;
     }
-    Node *selected = sequence_get(value, index);
-    evaluator_trace("subscript predicate: adding index %zd (%p) from sequence (%p) of %zd items",
-                    index, selected, value, node_size(value));
-    return nodelist_add(target, selected) ? true : (context->code = ERR_EVALUATOR_OUT_OF_MEMORY, false);
+    size_t from = index * region->length / region->tasks;
+    size_t to = (index + 1) * region->length / region->tasks;
+    return region->function(context, region, from, to);
 }
 
-static bool apply_slice_predicate(const Sequence *value, evaluator_context *context, nodelist *target)
+static bool run_region_pieces(evaluator_context *context, const Region *region, size_t from, size_t to)
 {
-    predicate *slice = step_predicate(current_step(context));
-    int from = 0, to = 0, increment = 0;
-    normalize_interval(value, slice, &from, &to, &increment);
-    evaluator_trace("slice predicate: using normalized interval [%d:%d:%d]", from, to, increment);
-
-    for(int i = from; 0 > increment ? i >= to : i < to; i += increment)
+    meta_context meta = {context, region->instruction};
+    for(size_t i = from; i < to; i++)
     {
-        Node *selected = sequence_get(value, (size_t)i);
-        if(NULL == selected || !nodelist_add(target, selected))
+        const Piece *each = &region->pieces[i];
+        bool result = each->walk
+            ? apply_recursive_test(&meta, each->node)
+            : test_recursive_node(&meta, each->node);
+        if(!result)
         {
-            evaluator_error("slice predicate: uh oh! out of memory, aborting. index: %d, selected: %p",
-                            i, selected);
-            context->code = ERR_EVALUATOR_OUT_OF_MEMORY;
             return false;
         }
-        evaluator_trace("slice predicate: adding index: %d (%p)", i, selected);
     }
     return true;
 }
 
-static bool apply_join_predicate(const Node *value __attribute__((unused)), evaluator_context *context, nodelist *target __attribute__((unused)))
+static bool run_region_documents(evaluator_context *context, const Region *region, size_t from, size_t to)
 {
-    evaluator_trace("join predicate: evaluating axes (_, _)");
-
-    // xxx - implement me!
-    evaluator_error("join predicate: uh-oh! not implemented yet, aborting...");
-    context->code = ERR_UNSUPPORTED_PATH;
-    return false;
+    for(size_t i = from; i < to; i++)
+    {
+        Document *each = model_document(context->model, region->first + i);
+        if(!execute(context, region->instruction, node(each)))
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 /*
@@ -546,18 +938,63 @@ static bool apply_join_predicate(const Node *value __attribute__((unused)), eval
  * =================
  */
 
-static bool add_to_nodelist_sequence_iterator(Node *each, void *context)
+static bool advance_sequence_item_iterator(Node *each, void *context)
 {
-    nodelist *list = (nodelist *)context;
+    meta_context *iterator_context = (meta_context *)context;
     Node *value = each;
     if(is_alias(each))
     {
         value = alias_target(alias(each));
     }
-    return nodelist_add(list, value);
+    return advance(iterator_context->context, iterator_context->instruction, value);
+}
+
+static bool advance_index_value_iterator(Node *value, void *context)
+{
+    meta_context *iterator_context = (meta_context *)context;
+    return advance(iterator_context->context, iterator_context->instruction, value);
+}
+
+static bool uses_opcode(const Program *program, enum opcode opcode)
+{
+    for(size_t i = 0; i < program->length; i++)
+    {
+        if(opcode == program->instructions[i].opcode)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Only a recursive step that follows steps selecting at most one node is
+ * split up, a step reached once for every node of a larger selection would
+ * start and join the threads each time for only a little work.
+ */
+static const Instruction *splittable_step(const Program *program)
+{
+    for(size_t i = 0; i < program->length; i++)
+    {
+        const Instruction *instruction = &program->instructions[i];
+        switch(instruction->opcode)
+        {
+            case OP_ROOT:
+            case OP_NAME:
+            case OP_SUBSCRIPT:
+                break;
+            case OP_RECURSE_NAME:
+            case OP_RECURSE_WILDCARD:
+            case OP_RECURSE_TYPE:
+                return instruction;
+            default:
+                return NULL;
+        }
+    }
+    return NULL;
 }
 
-static bool add_values_to_nodelist_map_iterator(Node *key __attribute__((unused)), Node *value, void *context)
+static bool advance_mapping_value_iterator(Node *key, Node *value, void *context)
 {
     meta_context *iterator_context = (meta_context *)context;
     bool result = false;
@@ -566,18 +1003,16 @@ static bool add_values_to_nodelist_map_iterator(Node *key __attribute__((unused)
         case SCALAR:
             trace_string("wildcard test: adding scalar mapping value: '%s' (%p)",
                          scalar_value(scalar(value)), node_size(value), value);
-            result = nodelist_add(iterator_context->target, value);
+            result = advance(iterator_context->context, iterator_context->instruction, value);
             break;
         case MAPPING:
             evaluator_trace("wildcard test: adding mapping mapping value (%p)", value);
-            result = nodelist_add(iterator_context->target, value);
+            result = advance(iterator_context->context, iterator_context->instruction, value);
             break;
         case SEQUENCE:
             evaluator_trace("wildcard test: adding %zd sequence mapping values (%p) items",
                             node_size(value), value);
-            result = sequence_iterate(sequence(value),
-                                      add_to_nodelist_sequence_iterator,
-                                      iterator_context->target);
+            result = sequence_iterate(sequence(value), advance_sequence_item_iterator, context);
             break;
         case DOCUMENT:
             evaluator_error("wildcard test: uh-oh! found a document node (%p), aborting...", value);
@@ -586,7 +1021,7 @@ static bool add_values_to_nodelist_map_iterator(Node *key __attribute__((unused)
             break;
         case ALIAS:
             evaluator_trace("wildcard test: resolving alias (%p)", value);
-            result = add_values_to_nodelist_map_iterator(key, alias_target(alias(value)), context);
+            result = advance_mapping_value_iterator(key, alias_target(alias(value)), context);
             break;
     }
     return result;
@@ -629,7 +1064,7 @@ static int normalize_to(const predicate *slice, const Sequence *value)
 }
 
 #ifdef USE_LOGGING
-static inline void log_interval(const Sequence *value, predicate *slice)
+static inline void log_interval(const Sequence *value, const predicate *slice)
 {
     static const char * fmt = "slice predicate: evaluating interval [%s:%s:%s] on sequence (%p) of %zd items";
     static const char * extent_fmt = "%" PRIdFAST32;
@@ -668,7 +1103,7 @@ static inline void log_interval(const Sequence *value, predicate *slice)
 }
 #endif
 
-static void normalize_interval(const Sequence *value, predicate *slice, int *from_val, int *to_val, int *step_val)
+static void normalize_interval(const Sequence *value, const predicate *slice, int *from_val, int *to_val, int *step_val)
 {
 #ifdef USE_LOGGING
     log_interval(value, slice);
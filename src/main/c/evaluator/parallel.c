@@ -0,0 +1,120 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "evaluator/private.h"
+
+/*
+ * A minimal fork/join runner: the tasks are numbered and every worker,
+ * including the calling thread, claims the next unstarted task from a
+ * shared counter until none remain.  Because a worker that finishes early
+ * simply claims more tasks, the load balances itself as long as there are
+ * several tasks per worker.
+ */
+
+struct task_runner
+{
+    size_t          count;
+    task_function   function;
+    void           *argument;
+    atomic_size_t   next;
+    atomic_bool     failed;
+};
+
+typedef struct task_runner task_runner;
+
+static void *worker(void *argument);
+
+
+static void *worker(void *argument)
+{
+    task_runner *runner = (task_runner *)argument;
+    while(!atomic_load_explicit(&runner->failed, memory_order_relaxed))
+    {
+        size_t index = atomic_fetch_add_explicit(&runner->next, 1, memory_order_relaxed);
+        if(index >= runner->count)
+        {
+            break;
+        }
+        if(!runner->function(index, runner->argument))
+        {
+            atomic_store_explicit(&runner->failed, true, memory_order_relaxed);
+        }
+    }
+    return NULL;
+}
+
+bool run_tasks(size_t count, size_t threads, task_function function, void *argument)
+{
+    task_runner runner = {.count=count, .function=function, .argument=argument};
+    atomic_init(&runner.next, 0);
+    atomic_init(&runner.failed, false);
+
+    size_t helpers = (threads < count ? threads : count);
+    helpers = 0 == helpers ? 0 : helpers - 1;
+    pthread_t *ids = 0 == helpers ? NULL : calloc(helpers, sizeof(pthread_t));
+    size_t started = 0;
+    if(NULL != ids)
+    {
+        for(; started < helpers; started++)
+        {
+            // N.B. - if a thread can't be started, the others just do more of the work
+            if(0 != pthread_create(&ids[started], NULL, worker, &runner))
+            {
+                evaluator_debug("parallel: only able to start %zd of %zd helper threads", started, helpers);
+                break;
+            }
+        }
+    }
+    evaluator_trace("parallel: running %zd tasks on %zd threads", count, started + 1);
+
+    worker(&runner);
+    for(size_t i = 0; i < started; i++)
+    {
+        pthread_join(ids[i], NULL);
+    }
+    free(ids);
+
+    return !atomic_load(&runner.failed);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2013 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/*
+ * A region allocator: memory is handed out by bumping a cursor through large
+ * chunks and is only ever released all at once by `arena_free'. Allocations
+ * are zero filled and aligned to the size of a pointer.
+ */
+typedef struct arena_s Arena;
+
+/* Constructor */
+Arena *make_arena(void);
+
+/* Destructor */
+void   arena_free(Arena *arena);
+/*
+ * Release every allocation at once but keep the arena for reuse, only the
+ * most recent chunk is kept, so an arena that is reset often doesn't map
+ * and unmap memory each time.
+ */
+void   arena_reset(Arena *arena);
+
+/* Allocation API */
+void  *arena_alloc(Arena *arena, size_t size);
+void  *arena_realloc(Arena *arena, void *value, size_t old_size, size_t new_size);
+void  *arena_copy(Arena *arena, const void *value, size_t size);
+
+/* Size API */
+size_t arena_allocated(const Arena *arena);
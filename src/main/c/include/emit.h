@@ -39,5 +39,9 @@
 #include "emit/zsh.h"
 #include "emit/json.h"
 #include "emit/yaml.h"
+#include "emit/ndjson.h"
+#include "emit/msgpack.h"
+#include "emit/cbor.h"
+#include "emit/raw.h"
 
-typedef bool (*emit_function)(const nodelist *list);
+typedef bool (*emit_function)(const nodelist *list, Writer *output);
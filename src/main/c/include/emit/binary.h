@@ -0,0 +1,69 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "model.h"
+#include "emit/writer.h"
+
+/*
+ * The binary formats share one walk of the nodes, and only differ in how
+ * each kind of value is encoded.  Scalars are written as the native value
+ * of the kind resolved when they were loaded, falling back to a string
+ * when their text can't be read as that kind.
+ */
+struct binary_format
+{
+    const char *name;
+    bool (*array)(Writer *output, size_t count);
+    bool (*map)(Writer *output, size_t count);
+    bool (*string)(Writer *output, const uint8_t *value, size_t length);
+    bool (*integer)(Writer *output, int64_t value);
+    bool (*unsigned_integer)(Writer *output, uint64_t value);
+    bool (*real)(Writer *output, double value);
+    bool (*boolean)(Writer *output, bool value);
+    bool (*null)(Writer *output);
+};
+
+typedef struct binary_format BinaryFormat;
+
+bool emit_binary_node(const BinaryFormat *format, Node *each, Writer *output);
+
+/* writes `prefix' followed by the low `width' bytes of `value', most significant first */
+bool emit_binary_header(Writer *output, uint8_t prefix, uint64_t value, size_t width);
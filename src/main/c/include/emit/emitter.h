@@ -0,0 +1,74 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "model.h"
+#include "nodelist.h"
+#include "emit/writer.h"
+
+/*
+ * An emitter writes the nodes of a result one at a time, so that a result
+ * can be written while it is still being found.  Once `start' has been
+ * called, `finish' always is too, even if a node couldn't be emitted, and
+ * either of them may be NULL when the format has nothing to write.  The
+ * output is buffered, and is only sure to have been written once `finish'
+ * has been called.
+ */
+struct emitter
+{
+    bool (*start)(struct emitter *self);
+    bool (*emit)(struct emitter *self, Node *each);
+    bool (*finish)(struct emitter *self);
+    /** the number of nodes emitted so far */
+    size_t count;
+    /** the format's own state, such as the libyaml emitter */
+    void  *state;
+    /** where the nodes are written, the emitter doesn't own it */
+    Writer *output;
+};
+
+typedef struct emitter Emitter;
+
+bool emitter_start(Emitter *emitter);
+bool emitter_emit(Emitter *emitter, Node *each);
+bool emitter_finish(Emitter *emitter);
+
+/* emits each node of `list' between the start and the finish */
+bool emit_nodelist(Emitter *emitter, const nodelist *list);
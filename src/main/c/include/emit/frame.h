@@ -0,0 +1,72 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/*
+ * With `--framing', each response of a non-tty interactive session is
+ * written to `buffer' first, so that it can be preceded by a header with its
+ * length.  `output' keeps the real stdout while the response is captured.
+ *
+ * The header is a line of `OK <n> <length>', where <n> is the number of
+ * selected nodes, or `ERR 0 <length>' when the response is only the error
+ * messages of a failed command.  <length> is the size of the response in
+ * bytes, not counting the header.
+ */
+struct frame
+{
+    FILE   *buffer;
+    int     output;
+    size_t  matches;
+    bool    failed;
+};
+
+bool open_frame(struct frame *response);
+void close_frame(struct frame *response);
+
+/* stdout is redirected to the buffer until `end_frame' */
+bool begin_frame(struct frame *response);
+/* discards what has been written for the response so far, leaving room for the error messages */
+void fail_frame(struct frame *response);
+/* writes the header and the response to the real stdout, and empties the buffer */
+bool end_frame(struct frame *response);
+
+bool copy_frame(int from, int to, off_t length);
@@ -38,6 +38,14 @@
 #pragma once
 
 #include "nodelist.h"
+#include "emit/emitter.h"
 #include "options.h"
 
-bool emit_json(const nodelist *list);
+bool    emit_json(const nodelist *list, Writer *output);
+Emitter make_json_emitter(Writer *output);
+
+/* writes `each' as a single compact JSON value */
+bool    emit_json_node(Node *each, Writer *output);
+
+/* writes `value' as the contents of a JSON string, escaping what must be */
+bool    emit_json_string(const uint8_t *value, size_t length, Writer *output);
@@ -41,21 +41,24 @@
 
 #include "model.h"
 
-bool emit_node(Node *value, void *context);
-bool emit_scalar(const Scalar *each);
-bool emit_quoted_scalar(const Scalar *each);
-bool emit_raw_scalar(const Scalar *each);
-bool emit_sequence_item(Node *each, void *context);
+#include "emit/writer.h"
 
 struct emit_context
 {
     mapping_iterator emit_mapping_item;
     bool wrap_collections;
+    Writer *output;
 };
 
 typedef struct emit_context emit_context;
 
-#define EMIT(STR) if(EOF == fputs((STR), stdout))                       \
+bool emit_node(Node *value, void *context);
+bool emit_scalar(const Scalar *each, emit_context *context);
+bool emit_quoted_scalar(const Scalar *each, emit_context *context);
+bool emit_raw_scalar(const Scalar *each, emit_context *context);
+bool emit_sequence_item(Node *each, void *context);
+
+#define EMIT(STR) if(!writer_puts(context->output, (STR)))              \
     {                                                                   \
         log_error("shell", "uh oh! couldn't emit literal %s", (STR));   \
         return false;                                                   \
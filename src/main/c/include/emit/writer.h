@@ -0,0 +1,88 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * A writer gathers the output of an emitter in a large buffer, so that a
+ * result is written to its file descriptor with a few system calls, instead
+ * of a locked stdio call for every brace, comma and scalar.  Anything too
+ * big for the space left in the buffer is written straight from the
+ * caller's memory, in the same `writev' as the bytes already buffered.
+ *
+ * Once a write fails, every later one does too, and the error is left in
+ * `errno'.
+ */
+
+#define WRITER_BUFFER_SIZE 65536
+
+struct writer
+{
+    int     fd;
+    size_t  length;
+    bool    failed;
+    uint8_t buffer[WRITER_BUFFER_SIZE];
+};
+
+typedef struct writer Writer;
+
+Writer *make_writer(int fd);
+void    writer_free(Writer *writer);
+
+/* writes `data' and the buffered bytes before it, and empties the buffer */
+bool writer_write_through(Writer *writer, const uint8_t *data, size_t length);
+bool writer_flush(Writer *writer);
+
+static inline bool writer_write(Writer *writer, const uint8_t *data, size_t length)
+{
+    if(length > WRITER_BUFFER_SIZE - writer->length)
+    {
+        return writer_write_through(writer, data, length);
+    }
+    memcpy(writer->buffer + writer->length, data, length);
+    writer->length += length;
+    return !writer->failed;
+}
+
+static inline bool writer_puts(Writer *writer, const char *value)
+{
+    return writer_write(writer, (const uint8_t *)value, strlen(value));
+}
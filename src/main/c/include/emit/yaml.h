@@ -38,6 +38,8 @@
 #pragma once
 
 #include "nodelist.h"
+#include "emit/emitter.h"
 #include "options.h"
 
-bool emit_yaml(const nodelist *list);
+bool    emit_yaml(const nodelist *list, Writer *output);
+Emitter make_yaml_emitter(Writer *output);
@@ -38,6 +38,8 @@
 #pragma once
 
 #include "nodelist.h"
+#include "emit/emitter.h"
 #include "options.h"
 
-bool emit_zsh(const nodelist *list);
+bool    emit_zsh(const nodelist *list, Writer *output);
+Emitter make_zsh_emitter(Writer *output);
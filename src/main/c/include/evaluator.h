@@ -37,6 +37,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include "maybe.h"
 #include "model.h"
 #include "jsonpath.h"
@@ -74,4 +76,112 @@ struct maybe_nodelist_s
 
 typedef struct maybe_nodelist_s MaybeNodelist;
 
+struct evaluator_options
+{
+    /** the most nodes to select, or zero for all of them */
+    size_t limit;
+    /** how many threads may share the evaluation */
+    size_t threads;
+    /** the documents of the stream to evaluate, from `first_document' up to but not including `last_document' */
+    size_t first_document;
+    size_t last_document;
+};
+
+typedef struct evaluator_options evaluator_options;
+
+struct batch
+{
+    size_t    count;
+    /** the nodes selected by each path of the batch, in the order the paths were given */
+    nodelist *results[];
+};
+
+typedef struct batch Batch;
+
+struct maybe_batch_s
+{
+    enum maybe_tag tag;
+    union
+    {
+        Batch *just;
+        struct
+        {
+            evaluator_status_code code;
+            const char *message;
+        } nothing;
+    };
+};
+
+typedef struct maybe_batch_s MaybeBatch;
+
+/* evaluates every document of the stream, one at a time, without a limit */
+#define EVALUATOR_DEFAULTS (evaluator_options){0, 1, 0, SIZE_MAX}
+
+/**
+ * Evaluate the path against each document of the model in turn, the
+ * results are in stream order.
+ */
 MaybeNodelist evaluate(const DocumentModel *model, const jsonpath *path);
+/**
+ * Evaluate the path, but stop walking the document as soon as `limit'
+ * nodes have been selected.  A limit of zero selects every matching node.
+ */
+MaybeNodelist evaluate_with_limit(const DocumentModel *model, const jsonpath *path, size_t limit);
+/**
+ * Evaluate the path, sharing the walk of each large subtree visited by a
+ * recursive step among `threads' threads.  The results are in the same order
+ * as a single threaded evaluation.  Recursive steps only run in parallel
+ * without a limit, since a limited query stops at its first matches.
+ */
+MaybeNodelist evaluate_with_threads(const DocumentModel *model, const jsonpath *path, size_t limit, size_t threads);
+/**
+ * Evaluate the path against a range of the documents of the model.  With
+ * more than one thread and more than one document in the range, whole
+ * documents are shared among the threads, otherwise the subtrees of the
+ * only document are.  Either way the results are in stream order.  A range
+ * that runs past the end of the stream stops at its last document.
+ */
+MaybeNodelist evaluate_with_options(const DocumentModel *model, const jsonpath *path, const evaluator_options *options);
+/**
+ * Evaluate several paths with a single walk of each document, so that the
+ * steps the paths start with in common are only taken once.  The results of
+ * each path are the same as those of `evaluate_with_options', except that a
+ * batch is never split over threads, and the limit applies to each path
+ * separately.
+ */
+MaybeBatch    evaluate_batch(const DocumentModel *model, jsonpath * const *paths, size_t count, const evaluator_options *options);
+void          batch_free(Batch *batch);
+
+/*
+ * Result Cache
+ *
+ * A cache of the nodes selected by a path, keyed by its canonical form and
+ * by the options that change the selection, for repeated queries of the
+ * same model.  It is bounded by the total number of cached nodes, and the
+ * least recently used results are evicted to make room.  The results are
+ * only valid for the model that they were selected from, the cache drops
+ * them all as soon as it is used with another model, or with the same one
+ * after it has changed.  The cache owns the nodelists put into it, so a
+ * nodelist returned by `result_cache_get' is only valid until the cache is
+ * next changed.
+ */
+typedef struct result_cache ResultCache;
+
+typedef bool (*result_cache_iterator)(const char *path, const evaluator_options *options, size_t nodes, size_t hits, void *context);
+
+ResultCache *make_result_cache(size_t capacity);
+void         result_cache_free(ResultCache *cache);
+
+nodelist    *result_cache_get(ResultCache *cache, const DocumentModel *model, const jsonpath *path, const evaluator_options *options);
+bool         result_cache_put(ResultCache *cache, const DocumentModel *model, const jsonpath *path, const evaluator_options *options, nodelist *list);
+void         result_cache_clear(ResultCache *cache);
+void         result_cache_resize(ResultCache *cache, size_t capacity);
+/* visits the entries from the most to the least recently used */
+bool         result_cache_iterate(const ResultCache *cache, result_cache_iterator iterator, void *context);
+
+size_t       result_cache_size(const ResultCache *cache);
+size_t       result_cache_cost(const ResultCache *cache);
+size_t       result_cache_capacity(const ResultCache *cache);
+size_t       result_cache_hits(const ResultCache *cache);
+size_t       result_cache_misses(const ResultCache *cache);
+size_t       result_cache_evictions(const ResultCache *cache);
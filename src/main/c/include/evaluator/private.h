@@ -40,18 +40,102 @@
 #include "evaluator.h"
 #include "log.h"
 
+/*
+ * Bytecode
+ *
+ * A path is compiled into a flat program of instructions, one for each
+ * step's test and one for each step's predicate, terminated by `OP_HALT'.
+ * Each instruction passes the nodes it selects on to the next one.
+ *
+ * A batch of paths is compiled into a single program that is a trie of
+ * their instructions, laid out in pre-order: the instructions that the
+ * paths share are only emitted once, and each instruction passes its nodes
+ * on to every one of its `branches', the first of which follows it.  Each
+ * branch spans `extent' instructions, so the next one starts right after
+ * it.  Every path of the batch ends with its own `OP_HALT', which collects
+ * the nodes for that path's `query'.
+ */
+
+enum opcode
+{
+    OP_ROOT,
+    OP_NAME,
+    OP_WILDCARD,
+    OP_TYPE,
+    OP_RECURSE_NAME,
+    OP_RECURSE_WILDCARD,
+    OP_RECURSE_TYPE,
+    OP_ALL,
+    OP_SUBSCRIPT,
+    OP_SLICE,
+    OP_JOIN,
+    OP_HALT
+};
+
+struct instruction
+{
+    enum opcode opcode;
+    /** how many instructions take this one's nodes, and how many this one's branch spans */
+    size_t      branches;
+    size_t      extent;
+    union
+    {
+        struct
+        {
+            uint8_t *value;
+            size_t   length;
+            hashcode hash;
+        } name;
+        enum type_test_kind type;
+        size_t              index;
+        const predicate    *slice;
+        size_t              query;
+    } operand;
+};
+
+typedef struct instruction Instruction;
+
+struct program
+{
+    size_t      length;
+    Instruction instructions[];
+};
+
+typedef struct program Program;
+
+Program    *compile_path(const jsonpath *path);
+Program    *compile_batch(jsonpath * const *paths, size_t count);
+void        program_free(Program *program);
+const char *opcode_name(enum opcode value);
+
 struct evaluator_context
 {
     enum evaluator_status_code code;
-    size_t                     current_step;
     const DocumentModel       *model;
     const jsonpath            *path;
+    const Program             *program;
+    const NameIndex           *names;
     nodelist                  *list;
+    /** the results of each path of a batch, by query, or NULL when a single path is evaluated */
+    nodelist                 **lists;
+    size_t                     limit;
+    size_t                     threads;
+    /** the recursive step that may be split over the threads, it is reached at most once */
+    const Instruction         *split;
+    bool                       done;
 };
 
 typedef struct evaluator_context evaluator_context;
 
-evaluator_status_code evaluate_steps(const DocumentModel *model, const jsonpath *path, nodelist **list);
+evaluator_status_code evaluate_steps(const DocumentModel *model, const jsonpath *path, const evaluator_options *options, nodelist **list);
+evaluator_status_code evaluate_batch_steps(const DocumentModel *model, jsonpath * const *paths, size_t count, const evaluator_options *options, nodelist **lists);
+
+/*
+ * Runs the tasks numbered 0 to `count' - 1 on up to `threads' threads,
+ * including the calling one.  No more tasks are started once one fails.
+ */
+typedef bool (*task_function)(size_t index, void *argument);
+bool run_tasks(size_t count, size_t threads, task_function function, void *argument);
 const char *evaluator_status_message(evaluator_status_code code);
 
 #define component_name "evaluator"
@@ -56,6 +56,10 @@ hashcode fnv1a_string_buffer_hash(const uint8_t *key, size_t length);
 hashcode djb_string_hash(const void *key);
 hashcode djb_string_buffer_hash(const uint8_t *key, size_t length);
 
+/* N.B. - seeded at random for each process, don't persist these values */
+hashcode wyhash_string_hash(const void *key);
+hashcode wyhash_string_buffer_hash(const uint8_t *key, size_t length);
+
 typedef bool (*compare_function)(const void *key1, const void *key2);
 
 bool string_comparitor(const void *key1, const void *key2);
@@ -35,11 +35,13 @@
 #include <stdio.h>
 
 #include "hash.h"
+#include "arena.h"
 
 typedef struct hashtable_s Hashtable;
 
 typedef bool (*hashtable_iterator)(void *key, void *value, void *context);
 typedef bool (*hashtable_item_iterator)(void *item, void *context);
+typedef bool (*hashtable_probe)(const void *key, const void *probe);
 
 Hashtable *make_hashtable(compare_function comparitor);
 Hashtable *make_hashtable_with_function(compare_function comparitor,
@@ -56,6 +58,8 @@ Hashtable *make_hashtable_with_capacity_factor_function(compare_function compari
                                                         size_t capacity_hint, 
                                                         float load_factor, 
                                                         hash_function function);
+/* N.B. - hashtables allocated from an arena are released with the arena, `hashtable_free' is a no-op */
+Hashtable *make_hashtable_in(Arena *arena, compare_function comparitor, hash_function function);
 
 void hashtable_free(Hashtable *hashtable);
 
@@ -76,6 +80,13 @@ bool hashtable_equals(const Hashtable *hashtable1,
 
 bool hashtable_contains(const Hashtable *hashtable, const void *key);
 void *hashtable_get(const Hashtable *hashtable, const void *key);
+/*
+ * N.B. - the probe functions look up a key without constructing one: `hash'
+ * must equal the table's hash of the matching key, and `match' is called
+ * with each candidate key and `probe'.
+ */
+bool hashtable_contains_probe(const Hashtable *hashtable, hashcode hash, hashtable_probe match, const void *probe);
+void *hashtable_get_probe(const Hashtable *hashtable, hashcode hash, hashtable_probe match, const void *probe);
 void *hashtable_get_if_absent(Hashtable *hashtable, void * key, void * value);
 void *hashtable_get_if_absent_put(Hashtable *hashtable, void *key, void *value);
 
@@ -120,6 +120,31 @@ void path_free(jsonpath *path);
 
 char *parser_status_message(const parser_context *context);
 
+// jsonpath cache api
+
+/*
+ * A cache of parsed paths keyed by their expressions, which holds at most
+ * `capacity' paths and evicts the least recently used one to make room for
+ * another.  The cache owns the paths put into it, so a path returned by
+ * `path_cache_get' is only valid until the cache is next changed.  A cache
+ * with no capacity never takes a path.
+ */
+typedef struct path_cache PathCache;
+
+PathCache *make_path_cache(size_t capacity);
+void       path_cache_free(PathCache *cache);
+
+jsonpath  *path_cache_get(PathCache *cache, const uint8_t *expression, size_t length);
+bool       path_cache_put(PathCache *cache, jsonpath *path);
+void       path_cache_clear(PathCache *cache);
+void       path_cache_resize(PathCache *cache, size_t capacity);
+
+size_t     path_cache_size(const PathCache *cache);
+size_t     path_cache_capacity(const PathCache *cache);
+size_t     path_cache_hits(const PathCache *cache);
+size_t     path_cache_misses(const PathCache *cache);
+size_t     path_cache_evictions(const PathCache *cache);
+
 // jsonpath model api
 
 typedef bool (*path_iterator)(step *each, void *context);
@@ -127,6 +152,8 @@ bool path_iterate(const jsonpath *path, path_iterator iterator, void *context);
 
 uint8_t *path_expression(const jsonpath *path);
 size_t path_expression_length(const jsonpath *path);
+/* the same for every expression of the same path, the result must be freed */
+char *path_canonical_form(const jsonpath *path);
 
 enum path_kind path_kind(const jsonpath *path);
 const char *   path_kind_name(enum path_kind value);
@@ -41,6 +41,7 @@
 
 #include "model.h"
 #include "maybe.h"
+#include "jsonpath.h"
 
 enum loader_status_code
 {
@@ -56,6 +57,8 @@ enum loader_status_code
     ERR_NO_ANCHOR_FOR_ALIAS,   // no anchor referenced by alias
     ERR_ALIAS_LOOP,            // the alias references an ancestor
     ERR_DUPLICATE_KEY,         // a duplicate mapping key was detected
+    ERR_INVALID_SNAPSHOT,      // the snapshot is damaged or from another version
+    ERR_UNSTREAMABLE_PATH,     // the path can't be evaluated without a model
     ERR_OTHER
 };
 
@@ -71,6 +74,16 @@ enum loader_duplicate_key_strategy
 const char *duplicate_strategy_name(enum loader_duplicate_key_strategy value);
 int32_t     parse_duplicate_strategy(const char *value);
 
+enum loader_input_format
+{
+    INPUT_AUTO,   // JSON when the input starts with `{' or `[', YAML otherwise
+    INPUT_YAML,
+    INPUT_JSON
+};
+
+const char *input_format_name(enum loader_input_format value);
+int32_t     parse_input_format(const char *value);
+
 struct maybe_document_s
 {
     enum maybe_tag tag;
@@ -89,3 +102,89 @@ typedef struct maybe_document_s MaybeDocument;
 
 MaybeDocument load_string(const unsigned char *input, size_t size, enum loader_duplicate_key_strategy value);
 MaybeDocument load_file(FILE *input, enum loader_duplicate_key_strategy value);
+/*
+ * Map the file at `path' into memory instead of reading it, scalars that
+ * appear verbatim in the input will refer to the mapped bytes rather than
+ * being copied. The mapping is released by `model_free'.
+ */
+MaybeDocument load_mapped(const char *path, enum loader_duplicate_key_strategy value);
+
+/*
+ * The loaders above detect JSON input automatically, these variants take
+ * the input format explicitly. JSON input is loaded without libyaml, with
+ * the same results; when detected automatically, input that turns out not
+ * to be JSON is loaded as YAML instead.
+ */
+MaybeDocument load_string_with_format(const unsigned char *input, size_t size, enum loader_duplicate_key_strategy value, enum loader_input_format format);
+MaybeDocument load_file_with_format(FILE *input, enum loader_duplicate_key_strategy value, enum loader_input_format format);
+MaybeDocument load_mapped_with_format(const char *path, enum loader_duplicate_key_strategy value, enum loader_input_format format);
+
+/* the deepest node of a snapshot, counting the document as the first level */
+#define SNAPSHOT_MAX_DEPTH 4096
+
+/*
+ * Write `model' to `path' as a snapshot, a binary form of the model that
+ * the loaders accept in place of its source, and load without parsing.  Mapping the
+ * snapshot with `load_mapped' is the fastest way to load it.
+ *
+ * The snapshot records the size and modification time of `source', the
+ * file the model was loaded from (or NULL), a snapshot is ignored in favor
+ * of its source once the source has changed.  A model nested deeper than
+ * `SNAPSHOT_MAX_DEPTH' isn't written, and `errno' is set to EOVERFLOW.
+ */
+bool write_snapshot(const DocumentModel *model, const char *source, const char *path);
+
+/*
+ * Streaming Queries
+ *
+ * `stream_file' evaluates `path' directly on the parser's events, without
+ * loading a model.  Only the nodes that the path selects are built, and they
+ * are passed to `callback' in the order that the evaluator gives, so the
+ * memory used depends on the selected nodes rather than on the size of the
+ * input.  A node is passed on once nothing later in the input can change the
+ * result before it: the nodes selected inside a mapping wait until it is
+ * complete, as a duplicate key may still replace them, and so do the nodes
+ * that a recursive step selects while one of the collections that it took
+ * is open.  The nodes are only valid during the call, and returning false
+ * from `callback' stops the query.
+ *
+ * Paths that use only the root, name, wildcard and type tests, recursive
+ * steps, and subscript or slice predicates with non-negative bounds can be
+ * streamed, see `path_is_streamable'.  Duplicate mapping keys are handled by
+ * `strategy' as the loader does, but with `DUPE_FAIL' the nodes passed on
+ * before the duplicate was found stand.
+ */
+
+typedef bool (*stream_callback)(Node *each, void *context);
+
+struct stream_options
+{
+    enum loader_duplicate_key_strategy strategy;
+    /** the documents queried, as for `evaluator_options' */
+    size_t first_document;
+    size_t last_document;
+};
+
+typedef struct stream_options stream_options;
+
+#define STREAM_DEFAULTS (stream_options){DUPE_CLOBBER, 0, SIZE_MAX}
+
+struct maybe_count_s
+{
+    enum maybe_tag tag;
+    union
+    {
+        size_t just;
+        struct
+        {
+            loader_status_code code;
+            char *message;
+        } nothing;
+    };
+};
+
+typedef struct maybe_count_s MaybeCount;
+
+bool       path_is_streamable(const jsonpath *path);
+/* the result is the number of nodes passed to `callback' */
+MaybeCount stream_file(FILE *input, const jsonpath *path, const stream_options *options, stream_callback callback, void *context);
@@ -38,7 +38,6 @@
 #pragma once
 
 #include <errno.h>
-#include <regex.h>
 
 #include "log.h"
 #include "hashtable.h"
@@ -48,27 +47,56 @@ struct loader_context
     yaml_parser_t      parser;
     loader_status_code code;
     enum loader_duplicate_key_strategy strategy;
+    enum loader_input_format format;
 
     DocumentModel     *model;
 
     Node              *target;
+    Scalar            *key_holder;
+    /** the number of duplicate mapping keys that were dropped or replaced */
+    size_t             duplicates;
+
+    /** the memory mapped input, when loading with `load_mapped' */
     struct
     {
-        uint8_t *value;
-        size_t   length;
-    } key_holder;
+        const uint8_t *data;
+        size_t         length;
+        /** byte offset and character index of the last mark resolved */
+        size_t         offset;
+        size_t         index;
+    } input;
 
     Hashtable        *anchors;
-
-    regex_t           decimal_regex;
-    regex_t           integer_regex;
-    regex_t           timestamp_regex;
 };
 
 typedef struct loader_context loader_context;
 
 void build_model(struct loader_context *context);
+void build_json_model(struct loader_context *context, const uint8_t *input, size_t length);
+bool sniff_json(const uint8_t *input, size_t length);
+
+bool sniff_snapshot(const uint8_t *input, size_t length);
+/*
+ * Is the snapshot intact, and unchanged since it was written?  When its
+ * source has changed, `source' is set to the path of the source.
+ */
+bool snapshot_is_current(const uint8_t *input, size_t length, char **source);
+void build_snapshot_model(struct loader_context *context, const uint8_t *input, size_t length);
+
+bool start_model(struct loader_context *context);
+void finish_model(struct loader_context *context);
+bool add_node(struct loader_context *context, Node *value);
+
+/*
+ * Runs `path' on the events of the parser rather than on a model, see
+ * `stream_file', the result is the number of nodes passed to `callback'.
+ */
+size_t stream_events(struct loader_context *context, const jsonpath *path, const stream_options *options,
+                     stream_callback callback, void *argument);
+
 loader_status_code interpret_yaml_error(yaml_parser_t *parser);
+ScalarKind resolve_scalar_kind(const yaml_event_t *event);
+ScalarKind classify_plain_scalar(const uint8_t *value, size_t length);
 char *loader_simple_status_message(loader_status_code code);
 char *loader_status_message(const loader_context *context);
 
@@ -41,6 +41,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "arena.h"
 #include "hashtable.h"
 #include "vector.h"
 
@@ -101,16 +102,28 @@ struct scalar_s
 {
     struct node_s    base;
     ScalarKind kind;
+    /* N.B. - set once the scalar is used as a mapping key, 0 until then */
+    uint32_t         hash;
     uint8_t         *value;
     size_t           length;
 };
 
 typedef struct scalar_s Scalar;
 
+/* where a node's text is in the model's source, a length of 0 when it isn't known */
+struct source_span_s
+{
+    size_t offset;
+    size_t length;
+};
+
+typedef struct source_span_s SourceSpan;
+
 struct sequence_s
 {
     struct node_s base;
     Vector       *values;
+    SourceSpan    source;
 };
 
 typedef struct sequence_s Sequence;
@@ -119,6 +132,7 @@ struct mapping_s
 {
     struct node_s base;
     Hashtable    *values;
+    SourceSpan    source;
 };
 
 typedef struct mapping_s Mapping;
@@ -131,7 +145,24 @@ struct alias_s
 
 typedef struct alias_s Alias;
 
-typedef Vector  DocumentModel;
+struct document_model_s
+{
+    Vector *documents;
+    /** when present, all of the nodes are allocated from this arena */
+    Arena  *arena;
+    /** a memory mapped input that scalar nodes may refer to directly */
+    struct
+    {
+        uint8_t *data;
+        size_t   length;
+    } source;
+    /** built on demand when `index_names' is set, see `model_name_index' */
+    struct name_index_s *names;
+    bool    index_names;
+    /** unique to this model and changed whenever a document is added, see `model_generation' */
+    size_t  generation;
+};
+typedef struct document_model_s DocumentModel;
 
 Node *narrow(Node *instance, NodeKind kind);
 #define CHECKED_CAST(OBJ, KIND, TYPE) ((TYPE *)narrow((OBJ), (KIND)))
@@ -145,8 +176,23 @@ Document *make_document_node(void);
 Sequence *make_sequence_node(void);
 Mapping  *make_mapping_node(void);
 Scalar   *make_scalar_node(const uint8_t *value, size_t length, ScalarKind kind);
+Scalar   *make_borrowed_scalar_node(const uint8_t *value, size_t length, ScalarKind kind);
 Alias    *make_alias_node(Node *target);
-#define   make_model() make_vector_with_capacity(1)
+
+/*
+ * N.B. - nodes allocated from an arena are never freed individually, their
+ * memory is released all at once with the arena.
+ */
+Document *make_document_node_in(Arena *arena);
+Sequence *make_sequence_node_in(Arena *arena);
+Mapping  *make_mapping_node_in(Arena *arena);
+Scalar   *make_scalar_node_in(Arena *arena, const uint8_t *value, size_t length, ScalarKind kind);
+Scalar   *make_borrowed_scalar_node_in(Arena *arena, const uint8_t *value, size_t length, ScalarKind kind);
+Alias    *make_alias_node_in(Arena *arena, Node *target);
+
+DocumentModel *make_model(void);
+/* the nodes of this model must be allocated from `model->arena', `model_free' releases them all at once */
+DocumentModel *make_model_with_arena(void);
 
 /*
  * Destructors
@@ -160,11 +206,15 @@ void model_free(DocumentModel *value);
  * Model API
  */
 
-#define model_size vector_length
-#define model_document vector_get
-Node   *model_document_root(const DocumentModel *model, size_t index);
+size_t    model_size(const DocumentModel *model);
+Document *model_document(const DocumentModel *model, size_t index);
+Node     *model_document_root(const DocumentModel *model, size_t index);
 
-bool    model_add(DocumentModel *model, Document *doc);
+bool      model_add(DocumentModel *model, Document *doc);
+/* no two models, nor one model before and after it changes, share a generation */
+size_t    model_generation(const DocumentModel *model);
+/* the model takes ownership of the mapped region, and will unmap it when freed */
+void      model_set_source(DocumentModel *model, uint8_t *data, size_t length);
 
 /*
  * Node API
@@ -182,13 +232,26 @@ Node       *node_parent_(const Node *value);
 size_t      node_size_(const Node *value);
 #define     node_size(object) node_size_(node((object)))
 
+/*
+ * Only sequences and mappings loaded from JSON input have a source span,
+ * the result is false for any other node.
+ */
+bool        node_source_(const Node *value, SourceSpan *span);
+#define     node_source(object, span) node_source_(const_node((object)), (span))
+void        node_set_source_(Node *value, size_t offset, size_t length);
+#define     node_set_source(object, offset, length) node_set_source_(node((object)), (offset), (length))
+
 bool        node_equals_(const Node *one, const Node *two);
 #define     node_equals(one, two) node_equals_(const_node((one)), const_node((two)))
 
 void        node_set_tag_(Node *target, const uint8_t *value, size_t length);
 #define     node_set_tag(object, value, length) node_set_tag_(node((object)), (value), (length))
+void        node_set_tag_in_(Arena *arena, Node *target, const uint8_t *value, size_t length);
+#define     node_set_tag_in(arena, object, value, length) node_set_tag_in_((arena), node((object)), (value), (length))
 void        node_set_anchor_(Node *target, const uint8_t *value, size_t length);
 #define     node_set_anchor(object, value, length) node_set_anchor_(node((object)), (value), (length))
+void        node_set_anchor_in_(Arena *arena, Node *target, const uint8_t *value, size_t length);
+#define     node_set_anchor_in(arena, object, value, length) node_set_anchor_in_((arena), node((object)), (value), (length))
 
 #define node(obj) ((Node *)(obj))
 #define const_node(obj) ((const Node *)(obj))
@@ -246,8 +309,13 @@ bool sequence_iterate(const Sequence *seq, sequence_iterator iterator, void *con
  */
 
 Node *mapping_get(const Mapping *map, uint8_t *key, size_t length);
+// N.B. - the hash must come from `mapping_hash_key', it is only stable for the life of the process
+hashcode mapping_hash_key(const uint8_t *key, size_t length);
+Node *mapping_get_with_hash(const Mapping *map, hashcode hash, uint8_t *key, size_t length);
 bool  mapping_contains(const Mapping *map, uint8_t *scalar, size_t length);
+bool  mapping_contains_key(const Mapping *map, Scalar *key);
 bool  mapping_put(Mapping *map, uint8_t *key, size_t length, Node *value);
+bool  mapping_put_scalar(Mapping *map, Scalar *key, Node *value);
 
 typedef bool (*mapping_iterator)(Node *key, Node *value, void *context);
 bool mapping_iterate(const Mapping *map, mapping_iterator iterator, void *context);
@@ -265,3 +333,25 @@ Node *alias_target(const Alias *alias);
 #define alias(obj) (CHECKED_CAST((obj), ALIAS, Alias))
 #define const_alias(obj) (CONST_CHECKED_CAST((obj), ALIAS, Alias))
 #define is_alias(obj) (ALIAS == node_kind(node((obj))))
+
+/*
+ * Name Index API
+ *
+ * An index of the mapping keys in a model that answers a recursive name
+ * query, such as `$..name', without walking the tree.  The index is built
+ * once, on first use unless `eager', and a model that contains aliases is
+ * never indexed.
+ */
+
+typedef struct name_index_s NameIndex;
+
+bool             model_use_name_index(DocumentModel *model, bool eager);
+/* N.B. - the index is NULL if it is not in use, or if it can't be used for this model */
+const NameIndex *model_name_index(DocumentModel *model);
+
+bool name_index_covers(const NameIndex *index, const Node *start);
+
+typedef bool (*name_index_iterator)(Node *value, void *context);
+/* visits the value for `key' in every mapping at or beneath `start', in document order */
+bool name_index_lookup(const NameIndex *index, const Node *start, const uint8_t *key, size_t length, hashcode hash,
+                       name_index_iterator iterator, void *context);
@@ -52,8 +52,12 @@ struct context_adapter_s
 typedef struct context_adapter_s context_adapter;
 
 
+void *node_alloc(Arena *arena, size_t size);
+
 void node_init_(Node *value, NodeKind kind);
 #define node_init(object, kind) node_init_(node((object)), (kind))
 
 bool node_comparitor(const void *one, const void *two);
 
+void name_index_free(NameIndex *index);
+
@@ -37,6 +37,8 @@
 
 #pragma once
 
+#include <stdbool.h>
+
 #include "loader.h"
 
 enum emit_mode
@@ -44,7 +46,18 @@ enum emit_mode
     BASH,
     ZSH,
     JSON,
-    YAML
+    YAML,
+    NDJSON,
+    MSGPACK,
+    CBOR,
+    RAW
+};
+
+enum query_mode
+{
+    QUERY_NODES,
+    QUERY_EXISTS,
+    QUERY_COUNT
 };
 
 enum command
@@ -53,7 +66,9 @@ enum command
     SHOW_WARRANTY,
     SHOW_HELP,
     INTERACTIVE_MODE,
-    EXPRESSION_MODE
+    EXPRESSION_MODE,
+    BATCH_MODE,
+    COMPILE_MODE
 };
 
 typedef enum loader_duplicate_key_strategy dup_strategy;
@@ -62,12 +77,41 @@ struct options
 {
     const char     *input_file_name;
     const char     *expression;
+    /** the file of queries, one per line, that are evaluated together in batch mode */
+    const char     *queries_file_name;
+    /** where to write the snapshot in compile mode */
+    const char     *output_file_name;
     enum command    mode;
     enum emit_mode  emit_mode;
     dup_strategy    duplicate_strategy;
+    enum loader_input_format input_format;
+    bool            memory_map;
+    /** build the name index as soon as the input is loaded */
+    bool            name_index;
+    /** what to report about the selected nodes */
+    enum query_mode query_mode;
+    /** the most nodes to select, or zero for all of them */
+    size_t          limit;
+    /** how many threads a recursive query may use, or zero for one per online CPU */
+    size_t          threads;
+    /** the documents of the input to query, from the first up to but not including the last */
+    size_t          first_document;
+    size_t          last_document;
+    /** evaluate the query on the parser's events, without loading a model, when the path allows it */
+    bool            stream;
+    /** how many parsed queries interactive mode keeps, or zero to parse every one */
+    size_t          path_cache;
+    /** how many selected nodes interactive mode keeps for repeated queries, or zero to evaluate every one */
+    size_t          result_cache;
+    /** precede each response of a non-tty interactive session with a header instead of following it with `EOD' */
+    bool            framing;
 };
 
 enum command process_options(const int argc, char * const *argv, struct options *options);
 
 int32_t parse_emit_mode(const char *valie);
+bool parse_count(const char *value, size_t *count);
+bool parse_document_range(const char *value, size_t *first, size_t *last);
 const char * emit_mode_name(enum emit_mode value);
+/** true for the formats that write binary values rather than text */
+bool is_binary_emit_mode(enum emit_mode value);
@@ -34,6 +34,8 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#include "arena.h"
+
 typedef struct vector_s Vector;
 
 /* Callback Functions */
@@ -45,6 +47,8 @@ typedef void *(*vector_reducer)(const void *one, const void *two, void *context)
 /* Constructors */
 Vector *make_vector(void);
 Vector *make_vector_with_capacity(size_t capacity);
+/* N.B. - vectors allocated from an arena are released with the arena, `vector_free' is a no-op */
+Vector *make_vector_in(Arena *arena, size_t capacity);
 Vector *make_vector_of(size_t count, ...);
 Vector *vector_copy(const Vector *vector);
 Vector *vector_with(const Vector *vector, void *value);
@@ -0,0 +1,309 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "jsonpath.h"
+#include "jsonpath/private.h"
+#include "hashtable.h"
+#include "log.h"
+#include "conditions.h"
+
+/*
+ * The entries are kept in a hashtable keyed by their expressions, and in a
+ * list from the most to the least recently used, so that a lookup moves its
+ * entry to the front and the entry at the back is the one evicted.
+ */
+
+struct cache_entry
+{
+    jsonpath           *path;
+    const uint8_t      *expression;
+    size_t              length;
+    hashcode            hash;
+    struct cache_entry *newer;
+    struct cache_entry *older;
+};
+
+typedef struct cache_entry CacheEntry;
+
+struct path_cache
+{
+    Hashtable  *entries;
+    CacheEntry *newest;
+    CacheEntry *oldest;
+    size_t      size;
+    size_t      capacity;
+    size_t      hits;
+    size_t      misses;
+    size_t      evictions;
+};
+
+struct expression_probe
+{
+    const uint8_t *expression;
+    size_t         length;
+};
+
+static hashcode entry_hash(const void *key);
+static bool entry_comparitor(const void *key1, const void *key2);
+static bool entry_matches(const void *key, const void *probe);
+static void unlink_entry(PathCache *cache, CacheEntry *entry);
+static void link_entry(PathCache *cache, CacheEntry *entry);
+static void evict_oldest(PathCache *cache);
+
+
+PathCache *make_path_cache(size_t capacity)
+{
+    PathCache *cache = calloc(1, sizeof(PathCache));
+    if(NULL == cache)
+    {
+        return NULL;
+    }
+    cache->entries = make_hashtable_with_function(entry_comparitor, entry_hash);
+    if(NULL == cache->entries)
+    {
+        free(cache);
+        return NULL;
+    }
+    cache->capacity = capacity;
+
+    return cache;
+}
+
+void path_cache_free(PathCache *cache)
+{
+    if(NULL == cache)
+    {
+        return;
+    }
+    path_cache_clear(cache);
+    hashtable_free(cache->entries);
+    free(cache);
+}
+
+jsonpath *path_cache_get(PathCache *cache, const uint8_t *expression, size_t length)
+{
+    PRECOND_NONNULL_ELSE_NULL(cache, expression);
+
+    struct expression_probe probe = {expression, length};
+    CacheEntry *entry = hashtable_get_probe(cache->entries, wyhash_string_buffer_hash(expression, length), entry_matches, &probe);
+    if(NULL == entry)
+    {
+        cache->misses++;
+        return NULL;
+    }
+
+    cache->hits++;
+    if(cache->newest != entry)
+    {
+        unlink_entry(cache, entry);
+        link_entry(cache, entry);
+    }
+    return entry->path;
+}
+
+bool path_cache_put(PathCache *cache, jsonpath *path)
+{
+    PRECOND_NONNULL_ELSE_FALSE(cache, path);
+
+    if(0 == cache->capacity)
+    {
+        return false;
+    }
+    CacheEntry *entry = calloc(1, sizeof(CacheEntry));
+    if(NULL == entry)
+    {
+        return false;
+    }
+    entry->path = path;
+    entry->expression = path_expression(path);
+    entry->length = path_expression_length(path);
+    entry->hash = wyhash_string_buffer_hash(entry->expression, entry->length);
+
+    struct expression_probe probe = {entry->expression, entry->length};
+    if(hashtable_contains_probe(cache->entries, entry->hash, entry_matches, &probe))
+    {
+        parser_debug("path cache: the expression is already cached, not replacing it");
+        free(entry);
+        return false;
+    }
+    if(cache->size == cache->capacity)
+    {
+        evict_oldest(cache);
+    }
+
+    errno = 0;
+    hashtable_put(cache->entries, entry, entry);
+    if(0 != errno)
+    {
+        free(entry);
+        return false;
+    }
+    link_entry(cache, entry);
+    cache->size++;
+
+    return true;
+}
+
+void path_cache_clear(PathCache *cache)
+{
+    if(NULL == cache)
+    {
+        return;
+    }
+    while(NULL != cache->oldest)
+    {
+        evict_oldest(cache);
+    }
+}
+
+void path_cache_resize(PathCache *cache, size_t capacity)
+{
+    if(NULL == cache)
+    {
+        return;
+    }
+    while(cache->size > capacity)
+    {
+        evict_oldest(cache);
+    }
+    cache->capacity = capacity;
+}
+
+size_t path_cache_size(const PathCache *cache)
+{
+    PRECOND_NONNULL_ELSE_ZERO(cache);
+    return cache->size;
+}
+
+size_t path_cache_capacity(const PathCache *cache)
+{
+    PRECOND_NONNULL_ELSE_ZERO(cache);
+    return cache->capacity;
+}
+
+size_t path_cache_hits(const PathCache *cache)
+{
+    PRECOND_NONNULL_ELSE_ZERO(cache);
+    return cache->hits;
+}
+
+size_t path_cache_misses(const PathCache *cache)
+{
+    PRECOND_NONNULL_ELSE_ZERO(cache);
+    return cache->misses;
+}
+
+size_t path_cache_evictions(const PathCache *cache)
+{
+    PRECOND_NONNULL_ELSE_ZERO(cache);
+    return cache->evictions;
+}
+
+static hashcode entry_hash(const void *key)
+{
+    return ((const CacheEntry *)key)->hash;
+}
+
+static bool entry_comparitor(const void *key1, const void *key2)
+{
+    const CacheEntry *one = (const CacheEntry *)key1;
+    const CacheEntry *two = (const CacheEntry *)key2;
+    return one->length == two->length && 0 == memcmp(one->expression, two->expression, one->length);
+}
+
+static bool entry_matches(const void *key, const void *probe)
+{
+    const CacheEntry *entry = (const CacheEntry *)key;
+    const struct expression_probe *expression = (const struct expression_probe *)probe;
+    return entry->length == expression->length && 0 == memcmp(entry->expression, expression->expression, entry->length);
+}
+
+static void unlink_entry(PathCache *cache, CacheEntry *entry)
+{
+    if(NULL == entry->newer)
+    {
+        cache->newest = entry->older;
+    }
+    else
+    {
+        entry->newer->older = entry->older;
+    }
+    if(NULL == entry->older)
+    {
+        cache->oldest = entry->newer;
+    }
+    else
+    {
+        entry->older->newer = entry->newer;
+    }
+    entry->newer = NULL;
+    entry->older = NULL;
+}
+
+static void link_entry(PathCache *cache, CacheEntry *entry)
+{
+    entry->older = cache->newest;
+    entry->newer = NULL;
+    if(NULL != cache->newest)
+    {
+        cache->newest->newer = entry;
+    }
+    cache->newest = entry;
+    if(NULL == cache->oldest)
+    {
+        cache->oldest = entry;
+    }
+}
+
+static void evict_oldest(PathCache *cache)
+{
+    CacheEntry *entry = cache->oldest;
+    if(NULL == entry)
+    {
+        return;
+    }
+    debug_string("path cache: evicting '%s'", entry->expression, entry->length);
+    unlink_entry(cache, entry);
+    hashtable_remove(cache->entries, entry);
+    path_free(entry->path);
+    free(entry);
+    cache->size--;
+    cache->evictions++;
+}
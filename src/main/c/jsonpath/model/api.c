@@ -36,13 +36,44 @@
  */
 
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
 
 #include "jsonpath.h"
 #include "jsonpath/private.h"
 #include "conditions.h"
 
+struct canonical_buffer
+{
+    char  *data;
+    size_t length;
+    size_t capacity;
+    bool   failed;
+};
+
+typedef struct canonical_buffer canonical_buffer;
+
+static const char * const TYPE_TEST_SYNTAX[] =
+{
+    "object()",
+    "array()",
+    "string()",
+    "number()",
+    "boolean()",
+    "null()"
+};
+
 static bool slice_predicate_has(const predicate *value, enum slice_specifiers specifier);
 
+static void write_canonical_path(canonical_buffer *buffer, const jsonpath *path);
+static void write_canonical_step(canonical_buffer *buffer, const step *each, bool first);
+static void write_canonical_name(canonical_buffer *buffer, const uint8_t *name, size_t length);
+static void write_canonical_predicate(canonical_buffer *buffer, const predicate *value);
+static void append(canonical_buffer *buffer, const char *value, size_t length);
+static void append_string(canonical_buffer *buffer, const char *value);
+static void append_integer(canonical_buffer *buffer, intmax_t value);
+
 static void step_free(step *step);
 static void predicate_free(predicate *predicate);
 
@@ -124,6 +155,166 @@ size_t path_expression_length(const jsonpath *path)
     return path->expr_length;
 }
 
+/*
+ * The canonical form spells every path that selects the same nodes in the
+ * same way: whitespace is dropped, names are quoted only when they must be,
+ * and slices are written out with all of their parts.
+ */
+char *path_canonical_form(const jsonpath *path)
+{
+    PRECOND_NONNULL_ELSE_NULL(path);
+
+    canonical_buffer buffer = {NULL, 0, 0, false};
+    write_canonical_path(&buffer, path);
+    append(&buffer, "", 1);
+    if(buffer.failed)
+    {
+        free(buffer.data);
+        return NULL;
+    }
+    return buffer.data;
+}
+
+static void write_canonical_path(canonical_buffer *buffer, const jsonpath *path)
+{
+    for(size_t i = 0; i < path_length(path); i++)
+    {
+        write_canonical_step(buffer, path_get(path, i), 0 == i);
+    }
+}
+
+static void write_canonical_step(canonical_buffer *buffer, const step *each, bool first)
+{
+    switch(step_kind(each))
+    {
+        case ROOT:
+            append_string(buffer, "$");
+            break;
+        case SINGLE:
+            append_string(buffer, first ? "" : ".");
+            break;
+        case RECURSIVE:
+            append_string(buffer, "..");
+            break;
+    }
+    if(ROOT != step_kind(each))
+    {
+        switch(step_test_kind(each))
+        {
+            case WILDCARD_TEST:
+                append_string(buffer, "*");
+                break;
+            case NAME_TEST:
+                write_canonical_name(buffer, name_test_step_name(each), name_test_step_length(each));
+                break;
+            case TYPE_TEST:
+                append_string(buffer, TYPE_TEST_SYNTAX[type_test_step_kind(each)]);
+                break;
+        }
+    }
+    if(step_has_predicate(each))
+    {
+        write_canonical_predicate(buffer, step_predicate(each));
+    }
+}
+
+static void write_canonical_name(canonical_buffer *buffer, const uint8_t *name, size_t length)
+{
+    bool plain = 0 != length;
+    for(size_t i = 0; plain && i < length; i++)
+    {
+        plain = ('a' <= name[i] && 'z' >= name[i]) || ('A' <= name[i] && 'Z' >= name[i]) ||
+            ('0' <= name[i] && '9' >= name[i]) || '_' == name[i] || '-' == name[i] || 0x80 <= name[i];
+    }
+    if(plain)
+    {
+        append(buffer, (const char *)name, length);
+        return;
+    }
+    append_string(buffer, "'");
+    for(size_t i = 0; i < length; i++)
+    {
+        if('\'' == name[i] || '\\' == name[i])
+        {
+            append_string(buffer, "\\");
+        }
+        append(buffer, (const char *)name + i, 1);
+    }
+    append_string(buffer, "'");
+}
+
+static void write_canonical_predicate(canonical_buffer *buffer, const predicate *value)
+{
+    append_string(buffer, "[");
+    switch(predicate_kind(value))
+    {
+        case WILDCARD:
+            append_string(buffer, "*");
+            break;
+        case SUBSCRIPT:
+            append_integer(buffer, (intmax_t)subscript_predicate_index(value));
+            break;
+        case SLICE:
+            if(slice_predicate_has_from(value))
+            {
+                append_integer(buffer, slice_predicate_from(value));
+            }
+            append_string(buffer, ":");
+            if(slice_predicate_has_to(value))
+            {
+                append_integer(buffer, slice_predicate_to(value));
+            }
+            append_string(buffer, ":");
+            append_integer(buffer, slice_predicate_has_step(value) ? slice_predicate_step(value) : 1);
+            break;
+        case JOIN:
+            write_canonical_path(buffer, join_predicate_left(value));
+            append_string(buffer, ",");
+            write_canonical_path(buffer, join_predicate_right(value));
+            break;
+    }
+    append_string(buffer, "]");
+}
+
+static void append(canonical_buffer *buffer, const char *value, size_t length)
+{
+    // N.B. - the data is still NULL before the first append, and memcpy mustn't be given a NULL pointer
+    if(buffer->failed || 0 == length)
+    {
+        return;
+    }
+    if(buffer->length + length > buffer->capacity)
+    {
+        size_t capacity = 0 == buffer->capacity ? 64 : buffer->capacity;
+        while(buffer->length + length > capacity)
+        {
+            capacity *= 2;
+        }
+        char *data = realloc(buffer->data, capacity);
+        if(NULL == data)
+        {
+            buffer->failed = true;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->length, value, length);
+    buffer->length += length;
+}
+
+static void append_string(canonical_buffer *buffer, const char *value)
+{
+    append(buffer, value, strlen(value));
+}
+
+static void append_integer(canonical_buffer *buffer, intmax_t value)
+{
+    char digits[24];
+    int length = snprintf(digits, sizeof(digits), "%" PRIdMAX, value);
+    append(buffer, digits, (size_t)length);
+}
+
 enum path_kind path_kind(const jsonpath *path)
 {
     return path->kind;
@@ -41,6 +41,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <unistd.h>
 #include <errno.h>
@@ -56,6 +57,7 @@
 #include "jsonpath.h"
 #include "evaluator.h"
 #include "emit.h"
+#include "emit/frame.h"
 #include "log.h"
 #include "version.h"
 #include "linenoise.h"
@@ -63,13 +65,44 @@
 static const char * const DEFAULT_PROGRAM_NAME = "kanabo";
 
 static const char * const HELP =
-    "usage: kanabo [-o <format>] [-d <strategy>] -q <jsonpath> [<file> | '-']\n"
-    "       kanabo [-o <format>] [-d <strategy>] [<file>]\n"
+    "usage: kanabo [-o <format>] [-d <strategy>] [-i <format>] [-m] [-x] [-t <n>] [-D <range>] [-l <n>] [-e | -n] [-s] -q <jsonpath> [<file> | '-']\n"
+    "       kanabo [-o <format>] [-d <strategy>] [-i <format>] [-m] [-x] [-D <range>] [-l <n>] [-e | -n] -Q <queries> [<file> | '-']\n"
+    "       kanabo [-o <format>] [-d <strategy>] [-i <format>] [-m] [-x] [-t <n>] [-D <range>] [-p <n>] [-r <n>] [-f] [<file>]\n"
+    "       kanabo [-d <strategy>] [-i <format>] [-m] -c <file> [-o <snapshot>]\n"
     "\n"
     "OPTIONS:\n"
     "-q, --query <jsonpath>      Specify a single JSONPath query to execute against the input document and exit.\n"
-    "-o, --output <format>       Specify the output format (`bash' (default), `zsh', `json' or `yaml').\n"
+    "-Q, --queries <queries>     Execute every JSONPath query in the file <queries>, one per line, in a single pass and exit.\n"
+    "                            The results of each query follow a `# <n>' line, numbered from zero, and `-l' applies to each.\n"
+    "                            With `-e', `true' or `false' is printed for each query.  Blank lines, and lines starting\n"
+    "                            with `#', are skipped.  <queries> may be `-' for stdin.\n"
+    "-c, --compile <file>        Write a snapshot of the input document, that loads without parsing, and exit.\n"
+    "                            The snapshot is written to <snapshot> if given, or beside <file> with a `.kbo' extension.\n"
+    "-o, --output <format>       Specify the output format (`bash' (default), `zsh', `json', `yaml', `ndjson',\n"
+    "                            `msgpack', `cbor' or `raw').  `ndjson' writes each node as JSON on a line of its own, as\n"
+    "                            soon as it is selected.  `msgpack' and `cbor' write each node as a value of its own, with\n"
+    "                            numbers, booleans and nulls as native values.  `raw' writes JSON, copying the text of\n"
+    "                            objects and arrays from a JSON input file as it is, which implies `--mmap'.\n"
     "-d, --duplicate <strategy>  Specify how to handle duplicate mapping keys (`clobber' (default), `warn' or `fail').\n"
+    "-i, --input-format <format> Specify the input format (`auto' (default), `yaml' or `json').\n"
+    "-m, --mmap                  Map the input file into memory instead of reading it (ignored for stdin).\n"
+    "-l, --limit <n>             Stop evaluating once <n> nodes have been selected (`0' (default) selects all of them).\n"
+    "-e, --exists                Print nothing, exit with a zero status only if the query selects at least one node.\n"
+    "-n, --count                 Print the number of selected nodes instead of the nodes themselves.\n"
+    "-x, --index                 Index the mapping keys of the input when it is loaded, to speed up `..name' queries.\n"
+    "                            In interactive mode the index is always built, on the first `..name' query by default.\n"
+    "-t, --threads <n>           Split recursive queries over <n> threads (`1' (default), or `0' for one per CPU).\n"
+    "                            When the input has several documents, whole documents are split over the threads.\n"
+    "-D, --documents <range>     Only query the documents in <range> of the input, numbered from zero (default: all of them).\n"
+    "                            <range> is either a single document `<n>' or `[<first>]:[<last>]', not including <last>.\n"
+    "-p, --path-cache <n>        Keep up to <n> parsed queries in interactive mode (`64' (default), or `0' to parse each one).\n"
+    "-r, --result-cache <n>      Keep the results of queries, up to <n> nodes, in interactive mode (`1000000' (default), or `0').\n"
+    "-f, --framing               When stdin is not a tty, precede each interactive response with a `<status> <n> <length>'\n"
+    "                            line instead of following it with `EOD'.  <status> is `OK' or `ERR', <n> is the number of\n"
+    "                            selected nodes (`0' for `ERR') and <length> is the size of the response in bytes.\n"
+    "-s, --stream                Evaluate the query as the input is read, keeping only the selected nodes in memory.\n"
+    "                            Queries with join predicates or negative slices, and snapshots, are loaded as usual.\n"
+    "                            Nodes are written once no later input can change them, `-m', `-x' and `-t' are ignored.\n"
     "\n"
     "STANDALONE OPTIONS:\n"
     "-v, --version               Print the version information and exit.\n"
@@ -84,8 +117,18 @@ static const char * const INTERACTIVE_HELP =
     "The following commands can be used, any other input is treated as JSONPath.\n"
     "\n"
     ":load <path>             Load JSON/YAML data from the file <path>.\n"
-    ":output [<format>]       Get/set the output format. (`bash', `zsh', `json' and `yaml' are supported).\n"
-    ":duplicate [<strategy>]  Get/set the strategy to handle duplicate mapping keys (`clobber' (default), `warn' or `fail').\n";
+    ":output [<format>]       Get/set the output format. (`bash', `zsh', `json', `yaml', `ndjson', `msgpack', `cbor' and `raw' are supported).\n"
+    ":duplicate [<strategy>]  Get/set the strategy to handle duplicate mapping keys (`clobber' (default), `warn' or `fail').\n"
+    ":input [<format>]        Get/set the input format (`auto' (default), `yaml' or `json').\n"
+    ":limit [<n>]             Get/set the most nodes a query selects (`0' (default) selects all of them).\n"
+    ":threads [<n>]           Get/set how many threads a recursive query uses (`0' uses one per CPU).\n"
+    ":documents [<range>]     Get/set the range of documents to query (`<n>' or `[<first>]:[<last>]', default `0:').\n"
+    ":exists <jsonpath>       Print `true' if the JSONPath selects at least one node, otherwise `false'.\n"
+    ":count <jsonpath>        Print the number of nodes selected by the JSONPath.\n"
+    ":batch <path>            Evaluate every JSONPath in the file <path>, one per line, in a single pass.\n"
+    ":path-cache [<n>]        Get/set how many parsed JSONPaths are kept (`0' parses every one).\n"
+    ":cache [clear | <n>]     List the cached results, empty the caches, or set how many nodes of results are kept.\n"
+    ":stats                   Print the number of hits and misses of the caches.\n";
 
 #define is_stdin_filename(NAME) \
     0 == memcmp("-", (NAME), 1)
@@ -96,8 +139,18 @@ static const char * const INTERACTIVE_HELP =
 #define get_input_name(NAME) \
     use_stdin((NAME)) ? "stdin" : (NAME)
 
+static const char * const SNAPSHOT_EXTENSION = ".kbo";
+
 static const char *program_name = NULL;
 static bool is_interactive = false;
+/* the parsed queries of an interactive session, by expression */
+static PathCache *path_cache = NULL;
+/* the results of the queries of an interactive session, for the current model */
+static ResultCache *result_cache = NULL;
+/* the emitters write the results to stdout through this, rather than through stdio */
+static Writer *output = NULL;
+/* the response being captured, with `--framing' */
+static struct frame *frame = NULL;
 
 #define kanabo_debug(FORMAT, ...) log_debug(program_name, (FORMAT), ##__VA_ARGS__)
 #define kanabo_trace(FORMAT, ...) log_trace(program_name, (FORMAT), ##__VA_ARGS__)
@@ -106,16 +159,21 @@ static bool is_interactive = false;
 __attribute__((__format__ (__printf__, 1, 2)))
 static void error(const char *format, ...)
 {
+    if(NULL != frame)
+    {
+        fail_frame(frame);
+    }
     va_list rest;
-    if(is_interactive)
+    if(is_interactive && NULL == frame)
     {
         fputs(program_name, stderr);
         fputs(": ", stderr);
     }
     va_start(rest, format);
-    vfprintf(stderr, format, rest);
+    FILE *stream = NULL == frame ? stderr : stdout;
+    vfprintf(stream, format, rest);
     va_end(rest);
-    fputc('\n', stderr);
+    fputc('\n', stream);
 }
 
 static jsonpath *parse_expression(const char *expression)
@@ -151,10 +209,56 @@ static jsonpath *parse_expression(const char *expression)
     return path;
 }
 
-static nodelist *evaluate_expression(const jsonpath *path, const DocumentModel *model)
+/*
+ * Parses the expression, or finds it in the path cache in interactive mode.
+ * A cached path is owned by the cache, so `cached' tells whether it is left
+ * to `release_expression' to free it.
+ */
+static jsonpath *get_expression(const char *expression, bool *cached)
+{
+    *cached = false;
+    if(NULL != path_cache)
+    {
+        jsonpath *path = path_cache_get(path_cache, (const uint8_t *)expression, strlen(expression));
+        if(NULL != path)
+        {
+            kanabo_trace("found expression in the path cache");
+            *cached = true;
+            return path;
+        }
+    }
+
+    jsonpath *path = parse_expression(expression);
+    if(NULL != path && NULL != path_cache)
+    {
+        *cached = path_cache_put(path_cache, path);
+    }
+    return path;
+}
+
+static void release_expression(jsonpath *path, bool cached)
+{
+    if(!cached)
+    {
+        path_free(path);
+    }
+}
+
+static size_t thread_count(size_t threads)
+{
+    if(0 != threads)
+    {
+        return threads;
+    }
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return 0 < online ? (size_t)online : 1;
+}
+
+static nodelist *evaluate_expression(const jsonpath *path, const DocumentModel *model, const evaluator_options *options)
 {
-    kanabo_trace("evaluating expression");
-    MaybeNodelist maybe = evaluate(model, path);
+    kanabo_trace("evaluating expression, limit: %zu, threads: %zu, documents: %zu to %zu",
+                 options->limit, options->threads, options->first_document, options->last_document);
+    MaybeNodelist maybe = evaluate_with_options(model, path, options);
     if(NOTHING == maybe.tag)
     {
         char *expression = (char *)path_expression(path);
@@ -164,58 +268,298 @@ static nodelist *evaluate_expression(const jsonpath *path, const DocumentModel *
     return maybe.just;
 }
 
-static emit_function get_emitter(enum emit_mode emit_mode)
+static Emitter get_emitter(enum emit_mode emit_mode, const DocumentModel *model)
 {
-    emit_function result = NULL;
+    // N.B. - anything already printed through stdio must come before the results
+    fflush(stdout);
+
+    Emitter result = {0};
     switch(emit_mode)
     {
         case BASH:
             kanabo_debug("using bash emitter");
-            result = emit_bash;
+            result = make_bash_emitter(output);
             break;
         case ZSH:
             kanabo_debug("using zsh emitter");
-            result = emit_zsh;
+            result = make_zsh_emitter(output);
             break;
         case JSON:
             kanabo_debug("using json emitter");
-            result = emit_json;
+            result = make_json_emitter(output);
             break;
         case YAML:
             kanabo_debug("using yaml emitter");
-            result = emit_yaml;
+            result = make_yaml_emitter(output);
+            break;
+        case NDJSON:
+            kanabo_debug("using ndjson emitter");
+            result = make_ndjson_emitter(output);
+            break;
+        case MSGPACK:
+            kanabo_debug("using msgpack emitter");
+            result = make_msgpack_emitter(output);
+            break;
+        case CBOR:
+            kanabo_debug("using cbor emitter");
+            result = make_cbor_emitter(output);
+            break;
+        case RAW:
+            kanabo_debug("using raw emitter");
+            result = make_raw_emitter(output, model);
             break;
     }
 
     return result;
 }
 
-static int apply_expression(const char *expression, DocumentModel *model, enum emit_mode emit_mode)
+static int report_count(size_t count, const struct options *options)
+{
+    int result = EXIT_SUCCESS;
+    if(QUERY_EXISTS == options->query_mode)
+    {
+        kanabo_debug("reporting existence of matching nodes");
+        result = 0 == count ? EXIT_FAILURE : EXIT_SUCCESS;
+        // N.B. - outside of interactive mode the exit status is the only output
+        if(is_interactive)
+        {
+            fputs(EXIT_SUCCESS == result ? "true\n" : "false\n", stdout);
+        }
+    }
+    else
+    {
+        kanabo_debug("reporting count of matching nodes");
+        fprintf(stdout, "%zu\n", count);
+    }
+
+    return result;
+}
+
+static int report_results(const nodelist *list, const DocumentModel *model, const struct options *options)
+{
+    int result = EXIT_SUCCESS;
+    if(NULL != frame)
+    {
+        frame->matches += nodelist_length(list);
+    }
+    switch(options->query_mode)
+    {
+        case QUERY_NODES:
+        {
+            Emitter emitter = get_emitter(options->emit_mode, model);
+            if(!emit_nodelist(&emitter, list))
+            {
+                error("unable to emit results");
+            }
+            break;
+        }
+        case QUERY_EXISTS:
+        case QUERY_COUNT:
+            result = report_count(nodelist_length(list), options);
+            break;
+    }
+
+    return result;
+}
+
+static int apply_expression(const char *expression, DocumentModel *model, const struct options *options)
 {
     kanabo_debug("evaluating expression: \"%s\"", expression);
-    jsonpath *path = parse_expression(expression);
+    bool cached = false;
+    jsonpath *path = get_expression(expression, &cached);
     if(NULL == path)
     {
         return EXIT_FAILURE;
     }
 
-    nodelist *list = evaluate_expression(path, model);
-    if(NULL == list)
+    evaluator_options evaluation = EVALUATOR_DEFAULTS;
+    // N.B. - one node is enough to know that the path matches
+    evaluation.limit = QUERY_EXISTS == options->query_mode ? 1 : options->limit;
+    evaluation.threads = thread_count(options->threads);
+    evaluation.first_document = options->first_document;
+    evaluation.last_document = options->last_document;
+
+    // N.B. - a cached result is owned by the cache, like a cached path
+    nodelist *list = NULL == result_cache ? NULL : result_cache_get(result_cache, model, path, &evaluation);
+    bool memoized = NULL != list;
+    if(memoized)
     {
-        path_free(path);
-        return EXIT_FAILURE;
+        kanabo_trace("found the results of the expression in the result cache");
     }
+    else
+    {
+        list = evaluate_expression(path, model, &evaluation);
+        if(NULL == list)
+        {
+            release_expression(path, cached);
+            return EXIT_FAILURE;
+        }
+        memoized = NULL != result_cache && result_cache_put(result_cache, model, path, &evaluation, list);
+    }
+
+    int result = report_results(list, model, options);
 
-    emit_function emitter = get_emitter(emit_mode);
-    if(!emitter(list))
+    release_expression(path, cached);
+    if(!memoized)
     {
-        error("unable to emit results");
+        nodelist_free(list);
     }
 
-    path_free(path);
-    nodelist_free(list);
+    return result;
+}
 
-    return EXIT_SUCCESS;
+static void free_queries(jsonpath **paths, size_t count)
+{
+    for(size_t i = 0; NULL != paths && i < count; i++)
+    {
+        path_free(paths[i]);
+    }
+    free(paths);
+}
+
+static bool add_query(char *line, jsonpath ***paths, size_t *count, size_t *capacity)
+{
+    size_t length = strlen(line);
+    while(0 < length && isspace((unsigned char)line[length - 1]))
+    {
+        line[--length] = '\0';
+    }
+    if(0 == length || '#' == line[0])
+    {
+        return true;
+    }
+
+    if(*count == *capacity)
+    {
+        size_t larger = 0 == *capacity ? 16 : *capacity * 2;
+        jsonpath **grown = realloc(*paths, larger * sizeof(jsonpath *));
+        if(NULL == grown)
+        {
+            error("while reading the queries: %s", strerror(errno));
+            return false;
+        }
+        *paths = grown;
+        *capacity = larger;
+    }
+    jsonpath *path = parse_expression(line);
+    if(NULL == path)
+    {
+        return false;
+    }
+    (*paths)[(*count)++] = path;
+    return true;
+}
+
+/*
+ * Parses every query in the file before any of them are evaluated, so that
+ * a mistake in one of them is reported without loading the input.
+ */
+static jsonpath **read_queries(const char *queries_file_name, size_t *count)
+{
+    FILE *queries = stdin;
+    if(!(use_stdin(queries_file_name)))
+    {
+        kanabo_debug("reading queries from file: '%s'", queries_file_name);
+        errno = 0;
+        queries = fopen(queries_file_name, "r");
+    }
+    if(NULL == queries)
+    {
+        error("while reading '%s': %s", queries_file_name, strerror(errno));
+        return NULL;
+    }
+
+    jsonpath **paths = NULL;
+    size_t capacity = 0;
+    char *line = NULL;
+    size_t length = 0;
+    bool result = true;
+    *count = 0;
+    errno = 0;
+    while(result && -1 != getline(&line, &length, queries))
+    {
+        result = add_query(line, &paths, count, &capacity);
+    }
+    if(result && ferror(queries))
+    {
+        error("while reading '%s': %s", get_input_name(queries_file_name), strerror(errno));
+        result = false;
+    }
+    free(line);
+    if(stdin != queries)
+    {
+        fclose(queries);
+    }
+
+    if(!result)
+    {
+        free_queries(paths, *count);
+        return NULL;
+    }
+    kanabo_debug("read %zu queries", *count);
+    // N.B. - an empty batch is still a success, it just has nothing to report
+    return NULL == paths ? calloc(1, sizeof(jsonpath *)) : paths;
+}
+
+static int report_batch(const Batch *batch, const DocumentModel *model, const struct options *options)
+{
+    int result = EXIT_SUCCESS;
+    for(size_t i = 0; i < batch->count; i++)
+    {
+        fprintf(stdout, "# %zu\n", i);
+        const nodelist *list = batch->results[i];
+        if(NULL != frame)
+        {
+            frame->matches += nodelist_length(list);
+        }
+        switch(options->query_mode)
+        {
+            case QUERY_NODES:
+            {
+                Emitter emitter = get_emitter(options->emit_mode, model);
+                if(!emit_nodelist(&emitter, list))
+                {
+                    error("unable to emit results");
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case QUERY_EXISTS:
+                // N.B. - the exit status can't tell which of the queries matched, so each is printed
+                fputs(nodelist_is_empty(list) ? "false\n" : "true\n", stdout);
+                if(nodelist_is_empty(list))
+                {
+                    result = EXIT_FAILURE;
+                }
+                break;
+            case QUERY_COUNT:
+                fprintf(stdout, "%zu\n", nodelist_length(list));
+                break;
+        }
+    }
+
+    return result;
+}
+
+static int apply_batch(jsonpath * const *paths, size_t count, DocumentModel *model, const struct options *options)
+{
+    kanabo_debug("evaluating a batch of %zu expressions", count);
+    evaluator_options evaluation = EVALUATOR_DEFAULTS;
+    evaluation.limit = QUERY_EXISTS == options->query_mode ? 1 : options->limit;
+    evaluation.first_document = options->first_document;
+    evaluation.last_document = options->last_document;
+
+    MaybeBatch maybe = evaluate_batch(model, paths, count, &evaluation);
+    if(NOTHING == maybe.tag)
+    {
+        error("while evaluating the queries: %s", maybe.nothing.message);
+        return EXIT_FAILURE;
+    }
+
+    int result = report_batch(maybe.just, model, options);
+    batch_free(maybe.just);
+
+    return result;
 }
 
 static FILE *open_input(const char *input_file_name)
@@ -245,30 +589,71 @@ static void close_input(FILE *input)
     fclose(input);
 }
 
-static DocumentModel *load_document(const char *input_file_name, dup_strategy strategy)
+static MaybeDocument read_document(const char *input_file_name, dup_strategy strategy, enum loader_input_format format)
 {
     FILE *input = open_input(input_file_name);
     if(NULL == input)
     {
-        const char *name = get_input_name(input_file_name);
-        error("while reading '%s': %s", name, strerror(errno));
-        return NULL;
+        return (MaybeDocument){.tag=NOTHING, .nothing={ERR_READER_FAILED, NULL}};
     }
 
-    MaybeDocument maybe = load_file(input, strategy);
+    MaybeDocument maybe = load_file_with_format(input, strategy, format);
     close_input(input);
+
+    return maybe;
+}
+
+static MaybeDocument map_document(const char *input_file_name, dup_strategy strategy, enum loader_input_format format)
+{
+    kanabo_debug("mapping file: '%s'", input_file_name);
+    errno = 0;
+    MaybeDocument maybe = load_mapped_with_format(input_file_name, strategy, format);
+    if(NOTHING == maybe.tag && ERR_READER_FAILED == maybe.nothing.code && 0 != errno)
+    {
+        free(maybe.nothing.message);
+        maybe.nothing.message = NULL;
+    }
+
+    return maybe;
+}
+
+static bool is_snapshot_name(const char *input_file_name)
+{
+    size_t length = strlen(input_file_name);
+    size_t extension = strlen(SNAPSHOT_EXTENSION);
+
+    return length > extension && 0 == strcmp(SNAPSHOT_EXTENSION, input_file_name + length - extension);
+}
+
+static DocumentModel *load_document(const char *input_file_name, const struct options *options)
+{
+    MaybeDocument maybe;
+    // N.B. - snapshots are always mapped, so that their scalars needn't be copied, and raw output copies from the mapping
+    if(!(use_stdin(input_file_name)) && (options->memory_map || RAW == options->emit_mode || is_snapshot_name(input_file_name)))
+    {
+        maybe = map_document(input_file_name, options->duplicate_strategy, options->input_format);
+    }
+    else
+    {
+        maybe = read_document(input_file_name, options->duplicate_strategy, options->input_format);
+    }
+
     if(NOTHING == maybe.tag)
     {
         const char *name = get_input_name(input_file_name);
-        error("while reading '%s': %s", name, maybe.nothing.message);
+        // N.B. - a missing message means the failure was reported by the system
+        error("while reading '%s': %s", name, NULL == maybe.nothing.message ? strerror(errno) : maybe.nothing.message);
         free(maybe.nothing.message);
 
         return NULL;
     }
-    else
+
+    // N.B. - an interactive session queries the same model repeatedly, so it always uses the index
+    if((options->name_index || is_interactive) && !model_use_name_index(maybe.just, options->name_index))
     {
-        return maybe.just;
+        error("while indexing '%s': %s", get_input_name(input_file_name), strerror(errno));
     }
+    return maybe.just;
 }
 
 static void output_command(const char *argument, struct options *options)
@@ -313,6 +698,231 @@ static void duplicate_command(const char *argument, struct options *options)
     options->duplicate_strategy = (enum loader_duplicate_key_strategy)strategy;
 }
 
+static void input_command(const char *argument, struct options *options)
+{
+    kanabo_debug("processing input command...");
+    if(!argument)
+    {
+        kanabo_trace("no command argument, printing current value");
+        fputs(input_format_name(options->input_format), stdout);
+        fputc('\n', stdout);
+        return;
+    }
+
+    int32_t format = parse_input_format(argument);
+    if(-1 == format)
+    {
+        error("unsupported input format `%s'", argument);
+        return;
+    }
+
+    kanabo_debug("setting value to: %s", argument);
+    options->input_format = (enum loader_input_format)format;
+}
+
+static void limit_command(const char *argument, struct options *options)
+{
+    kanabo_debug("processing limit command...");
+    if(!argument)
+    {
+        kanabo_trace("no command argument, printing current value");
+        fprintf(stdout, "%zu\n", options->limit);
+        return;
+    }
+
+    size_t limit = 0;
+    if(!parse_count(argument, &limit))
+    {
+        error("invalid limit `%s'", argument);
+        return;
+    }
+
+    kanabo_debug("setting value to: %zu", limit);
+    options->limit = limit;
+}
+
+static void threads_command(const char *argument, struct options *options)
+{
+    kanabo_debug("processing threads command...");
+    if(!argument)
+    {
+        kanabo_trace("no command argument, printing current value");
+        fprintf(stdout, "%zu\n", options->threads);
+        return;
+    }
+
+    size_t threads = 0;
+    if(!parse_count(argument, &threads))
+    {
+        error("invalid thread count `%s'", argument);
+        return;
+    }
+
+    kanabo_debug("setting value to: %zu", threads);
+    options->threads = threads;
+}
+
+static void documents_command(const char *argument, struct options *options)
+{
+    kanabo_debug("processing documents command...");
+    if(!argument)
+    {
+        kanabo_trace("no command argument, printing current value");
+        if(SIZE_MAX == options->last_document)
+        {
+            fprintf(stdout, "%zu:\n", options->first_document);
+        }
+        else
+        {
+            fprintf(stdout, "%zu:%zu\n", options->first_document, options->last_document);
+        }
+        return;
+    }
+
+    size_t first = 0, last = 0;
+    if(!parse_document_range(argument, &first, &last))
+    {
+        error("invalid document range `%s'", argument);
+        return;
+    }
+
+    kanabo_debug("setting value to: %zu to %zu", first, last);
+    options->first_document = first;
+    options->last_document = last;
+}
+
+static void path_cache_command(const char *argument, struct options *options)
+{
+    kanabo_debug("processing path cache command...");
+    if(!argument)
+    {
+        kanabo_trace("no command argument, printing current value");
+        fprintf(stdout, "%zu\n", options->path_cache);
+        return;
+    }
+
+    size_t capacity = 0;
+    if(!parse_count(argument, &capacity))
+    {
+        error("invalid path cache size `%s'", argument);
+        return;
+    }
+
+    kanabo_debug("setting value to: %zu", capacity);
+    options->path_cache = capacity;
+    path_cache_resize(path_cache, capacity);
+}
+
+static void stats_command(void)
+{
+    kanabo_debug("processing stats command...");
+    fprintf(stdout, "path cache: %zu of %zu paths, %zu hits, %zu misses, %zu evictions\n",
+            path_cache_size(path_cache), path_cache_capacity(path_cache),
+            path_cache_hits(path_cache), path_cache_misses(path_cache), path_cache_evictions(path_cache));
+    fprintf(stdout, "result cache: %zu results, %zu of %zu nodes, %zu hits, %zu misses, %zu evictions\n",
+            result_cache_size(result_cache), result_cache_cost(result_cache), result_cache_capacity(result_cache),
+            result_cache_hits(result_cache), result_cache_misses(result_cache), result_cache_evictions(result_cache));
+}
+
+static bool print_cached_result(const char *path, const evaluator_options *options, size_t nodes, size_t hits, void *context __attribute__((unused)))
+{
+    fprintf(stdout, "%zu hits, %zu nodes: %s", hits, nodes, path);
+    if(0 != options->limit)
+    {
+        fprintf(stdout, " (limit: %zu)", options->limit);
+    }
+    if(0 != options->first_document || SIZE_MAX != options->last_document)
+    {
+        fprintf(stdout, SIZE_MAX == options->last_document ? " (documents: %zu:)" : " (documents: %zu:%zu)",
+                options->first_document, options->last_document);
+    }
+    fputc('\n', stdout);
+    return true;
+}
+
+static void cache_command(const char *argument, struct options *options)
+{
+    kanabo_debug("processing cache command...");
+    if(!argument)
+    {
+        kanabo_trace("no command argument, printing the cached results");
+        result_cache_iterate(result_cache, print_cached_result, NULL);
+        return;
+    }
+    if(0 == strcmp("clear", argument))
+    {
+        kanabo_debug("clearing the caches");
+        result_cache_clear(result_cache);
+        path_cache_clear(path_cache);
+        return;
+    }
+
+    size_t capacity = 0;
+    if(!parse_count(argument, &capacity))
+    {
+        error("invalid result cache size `%s'", argument);
+        return;
+    }
+
+    kanabo_debug("setting value to: %zu", capacity);
+    options->result_cache = capacity;
+    result_cache_resize(result_cache, capacity);
+}
+
+static void query_command(const char *name, const char *argument, enum query_mode mode, const struct options *options, DocumentModel *model)
+{
+    kanabo_debug("processing %s command...", name);
+    if(!argument)
+    {
+        kanabo_trace("no command argument, aborting...");
+        error("%s command requires an argument", name);
+        return;
+    }
+    if(NULL == model)
+    {
+        error("no input loaded, use the `:load' command");
+        return;
+    }
+
+    struct options query = *options;
+    query.query_mode = mode;
+    apply_expression(argument, model, &query);
+}
+
+static void batch_command(const char *argument, const struct options *options, DocumentModel *model)
+{
+    kanabo_debug("processing batch command...");
+    if(!argument)
+    {
+        kanabo_trace("no command argument, aborting...");
+        error(":batch command requires an argument");
+        return;
+    }
+    if(NULL == model)
+    {
+        error("no input loaded, use the `:load' command");
+        return;
+    }
+    if(is_stdin_filename(argument))
+    {
+        error("the queries of a :batch command can't be read from stdin");
+        return;
+    }
+    if(QUERY_NODES == options->query_mode && is_binary_emit_mode(options->emit_mode))
+    {
+        error("the results of a :batch command can't be written as `%s'", emit_mode_name(options->emit_mode));
+        return;
+    }
+
+    size_t count = 0;
+    jsonpath **paths = read_queries(argument, &count);
+    if(NULL != paths)
+    {
+        apply_batch(paths, count, model, options);
+        free_queries(paths, count);
+    }
+}
+
 static DocumentModel *load_command(const char *argument, struct options *options)
 {
     kanabo_debug("processing load command...");
@@ -324,7 +934,7 @@ static DocumentModel *load_command(const char *argument, struct options *options
     }
 
     kanabo_debug("found command argument, loading '%s'...", argument);
-    return load_document(argument, options->duplicate_strategy);
+    return load_document(argument, options);
 }
 
 static const char *get_argument(const char *command)
@@ -369,11 +979,53 @@ static void dispatch_interactive_command(const char *command, struct options *op
     {
         duplicate_command(get_argument(command), options);
     }
+    else if(0 == memcmp(":input", command, 6))
+    {
+        input_command(get_argument(command), options);
+    }
+    else if(0 == memcmp(":limit", command, 6))
+    {
+        limit_command(get_argument(command), options);
+    }
+    else if(0 == memcmp(":threads", command, 8))
+    {
+        threads_command(get_argument(command), options);
+    }
+    else if(0 == memcmp(":documents", command, 10))
+    {
+        documents_command(get_argument(command), options);
+    }
+    else if(0 == memcmp(":exists", command, 7))
+    {
+        query_command(":exists", get_argument(command), QUERY_EXISTS, options, *model);
+    }
+    else if(0 == memcmp(":count", command, 6))
+    {
+        query_command(":count", get_argument(command), QUERY_COUNT, options, *model);
+    }
+    else if(0 == memcmp(":path-cache", command, 11))
+    {
+        path_cache_command(get_argument(command), options);
+    }
+    else if(0 == memcmp(":stats", command, 6))
+    {
+        stats_command();
+    }
+    else if(0 == memcmp(":cache", command, 6))
+    {
+        cache_command(get_argument(command), options);
+    }
+    else if(0 == memcmp(":batch", command, 6))
+    {
+        batch_command(get_argument(command), options, *model);
+    }
     else if(0 == memcmp(":load", command, 5))
     {
         DocumentModel *new_model = load_command(get_argument(command), options);
         if(new_model)
         {
+            // N.B. - the cached results point into the old model
+            result_cache_clear(result_cache);
             model_free(*model);
             *model = new_model;
         }
@@ -385,7 +1037,7 @@ static void dispatch_interactive_command(const char *command, struct options *op
             error("no input loaded, use the `:load' command");
             return;
         }
-        apply_expression(command, *model, options->emit_mode);
+        apply_expression(command, *model, options);
     }
 }
 
@@ -399,7 +1051,7 @@ static void tty_interctive_mode(struct options *options)
     DocumentModel *model = NULL;
     if(options->input_file_name)
     {
-        model = load_document(options->input_file_name, options->duplicate_strategy);
+        model = load_document(options->input_file_name, options);
     }
 
     char *input;
@@ -432,7 +1084,20 @@ static void pipe_interactive_mode(struct options *options)
     DocumentModel *model = NULL;
     if(options->input_file_name)
     {
-        model = load_document(options->input_file_name, options->duplicate_strategy);
+        model = load_document(options->input_file_name, options);
+    }
+
+    // N.B. - like the `EOD' protocol, there is no response to loading the input file
+    struct frame response;
+    if(options->framing)
+    {
+        if(!open_frame(&response))
+        {
+            error("while creating the response buffer: %s", strerror(errno));
+            model_free(model);
+            return;
+        }
+        frame = &response;
     }
 
     kanabo_debug("entering non-tty interative mode");
@@ -443,17 +1108,48 @@ static void pipe_interactive_mode(struct options *options)
             continue;
         }
         input[read - 1] = '\0';  // N.B. `read` should always be positive here
-        dispatch_interactive_command(input, options, &model);
-        fputs("EOD\n", stdout);
-        fflush(stdout);
+        if(NULL == frame)
+        {
+            dispatch_interactive_command(input, options, &model);
+            fputs("EOD\n", stdout);
+            fflush(stdout);
+        }
+        else if(!begin_frame(frame))
+        {
+            break;
+        }
+        else
+        {
+            dispatch_interactive_command(input, options, &model);
+            if(!end_frame(frame))
+            {
+                break;
+            }
+        }
     }
+
     free(input);
     model_free(model);
+    if(NULL != frame)
+    {
+        close_frame(frame);
+        frame = NULL;
+    }
 }
 
 static int interactive_mode(struct options *options)
 {
     is_interactive = true;
+    path_cache = make_path_cache(options->path_cache);
+    result_cache = make_result_cache(options->result_cache);
+    if(NULL == path_cache || NULL == result_cache)
+    {
+        error("while creating the caches: %s", strerror(errno));
+        path_cache_free(path_cache);
+        result_cache_free(result_cache);
+        return EXIT_FAILURE;
+    }
+
     if(isatty(fileno(stdin)))
     {
         tty_interctive_mode(options);
@@ -463,12 +1159,117 @@ static int interactive_mode(struct options *options)
         pipe_interactive_mode(options);
     }
 
+    result_cache_free(result_cache);
+    result_cache = NULL;
+    path_cache_free(path_cache);
+    path_cache = NULL;
     return EXIT_SUCCESS;
 }
 
+struct stream_report
+{
+    const struct options *options;
+    Emitter emitter;
+    size_t  count;
+    bool    started;
+    bool    failed;
+};
+
+static bool report_streamed_node(Node *each, void *context)
+{
+    struct stream_report *report = (struct stream_report *)context;
+    report->count++;
+    // N.B. - the results are only started once there is one, so a query that fails first emits nothing, as it would if loaded
+    if(QUERY_NODES == report->options->query_mode && !report->started)
+    {
+        report->started = true;
+        report->failed = !emitter_start(&report->emitter);
+    }
+    if(QUERY_NODES == report->options->query_mode && (report->failed || !emitter_emit(&report->emitter, each)))
+    {
+        report->failed = true;
+        return false;
+    }
+    // N.B. - one node is enough to know that the path matches
+    if(QUERY_EXISTS == report->options->query_mode)
+    {
+        return false;
+    }
+    return 0 == report->options->limit || report->count < report->options->limit;
+}
+
+/*
+ * Evaluates the query while the input is parsed, rather than loading it
+ * first.  The result is false if the query, or the input, can't be streamed
+ * and must be loaded after all.
+ */
+static bool stream_expression(const struct options *options, int *result)
+{
+    const char *input_file_name = options->input_file_name;
+    if(!(use_stdin(input_file_name)) && is_snapshot_name(input_file_name))
+    {
+        kanabo_debug("snapshots can't be streamed, loading the input instead");
+        return false;
+    }
+    jsonpath *path = parse_expression(options->expression);
+    if(NULL == path)
+    {
+        *result = EXIT_FAILURE;
+        return true;
+    }
+    if(!path_is_streamable(path))
+    {
+        kanabo_debug("the expression can't be streamed, loading the input instead");
+        path_free(path);
+        return false;
+    }
+
+    FILE *input = open_input(input_file_name);
+    if(NULL == input)
+    {
+        error("while reading '%s': %s", get_input_name(input_file_name), strerror(errno));
+        path_free(path);
+        *result = EXIT_FAILURE;
+        return true;
+    }
+
+    kanabo_debug("streaming expression: \"%s\"", options->expression);
+    struct stream_report report = {.options = options, .emitter = get_emitter(options->emit_mode, NULL)};
+    stream_options streaming = {options->duplicate_strategy, options->first_document, options->last_document};
+    MaybeCount maybe = stream_file(input, path, &streaming, report_streamed_node, &report);
+    if(QUERY_NODES == options->query_mode && JUST == maybe.tag && !report.started)
+    {
+        report.started = true;
+        report.failed = !emitter_start(&report.emitter);
+    }
+    if(report.started && (!emitter_finish(&report.emitter) || report.failed))
+    {
+        error("unable to emit results");
+    }
+    close_input(input);
+    path_free(path);
+
+    if(NOTHING == maybe.tag)
+    {
+        // N.B. - a missing message means the failure was reported by the system
+        error("while reading '%s': %s", get_input_name(input_file_name), NULL == maybe.nothing.message ? strerror(errno) : maybe.nothing.message);
+        free(maybe.nothing.message);
+        *result = EXIT_FAILURE;
+        return true;
+    }
+    *result = QUERY_NODES == options->query_mode ? EXIT_SUCCESS : report_count(report.count, options);
+    return true;
+}
+
 static int expression_mode(struct options *options)
 {
-    DocumentModel *model = load_document(options->input_file_name, options->duplicate_strategy);
+    int result = EXIT_SUCCESS;
+    if(options->stream && stream_expression(options, &result))
+    {
+        return result;
+    }
+
+    DocumentModel *model = load_document(options->input_file_name, options);
     if(NULL == model)
     {
         return EXIT_FAILURE;
@@ -477,13 +1278,93 @@ static int expression_mode(struct options *options)
     {
         kanabo_trace("model loaded.");
 
-        int result = apply_expression(options->expression, model, options->emit_mode);
+        result = apply_expression(options->expression, model, options);
         model_free(model);
 
         return result;
     }
 }
 
+static int batch_mode(struct options *options)
+{
+    size_t count = 0;
+    jsonpath **paths = read_queries(options->queries_file_name, &count);
+    if(NULL == paths)
+    {
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_FAILURE;
+    DocumentModel *model = load_document(options->input_file_name, options);
+    if(NULL != model)
+    {
+        kanabo_trace("model loaded.");
+        result = apply_batch(paths, count, model, options);
+        model_free(model);
+    }
+    free_queries(paths, count);
+
+    return result;
+}
+
+static char *snapshot_name(const char *input_file_name)
+{
+    const char *base = strrchr(input_file_name, '/');
+    const char *extension = strrchr(NULL == base ? input_file_name : base, '.');
+    size_t length = NULL == extension || extension == base + 1 || extension == input_file_name
+        ? strlen(input_file_name)
+        : (size_t)(extension - input_file_name);
+
+    char *result = malloc(length + strlen(SNAPSHOT_EXTENSION) + 1);
+    if(NULL != result)
+    {
+        memcpy(result, input_file_name, length);
+        strcpy(result + length, SNAPSHOT_EXTENSION);
+    }
+    return result;
+}
+
+static int compile_mode(struct options *options)
+{
+    const char *input_file_name = options->input_file_name;
+    if((use_stdin(input_file_name)) && NULL == options->output_file_name)
+    {
+        error("the snapshot of stdin must be named with `-o'");
+        return EXIT_FAILURE;
+    }
+
+    char *output_file_name = NULL == options->output_file_name
+        ? snapshot_name(input_file_name)
+        : strdup(options->output_file_name);
+    if(NULL == output_file_name)
+    {
+        error("while compiling '%s': %s", get_input_name(input_file_name), strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_SUCCESS;
+    DocumentModel *model = load_document(input_file_name, options);
+    if(NULL == model)
+    {
+        result = EXIT_FAILURE;
+    }
+    else
+    {
+        kanabo_debug("writing snapshot: '%s'", output_file_name);
+        errno = 0;
+        const char *source = (use_stdin(input_file_name)) ? NULL : input_file_name;
+        if(!write_snapshot(model, source, output_file_name))
+        {
+            error("while writing '%s': %s", output_file_name, strerror(errno));
+            result = EXIT_FAILURE;
+        }
+        model_free(model);
+    }
+
+    free(output_file_name);
+    return result;
+}
+
 static int execute_command(enum command cmd, struct options *options)
 {
     int result = EXIT_SUCCESS;
@@ -505,6 +1386,12 @@ static int execute_command(enum command cmd, struct options *options)
         case EXPRESSION_MODE:
             result = expression_mode(options);
             break;
+        case BATCH_MODE:
+            result = batch_mode(options);
+            break;
+        case COMPILE_MODE:
+            result = compile_mode(options);
+            break;
     }
 
     return result;
@@ -516,7 +1403,17 @@ static int run(const int argc, char * const *argv)
     memset(&options, 0, sizeof(struct options));
     enum command cmd = process_options(argc, argv, &options);
 
-    return execute_command(cmd, &options);
+    output = make_writer(STDOUT_FILENO);
+    if(NULL == output)
+    {
+        error("while creating the output buffer: %s", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int result = execute_command(cmd, &options);
+    writer_free(output);
+    output = NULL;
+
+    return result;
 }
 
 static void handle_signal(int sigval)
@@ -41,14 +41,15 @@
 #endif
 
 #include <stdio.h>            /* for fileno() */
+#include <fcntl.h>            /* for open() */
+#include <unistd.h>           /* for close() */
 #include <sys/stat.h>         /* for fstat() */
+#include <sys/mman.h>         /* for mmap() */
 
 #include "conditions.h"
 #include "loader.h"
 #include "loader/private.h"
 
-#define make_regex(MEMBER, PATTERN) (0 == regcomp((MEMBER), (PATTERN), REG_EXTENDED | REG_NOSUB))
-
 #define _nothing(CODE, MESSAGE) (MaybeDocument){.tag=NOTHING, .nothing={(CODE), (MESSAGE)}}
 
 #define nothing(CONTEXT) _nothing((CONTEXT)->code, loader_status_message((CONTEXT)))
@@ -58,47 +59,28 @@
 #define PRECOND_NONNULL_ELSE_NOTHING(VALUE, CODE) ENSURE_NONNULL(_nothing(CODE, loader_simple_status_message(CODE)), EINVAL, (VALUE))
 #define PRECOND_NONZERO_ELSE_NOTHING(VALUE, CODE) ENSURE_THAT(_nothing(CODE, loader_simple_status_message(CODE)), EINVAL, 0 != (VALUE))
 
-static const char * const DECIMAL_PATTERN = "^-?(0|([1-9][[:digit:]]*))([.][[:digit:]]+)?([eE][+-]?[[:digit:]]+)?$";
-static const char * const INTEGER_PATTERN = "^-?(0|([1-9][[:digit:]]*))$";
-static const char * const TIMESTAMP_PATTERN = "^[0-9][0-9][0-9][0-9]-[0-9][0-9]?-[0-9][0-9]?(([Tt]|[ \t]+)[0-9][0-9]?:[0-9][0-9](:[0-9][0-9])?([.][0-9]+)?([ \t]*(Z|([-+][0-9][0-9]?(:[0-9][0-9])?)))?)?$";
+#define _no_count(CODE, MESSAGE) (MaybeCount){.tag=NOTHING, .nothing={(CODE), (MESSAGE)}}
+#define PRECOND_ELSE_NO_COUNT(COND, CODE) ENSURE_THAT(_no_count(CODE, loader_simple_status_message(CODE)), EINVAL, (COND))
+
+static const size_t READ_BUFFER_SIZE = 64 * 1024;
 
-static loader_status_code make_loader(loader_context *context, enum loader_duplicate_key_strategy value)
+static loader_status_code make_loader(loader_context *context, enum loader_duplicate_key_strategy value, enum loader_input_format format)
 {
     loader_debug("creating common loader context");
     context->strategy = value;
+    context->format = format;
 
     if(!yaml_parser_initialize(&context->parser))
     {
         return interpret_yaml_error(&context->parser);
     }
 
-    context->anchors = make_hashtable_with_function(string_comparitor, shift_add_xor_string_hash);
+    context->anchors = make_hashtable_with_function(string_comparitor, wyhash_string_hash);
     if(NULL == context->anchors)
     {
         return ERR_LOADER_OUT_OF_MEMORY;
     }
 
-    if(!make_regex(&context->decimal_regex, DECIMAL_PATTERN))
-    {
-        hashtable_free(context->anchors);
-        return ERR_OTHER;
-    }
-
-    if(!make_regex(&context->integer_regex, INTEGER_PATTERN))
-    {
-        hashtable_free(context->anchors);
-        regfree(&context->decimal_regex);
-        return ERR_OTHER;
-    }
-
-    if(!make_regex(&context->timestamp_regex, TIMESTAMP_PATTERN))
-    {
-        hashtable_free(context->anchors);
-        regfree(&context->decimal_regex);
-        regfree(&context->integer_regex);
-        return ERR_OTHER;
-    }
-
     return LOADER_SUCCESS;
 }
 
@@ -110,10 +92,6 @@ static void loader_free(loader_context *context)
 
     hashtable_free(context->anchors);
     context->anchors = NULL;
-
-    regfree(&context->decimal_regex);
-    regfree(&context->integer_regex);
-    regfree(&context->timestamp_regex);
 }
 
 static inline MaybeDocument load(loader_context *context)
@@ -130,7 +108,112 @@ static inline MaybeDocument load(loader_context *context)
     }
 }
 
+static inline bool is_syntax_error(loader_status_code code)
+{
+    return ERR_SCANNER_FAILED == code || ERR_PARSER_FAILED == code;
+}
+
+static MaybeDocument load_snapshot(loader_context *context, const uint8_t *input, size_t size)
+{
+    char *source = NULL;
+    if(!snapshot_is_current(input, size, &source))
+    {
+        if(NULL == source)
+        {
+            return _nothing(ERR_INVALID_SNAPSHOT, loader_simple_status_message(ERR_INVALID_SNAPSHOT));
+        }
+        loader_info("the snapshot is out of date, loading '%s' instead", source);
+        MaybeDocument result = load_mapped_with_format(source, context->strategy, context->format);
+        free(source);
+        return result;
+    }
+
+    loader_debug("starting snapshot load...");
+    build_snapshot_model(context, input, size);
+    if(LOADER_SUCCESS != context->code)
+    {
+        return nothing(context);
+    }
+    return just(context->model);
+}
+
+/*
+ * Loads a complete input held in memory: a snapshot, or with the JSON
+ * loader when the input is (or looks like) JSON, and with libyaml
+ * otherwise.
+ */
+static MaybeDocument load_input(loader_context *context, const uint8_t *input, size_t size)
+{
+    if(sniff_snapshot(input, size))
+    {
+        return load_snapshot(context, input, size);
+    }
+
+    bool json = INPUT_JSON == context->format || (INPUT_AUTO == context->format && sniff_json(input, size));
+    if(json)
+    {
+        loader_debug("starting json load...");
+        build_json_model(context, input, size);
+        if(LOADER_SUCCESS == context->code)
+        {
+            return just(context->model);
+        }
+        if(INPUT_JSON == context->format || !is_syntax_error(context->code))
+        {
+            return nothing(context);
+        }
+        loader_debug("the input isn't json after all, loading it as yaml");
+        context->code = LOADER_SUCCESS;
+        context->target = NULL;
+        context->key_holder = NULL;
+        context->parser.problem = NULL;
+    }
+
+    yaml_parser_set_input_string(&context->parser, input, size);
+    return load(context);
+}
+
+static uint8_t *read_input(FILE *input, size_t *size)
+{
+    size_t capacity = READ_BUFFER_SIZE;
+    size_t length = 0;
+    uint8_t *buffer = malloc(capacity);
+    while(NULL != buffer)
+    {
+        if(length == capacity)
+        {
+            capacity *= 2;
+            uint8_t *expanded = realloc(buffer, capacity);
+            if(NULL == expanded)
+            {
+                free(buffer);
+                return NULL;
+            }
+            buffer = expanded;
+        }
+        size_t count = fread(buffer + length, 1, capacity - length, input);
+        length += count;
+        if(0 == count)
+        {
+            if(ferror(input))
+            {
+                free(buffer);
+                return NULL;
+            }
+            break;
+        }
+    }
+    *size = length;
+
+    return buffer;
+}
+
 MaybeDocument load_string(const unsigned char *input, size_t size, enum loader_duplicate_key_strategy value)
+{
+    return load_string_with_format(input, size, value, INPUT_AUTO);
+}
+
+MaybeDocument load_string_with_format(const unsigned char *input, size_t size, enum loader_duplicate_key_strategy value, enum loader_input_format format)
 {
     PRECOND_NONNULL_ELSE_NOTHING(input, ERR_INPUT_IS_NULL);
     PRECOND_NONZERO_ELSE_NOTHING(size, ERR_INPUT_SIZE_IS_ZERO);
@@ -139,19 +222,23 @@ MaybeDocument load_string(const unsigned char *input, size_t size, enum loader_d
     loader_context context;
     memset(&context, 0, sizeof(loader_context));
 
-    loader_status_code code = make_loader(&context, value);
+    loader_status_code code = make_loader(&context, value, format);
     if(LOADER_SUCCESS != code)
     {
         return nothing(&context);
     }
 
-    yaml_parser_set_input_string(&context.parser, input, size);
-    MaybeDocument result = load(&context);
+    MaybeDocument result = load_input(&context, input, size);
     loader_free(&context);
     return result;
 }
 
 MaybeDocument load_file(FILE *input, enum loader_duplicate_key_strategy value)
+{
+    return load_file_with_format(input, value, INPUT_AUTO);
+}
+
+MaybeDocument load_file_with_format(FILE *input, enum loader_duplicate_key_strategy value, enum loader_input_format format)
 {
     PRECOND_NONNULL_ELSE_NOTHING(input, ERR_INPUT_IS_NULL);
 
@@ -166,14 +253,130 @@ MaybeDocument load_file(FILE *input, enum loader_duplicate_key_strategy value)
     loader_context context;
     memset(&context, 0, sizeof(loader_context));
 
-    loader_status_code code = make_loader(&context, value);
+    loader_status_code code = make_loader(&context, value, format);
     if(LOADER_SUCCESS != code)
     {
         return nothing(&context);
     }
 
-    yaml_parser_set_input_file(&context.parser, input);
-    MaybeDocument result = load(&context);
+    MaybeDocument result;
+    if(INPUT_YAML == format)
+    {
+        yaml_parser_set_input_file(&context.parser, input);
+        result = load(&context);
+    }
+    else
+    {
+        // N.B. - JSON detection and the JSON loader both need the whole input
+        size_t size = 0;
+        uint8_t *buffer = read_input(input, &size);
+        if(NULL == buffer)
+        {
+            loader_free(&context);
+            return _nothing(ERR_READER_FAILED, loader_simple_status_message(ERR_READER_FAILED));
+        }
+        result = load_input(&context, buffer, size);
+        free(buffer);
+    }
     loader_free(&context);
     return result;
 }
+
+MaybeDocument load_mapped(const char *path, enum loader_duplicate_key_strategy value)
+{
+    return load_mapped_with_format(path, value, INPUT_AUTO);
+}
+
+MaybeDocument load_mapped_with_format(const char *path, enum loader_duplicate_key_strategy value, enum loader_input_format format)
+{
+    PRECOND_NONNULL_ELSE_NOTHING(path, ERR_INPUT_IS_NULL);
+
+    int descriptor = open(path, O_RDONLY);
+    PRECOND_ELSE_NOTHING(-1 != descriptor, ERR_READER_FAILED);
+
+    struct stat file_info;
+    if(-1 == fstat(descriptor, &file_info))
+    {
+        close(descriptor);
+        return _nothing(ERR_READER_FAILED, loader_simple_status_message(ERR_READER_FAILED));
+    }
+    if(0 == file_info.st_size)
+    {
+        close(descriptor);
+        errno = EINVAL;
+        return _nothing(ERR_INPUT_SIZE_IS_ZERO, loader_simple_status_message(ERR_INPUT_SIZE_IS_ZERO));
+    }
+
+    size_t size = (size_t)file_info.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if(MAP_FAILED == data)
+    {
+        return _nothing(ERR_READER_FAILED, loader_simple_status_message(ERR_READER_FAILED));
+    }
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+
+    loader_debug("creating mapped file loader context");
+    loader_context context;
+    memset(&context, 0, sizeof(loader_context));
+
+    loader_status_code code = make_loader(&context, value, format);
+    if(LOADER_SUCCESS != code)
+    {
+        munmap(data, size);
+        return _nothing(code, loader_simple_status_message(code));
+    }
+
+    context.input.data = data;
+    context.input.length = size;
+    MaybeDocument result = load_input(&context, data, size);
+    loader_free(&context);
+
+    // N.B. - a model loaded from the source of a stale snapshot has its own mapping
+    if(JUST == result.tag && NULL == result.just->source.data)
+    {
+        model_set_source(result.just, data, size);
+    }
+    else
+    {
+        munmap(data, size);
+    }
+    return result;
+}
+
+MaybeCount stream_file(FILE *input, const jsonpath *path, const stream_options *options, stream_callback callback, void *context)
+{
+    PRECOND_ELSE_NO_COUNT(NULL != input, ERR_INPUT_IS_NULL);
+    PRECOND_ELSE_NO_COUNT(NULL != options && NULL != callback, ERR_OTHER);
+    PRECOND_ELSE_NO_COUNT(path_is_streamable(path), ERR_UNSTREAMABLE_PATH);
+
+    struct stat file_info;
+    int syscall_result = fstat(fileno(input), &file_info);
+    PRECOND_ELSE_NO_COUNT(-1 != syscall_result, ERR_READER_FAILED);
+
+    bool is_readable = !(file_info.st_mode & S_IFREG && (feof(input) || 0 == file_info.st_size));
+    PRECOND_ELSE_NO_COUNT(is_readable, ERR_INPUT_SIZE_IS_ZERO);
+
+    loader_debug("creating streaming loader context");
+    loader_context loader;
+    memset(&loader, 0, sizeof(loader_context));
+
+    loader_status_code code = make_loader(&loader, options->strategy, INPUT_YAML);
+    if(LOADER_SUCCESS != code)
+    {
+        loader_free(&loader);
+        return _no_count(code, loader_simple_status_message(code));
+    }
+
+    // N.B. - the events are parsed as the input is read, JSON is parsed as YAML
+    yaml_parser_set_input_file(&loader.parser, input);
+    size_t count = stream_events(&loader, path, options, callback, context);
+    MaybeCount result = (MaybeCount){.tag=JUST, .just=count};
+    if(LOADER_SUCCESS != loader.code)
+    {
+        result = _no_count(loader.code, loader_status_message(&loader));
+    }
+    loader_free(&loader);
+
+    return result;
+}
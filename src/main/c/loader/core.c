@@ -37,11 +37,12 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
-#include <regex.h>
 
 #include "loader.h"
 #include "loader/private.h"
 
+#define arena(CONTEXT) (CONTEXT)->model->arena
+
 static const char * const DUPLICATE_STRATEGIES [] =
 {
     "clobber",
@@ -49,16 +50,23 @@ static const char * const DUPLICATE_STRATEGIES [] =
     "fail"
 };
 
+static const char * const INPUT_FORMATS [] =
+{
+    "auto",
+    "yaml",
+    "json"
+};
+
 static void event_loop(loader_context *context);
 static bool dispatch_event(yaml_event_t *event, loader_context *context);
 
 static bool add_scalar(loader_context *context, const yaml_event_t *event);
-static ScalarKind resolve_scalar_kind(const loader_context *context, const yaml_event_t *event);
 static ScalarKind tag_to_scalar_kind(const yaml_event_t *event);
-static inline bool regex_test(const yaml_event_t *event, const regex_t *regex);
 
 static bool cache_mapping_key(loader_context *context, const yaml_event_t *event);
 static Scalar *build_scalar_node(loader_context *context, const yaml_event_t *event);
+static const uint8_t *borrow_scalar_value(loader_context *context, const yaml_event_t *event);
+static size_t mark_offset(loader_context *context, size_t index);
 
 static bool add_alias(loader_context *context, const yaml_event_t *event);
 
@@ -69,29 +77,42 @@ static bool end_sequence(loader_context *context);
 static bool start_mapping(loader_context *context, const yaml_event_t *event);
 static bool end_mapping(loader_context *context);
 
-static void set_anchor(loader_context *context, Node *target, uint8_t *anchor);
+static void set_anchor(loader_context *context, Node *target, const uint8_t *anchor);
 
-static bool add_node(loader_context *context, Node *value);
 static inline bool add_to_mapping_node(loader_context *context, Node *value);
 
 void build_model(struct loader_context *context)
+{
+    if(!start_model(context))
+    {
+        return;
+    }
+    event_loop(context);
+    finish_model(context);
+}
+
+bool start_model(struct loader_context *context)
 {
     loader_debug("building model...");
-    DocumentModel *model = make_model();
+    DocumentModel *model = make_model_with_arena();
     if(NULL == model)
     {
         loader_error("uh oh! out of memory, can't allocate the document model, aborting...");
         context->code = ERR_LOADER_OUT_OF_MEMORY;
-        return;
+        return false;
     }
     context->model = model;
+    context->code = LOADER_SUCCESS;
 
-    event_loop(context);
+    return true;
+}
+
+void finish_model(struct loader_context *context)
+{
     if(LOADER_SUCCESS == context->code && 0 == model_size(context->model))
     {
         loader_error("no documents found for the input!");
         context->code = ERR_NO_DOCUMENTS_FOUND;
-        return;
     }
     if(LOADER_SUCCESS == context->code)
     {
@@ -120,6 +141,7 @@ static void event_loop(loader_context *context)
             break;
         }
         done = dispatch_event(&event, context);
+        yaml_event_delete(&event);
     }
     loader_trace("finished loading");
 }
@@ -190,7 +212,7 @@ static bool dispatch_event(yaml_event_t *event, loader_context *context)
 static bool add_scalar(loader_context *context, const yaml_event_t *event)
 {
 
-    if(NULL == context->key_holder.value && is_mapping(context->target))
+    if(NULL == context->key_holder && is_mapping(context->target))
     {
         return cache_mapping_key(context, event);
     }
@@ -209,23 +231,24 @@ static bool add_scalar(loader_context *context, const yaml_event_t *event)
 static bool cache_mapping_key(loader_context *context, const yaml_event_t *event)
 {
     trace_string("caching scalar '%s' (%p) as mapping key", event->data.scalar.value, event->data.scalar.length, event->data.scalar.value);
-    context->key_holder.value = event->data.scalar.value;
-    context->key_holder.length = event->data.scalar.length;
+    context->key_holder = build_scalar_node(context, event);
 
-    if(NULL != event->data.scalar.anchor)
-    {
-        // this node will be held in the anchor hashtable
-        Scalar *key = build_scalar_node(context, event);
-        return NULL == key;
-    }
-
-    return false;
+    return NULL == context->key_holder;
 }
 
 static Scalar *build_scalar_node(loader_context *context, const yaml_event_t *event)
 {
-    ScalarKind kind = resolve_scalar_kind(context, event);
-    Scalar *result = make_scalar_node(event->data.scalar.value, event->data.scalar.length, kind);
+    ScalarKind kind = resolve_scalar_kind(event);
+    const uint8_t *borrowed = borrow_scalar_value(context, event);
+    Scalar *result = NULL;
+    if(NULL != borrowed)
+    {
+        result = make_borrowed_scalar_node_in(arena(context), borrowed, event->data.scalar.length, kind);
+    }
+    else
+    {
+        result = make_scalar_node_in(arena(context), event->data.scalar.value, event->data.scalar.length, kind);
+    }
     if(NULL == result)
     {
         loader_error("uh oh! couldn't create scalar node, aborting...");
@@ -234,14 +257,83 @@ static Scalar *build_scalar_node(loader_context *context, const yaml_event_t *ev
     }
     if(NULL != event->data.scalar.tag)
     {
-        node_set_tag(result, event->data.scalar.tag, strlen((char *)event->data.scalar.tag));
+        node_set_tag_in(arena(context), result, event->data.scalar.tag, strlen((char *)event->data.scalar.tag));
     }
     set_anchor(context, node(result), event->data.scalar.anchor);
 
     return result;
 }
 
-static ScalarKind resolve_scalar_kind(const loader_context *context, const yaml_event_t *event)
+/*
+ * When the input is mapped, a scalar whose value appears verbatim in the
+ * input (i.e. one that needed no unescaping or folding) can refer to the
+ * mapped bytes instead of being copied. libyaml's marks are character indexes
+ * rather than byte offsets, so the end mark is translated and the candidate
+ * bytes are compared with the parsed value before they are used.
+ */
+static const uint8_t *borrow_scalar_value(loader_context *context, const yaml_event_t *event)
+{
+    if(NULL == context->input.data)
+    {
+        return NULL;
+    }
+
+    size_t length = event->data.scalar.length;
+    size_t end = mark_offset(context, event->end_mark.index);
+    switch(event->data.scalar.style)
+    {
+        case YAML_PLAIN_SCALAR_STYLE:
+            break;
+        case YAML_SINGLE_QUOTED_SCALAR_STYLE:
+        case YAML_DOUBLE_QUOTED_SCALAR_STYLE:
+            end--;  // N.B. - step back over the closing quote
+            break;
+        default:
+            // N.B. - block scalars are always chomped or folded
+            return NULL;
+    }
+    if(SIZE_MAX == end || end < length || end > context->input.length)
+    {
+        return NULL;
+    }
+
+    const uint8_t *candidate = context->input.data + (end - length);
+    if(0 != memcmp(candidate, event->data.scalar.value, length))
+    {
+        return NULL;
+    }
+    return candidate;
+}
+
+/*
+ * Marks always move forward through the input, so the cursor is only ever
+ * advanced and the input is scanned at most once.
+ */
+static size_t mark_offset(loader_context *context, size_t index)
+{
+    if(index < context->input.index)
+    {
+        return SIZE_MAX;
+    }
+
+    const uint8_t *data = context->input.data;
+    size_t offset = context->input.offset;
+    for(size_t count = index - context->input.index; 0 != count && offset < context->input.length; count--)
+    {
+        offset++;
+        // N.B. - continuation bytes don't start a new character
+        while(offset < context->input.length && 0x80 == (data[offset] & 0xC0))
+        {
+            offset++;
+        }
+    }
+    context->input.offset = offset;
+    context->input.index = index;
+
+    return offset;
+}
+
+ScalarKind resolve_scalar_kind(const yaml_event_t *event)
 {
     ScalarKind kind = SCALAR_STRING;
 
@@ -255,35 +347,21 @@ static ScalarKind resolve_scalar_kind(const loader_context *context, const yaml_
         trace_string("found scalar string '%s', len: %zd", event->data.scalar.value, event->data.scalar.length, event->data.scalar.length);
         kind = SCALAR_STRING;
     }
-    else if(0 == memcmp("null", event->data.scalar.value, 4))
+    else if(4 <= event->data.scalar.length && 0 == memcmp("null", event->data.scalar.value, 4))
     {
         loader_trace("found scalar null");
         kind = SCALAR_NULL;
     }
-    else if(0 == memcmp("true", event->data.scalar.value, 4) ||
-            0 == memcmp("false", event->data.scalar.value, 5))
+    else if((4 <= event->data.scalar.length && 0 == memcmp("true", event->data.scalar.value, 4)) ||
+            (5 <= event->data.scalar.length && 0 == memcmp("false", event->data.scalar.value, 5)))
     {
         trace_string("found scalar boolean '%s'", event->data.scalar.value, event->data.scalar.length);
         kind = SCALAR_BOOLEAN;
     }
-    else if(regex_test(event, &context->integer_regex))
-    {
-        trace_string("found scalar integer '%s'", event->data.scalar.value, event->data.scalar.length);
-        kind = SCALAR_INTEGER;
-    }
-    else if(regex_test(event, &context->decimal_regex))
-    {
-        trace_string("found scalar real '%s'", event->data.scalar.value, event->data.scalar.length);
-        kind = SCALAR_REAL;
-    }
-    else if(regex_test(event, &context->timestamp_regex))
-    {
-        trace_string("found scalar timestamp '%s'", event->data.scalar.value, event->data.scalar.length);
-        kind = SCALAR_TIMESTAMP;
-    }
     else
     {
-        trace_string("defaulting to scalar string '%s'", event->data.scalar.value, event->data.scalar.length, event->data.scalar.length);
+        kind = classify_plain_scalar(event->data.scalar.value, event->data.scalar.length);
+        trace_string("classified plain scalar '%s' as kind %d", event->data.scalar.value, event->data.scalar.length, (int)kind);
     }
 
     return kind;
@@ -292,32 +370,32 @@ static ScalarKind resolve_scalar_kind(const loader_context *context, const yaml_
 static ScalarKind tag_to_scalar_kind(const yaml_event_t *event)
 {
     const yaml_char_t * tag = event->data.scalar.tag;
-    if(0 == memcmp(YAML_NULL_TAG, tag, strlen(YAML_NULL_TAG)))
+    if(0 == strncmp((const char *)YAML_NULL_TAG, (const char *)tag, strlen(YAML_NULL_TAG)))
     {
         trace_string("found yaml null tag for scalar '%s'", event->data.scalar.value, event->data.scalar.length);
         return SCALAR_NULL;
     }
-    if(0 == memcmp(YAML_BOOL_TAG, tag, strlen(YAML_BOOL_TAG)))
+    if(0 == strncmp((const char *)YAML_BOOL_TAG, (const char *)tag, strlen(YAML_BOOL_TAG)))
     {
         trace_string("found yaml boolean tag for scalar '%s'", event->data.scalar.value, event->data.scalar.length);
         return SCALAR_BOOLEAN;
     }
-    if(0 == memcmp(YAML_STR_TAG, tag, strlen(YAML_STR_TAG)))
+    if(0 == strncmp((const char *)YAML_STR_TAG, (const char *)tag, strlen(YAML_STR_TAG)))
     {
         trace_string("found yaml string tag for scalar '%s'", event->data.scalar.value, event->data.scalar.length);
         return SCALAR_STRING;
     }
-    if(0 == memcmp(YAML_INT_TAG, tag, strlen(YAML_INT_TAG)))
+    if(0 == strncmp((const char *)YAML_INT_TAG, (const char *)tag, strlen(YAML_INT_TAG)))
     {
         trace_string("found yaml integer tag for scalar '%s'", event->data.scalar.value, event->data.scalar.length);
         return SCALAR_INTEGER;
     }
-    if(0 == memcmp(YAML_FLOAT_TAG, tag, strlen(YAML_FLOAT_TAG)))
+    if(0 == strncmp((const char *)YAML_FLOAT_TAG, (const char *)tag, strlen(YAML_FLOAT_TAG)))
     {
         trace_string("found yaml float tag for scalar '%s'", event->data.scalar.value, event->data.scalar.length);
         return SCALAR_REAL;
     }
-    if(0 == memcmp(YAML_TIMESTAMP_TAG, tag, strlen(YAML_TIMESTAMP_TAG)))
+    if(0 == strncmp((const char *)YAML_TIMESTAMP_TAG, (const char *)tag, strlen(YAML_TIMESTAMP_TAG)))
     {
         trace_string("found yaml timestamp tag for scalar '%s'", event->data.scalar.value, event->data.scalar.length);
         return SCALAR_TIMESTAMP;
@@ -326,15 +404,6 @@ static ScalarKind tag_to_scalar_kind(const yaml_event_t *event)
     return SCALAR_STRING;
 }
 
-static inline bool regex_test(const yaml_event_t *event, const regex_t *regex)
-{
-    char string[event->data.scalar.length + 1];
-    memcpy(string, event->data.scalar.value, event->data.scalar.length);
-    string[event->data.scalar.length] = '\0';
-
-    return 0 == regexec(regex, string, 0, NULL, 0);
-}
-
 static bool add_alias(loader_context *context, const yaml_event_t *event)
 {
     Node *target = hashtable_get(context->anchors, event->data.alias.anchor);
@@ -356,13 +425,13 @@ static bool add_alias(loader_context *context, const yaml_event_t *event)
     }
 
     loader_trace("added '%s' alias target (%p)", event->data.alias.anchor, target);
-    Alias *value = make_alias_node(target);
+    Alias *value = make_alias_node_in(arena(context), target);
     return add_node(context, node(value));
 }
 
 static bool start_document(loader_context *context)
 {
-    Document *value = make_document_node();
+    Document *value = make_document_node_in(arena(context));
     if(NULL == value)
     {
         loader_error("uh oh! couldn't create new document node, aborting...");
@@ -387,13 +456,13 @@ static bool end_document(loader_context *context)
 
 static bool start_sequence(loader_context *context, const yaml_event_t *event)
 {
-    if(NULL == context->key_holder.value && is_mapping(context->target))
+    if(NULL == context->key_holder && is_mapping(context->target))
     {
         loader_debug("uh oh! found a non scalar mapping key, aborting...");
         context->code = ERR_NON_SCALAR_KEY;
         return true;
     }
-    Sequence *seq = make_sequence_node();
+    Sequence *seq = make_sequence_node_in(arena(context));
     if(NULL == seq)
     {
         loader_error("uh oh! couldn't create a sequence node, aborting...");
@@ -403,7 +472,7 @@ static bool start_sequence(loader_context *context, const yaml_event_t *event)
     if(NULL != event->data.sequence_start.tag)
     {
         size_t len = strlen((char *)event->data.sequence_start.tag);
-        node_set_tag(seq, event->data.sequence_start.tag, len);
+        node_set_tag_in(arena(context), seq, event->data.sequence_start.tag, len);
     }
     set_anchor(context, node(seq), event->data.sequence_start.anchor);
 
@@ -427,13 +496,13 @@ static bool end_sequence(loader_context *context)
 
 static bool start_mapping(loader_context *context, const yaml_event_t *event)
 {
-    if(NULL == context->key_holder.value && is_mapping(context->target))
+    if(NULL == context->key_holder && is_mapping(context->target))
     {
         loader_debug("uh oh! found a non scalar mapping key, aborting...");
         context->code = ERR_NON_SCALAR_KEY;
         return true;
     }
-    Mapping *map = make_mapping_node();
+    Mapping *map = make_mapping_node_in(arena(context));
     if(NULL == map)
     {
         loader_error("uh oh! couldn't create a mapping node, aborting...");
@@ -443,7 +512,7 @@ static bool start_mapping(loader_context *context, const yaml_event_t *event)
     if(NULL != event->data.mapping_start.tag)
     {
         size_t length = strlen((char *)event->data.mapping_start.tag);
-        node_set_tag(map, event->data.mapping_start.tag, length);
+        node_set_tag_in(arena(context), map, event->data.mapping_start.tag, length);
     }
     set_anchor(context, node(map), event->data.mapping_start.anchor);
 
@@ -464,18 +533,19 @@ static bool end_mapping(loader_context *context)
     return false;
 }
 
-static void set_anchor(loader_context *context, Node *target, uint8_t *anchor)
+static void set_anchor(loader_context *context, Node *target, const uint8_t *anchor)
 {
     if(NULL == anchor)
     {
         return;
     }
-    node_set_anchor(target, anchor, strlen((char *)anchor));
+    node_set_anchor_in(arena(context), target, anchor, strlen((char *)anchor));
 
-    hashtable_put(context->anchors, anchor, target);
+    // N.B. - the event will be deleted, so key the table with the node's copy
+    hashtable_put(context->anchors, target->anchor, target);
 }
 
-static bool add_node(loader_context *context, Node *value)
+bool add_node(loader_context *context, Node *value)
 {
     switch(node_kind(context->target))
     {
@@ -486,7 +556,7 @@ static bool add_node(loader_context *context, Node *value)
             loader_trace("adding node (%p) to sequence context (%p)", value, context->target);
             return !sequence_add(sequence(context->target), value);
         case MAPPING:
-            trace_string("adding {\"%s\": node (%p)} to mapping context (%p)", context->key_holder.value, context->key_holder.length, value, context->target);
+            trace_string("adding {\"%s\": node (%p)} to mapping context (%p)", scalar_value(context->key_holder), node_size(context->key_holder), value, context->target);
             return add_to_mapping_node(context, value);
         case SCALAR:
             loader_debug("uh oh! a scalar node has become the context node, aborting...");
@@ -503,9 +573,8 @@ static bool add_node(loader_context *context, Node *value)
 
 static inline bool add_to_mapping_node(loader_context *context, Node *value)
 {
-    bool duplicate = mapping_contains(mapping(context->target),
-                                      context->key_holder.value,
-                                      context->key_holder.length);
+    Scalar *key = context->key_holder;
+    bool duplicate = mapping_contains_key(mapping(context->target), key);
     if(duplicate && DUPE_FAIL == context->strategy)
     {
         loader_debug("uh oh! a scalar node has become the context node, aborting...");
@@ -514,18 +583,21 @@ static inline bool add_to_mapping_node(loader_context *context, Node *value)
     }
     if(duplicate && DUPE_WARN == context->strategy)
     {
-        char key_name[context->key_holder.length + 1];
-        memcpy(key_name, context->key_holder.value, context->key_holder.length);
-        key_name[context->key_holder.length] = '\0';
+        size_t length = node_size(key);
+        char key_name[length + 1];
+        memcpy(key_name, scalar_value(key), length);
+        key_name[length] = '\0';
         fprintf(stderr, "warning: duplicate mapping key found: '%s'\n", key_name);
     }
-    bool done = !mapping_put(mapping(context->target),
-                             context->key_holder.value,
-                             context->key_holder.length, value);
+    if(duplicate)
+    {
+        context->duplicates++;
+    }
+    bool done = !mapping_put_scalar(mapping(context->target), key, value);
     if(!done)
     {
-        context->key_holder.value = NULL;
-        context->key_holder.length = 0ul;
+        // N.B. - for duplicates the mapping keeps the original key, the arena will reclaim this one
+        context->key_holder = NULL;
     }
     return done;
 }
@@ -554,3 +626,28 @@ const char * duplicate_strategy_name(enum loader_duplicate_key_strategy value)
 {
     return DUPLICATE_STRATEGIES[value];
 }
+
+int32_t parse_input_format(const char *argument)
+{
+    if(0 == strncmp("auto", argument, 4ul))
+    {
+        return INPUT_AUTO;
+    }
+    else if(0 == strncmp("yaml", argument, 4ul))
+    {
+        return INPUT_YAML;
+    }
+    else if(0 == strncmp("json", argument, 4ul))
+    {
+        return INPUT_JSON;
+    }
+    else
+    {
+        return -1;
+    }
+}
+
+const char * input_format_name(enum loader_input_format value)
+{
+    return INPUT_FORMATS[value];
+}
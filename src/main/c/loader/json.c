@@ -0,0 +1,1030 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "loader.h"
+#include "loader/private.h"
+
+/*
+ * A loader for JSON input that builds the document model directly instead
+ * of going through libyaml's event parser.  It works in two stages, in the
+ * style of simdjson:
+ *
+ * 1. The input is classified 64 bytes at a time into bitmasks of quotes,
+ *    backslashes, structural characters and whitespace.  Escaped quotes are
+ *    removed, string interiors are found with a prefix XOR over the quote
+ *    mask, and the offsets of every structural character and every scalar
+ *    that starts outside of a string are written to an index.
+ *
+ * 2. The index is walked with a small state machine that creates the same
+ *    nodes, with the same kinds, that the libyaml loader would for the same
+ *    input.
+ *
+ * Strings are checked for the control characters and malformed UTF-8 that
+ * libyaml's reader rejects, so that any input accepted here is loaded
+ * exactly as libyaml would load it.
+ */
+
+#define arena(CONTEXT) (CONTEXT)->model->arena
+
+#define BLOCK_SIZE 64
+
+static const uint64_t EVEN_BITS = 0x5555555555555555ull;
+
+enum json_state
+{
+    EXPECT_VALUE,
+    EXPECT_KEY,
+    AFTER_VALUE
+};
+
+struct block_masks_s
+{
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t operator;
+    uint64_t whitespace;
+};
+
+typedef struct block_masks_s block_masks;
+
+struct json_parser_s
+{
+    loader_context *context;
+
+    const uint8_t  *input;
+    size_t          length;
+    /** may scalars refer to the input instead of copying it? */
+    bool            borrow;
+
+    /** offsets of the structural characters, terminated by `length' */
+    uint32_t       *index;
+    size_t          count;
+    size_t          capacity;
+    size_t          position;
+
+    /** holds the unescaped value of the current string */
+    uint8_t        *scratch;
+    size_t          scratch_size;
+};
+
+typedef struct json_parser_s json_parser;
+
+static bool find_structurals(json_parser *parser);
+static inline void classify_block(const uint8_t *block, block_masks *masks);
+static inline uint64_t find_escaped(uint64_t backslash, uint64_t *previous_ends_odd);
+static inline uint64_t prefix_xor(uint64_t bits);
+static bool flatten_bits(json_parser *parser, size_t base, uint64_t bits);
+
+static void parse_document(json_parser *parser);
+static bool parse_values(json_parser *parser);
+static bool parse_value(json_parser *parser, enum json_state *state);
+static bool parse_key(json_parser *parser);
+static bool after_value(json_parser *parser, enum json_state *state);
+static bool start_container(json_parser *parser, Node *container);
+static void end_container(json_parser *parser);
+static void complete_source(json_parser *parser, Node *container);
+
+static Scalar *parse_string(json_parser *parser);
+static size_t scan_string(json_parser *parser, size_t start, bool *escaped);
+static inline size_t find_special(const uint8_t *input, size_t offset, size_t length);
+static size_t check_escape(const uint8_t *input, size_t offset, size_t length);
+static size_t check_utf8(const uint8_t *input, size_t offset, size_t length);
+static bool unescape(json_parser *parser, size_t start, size_t end, size_t *length);
+static inline bool read_hex(const uint8_t *input, uint32_t *value);
+static inline size_t encode_utf8(uint8_t *output, uint32_t value);
+static Scalar *parse_token(json_parser *parser);
+static Scalar *make_value(json_parser *parser, const uint8_t *value, size_t length, ScalarKind kind);
+
+static inline bool has_token(const json_parser *parser);
+static inline uint8_t token(const json_parser *parser);
+static inline size_t token_offset(const json_parser *parser);
+static bool fail(json_parser *parser, loader_status_code code, const char *problem);
+
+bool sniff_json(const uint8_t *input, size_t length)
+{
+    if(NULL == input || UINT32_MAX <= length)
+    {
+        return false;
+    }
+    for(size_t i = 0; i < length; i++)
+    {
+        switch(input[i])
+        {
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                continue;
+            case '{':
+            case '[':
+                return true;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+void build_json_model(loader_context *context, const uint8_t *input, size_t length)
+{
+    loader_debug("building model from json input...");
+    if(UINT32_MAX <= length)
+    {
+        loader_error("uh oh! the input is too large for the json loader, aborting...");
+        context->code = ERR_OTHER;
+        return;
+    }
+    if(!start_model(context))
+    {
+        return;
+    }
+
+    json_parser parser =
+    {
+        .context = context,
+        .input = input,
+        .length = length,
+        .borrow = NULL != context->input.data
+    };
+
+    if(find_structurals(&parser))
+    {
+        loader_trace("found %zd structural characters", parser.count);
+        parse_document(&parser);
+    }
+
+    free(parser.index);
+    free(parser.scratch);
+    finish_model(context);
+}
+
+static bool find_structurals(json_parser *parser)
+{
+    parser->capacity = parser->length / 8 + BLOCK_SIZE + 1;
+    parser->index = malloc(parser->capacity * sizeof(uint32_t));
+    if(NULL == parser->index)
+    {
+        return fail(parser, ERR_LOADER_OUT_OF_MEMORY, "unable to allocate the structural index");
+    }
+
+    uint64_t previous_ends_odd = 0;
+    uint64_t previous_in_string = 0;
+    // N.B. - the start of the input counts as whitespace, so a scalar there is a structural
+    uint64_t previous_ends_separator = 1;
+    uint8_t tail[BLOCK_SIZE];
+
+    for(size_t base = 0; base < parser->length; base += BLOCK_SIZE)
+    {
+        const uint8_t *block = parser->input + base;
+        if(BLOCK_SIZE > parser->length - base)
+        {
+            memset(tail, ' ', BLOCK_SIZE);
+            memcpy(tail, block, parser->length - base);
+            block = tail;
+        }
+
+        block_masks masks;
+        classify_block(block, &masks);
+
+        uint64_t escaped = find_escaped(masks.backslash, &previous_ends_odd);
+        uint64_t quotes = masks.quote & ~escaped;
+        // N.B. - the interior mask includes the opening quote but not the closing one
+        uint64_t in_string = prefix_xor(quotes) ^ previous_in_string;
+        previous_in_string = (uint64_t)((int64_t)in_string >> 63);
+
+        uint64_t structurals = (masks.operator & ~in_string) | quotes;
+        uint64_t separators = structurals | masks.whitespace;
+        uint64_t after_separator = (separators << 1) | previous_ends_separator;
+        previous_ends_separator = separators >> 63;
+        structurals |= after_separator & ~masks.whitespace & ~in_string;
+        structurals &= ~(quotes & ~in_string);
+
+        if(!flatten_bits(parser, base, structurals))
+        {
+            return false;
+        }
+    }
+    if(0 != previous_in_string)
+    {
+        return fail(parser, ERR_SCANNER_FAILED, "found an unterminated string");
+    }
+    parser->index[parser->count] = (uint32_t)parser->length;
+
+    return true;
+}
+
+#ifdef __SSE2__
+
+static inline uint64_t match_byte(__m128i chunk[4], uint8_t value)
+{
+    __m128i pattern = _mm_set1_epi8((char)value);
+    uint64_t result = 0;
+    for(size_t i = 0; i < 4; i++)
+    {
+        uint64_t bits = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[i], pattern));
+        result |= bits << (i * 16);
+    }
+    return result;
+}
+
+static inline void classify_block(const uint8_t *block, block_masks *masks)
+{
+    __m128i chunk[4];
+    for(size_t i = 0; i < 4; i++)
+    {
+        chunk[i] = _mm_loadu_si128((const __m128i *)(const void *)(block + i * 16));
+    }
+
+    masks->quote = match_byte(chunk, '"');
+    masks->backslash = match_byte(chunk, '\\');
+    masks->operator = match_byte(chunk, '{') | match_byte(chunk, '}')
+        | match_byte(chunk, '[') | match_byte(chunk, ']')
+        | match_byte(chunk, ':') | match_byte(chunk, ',');
+    masks->whitespace = match_byte(chunk, ' ') | match_byte(chunk, '\t')
+        | match_byte(chunk, '\n') | match_byte(chunk, '\r');
+}
+
+#else
+
+static inline void classify_block(const uint8_t *block, block_masks *masks)
+{
+    memset(masks, 0, sizeof(block_masks));
+    for(size_t i = 0; i < BLOCK_SIZE; i++)
+    {
+        uint64_t bit = 1ull << i;
+        switch(block[i])
+        {
+            case '"':
+                masks->quote |= bit;
+                break;
+            case '\\':
+                masks->backslash |= bit;
+                break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+                masks->operator |= bit;
+                break;
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                masks->whitespace |= bit;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+#endif
+
+/*
+ * Finds the characters that follow an odd length run of backslashes, these
+ * are the escaped characters.  Runs are told apart by whether they start on
+ * an even or an odd offset, and their ends are found with a carrying add.
+ */
+static inline uint64_t find_escaped(uint64_t backslash, uint64_t *previous_ends_odd)
+{
+    uint64_t starts = backslash & ~(backslash << 1);
+    uint64_t even_start_mask = EVEN_BITS ^ *previous_ends_odd;
+    uint64_t even_starts = starts & even_start_mask;
+    uint64_t odd_starts = starts & ~even_start_mask;
+
+    uint64_t even_carries = backslash + even_starts;
+    uint64_t odd_carries = backslash + odd_starts;
+    bool ends_odd = odd_carries < backslash;
+    odd_carries |= *previous_ends_odd;
+    *previous_ends_odd = ends_odd ? 1 : 0;
+
+    uint64_t even_carry_ends = even_carries & ~backslash;
+    uint64_t odd_carry_ends = odd_carries & ~backslash;
+    return (even_carry_ends & ~EVEN_BITS) | (odd_carry_ends & EVEN_BITS);
+}
+
+static inline uint64_t prefix_xor(uint64_t bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+static bool flatten_bits(json_parser *parser, size_t base, uint64_t bits)
+{
+    // N.B. - one extra slot is always kept for the terminating offset
+    if(parser->count + BLOCK_SIZE + 1 > parser->capacity)
+    {
+        size_t capacity = parser->capacity * 2;
+        uint32_t *index = realloc(parser->index, capacity * sizeof(uint32_t));
+        if(NULL == index)
+        {
+            return fail(parser, ERR_LOADER_OUT_OF_MEMORY, "unable to grow the structural index");
+        }
+        parser->index = index;
+        parser->capacity = capacity;
+    }
+
+    uint32_t *cursor = parser->index + parser->count;
+    while(0 != bits)
+    {
+        size_t offset = base + (size_t)__builtin_ctzll(bits);
+        if(offset < parser->length)
+        {
+            *cursor++ = (uint32_t)offset;
+        }
+        bits &= bits - 1;
+    }
+    parser->count = (size_t)(cursor - parser->index);
+
+    return true;
+}
+
+static void parse_document(json_parser *parser)
+{
+    loader_context *context = parser->context;
+    Document *value = make_document_node_in(arena(context));
+    if(NULL == value)
+    {
+        fail(parser, ERR_LOADER_OUT_OF_MEMORY, "unable to allocate a document");
+        return;
+    }
+    loader_trace("started document (%p)", value);
+    context->target = node(value);
+
+    if(parse_values(parser))
+    {
+        model_add(context->model, value);
+        loader_trace("added document (%p) to model (%p)", value, context->model);
+    }
+    context->target = NULL;
+}
+
+static bool parse_values(json_parser *parser)
+{
+    enum json_state state = EXPECT_VALUE;
+    while(true)
+    {
+        bool result = false;
+        switch(state)
+        {
+            case EXPECT_VALUE:
+                result = parse_value(parser, &state);
+                break;
+            case EXPECT_KEY:
+                result = parse_key(parser);
+                state = EXPECT_VALUE;
+                break;
+            case AFTER_VALUE:
+                if(is_document(parser->context->target))
+                {
+                    return !has_token(parser) || fail(parser, ERR_PARSER_FAILED, "found unexpected content after the document");
+                }
+                result = after_value(parser, &state);
+                break;
+        }
+        if(!result)
+        {
+            return false;
+        }
+    }
+}
+
+static bool parse_value(json_parser *parser, enum json_state *state)
+{
+    if(!has_token(parser))
+    {
+        return fail(parser, ERR_PARSER_FAILED, "expected a value");
+    }
+
+    loader_context *context = parser->context;
+    Node *value = NULL;
+    switch(token(parser))
+    {
+        case '{':
+            value = node(make_mapping_node_in(arena(context)));
+            parser->position++;
+            if(!start_container(parser, value))
+            {
+                return false;
+            }
+            if(has_token(parser) && '}' == token(parser))
+            {
+                parser->position++;
+                end_container(parser);
+                *state = AFTER_VALUE;
+            }
+            else
+            {
+                *state = EXPECT_KEY;
+            }
+            return true;
+        case '[':
+            value = node(make_sequence_node_in(arena(context)));
+            parser->position++;
+            if(!start_container(parser, value))
+            {
+                return false;
+            }
+            if(has_token(parser) && ']' == token(parser))
+            {
+                parser->position++;
+                end_container(parser);
+                *state = AFTER_VALUE;
+            }
+            else
+            {
+                *state = EXPECT_VALUE;
+            }
+            return true;
+        case '"':
+            value = node(parse_string(parser));
+            break;
+        case '}':
+        case ']':
+        case ':':
+        case ',':
+            return fail(parser, ERR_PARSER_FAILED, "expected a value");
+        default:
+            value = node(parse_token(parser));
+            break;
+    }
+    if(NULL == value)
+    {
+        return false;
+    }
+    *state = AFTER_VALUE;
+    if(add_node(context, value))
+    {
+        return fail(parser, context->code, "unable to add a value");
+    }
+    return true;
+}
+
+static bool parse_key(json_parser *parser)
+{
+    if(!has_token(parser) || '"' != token(parser))
+    {
+        return fail(parser, ERR_PARSER_FAILED, "expected a string mapping key");
+    }
+    Scalar *key = parse_string(parser);
+    if(NULL == key)
+    {
+        return false;
+    }
+    if(!has_token(parser) || ':' != token(parser))
+    {
+        return fail(parser, ERR_PARSER_FAILED, "expected ':' after a mapping key");
+    }
+    parser->position++;
+    parser->context->key_holder = key;
+
+    return true;
+}
+
+static bool after_value(json_parser *parser, enum json_state *state)
+{
+    Node *target = parser->context->target;
+    uint8_t expected = is_mapping(target) ? '}' : ']';
+    uint8_t current = has_token(parser) ? token(parser) : 0;
+    if(',' == current)
+    {
+        parser->position++;
+        *state = is_mapping(target) ? EXPECT_KEY : EXPECT_VALUE;
+        return true;
+    }
+    if(expected == current)
+    {
+        parser->position++;
+        end_container(parser);
+        return true;
+    }
+    return fail(parser, ERR_PARSER_FAILED, is_mapping(target) ? "expected ',' or '}' in a mapping" : "expected ',' or ']' in a sequence");
+}
+
+static bool start_container(json_parser *parser, Node *container)
+{
+    loader_context *context = parser->context;
+    if(NULL == container)
+    {
+        return fail(parser, ERR_LOADER_OUT_OF_MEMORY, "unable to allocate a node");
+    }
+    loader_trace("started %s (%p)", node_kind_name(container), container);
+    // N.B. - until `end_container' the length holds the count of duplicate keys seen so far
+    node_set_source(container, parser->index[parser->position - 1], context->duplicates);
+    if(add_node(context, container))
+    {
+        return fail(parser, context->code, "unable to add a value");
+    }
+    context->target = container;
+
+    return true;
+}
+
+static void end_container(json_parser *parser)
+{
+    loader_context *context = parser->context;
+    Node *container = context->target;
+    loader_trace("completed %s (%p) of length: %zd", node_kind_name(container), container, node_size(container));
+    if(is_sequence(container))
+    {
+        vector_trim(sequence(container)->values);
+    }
+    complete_source(parser, container);
+    context->target = node_parent(container);
+}
+
+/*
+ * A container's span covers its text from the opening to the closing
+ * bracket, so that it can be written out again without visiting its
+ * children.  When a duplicate key was dropped or replaced inside it, the
+ * text no longer matches the model, and the container is left without one.
+ */
+static void complete_source(json_parser *parser, Node *container)
+{
+    SourceSpan span = {0, 0};
+    node_source(container, &span);
+    if(span.length != parser->context->duplicates)
+    {
+        node_set_source(container, 0, 0);
+        return;
+    }
+    size_t end = parser->index[parser->position - 1] + 1;
+    node_set_source(container, span.offset, end - span.offset);
+}
+
+static Scalar *parse_string(json_parser *parser)
+{
+    size_t start = token_offset(parser) + 1;
+    bool escaped = false;
+    size_t end = scan_string(parser, start, &escaped);
+    if(0 == end)
+    {
+        return NULL;
+    }
+    parser->position++;
+
+    if(!escaped)
+    {
+        return make_value(parser, parser->input + start, end - start, SCALAR_STRING);
+    }
+
+    size_t length = 0;
+    if(!unescape(parser, start, end, &length))
+    {
+        return NULL;
+    }
+    Scalar *result = make_scalar_node_in(arena(parser->context), parser->scratch, length, SCALAR_STRING);
+    if(NULL == result)
+    {
+        fail(parser, ERR_LOADER_OUT_OF_MEMORY, "unable to allocate a scalar");
+    }
+    return result;
+}
+
+/*
+ * Returns the offset of the closing quote of the string starting at
+ * `start', or zero if the string isn't valid.
+ */
+static size_t scan_string(json_parser *parser, size_t start, bool *escaped)
+{
+    const uint8_t *input = parser->input;
+    size_t length = parser->length;
+    size_t offset = start;
+    while(true)
+    {
+        offset = find_special(input, offset, length);
+        if(offset >= length)
+        {
+            fail(parser, ERR_SCANNER_FAILED, "found an unterminated string");
+            return 0;
+        }
+
+        uint8_t current = input[offset];
+        size_t width = 0;
+        if('"' == current)
+        {
+            return offset;
+        }
+        else if('\\' == current)
+        {
+            *escaped = true;
+            width = check_escape(input, offset, length);
+        }
+        else if(0x80 <= current)
+        {
+            width = check_utf8(input, offset, length);
+        }
+        if(0 == width)
+        {
+            fail(parser, ERR_SCANNER_FAILED, '\\' == current ? "found an invalid escape sequence in a string"
+                                                              : "found an invalid character in a string");
+            return 0;
+        }
+        offset += width;
+    }
+}
+
+/*
+ * Finds the next quote, backslash, control character or non-ASCII byte.
+ */
+static inline size_t find_special(const uint8_t *input, size_t offset, size_t length)
+{
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i delete = _mm_set1_epi8(0x7F);
+    const __m128i space = _mm_set1_epi8(0x20);
+    for(; offset + 16 <= length; offset += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(const void *)(input + offset));
+        // N.B. - a signed comparison catches both the control characters and the non-ASCII bytes
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(chunk, delete), _mm_cmplt_epi8(chunk, space)));
+        int bits = _mm_movemask_epi8(special);
+        if(0 != bits)
+        {
+            return offset + (size_t)__builtin_ctz((unsigned int)bits);
+        }
+    }
+#endif
+    for(; offset < length; offset++)
+    {
+        uint8_t current = input[offset];
+        if('"' == current || '\\' == current || 0x20 > current || 0x7F <= current)
+        {
+            break;
+        }
+    }
+    return offset;
+}
+
+static size_t check_escape(const uint8_t *input, size_t offset, size_t length)
+{
+    if(offset + 1 >= length)
+    {
+        return 0;
+    }
+    switch(input[offset + 1])
+    {
+        case '"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            return 2;
+        case 'u':
+        {
+            uint32_t value = 0;
+            if(offset + 6 > length || !read_hex(input + offset + 2, &value))
+            {
+                return 0;
+            }
+            if(0xD800 > value || 0xDFFF < value)
+            {
+                return 6;
+            }
+            // N.B. - a surrogate is only valid as the first half of a pair
+            uint32_t low = 0;
+            if(0xDBFF < value || offset + 12 > length || '\\' != input[offset + 6] || 'u' != input[offset + 7]
+               || !read_hex(input + offset + 8, &low) || 0xDC00 > low || 0xDFFF < low)
+            {
+                return 0;
+            }
+            return 12;
+        }
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Returns the width of the UTF-8 sequence at `offset', or zero if it is
+ * malformed or encodes a character that libyaml's reader would reject.
+ */
+static size_t check_utf8(const uint8_t *input, size_t offset, size_t length)
+{
+    uint8_t lead = input[offset];
+    size_t width = 0;
+    uint32_t value = 0;
+    if(0xC0 == (lead & 0xE0))
+    {
+        width = 2;
+        value = lead & 0x1Fu;
+    }
+    else if(0xE0 == (lead & 0xF0))
+    {
+        width = 3;
+        value = lead & 0x0Fu;
+    }
+    else if(0xF0 == (lead & 0xF8))
+    {
+        width = 4;
+        value = lead & 0x07u;
+    }
+    else
+    {
+        return 0;
+    }
+    if(offset + width > length)
+    {
+        return 0;
+    }
+    for(size_t i = 1; i < width; i++)
+    {
+        uint8_t next = input[offset + i];
+        if(0x80 != (next & 0xC0))
+        {
+            return 0;
+        }
+        value = (value << 6) | (next & 0x3Fu);
+    }
+
+    static const uint32_t MINIMUM[] = {0, 0, 0x80, 0x800, 0x10000};
+    if(value < MINIMUM[width] || 0x10FFFF < value
+       || (0x85 != value && 0xA0 > value)
+       || (0xD800 <= value && 0xDFFF >= value)
+       || 0xFFFE == value || 0xFFFF == value)
+    {
+        return 0;
+    }
+    return width;
+}
+
+static bool unescape(json_parser *parser, size_t start, size_t end, size_t *length)
+{
+    // N.B. - unescaping never makes a string longer
+    size_t size = end - start;
+    if(size > parser->scratch_size)
+    {
+        uint8_t *scratch = realloc(parser->scratch, size);
+        if(NULL == scratch)
+        {
+            return fail(parser, ERR_LOADER_OUT_OF_MEMORY, "unable to allocate a string buffer");
+        }
+        parser->scratch = scratch;
+        parser->scratch_size = size;
+    }
+
+    const uint8_t *input = parser->input;
+    uint8_t *output = parser->scratch;
+    for(size_t offset = start; offset < end;)
+    {
+        const uint8_t *backslash = memchr(input + offset, '\\', end - offset);
+        size_t run = NULL == backslash ? end - offset : (size_t)(backslash - (input + offset));
+        memcpy(output, input + offset, run);
+        output += run;
+        offset += run;
+        if(offset >= end)
+        {
+            break;
+        }
+
+        uint8_t escape = input[offset + 1];
+        offset += 2;
+        switch(escape)
+        {
+            case 'b':
+                *output++ = '\b';
+                break;
+            case 'f':
+                *output++ = '\f';
+                break;
+            case 'n':
+                *output++ = '\n';
+                break;
+            case 'r':
+                *output++ = '\r';
+                break;
+            case 't':
+                *output++ = '\t';
+                break;
+            case 'u':
+            {
+                uint32_t value = 0;
+                read_hex(input + offset, &value);
+                offset += 4;
+                if(0xD800 <= value && 0xDBFF >= value)
+                {
+                    uint32_t low = 0;
+                    read_hex(input + offset + 2, &low);
+                    offset += 6;
+                    value = 0x10000 + ((value - 0xD800) << 10) + (low - 0xDC00);
+                }
+                output += encode_utf8(output, value);
+                break;
+            }
+            default:
+                *output++ = escape;
+                break;
+        }
+    }
+    *length = (size_t)(output - parser->scratch);
+
+    return true;
+}
+
+static inline bool read_hex(const uint8_t *input, uint32_t *value)
+{
+    uint32_t result = 0;
+    for(size_t i = 0; i < 4; i++)
+    {
+        uint8_t digit = input[i];
+        if('0' <= digit && '9' >= digit)
+        {
+            digit = (uint8_t)(digit - '0');
+        }
+        else if('a' <= (digit | 0x20) && 'f' >= (digit | 0x20))
+        {
+            digit = (uint8_t)((digit | 0x20) - 'a' + 10);
+        }
+        else
+        {
+            return false;
+        }
+        result = (result << 4) | digit;
+    }
+    *value = result;
+    return true;
+}
+
+static inline size_t encode_utf8(uint8_t *output, uint32_t value)
+{
+    if(0x80 > value)
+    {
+        output[0] = (uint8_t)value;
+        return 1;
+    }
+    if(0x800 > value)
+    {
+        output[0] = (uint8_t)(0xC0 | (value >> 6));
+        output[1] = (uint8_t)(0x80 | (value & 0x3F));
+        return 2;
+    }
+    if(0x10000 > value)
+    {
+        output[0] = (uint8_t)(0xE0 | (value >> 12));
+        output[1] = (uint8_t)(0x80 | ((value >> 6) & 0x3F));
+        output[2] = (uint8_t)(0x80 | (value & 0x3F));
+        return 3;
+    }
+    output[0] = (uint8_t)(0xF0 | (value >> 18));
+    output[1] = (uint8_t)(0x80 | ((value >> 12) & 0x3F));
+    output[2] = (uint8_t)(0x80 | ((value >> 6) & 0x3F));
+    output[3] = (uint8_t)(0x80 | (value & 0x3F));
+    return 4;
+}
+
+/*
+ * Numbers and the literals `true', `false' and `null' run up to the next
+ * structural character, less any trailing whitespace.
+ */
+static Scalar *parse_token(json_parser *parser)
+{
+    size_t start = token_offset(parser);
+    size_t end = parser->index[parser->position + 1];
+    while(end > start && (' ' == parser->input[end - 1] || '\t' == parser->input[end - 1] ||
+                          '\n' == parser->input[end - 1] || '\r' == parser->input[end - 1]))
+    {
+        end--;
+    }
+    parser->position++;
+
+    const uint8_t *value = parser->input + start;
+    size_t length = end - start;
+    ScalarKind kind = SCALAR_STRING;
+    if(4 == length && 0 == memcmp("null", value, 4))
+    {
+        kind = SCALAR_NULL;
+    }
+    else if((4 == length && 0 == memcmp("true", value, 4)) || (5 == length && 0 == memcmp("false", value, 5)))
+    {
+        kind = SCALAR_BOOLEAN;
+    }
+    else
+    {
+        // N.B. - the real pattern is exactly the JSON number grammar
+        kind = classify_plain_scalar(value, length);
+    }
+    if(SCALAR_STRING == kind || SCALAR_TIMESTAMP == kind)
+    {
+        parser->position--;
+        fail(parser, ERR_SCANNER_FAILED, "found an invalid literal");
+        return NULL;
+    }
+    return make_value(parser, value, length, kind);
+}
+
+static Scalar *make_value(json_parser *parser, const uint8_t *value, size_t length, ScalarKind kind)
+{
+    Scalar *result = NULL;
+    if(parser->borrow)
+    {
+        result = make_borrowed_scalar_node_in(arena(parser->context), value, length, kind);
+    }
+    else
+    {
+        result = make_scalar_node_in(arena(parser->context), value, length, kind);
+    }
+    if(NULL == result)
+    {
+        fail(parser, ERR_LOADER_OUT_OF_MEMORY, "unable to allocate a scalar");
+    }
+    return result;
+}
+
+static inline bool has_token(const json_parser *parser)
+{
+    return parser->position < parser->count;
+}
+
+static inline uint8_t token(const json_parser *parser)
+{
+    return parser->input[parser->index[parser->position]];
+}
+
+static inline size_t token_offset(const json_parser *parser)
+{
+    return parser->index[parser->position];
+}
+
+/*
+ * Records the failure along with a libyaml style problem mark, so that the
+ * status message reads the same as for the libyaml loader.
+ */
+static bool fail(json_parser *parser, loader_status_code code, const char *problem)
+{
+    loader_context *context = parser->context;
+    size_t offset = NULL == parser->index ? 0 : parser->position < parser->count ? token_offset(parser) : parser->length;
+    size_t line = 0;
+    size_t line_start = 0;
+    for(size_t i = 0; i < offset; i++)
+    {
+        if('\n' == parser->input[i])
+        {
+            line++;
+            line_start = i + 1;
+        }
+    }
+
+    loader_debug("uh oh! %s at offset %zd, aborting...", problem, offset);
+    context->code = code;
+    context->parser.problem = problem;
+    context->parser.problem_offset = offset;
+    context->parser.problem_mark.index = offset;
+    context->parser.problem_mark.line = line;
+    context->parser.problem_mark.column = offset - line_start;
+    context->parser.mark = context->parser.problem_mark;
+
+    return false;
+}
@@ -65,6 +65,8 @@ static const char * const MESSAGES[] =
     "No matching anchor was found for the alias on line %ld",
     "The alias on line %ld refers to an anchor that is an ancestor",
     "A duplicate mapping key was found on line %ld",
+    "The snapshot is damaged or was written by another version, it must be compiled again",
+    "The path can't be evaluated without loading the input",
     "An unexpected error has occured."
 };
 
@@ -97,6 +99,8 @@ char *loader_simple_status_message(loader_status_code code)
         case ERR_INPUT_SIZE_IS_ZERO:
         case ERR_NO_DOCUMENTS_FOUND:
         case ERR_LOADER_OUT_OF_MEMORY:
+        case ERR_INVALID_SNAPSHOT:
+        case ERR_UNSTREAMABLE_PATH:
         case ERR_OTHER:
             message = strdup(MESSAGES[code]);
             break;
@@ -0,0 +1,225 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include "loader.h"
+#include "loader/private.h"
+
+/*
+ * A single forward scan that classifies an untagged plain scalar as an
+ * integer, a real or a timestamp.  It accepts exactly the strings matched
+ * by these POSIX extended patterns (shown with bounded repetition for
+ * brevity), tried in this order:
+ *
+ * integer:   ^-?(0|([1-9][[:digit:]]*))$
+ * real:      ^-?(0|([1-9][[:digit:]]*))([.][[:digit:]]+)?([eE][+-]?[[:digit:]]+)?$
+ * timestamp: ^[0-9]{4}-[0-9]{1,2}-[0-9]{1,2}(([Tt]|[ \t]+)[0-9]{1,2}:[0-9]{2}(:[0-9]{2})?([.][0-9]+)?([ \t]*(Z|([-+][0-9]{1,2}(:[0-9]{2})?)))?)?$
+ *
+ * The input is consumed strictly left to right and is never rescanned.
+ */
+
+struct cursor_s
+{
+    const uint8_t *at;
+    const uint8_t *end;
+};
+
+typedef struct cursor_s cursor;
+
+static inline bool at_end(const cursor *input);
+static inline bool peek(const cursor *input, uint8_t value);
+static inline bool accept(cursor *input, uint8_t value);
+static inline size_t digits(cursor *input);
+static inline size_t blanks(cursor *input);
+
+static ScalarKind scan_number(cursor *input);
+static ScalarKind scan_timestamp(cursor *input);
+static bool scan_time(cursor *input);
+static bool scan_zone(cursor *input);
+
+static inline bool at_end(const cursor *input)
+{
+    return input->at == input->end;
+}
+
+static inline bool peek(const cursor *input, uint8_t value)
+{
+    return input->at < input->end && value == *input->at;
+}
+
+static inline bool accept(cursor *input, uint8_t value)
+{
+    if(peek(input, value))
+    {
+        input->at++;
+        return true;
+    }
+    return false;
+}
+
+static inline size_t digits(cursor *input)
+{
+    const uint8_t *start = input->at;
+    while(input->at < input->end && (uint8_t)(*input->at - '0') < 10)
+    {
+        input->at++;
+    }
+    return (size_t)(input->at - start);
+}
+
+static inline size_t blanks(cursor *input)
+{
+    const uint8_t *start = input->at;
+    while(input->at < input->end && (' ' == *input->at || '\t' == *input->at))
+    {
+        input->at++;
+    }
+    return (size_t)(input->at - start);
+}
+
+ScalarKind classify_plain_scalar(const uint8_t *value, size_t length)
+{
+    if(NULL == value || 0 == length)
+    {
+        return SCALAR_STRING;
+    }
+
+    cursor input = {value, value + length};
+    bool negative = accept(&input, '-');
+    bool zero = peek(&input, '0');
+    size_t count = digits(&input);
+    if(!negative && 4 == count && accept(&input, '-'))
+    {
+        return scan_timestamp(&input);
+    }
+    if(0 == count || (zero && 1 < count))
+    {
+        return SCALAR_STRING;
+    }
+    return scan_number(&input);
+}
+
+static ScalarKind scan_number(cursor *input)
+{
+    if(at_end(input))
+    {
+        return SCALAR_INTEGER;
+    }
+    if(accept(input, '.') && 0 == digits(input))
+    {
+        return SCALAR_STRING;
+    }
+    if(accept(input, 'e') || accept(input, 'E'))
+    {
+        if(!accept(input, '+'))
+        {
+            accept(input, '-');
+        }
+        if(0 == digits(input))
+        {
+            return SCALAR_STRING;
+        }
+    }
+    return at_end(input) ? SCALAR_REAL : SCALAR_STRING;
+}
+
+static ScalarKind scan_timestamp(cursor *input)
+{
+    size_t month = digits(input);
+    if(1 > month || 2 < month || !accept(input, '-'))
+    {
+        return SCALAR_STRING;
+    }
+    size_t day = digits(input);
+    if(1 > day || 2 < day)
+    {
+        return SCALAR_STRING;
+    }
+    if(at_end(input))
+    {
+        return SCALAR_TIMESTAMP;
+    }
+    return scan_time(input) ? SCALAR_TIMESTAMP : SCALAR_STRING;
+}
+
+static bool scan_time(cursor *input)
+{
+    if(!accept(input, 'T') && !accept(input, 't') && 0 == blanks(input))
+    {
+        return false;
+    }
+    size_t hour = digits(input);
+    if(1 > hour || 2 < hour || !accept(input, ':') || 2 != digits(input))
+    {
+        return false;
+    }
+    if(accept(input, ':') && 2 != digits(input))
+    {
+        return false;
+    }
+    if(accept(input, '.') && 0 == digits(input))
+    {
+        return false;
+    }
+    if(at_end(input))
+    {
+        return true;
+    }
+    blanks(input);
+    return scan_zone(input);
+}
+
+static bool scan_zone(cursor *input)
+{
+    if(accept(input, 'Z'))
+    {
+        return at_end(input);
+    }
+    if(!accept(input, '+') && !accept(input, '-'))
+    {
+        return false;
+    }
+    size_t hour = digits(input);
+    if(1 > hour || 2 < hour)
+    {
+        return false;
+    }
+    if(accept(input, ':') && 2 != digits(input))
+    {
+        return false;
+    }
+    return at_end(input);
+}
@@ -0,0 +1,1003 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700       /* for realpath() */
+#endif
+
+#ifdef __APPLE__
+#define st_mtim st_mtimespec
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "loader.h"
+#include "loader/private.h"
+#include "conditions.h"
+
+/*
+ * A snapshot is a compact binary serialization of a document model, that
+ * the loaders accept in place of the input it was loaded from.  It holds
+ * no pointers, the nodes are written depth first (mappings in insertion
+ * order, which is document order), each as:
+ *
+ * - a type byte, the node kind (or for scalars the scalar kind) and flags;
+ * - the number of the node, when it is the target of an alias;
+ * - the tag and the anchor when flagged, each as a length and the bytes;
+ * - a size: the length of a scalar, the item count of a sequence, the entry
+ *   count of a mapping, the target number of an alias, or for a document
+ *   whether it has a root;
+ * - the value of a scalar, or the children of a collection with each
+ *   mapping key before its value.
+ *
+ * All of the numbers are unsigned LEB128 varints.  The targets of aliases
+ * are numbered, since an alias may be written before its target.  Loading
+ * a snapshot is a single pass over the nodes with no parsing, and when the
+ * snapshot is mapped the scalars refer to it directly.
+ *
+ * The nodes are read recursively, so a snapshot nested deeper than
+ * `SNAPSHOT_MAX_DEPTH' is refused when it is read, since a valid checksum
+ * says nothing about where the snapshot came from, and it isn't written.
+ *
+ * The fixed size header holds the format version, the byte order, a
+ * checksum of the rest of the snapshot, and the path, size and
+ * modification time of the source that the model was loaded from.
+ */
+
+#define arena(CONTEXT) (CONTEXT)->model->arena
+
+#define SNAPSHOT_VERSION 1u
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+/* the longest varint encoding of a 64 bit value */
+#define MAX_VARINT_LENGTH 10
+
+static const uint8_t SNAPSHOT_MAGIC[8] = {0x89, 'K', 'B', 'O', '\r', '\n', 0x1a, '\n'};
+
+static const uint64_t CHECKSUM_SEED = 0x9e3779b97f4a7c15ull;
+static const uint64_t CHECKSUM_PRIME = 0xff51afd7ed558ccdull;
+
+enum snapshot_type
+{
+    SNAPSHOT_DOCUMENT = 0,
+    SNAPSHOT_SEQUENCE = 1,
+    SNAPSHOT_MAPPING  = 2,
+    SNAPSHOT_ALIAS    = 3,
+    /** plus the scalar kind */
+    SNAPSHOT_SCALAR   = 8,
+
+    SNAPSHOT_TYPE     = 0x1f,
+    SNAPSHOT_TAG      = 0x20,
+    SNAPSHOT_ANCHOR   = 0x40,
+    SNAPSHOT_TARGET   = 0x80
+};
+
+struct snapshot_header_s
+{
+    uint8_t  magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    /** of everything that follows this field */
+    uint64_t checksum;
+    /** of the whole snapshot, including this header */
+    uint64_t length;
+    uint64_t documents;
+    /** the number of nodes that are the target of an alias */
+    uint64_t targets;
+    uint64_t source_size;
+    int64_t  source_seconds;
+    int64_t  source_nanoseconds;
+    /** the length of the source path that follows this header, zero when there is none */
+    uint64_t source_length;
+};
+
+typedef struct snapshot_header_s snapshot_header;
+
+#define CHECKSUM_START offsetof(snapshot_header, length)
+
+struct snapshot_writer_s
+{
+    uint8_t   *data;
+    size_t     length;
+    size_t     capacity;
+    /** the targets of aliases, mapped to their number plus one */
+    Hashtable *targets;
+    size_t     count;
+    /** of the node being written */
+    size_t     depth;
+    bool       failed;
+};
+
+typedef struct snapshot_writer_s snapshot_writer;
+
+struct pending_alias_s
+{
+    Alias  *alias;
+    size_t  target;
+};
+
+struct snapshot_reader_s
+{
+    loader_context *context;
+    const uint8_t  *cursor;
+    const uint8_t  *end;
+    /** may scalars refer to the input instead of copying it? */
+    bool            borrow;
+    /** of the node being read */
+    size_t          depth;
+
+    /** the targets of aliases by number, as they are read */
+    Node          **targets;
+    size_t          target_count;
+    /** aliases read before their targets */
+    struct pending_alias_s *pending;
+    size_t          pending_count;
+    size_t          pending_capacity;
+};
+
+typedef struct snapshot_reader_s snapshot_reader;
+
+static uint64_t checksum(const uint8_t *data, size_t length);
+static bool is_snapshot_file(const char *path);
+static bool write_file(const char *path, const uint8_t *data, size_t length);
+
+static bool pointer_comparitor(const void *one, const void *two);
+static size_t target_number(const snapshot_writer *writer, const Node *value);
+static void number_targets(snapshot_writer *writer, Node *value);
+static bool number_item(Node *each, void *context);
+static bool number_entry(Node *key, Node *value, void *context);
+
+static void write_node(snapshot_writer *writer, Node *value);
+static bool write_item(Node *each, void *context);
+static bool write_entry(Node *key, Node *value, void *context);
+static void write_string(snapshot_writer *writer, const uint8_t *value);
+static void write_varint(snapshot_writer *writer, uint64_t value);
+static void write_bytes(snapshot_writer *writer, const void *value, size_t length);
+static bool reserve(snapshot_writer *writer, size_t length);
+
+static bool read_header(const uint8_t *input, size_t length, snapshot_header *header);
+static bool read_document(snapshot_reader *reader);
+static Node *read_node(snapshot_reader *reader);
+static Node *read_children(snapshot_reader *reader, Node *value, uint64_t size);
+static Node *read_alias(snapshot_reader *reader, uint64_t number);
+static bool add_target(snapshot_reader *reader, uint64_t number, Node *value);
+static bool resolve_aliases(snapshot_reader *reader);
+static bool read_varint(snapshot_reader *reader, uint64_t *value);
+static const uint8_t *read_string(snapshot_reader *reader, uint64_t *length);
+static const uint8_t *read_bytes(snapshot_reader *reader, uint64_t length);
+
+static inline bool invalid(snapshot_reader *reader)
+{
+    reader->context->code = ERR_INVALID_SNAPSHOT;
+    return false;
+}
+
+bool sniff_snapshot(const uint8_t *input, size_t length)
+{
+    return sizeof(SNAPSHOT_MAGIC) <= length && 0 == memcmp(SNAPSHOT_MAGIC, input, sizeof(SNAPSHOT_MAGIC));
+}
+
+/*
+ * A word at a time, in four independent lanes so that the multiplies
+ * overlap.
+ */
+static uint64_t checksum(const uint8_t *data, size_t length)
+{
+    uint64_t lanes[4] = {CHECKSUM_SEED, CHECKSUM_SEED + 1, CHECKSUM_SEED + 2, CHECKSUM_SEED + 3};
+    size_t offset = 0;
+    for(; offset + 32 <= length; offset += 32)
+    {
+        uint64_t words[4];
+        memcpy(words, data + offset, sizeof(words));
+        for(size_t i = 0; i < 4; i++)
+        {
+            lanes[i] = (lanes[i] ^ words[i]) * CHECKSUM_PRIME;
+            lanes[i] ^= lanes[i] >> 29;
+        }
+    }
+    for(size_t i = 0; offset < length; offset += 8, i++)
+    {
+        uint64_t word = 0;
+        memcpy(&word, data + offset, length - offset < 8 ? length - offset : 8);
+        lanes[i] = (lanes[i] ^ word) * CHECKSUM_PRIME;
+        lanes[i] ^= lanes[i] >> 29;
+    }
+
+    uint64_t result = length;
+    for(size_t i = 0; i < 4; i++)
+    {
+        result = (result ^ lanes[i]) * CHECKSUM_PRIME;
+        result ^= result >> 32;
+    }
+    return result;
+}
+
+/*
+ * Writing
+ */
+
+bool write_snapshot(const DocumentModel *model, const char *source, const char *path)
+{
+    PRECOND_NONNULL_ELSE_FALSE(model, path);
+    PRECOND_ELSE_FALSE(0 < model_size(model));
+
+    snapshot_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.documents = model_size(model);
+
+    char *source_path = NULL;
+    if(NULL != source)
+    {
+        // N.B. - a snapshot of a snapshot would make a chain of sources to check
+        ENSURE_THAT(false, EINVAL, !is_snapshot_file(source));
+        source_path = realpath(source, NULL);
+        struct stat info;
+        if(NULL == source_path || -1 == stat(source_path, &info))
+        {
+            free(source_path);
+            return false;
+        }
+        header.source_size = (uint64_t)info.st_size;
+        header.source_seconds = (int64_t)info.st_mtim.tv_sec;
+        header.source_nanoseconds = (int64_t)info.st_mtim.tv_nsec;
+        header.source_length = strlen(source_path);
+    }
+
+    snapshot_writer writer;
+    memset(&writer, 0, sizeof(writer));
+    writer.targets = make_hashtable_with_function(pointer_comparitor, identity_xor_hash);
+    writer.failed = NULL == writer.targets;
+
+    // N.B. - this is a placeholder, the header is complete once the nodes are written
+    write_bytes(&writer, &header, sizeof(header));
+    if(NULL != source_path)
+    {
+        write_bytes(&writer, source_path, header.source_length);
+    }
+    for(size_t i = 0; i < model_size(model); i++)
+    {
+        number_targets(&writer, node(model_document(model, i)));
+    }
+    for(size_t i = 0; i < model_size(model); i++)
+    {
+        write_node(&writer, node(model_document(model, i)));
+    }
+
+    bool result = !writer.failed;
+    if(result)
+    {
+        header.length = writer.length;
+        header.targets = writer.count;
+        memcpy(writer.data, &header, sizeof(header));
+        header.checksum = checksum(writer.data + CHECKSUM_START, writer.length - CHECKSUM_START);
+        memcpy(writer.data + offsetof(snapshot_header, checksum), &header.checksum, sizeof(header.checksum));
+        result = write_file(path, writer.data, writer.length);
+    }
+
+    int saved = errno;
+    free(source_path);
+    free(writer.data);
+    hashtable_free(writer.targets);
+    errno = saved;
+
+    return result;
+}
+
+static bool is_snapshot_file(const char *path)
+{
+    uint8_t magic[sizeof(SNAPSHOT_MAGIC)];
+    FILE *input = fopen(path, "rb");
+    if(NULL == input)
+    {
+        return false;
+    }
+    size_t count = fread(magic, 1, sizeof(magic), input);
+    fclose(input);
+
+    return sniff_snapshot(magic, count);
+}
+
+/*
+ * The snapshot is written beside `path' and then renamed over it, so that
+ * a reader never maps a partly written snapshot.
+ */
+static bool write_file(const char *path, const uint8_t *data, size_t length)
+{
+    size_t size = strlen(path) + 32;
+    char *temporary = malloc(size);
+    if(NULL == temporary)
+    {
+        return false;
+    }
+    snprintf(temporary, size, "%s.%ld.tmp", path, (long)getpid());
+
+    int descriptor = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if(-1 == descriptor)
+    {
+        free(temporary);
+        return false;
+    }
+
+    bool result = true;
+    size_t written = 0;
+    while(result && written < length)
+    {
+        ssize_t count = write(descriptor, data + written, length - written);
+        if(-1 == count && EINTR != errno)
+        {
+            result = false;
+        }
+        else if(0 < count)
+        {
+            written += (size_t)count;
+        }
+    }
+    result = -1 != close(descriptor) && result;
+    result = result && -1 != rename(temporary, path);
+
+    if(!result)
+    {
+        int saved = errno;
+        unlink(temporary);
+        errno = saved;
+    }
+    free(temporary);
+
+    return result;
+}
+
+static bool pointer_comparitor(const void *one, const void *two)
+{
+    return one == two;
+}
+
+/* the number of an alias target plus one, or zero when `value' isn't one */
+static size_t target_number(const snapshot_writer *writer, const Node *value)
+{
+    void *number = hashtable_get(writer->targets, value);
+    return (size_t)(uintptr_t)number;
+}
+
+static void number_targets(snapshot_writer *writer, Node *value)
+{
+    if(writer->failed || NULL == value)
+    {
+        return;
+    }
+
+    switch(node_kind(value))
+    {
+        case DOCUMENT:
+            number_targets(writer, document_root(document(value)));
+            break;
+        case SCALAR:
+            break;
+        case SEQUENCE:
+            sequence_iterate(sequence(value), number_item, writer);
+            break;
+        case MAPPING:
+            mapping_iterate(mapping(value), number_entry, writer);
+            break;
+        case ALIAS:
+        {
+            Node *target = alias_target(alias(value));
+            if(0 != target_number(writer, target))
+            {
+                break;
+            }
+            errno = 0;
+            writer->count++;
+            hashtable_put(writer->targets, target, (void *)(uintptr_t)writer->count);
+            writer->failed = 0 != errno;
+            break;
+        }
+    }
+}
+
+static bool number_item(Node *each, void *context)
+{
+    snapshot_writer *writer = (snapshot_writer *)context;
+    number_targets(writer, each);
+
+    return !writer->failed;
+}
+
+static bool number_entry(Node *key, Node *value, void *context)
+{
+    snapshot_writer *writer = (snapshot_writer *)context;
+    number_targets(writer, key);
+    number_targets(writer, value);
+
+    return !writer->failed;
+}
+
+static void write_node(snapshot_writer *writer, Node *value)
+{
+    if(writer->failed)
+    {
+        return;
+    }
+
+    uint8_t type = 0;
+    uint64_t size = 0;
+    switch(node_kind(value))
+    {
+        case DOCUMENT:
+            type = SNAPSHOT_DOCUMENT;
+            size = NULL == document_root(document(value)) ? 0 : 1;
+            break;
+        case SCALAR:
+        {
+            ScalarKind kind = scalar_kind(scalar(value));
+            type = (uint8_t)(SNAPSHOT_SCALAR + kind);
+            size = node_size(value);
+            break;
+        }
+        case SEQUENCE:
+            type = SNAPSHOT_SEQUENCE;
+            size = node_size(value);
+            break;
+        case MAPPING:
+            type = SNAPSHOT_MAPPING;
+            size = node_size(value);
+            break;
+        case ALIAS:
+            type = SNAPSHOT_ALIAS;
+            size = target_number(writer, alias_target(alias(value))) - 1;
+            break;
+    }
+
+    size_t number = target_number(writer, value);
+    if(0 != number)
+    {
+        type |= SNAPSHOT_TARGET;
+    }
+    if(NULL != value->tag.name)
+    {
+        type |= SNAPSHOT_TAG;
+    }
+    if(NULL != value->anchor)
+    {
+        type |= SNAPSHOT_ANCHOR;
+    }
+
+    write_bytes(writer, &type, 1);
+    if(0 != number)
+    {
+        write_varint(writer, number - 1);
+    }
+    if(NULL != value->tag.name)
+    {
+        write_string(writer, value->tag.name);
+    }
+    if(NULL != value->anchor)
+    {
+        write_string(writer, value->anchor);
+    }
+    write_varint(writer, size);
+
+    if(SNAPSHOT_MAX_DEPTH < ++writer->depth)
+    {
+        errno = EOVERFLOW;
+        writer->failed = true;
+        return;
+    }
+    switch(node_kind(value))
+    {
+        case DOCUMENT:
+            if(0 != size)
+            {
+                write_node(writer, document_root(document(value)));
+            }
+            break;
+        case SCALAR:
+            write_bytes(writer, scalar_value(scalar(value)), (size_t)size);
+            break;
+        case SEQUENCE:
+            sequence_iterate(sequence(value), write_item, writer);
+            break;
+        case MAPPING:
+            mapping_iterate(mapping(value), write_entry, writer);
+            break;
+        case ALIAS:
+            break;
+    }
+    writer->depth--;
+}
+
+static bool write_item(Node *each, void *context)
+{
+    snapshot_writer *writer = (snapshot_writer *)context;
+    write_node(writer, each);
+
+    return !writer->failed;
+}
+
+static bool write_entry(Node *key, Node *value, void *context)
+{
+    snapshot_writer *writer = (snapshot_writer *)context;
+    write_node(writer, key);
+    write_node(writer, value);
+
+    return !writer->failed;
+}
+
+static void write_string(snapshot_writer *writer, const uint8_t *value)
+{
+    size_t length = strlen((const char *)value);
+    write_varint(writer, length);
+    write_bytes(writer, value, length);
+}
+
+static void write_varint(snapshot_writer *writer, uint64_t value)
+{
+    uint8_t buffer[MAX_VARINT_LENGTH];
+    size_t length = 0;
+    while(0x80 <= value)
+    {
+        buffer[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (uint8_t)value;
+    write_bytes(writer, buffer, length);
+}
+
+static void write_bytes(snapshot_writer *writer, const void *value, size_t length)
+{
+    if(writer->failed || 0 == length || !reserve(writer, length))
+    {
+        return;
+    }
+    memcpy(writer->data + writer->length, value, length);
+    writer->length += length;
+}
+
+static bool reserve(snapshot_writer *writer, size_t length)
+{
+    if(writer->capacity - writer->length >= length)
+    {
+        return true;
+    }
+
+    size_t capacity = 0 == writer->capacity ? 64 * 1024 : writer->capacity;
+    while(capacity - writer->length < length)
+    {
+        capacity *= 2;
+    }
+    uint8_t *data = realloc(writer->data, capacity);
+    if(NULL == data)
+    {
+        writer->failed = true;
+        return false;
+    }
+    writer->data = data;
+    writer->capacity = capacity;
+
+    return true;
+}
+
+/*
+ * Reading
+ */
+
+static bool read_header(const uint8_t *input, size_t length, snapshot_header *header)
+{
+    if(sizeof(snapshot_header) > length)
+    {
+        loader_debug("the snapshot is truncated");
+        return false;
+    }
+    memcpy(header, input, sizeof(snapshot_header));
+    if(SNAPSHOT_VERSION != header->version || SNAPSHOT_BYTE_ORDER != header->byte_order)
+    {
+        loader_debug("the snapshot was written by an incompatible version");
+        return false;
+    }
+    if(length != header->length
+       || length - sizeof(snapshot_header) < header->source_length
+       || header->checksum != checksum(input + CHECKSUM_START, length - CHECKSUM_START))
+    {
+        loader_debug("the snapshot is damaged");
+        return false;
+    }
+
+    return true;
+}
+
+bool snapshot_is_current(const uint8_t *input, size_t length, char **source)
+{
+    *source = NULL;
+
+    snapshot_header header;
+    if(!read_header(input, length, &header))
+    {
+        return false;
+    }
+    if(0 == header.source_length)
+    {
+        return true;
+    }
+
+    char *path = strndup((const char *)input + sizeof(snapshot_header), header.source_length);
+    if(NULL == path)
+    {
+        return false;
+    }
+    struct stat info;
+    if(-1 == stat(path, &info))
+    {
+        loader_debug("the source of the snapshot is gone, using it as it is");
+        free(path);
+        return true;
+    }
+    if(header.source_size == (uint64_t)info.st_size
+       && header.source_seconds == (int64_t)info.st_mtim.tv_sec
+       && header.source_nanoseconds == (int64_t)info.st_mtim.tv_nsec)
+    {
+        free(path);
+        return true;
+    }
+
+    loader_debug("the source of the snapshot has changed since it was written");
+    *source = path;
+    return false;
+}
+
+void build_snapshot_model(struct loader_context *context, const uint8_t *input, size_t length)
+{
+    snapshot_header header;
+    if(!read_header(input, length, &header))
+    {
+        context->code = ERR_INVALID_SNAPSHOT;
+        return;
+    }
+    if(!start_model(context))
+    {
+        return;
+    }
+
+    snapshot_reader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.context = context;
+    reader.cursor = input + sizeof(snapshot_header) + header.source_length;
+    reader.end = input + length;
+    reader.borrow = NULL != context->input.data;
+    reader.target_count = header.targets;
+
+    // N.B. - every target takes at least two bytes
+    if(header.targets > length / 2)
+    {
+        context->code = ERR_INVALID_SNAPSHOT;
+    }
+    else if(0 != header.targets && NULL == (reader.targets = calloc(header.targets, sizeof(Node *))))
+    {
+        context->code = ERR_LOADER_OUT_OF_MEMORY;
+    }
+    for(uint64_t i = 0; LOADER_SUCCESS == context->code && i < header.documents; i++)
+    {
+        read_document(&reader);
+    }
+    if(LOADER_SUCCESS == context->code && (reader.cursor != reader.end || !resolve_aliases(&reader)))
+    {
+        context->code = ERR_INVALID_SNAPSHOT;
+    }
+    free(reader.targets);
+    free(reader.pending);
+
+    finish_model(context);
+}
+
+static bool read_document(snapshot_reader *reader)
+{
+    const uint8_t *type = read_bytes(reader, 1);
+    uint64_t size = 0;
+    if(NULL == type || SNAPSHOT_DOCUMENT != *type || !read_varint(reader, &size) || 1 < size)
+    {
+        return invalid(reader);
+    }
+
+    Document *document = make_document_node_in(arena(reader->context));
+    if(NULL == document || !model_add(reader->context->model, document))
+    {
+        reader->context->code = ERR_LOADER_OUT_OF_MEMORY;
+        return false;
+    }
+    if(0 == size)
+    {
+        return true;
+    }
+
+    // N.B. - the document is the first level, as it is when the snapshot is written
+    reader->depth = 1;
+    Node *root = read_node(reader);
+    if(NULL == root)
+    {
+        return false;
+    }
+    return document_set_root(document, root);
+}
+
+static Node *read_node(snapshot_reader *reader)
+{
+    loader_context *context = reader->context;
+    const uint8_t *type = read_bytes(reader, 1);
+    if(NULL == type)
+    {
+        return NULL;
+    }
+    uint8_t flags = (uint8_t)(*type & (SNAPSHOT_TAG | SNAPSHOT_ANCHOR | SNAPSHOT_TARGET));
+    uint8_t kind = (uint8_t)(*type & SNAPSHOT_TYPE);
+
+    uint64_t number = 0;
+    if(SNAPSHOT_TARGET & flags && !read_varint(reader, &number))
+    {
+        return NULL;
+    }
+    uint64_t tag_length = 0;
+    const uint8_t *tag = NULL;
+    if(SNAPSHOT_TAG & flags && NULL == (tag = read_string(reader, &tag_length)))
+    {
+        return NULL;
+    }
+    uint64_t anchor_length = 0;
+    const uint8_t *anchor = NULL;
+    if(SNAPSHOT_ANCHOR & flags && NULL == (anchor = read_string(reader, &anchor_length)))
+    {
+        return NULL;
+    }
+    uint64_t size = 0;
+    if(!read_varint(reader, &size))
+    {
+        return NULL;
+    }
+
+    Node *value = NULL;
+    if(SNAPSHOT_SCALAR <= kind && SNAPSHOT_SCALAR + SCALAR_NULL >= kind)
+    {
+        const uint8_t *bytes = read_bytes(reader, size);
+        if(NULL == bytes)
+        {
+            return NULL;
+        }
+        ScalarKind scalar_kind = (ScalarKind)(kind - SNAPSHOT_SCALAR);
+        value = node(reader->borrow ? make_borrowed_scalar_node_in(arena(context), bytes, (size_t)size, scalar_kind)
+                                    : make_scalar_node_in(arena(context), bytes, (size_t)size, scalar_kind));
+    }
+    else if(SNAPSHOT_SEQUENCE == kind)
+    {
+        value = node(make_sequence_node_in(arena(context)));
+    }
+    else if(SNAPSHOT_MAPPING == kind)
+    {
+        value = node(make_mapping_node_in(arena(context)));
+    }
+    else if(SNAPSHOT_ALIAS == kind && 0 == flags)
+    {
+        return read_alias(reader, size);
+    }
+    else
+    {
+        invalid(reader);
+        return NULL;
+    }
+    if(NULL == value)
+    {
+        context->code = ERR_LOADER_OUT_OF_MEMORY;
+        return NULL;
+    }
+
+    if(NULL != tag)
+    {
+        node_set_tag_in(arena(context), value, tag, (size_t)tag_length);
+    }
+    if(NULL != anchor)
+    {
+        node_set_anchor_in(arena(context), value, anchor, (size_t)anchor_length);
+    }
+    if(SNAPSHOT_TARGET & flags && !add_target(reader, number, value))
+    {
+        return NULL;
+    }
+
+    if(SNAPSHOT_MAX_DEPTH < ++reader->depth)
+    {
+        invalid(reader);
+        return NULL;
+    }
+    Node *result = read_children(reader, value, size);
+    reader->depth--;
+
+    return result;
+}
+
+static Node *read_children(snapshot_reader *reader, Node *value, uint64_t size)
+{
+    loader_context *context = reader->context;
+    for(uint64_t i = 0; SEQUENCE == node_kind(value) && i < size; i++)
+    {
+        Node *item = read_node(reader);
+        if(NULL == item)
+        {
+            return NULL;
+        }
+        if(!sequence_add(sequence(value), item))
+        {
+            context->code = ERR_LOADER_OUT_OF_MEMORY;
+            return NULL;
+        }
+    }
+    for(uint64_t i = 0; MAPPING == node_kind(value) && i < size; i++)
+    {
+        Node *key = read_node(reader);
+        if(NULL == key)
+        {
+            return NULL;
+        }
+        if(SCALAR != node_kind(key))
+        {
+            invalid(reader);
+            return NULL;
+        }
+        Node *item = read_node(reader);
+        if(NULL == item)
+        {
+            return NULL;
+        }
+        if(!mapping_put_scalar(mapping(value), scalar(key), item))
+        {
+            context->code = ERR_LOADER_OUT_OF_MEMORY;
+            return NULL;
+        }
+    }
+
+    return value;
+}
+
+static Node *read_alias(snapshot_reader *reader, uint64_t number)
+{
+    loader_context *context = reader->context;
+    if(number >= reader->target_count)
+    {
+        invalid(reader);
+        return NULL;
+    }
+
+    Alias *value = make_alias_node_in(arena(context), reader->targets[number]);
+    if(NULL == value)
+    {
+        context->code = ERR_LOADER_OUT_OF_MEMORY;
+        return NULL;
+    }
+    if(NULL != value->target)
+    {
+        return node(value);
+    }
+
+    if(reader->pending_count == reader->pending_capacity)
+    {
+        size_t capacity = 0 == reader->pending_capacity ? 16 : reader->pending_capacity * 2;
+        struct pending_alias_s *pending = realloc(reader->pending, capacity * sizeof(struct pending_alias_s));
+        if(NULL == pending)
+        {
+            context->code = ERR_LOADER_OUT_OF_MEMORY;
+            return NULL;
+        }
+        reader->pending = pending;
+        reader->pending_capacity = capacity;
+    }
+    reader->pending[reader->pending_count++] = (struct pending_alias_s){value, (size_t)number};
+
+    return node(value);
+}
+
+static bool add_target(snapshot_reader *reader, uint64_t number, Node *value)
+{
+    if(number >= reader->target_count || NULL != reader->targets[number])
+    {
+        return invalid(reader);
+    }
+    reader->targets[number] = value;
+
+    return true;
+}
+
+static bool resolve_aliases(snapshot_reader *reader)
+{
+    for(size_t i = 0; i < reader->pending_count; i++)
+    {
+        Node *target = reader->targets[reader->pending[i].target];
+        if(NULL == target)
+        {
+            loader_debug("the snapshot has an alias with no target");
+            return false;
+        }
+        reader->pending[i].alias->target = target;
+    }
+
+    return true;
+}
+
+static bool read_varint(snapshot_reader *reader, uint64_t *value)
+{
+    uint64_t result = 0;
+    for(unsigned int shift = 0; shift < 7 * MAX_VARINT_LENGTH && reader->cursor < reader->end; shift += 7)
+    {
+        uint8_t byte = *reader->cursor++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if(0 == (byte & 0x80))
+        {
+            *value = result;
+            return true;
+        }
+    }
+
+    return invalid(reader);
+}
+
+static const uint8_t *read_string(snapshot_reader *reader, uint64_t *length)
+{
+    if(!read_varint(reader, length))
+    {
+        return NULL;
+    }
+
+    return read_bytes(reader, *length);
+}
+
+static const uint8_t *read_bytes(snapshot_reader *reader, uint64_t length)
+{
+    if(length > (uint64_t)(reader->end - reader->cursor))
+    {
+        invalid(reader);
+        return NULL;
+    }
+
+    const uint8_t *result = reader->cursor;
+    reader->cursor += length;
+    return result;
+}
@@ -0,0 +1,1662 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "loader.h"
+#include "loader/private.h"
+
+/*
+ * Streaming Evaluation
+ * ====================
+ *
+ * The path is compiled into a list of operations, like the evaluator's
+ * program, that is run as an automaton over the parser's events.  Each open
+ * collection has a set of states, saying what its children are tested for,
+ * and when a node starts the states of its parent decide which operations it
+ * arrives at.  Following an operation that selects the node itself, such as a
+ * type test, leads straight on to the next operation, so by the time its
+ * start event has been seen, it is known whether a node is selected, and
+ * what its own children will be tested for.
+ *
+ * A node is only built when it is selected, when it is inside a node that is
+ * being built, or when it is anchored, as an alias may refer to it later.
+ * An alias is queried by replaying its target, which is complete.
+ *
+ * Selected nodes are passed on in the order that the evaluator gives, which
+ * isn't always the order that they start in.  The evaluator takes the result
+ * of each step in turn, so a recursive step orders its nodes by their place
+ * in the document, or by their parent's place for a name test, and only then
+ * are the following steps taken from each of them.  Every selected node is
+ * queued with its position, the index of it and each of its ancestors, and
+ * the depth of the node that each recursive step took on the way to it, and
+ * the queue is sorted on these before it is passed on.
+ *
+ * A later key may replace the value of a mapping, taking the place of the
+ * original, so the nodes selected inside an open mapping are held until it
+ * is complete, and those inside a replaced value are dropped.  Similarly, a
+ * collection that a recursive step selected may still add nodes that sort
+ * before the ones already queued.  The queue is passed on once none of these
+ * collections are open and every node in it is complete, and then nothing
+ * refers to the selected nodes any more, and their arena is reset.  Without
+ * recursive steps or replaced values the queue is already in order, so each
+ * node is passed on once it, and every node queued before it, is complete.
+ */
+
+enum operation_code
+{
+    STREAM_ROOT,
+    STREAM_NAME,
+    STREAM_WILDCARD,
+    STREAM_TYPE,
+    STREAM_RECURSE_NAME,
+    STREAM_RECURSE_WILDCARD,
+    STREAM_RECURSE_TYPE,
+    STREAM_ALL,
+    STREAM_SUBSCRIPT,
+    STREAM_SLICE,
+    STREAM_HALT
+};
+
+struct operation
+{
+    enum operation_code code;
+    union
+    {
+        struct
+        {
+            const uint8_t *value;
+            size_t         length;
+        } name;
+        enum type_test_kind type;
+        size_t              index;
+        struct
+        {
+            size_t from;
+            size_t to;
+            size_t step;
+        } slice;
+    } operand;
+};
+
+typedef struct operation Operation;
+
+enum state_kind
+{
+    /** the node is tested by the operation at `pc' */
+    ARRIVAL,
+    /** as for `ARRIVAL', but the node was picked from a sequence by index, and an alias is not resolved */
+    INDEXED,
+    /** the children of the node are tested by the operation at `pc' */
+    CHILDREN,
+    /** the items of the sequence are selected by the operation at `pc' */
+    ITEMS,
+    /** the children of the node arrive at the recursive step at `pc' */
+    RECURSE
+};
+
+struct state
+{
+    enum state_kind kind;
+    size_t          pc;
+    /** the last of the levels of the recursive steps taken to the state, or `NO_LEVEL' */
+    size_t          levels;
+};
+
+typedef struct state State;
+
+/*
+ * The depth of the node that a recursive step took, the evaluator orders the
+ * nodes of the step by the position of this node.  The levels of a state are
+ * a list, linked back through `previous'.
+ */
+struct level
+{
+    size_t length;
+    size_t previous;
+};
+
+#define NO_LEVEL SIZE_MAX
+
+struct frame
+{
+    NodeKind  kind;
+    /** the collection, if it has been built */
+    Node     *node;
+    /** where the children are built, or NULL if they aren't */
+    Arena    *arena;
+    /** the collection is an alias target being replayed, its nodes already exist */
+    bool      replay;
+    /** this collection's states are `count' entries of the state stack from `states' */
+    size_t    states;
+    size_t    count;
+    /** the index of the next child */
+    size_t    index;
+    /** the position of the current child, for a duplicate key this is the index of the original */
+    size_t    position;
+    bool      duplicate;
+    size_t    original;
+    /** for a mapping, set once the key of the next value has been read */
+    bool      has_key;
+    const uint8_t *key;
+    size_t    key_length;
+    Scalar   *key_node;
+    /** a copy of the key, when it isn't built */
+    uint8_t  *buffer;
+    size_t    capacity;
+    /** the keys of the mapping seen so far, if duplicates are being tracked */
+    Hashtable *keys;
+    Arena     *key_arena;
+    /** the levels that are released when the collection is complete */
+    size_t    levels;
+    /** the matches queued for this collection */
+    size_t    first_match;
+    size_t    match_count;
+    /** the queue is held while the collection is open */
+    bool      holds;
+};
+
+typedef struct frame Frame;
+
+/*
+ * The sort key of a match, the levels of the recursive steps that selected
+ * it, followed by its position.
+ */
+struct match_key
+{
+    size_t recursions;
+    size_t depth;
+    size_t values[];
+};
+
+typedef struct match_key MatchKey;
+
+struct match
+{
+    Node     *node;
+    bool      closed;
+    /** the match is inside a value that was replaced by a duplicate key */
+    bool      dropped;
+    size_t    order;
+    MatchKey *key;
+};
+
+struct seen_key
+{
+    size_t  index;
+    size_t  length;
+    uint8_t value[];
+};
+
+struct key_probe
+{
+    const uint8_t *value;
+    size_t         length;
+};
+
+struct stream_context
+{
+    loader_context       *loader;
+    const stream_options *options;
+    stream_callback       callback;
+    void                 *argument;
+
+    Operation *program;
+    /** the number of recursive steps, and the first of them */
+    size_t     recursions;
+    size_t     first_recursion;
+
+    Frame     *frames;
+    size_t     depth;
+    size_t     frame_capacity;
+
+    State     *states;
+    size_t     state_count;
+    size_t     state_capacity;
+
+    /** the states of the next node, before its own operations are followed */
+    State     *seeds;
+    size_t     seed_count;
+    size_t     seed_capacity;
+
+    struct level *levels;
+    size_t     level_count;
+    size_t     level_capacity;
+
+    /** the levels of each time that the current node is selected */
+    size_t    *hits;
+    size_t     hit_count;
+    size_t     hit_capacity;
+
+    struct match *matches;
+    size_t     head;
+    size_t     match_count;
+    size_t     match_capacity;
+    /** the queued matches that aren't complete */
+    size_t     open_matches;
+    /** the open collections that hold the queue */
+    size_t     holding;
+    /** a duplicate key has put the queue out of order */
+    bool       reordered;
+
+    /** anchored nodes, which are kept until the end of the input */
+    Arena     *anchored;
+    /** selected nodes, which are released once they have been passed on */
+    Arena     *selected;
+
+    /** the number of documents started */
+    size_t     documents;
+    size_t     emitted;
+    bool       done;
+};
+
+typedef struct stream_context stream_context;
+
+static const size_t INITIAL_CAPACITY = 16;
+
+static Operation *compile_operations(const jsonpath *path);
+static void compile_test(const step *each, Operation *operation);
+static void compile_predicate(const predicate *each, Operation *operation);
+
+static bool dispatch_event(stream_context *context, const yaml_event_t *event);
+static bool start_document(stream_context *context);
+static bool end_document(stream_context *context);
+static bool add_scalar(stream_context *context, const yaml_event_t *event);
+static bool cache_mapping_key(stream_context *context, Frame *parent, const yaml_event_t *event);
+static bool track_key(stream_context *context, Frame *parent, const yaml_event_t *event);
+static bool add_alias(stream_context *context, const yaml_event_t *event);
+static bool start_collection(stream_context *context, const yaml_event_t *event, NodeKind kind);
+static bool end_collection(stream_context *context);
+
+static bool select_seeds(stream_context *context, Frame *parent, NodeKind kind);
+static bool enter_seeds(stream_context *context, NodeKind kind, ScalarKind value_kind);
+static bool arrive(stream_context *context, size_t pc, size_t levels, NodeKind kind, ScalarKind value_kind);
+static bool type_matches(enum type_test_kind test, NodeKind kind, ScalarKind value_kind);
+static bool name_matches(const Operation *operation, const Frame *parent);
+static bool slice_selects(const Operation *operation, size_t index);
+
+static bool visit_alias(stream_context *context, Frame *parent, Node *target, Node *value);
+static bool replay_node(stream_context *context, Node *each);
+static bool replay_item(Node *each, void *argument);
+static bool replay_value(Node *key, Node *value, void *argument);
+
+static Node *build_scalar(stream_context *context, Arena *arena, const yaml_event_t *event, ScalarKind kind);
+static Node *build_collection(stream_context *context, Arena *arena, const yaml_event_t *event, NodeKind kind);
+static void set_anchor(stream_context *context, Arena *arena, Node *target, const uint8_t *anchor);
+static bool attach_node(stream_context *context, Frame *parent, Node *value);
+static Arena *arena_for(stream_context *context, const Frame *parent, const uint8_t *anchor);
+
+static bool queue_matches(stream_context *context, Node *each, bool closed);
+static void close_matches(stream_context *context, size_t first, size_t count);
+static void drop_matches(stream_context *context, size_t depth, size_t original);
+static bool drain_matches(stream_context *context);
+static int  compare_matches(const void *one, const void *two);
+static int  compare_positions(const MatchKey *one, size_t one_length, const MatchKey *two, size_t two_length);
+
+static hashcode seen_key_hash(const void *key);
+static bool     seen_key_comparitor(const void *one, const void *two);
+static bool     seen_key_probe(const void *key, const void *probe);
+
+static Frame *push_frame(stream_context *context, NodeKind kind, size_t states);
+static void   pop_frame(stream_context *context);
+static bool   holds_queue(const stream_context *context, const Frame *frame);
+static void   advance_frame(Frame *frame);
+static bool   push_state(stream_context *context, enum state_kind kind, size_t pc, size_t levels);
+static bool   push_seed(stream_context *context, enum state_kind kind, size_t pc, size_t levels);
+static bool   push_level(stream_context *context, size_t length, size_t previous);
+static bool   push_hit(stream_context *context, size_t levels);
+static void  *grow(void *array, size_t *capacity, size_t size);
+static bool   out_of_memory(stream_context *context);
+
+#define top(CONTEXT) (&(CONTEXT)->frames[(CONTEXT)->depth - 1])
+#define is_key_position(FRAME) (MAPPING == (FRAME)->kind && !(FRAME)->has_key)
+#define is_collection(KIND) (SEQUENCE == (KIND) || MAPPING == (KIND))
+
+bool path_is_streamable(const jsonpath *path)
+{
+    if(NULL == path || ABSOLUTE_PATH != path_kind(path))
+    {
+        return false;
+    }
+    for(size_t i = 0; i < path_length(path); i++)
+    {
+        const step *each = path_get(path, i);
+        if(!step_has_predicate(each))
+        {
+            continue;
+        }
+        const predicate *value = step_predicate(each);
+        switch(predicate_kind(value))
+        {
+            case JOIN:
+                return false;
+            case SLICE:
+                // N.B. - a negative bound counts from the end of a sequence, which isn't known until it is complete
+                if((slice_predicate_has_from(value) && 0 > slice_predicate_from(value)) ||
+                   (slice_predicate_has_to(value) && 0 > slice_predicate_to(value)) ||
+                   (slice_predicate_has_step(value) && 0 > slice_predicate_step(value)))
+                {
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+size_t stream_events(struct loader_context *loader, const jsonpath *path, const stream_options *options,
+                     stream_callback callback, void *argument)
+{
+    stream_context context;
+    memset(&context, 0, sizeof(stream_context));
+    context.loader = loader;
+    context.options = options;
+    context.callback = callback;
+    context.argument = argument;
+    loader->code = LOADER_SUCCESS;
+
+    context.program = compile_operations(path);
+    context.first_recursion = SIZE_MAX;
+    for(size_t pc = 0; NULL != context.program && STREAM_HALT != context.program[pc].code; pc++)
+    {
+        switch(context.program[pc].code)
+        {
+            case STREAM_RECURSE_NAME:
+            case STREAM_RECURSE_WILDCARD:
+            case STREAM_RECURSE_TYPE:
+                if(0 == context.recursions++)
+                {
+                    context.first_recursion = pc;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    context.anchored = make_arena();
+    context.selected = make_arena();
+    if(NULL == context.program || NULL == context.anchored || NULL == context.selected)
+    {
+        loader_error("uh oh! out of memory, can't start the streaming query, aborting...");
+        loader->code = ERR_LOADER_OUT_OF_MEMORY;
+    }
+
+    yaml_event_t event;
+    memset(&event, 0, sizeof(event));
+    loader_trace("entering streaming event loop...");
+    bool done = LOADER_SUCCESS != loader->code;
+    while(!done)
+    {
+        if(!yaml_parser_parse(&loader->parser, &event))
+        {
+            loader->code = interpret_yaml_error(&loader->parser);
+            break;
+        }
+        done = dispatch_event(&context, &event);
+        yaml_event_delete(&event);
+    }
+
+    if(LOADER_SUCCESS == loader->code && 0 == context.documents)
+    {
+        loader_error("no documents found for the input!");
+        loader->code = ERR_NO_DOCUMENTS_FOUND;
+    }
+    loader_debug("done. selected %zd nodes from %zd documents.", context.emitted, context.documents);
+
+    for(size_t i = 0; i < context.frame_capacity; i++)
+    {
+        free(context.frames[i].buffer);
+        arena_free(context.frames[i].key_arena);
+    }
+    free(context.frames);
+    free(context.states);
+    free(context.seeds);
+    free(context.levels);
+    free(context.hits);
+    free(context.matches);
+    free(context.program);
+    arena_free(context.anchored);
+    arena_free(context.selected);
+
+    return context.emitted;
+}
+
+static Operation *compile_operations(const jsonpath *path)
+{
+    // N.B. - at most one test and one predicate per step, plus the halt
+    size_t length = path_length(path);
+    Operation *program = calloc(length * 2 + 1, sizeof(Operation));
+    if(NULL == program)
+    {
+        return NULL;
+    }
+
+    size_t pc = 0;
+    for(size_t i = 0; i < length; i++)
+    {
+        const step *each = path_get(path, i);
+        compile_test(each, &program[pc++]);
+        if(step_has_predicate(each))
+        {
+            compile_predicate(step_predicate(each), &program[pc++]);
+        }
+    }
+    program[pc].code = STREAM_HALT;
+    loader_debug("compiled %zd streaming operations for %zd steps", pc + 1, length);
+
+    return program;
+}
+
+static void compile_test(const step *each, Operation *operation)
+{
+    if(ROOT == step_kind(each))
+    {
+        operation->code = STREAM_ROOT;
+        return;
+    }
+
+    bool recursive = RECURSIVE == step_kind(each);
+    switch(step_test_kind(each))
+    {
+        case WILDCARD_TEST:
+            operation->code = recursive ? STREAM_RECURSE_WILDCARD : STREAM_WILDCARD;
+            break;
+        case TYPE_TEST:
+            operation->code = recursive ? STREAM_RECURSE_TYPE : STREAM_TYPE;
+            operation->operand.type = type_test_step_kind(each);
+            break;
+        case NAME_TEST:
+            operation->code = recursive ? STREAM_RECURSE_NAME : STREAM_NAME;
+            operation->operand.name.value = name_test_step_name(each);
+            operation->operand.name.length = name_test_step_length(each);
+            break;
+    }
+}
+
+static void compile_predicate(const predicate *each, Operation *operation)
+{
+    switch(predicate_kind(each))
+    {
+        case SUBSCRIPT:
+            operation->code = STREAM_SUBSCRIPT;
+            operation->operand.index = subscript_predicate_index(each);
+            break;
+        case SLICE:
+        {
+            operation->code = STREAM_SLICE;
+            int_fast32_t from = slice_predicate_has_from(each) ? slice_predicate_from(each) : 0;
+            int_fast32_t increment = slice_predicate_has_step(each) ? slice_predicate_step(each) : 1;
+            operation->operand.slice.from = (size_t)from;
+            operation->operand.slice.step = (size_t)increment;
+            if(slice_predicate_has_to(each))
+            {
+                int_fast32_t to = slice_predicate_to(each);
+                operation->operand.slice.to = (size_t)to;
+            }
+            else
+            {
+                operation->operand.slice.to = SIZE_MAX;
+            }
+            break;
+        }
+        default:
+            // N.B. - join predicates aren't streamable, so this is a wildcard predicate
+            operation->code = STREAM_ALL;
+            break;
+    }
+}
+
+static bool dispatch_event(stream_context *context, const yaml_event_t *event)
+{
+    bool done = false;
+
+    switch(event->type)
+    {
+        case YAML_NO_EVENT:
+        case YAML_STREAM_START_EVENT:
+            break;
+        case YAML_STREAM_END_EVENT:
+            done = true;
+            break;
+        case YAML_DOCUMENT_START_EVENT:
+            done = start_document(context);
+            break;
+        case YAML_DOCUMENT_END_EVENT:
+            done = end_document(context);
+            break;
+        case YAML_ALIAS_EVENT:
+            done = add_alias(context, event);
+            break;
+        case YAML_SCALAR_EVENT:
+            done = add_scalar(context, event);
+            break;
+        case YAML_SEQUENCE_START_EVENT:
+            done = start_collection(context, event, SEQUENCE);
+            break;
+        case YAML_MAPPING_START_EVENT:
+            done = start_collection(context, event, MAPPING);
+            break;
+        case YAML_SEQUENCE_END_EVENT:
+        case YAML_MAPPING_END_EVENT:
+            done = end_collection(context);
+            break;
+    }
+
+    return done || context->done;
+}
+
+static bool start_document(stream_context *context)
+{
+    size_t index = context->documents++;
+    if(index >= context->options->last_document)
+    {
+        loader_debug("document %zd is past the range of documents, stopping", index);
+        return true;
+    }
+
+    loader_trace("started document %zd", index);
+    if(NULL == push_frame(context, DOCUMENT, context->state_count))
+    {
+        return out_of_memory(context);
+    }
+    // N.B. - the root step always comes first, the document's root node is what it selects
+    if(index >= context->options->first_document && !push_state(context, ITEMS, 0, NO_LEVEL))
+    {
+        return out_of_memory(context);
+    }
+    top(context)->count = context->state_count - top(context)->states;
+
+    return false;
+}
+
+static bool end_document(stream_context *context)
+{
+    loader_trace("completed document %zd", context->documents - 1);
+    pop_frame(context);
+
+    return drain_matches(context);
+}
+
+static bool add_scalar(stream_context *context, const yaml_event_t *event)
+{
+    Frame *parent = top(context);
+    if(is_key_position(parent))
+    {
+        return cache_mapping_key(context, parent, event);
+    }
+
+    ScalarKind kind = resolve_scalar_kind(event);
+    size_t mark = context->state_count;
+    size_t levels = context->level_count;
+    if(!select_seeds(context, parent, SCALAR) || !enter_seeds(context, SCALAR, kind))
+    {
+        return out_of_memory(context);
+    }
+    // N.B. - a scalar has no children, so its own states are never needed
+    context->state_count = mark;
+
+    const uint8_t *anchor = event->data.scalar.anchor;
+    if(NULL != parent->arena || 0 != context->hit_count || NULL != anchor)
+    {
+        Node *value = build_scalar(context, arena_for(context, parent, anchor), event, kind);
+        if(NULL == value)
+        {
+            return true;
+        }
+        if(NULL != parent->node && !attach_node(context, parent, value))
+        {
+            return true;
+        }
+        if(!queue_matches(context, value, true))
+        {
+            return out_of_memory(context);
+        }
+    }
+    context->level_count = levels;
+    advance_frame(parent);
+
+    return drain_matches(context);
+}
+
+static bool cache_mapping_key(stream_context *context, Frame *parent, const yaml_event_t *event)
+{
+    trace_string("caching scalar '%s' as mapping key", event->data.scalar.value, event->data.scalar.length);
+    parent->has_key = true;
+    parent->key_node = NULL;
+    parent->key_length = event->data.scalar.length;
+    // N.B. - a duplicate only matters for what is selected beneath the mapping, unless it is reported
+    if((DUPE_CLOBBER != context->options->strategy || 0 != parent->count) &&
+       !track_key(context, parent, event))
+    {
+        return true;
+    }
+
+    const uint8_t *anchor = event->data.scalar.anchor;
+    if(NULL != parent->arena || NULL != anchor)
+    {
+        Node *key = build_scalar(context, arena_for(context, parent, anchor), event, resolve_scalar_kind(event));
+        if(NULL == key)
+        {
+            return true;
+        }
+        parent->key_node = scalar(key);
+        parent->key = scalar_value(parent->key_node);
+        return false;
+    }
+    // N.B. - the key is only needed to test the children by name
+    if(0 == parent->count)
+    {
+        parent->key = NULL;
+        return false;
+    }
+
+    if(parent->capacity < parent->key_length)
+    {
+        uint8_t *buffer = realloc(parent->buffer, parent->key_length);
+        if(NULL == buffer)
+        {
+            return out_of_memory(context);
+        }
+        parent->buffer = buffer;
+        parent->capacity = parent->key_length;
+    }
+    if(0 != parent->key_length)
+    {
+        memcpy(parent->buffer, event->data.scalar.value, parent->key_length);
+    }
+    parent->key = parent->buffer;
+
+    return false;
+}
+
+/*
+ * Records a key of the mapping at the top of the stack, as the loader would
+ * find a duplicate of it.  The value of a duplicate replaces the original in
+ * its place, so anything selected inside the original is dropped.  The
+ * result is false if the query should stop.
+ */
+static bool track_key(stream_context *context, Frame *parent, const yaml_event_t *event)
+{
+    const uint8_t *value = event->data.scalar.value;
+    size_t length = event->data.scalar.length;
+    if(NULL == parent->keys)
+    {
+        if(NULL == parent->key_arena)
+        {
+            parent->key_arena = make_arena();
+        }
+        else
+        {
+            arena_reset(parent->key_arena);
+        }
+        parent->keys = NULL == parent->key_arena ? NULL : make_hashtable_in(parent->key_arena, seen_key_comparitor, seen_key_hash);
+        if(NULL == parent->keys)
+        {
+            return !out_of_memory(context);
+        }
+    }
+
+    hashcode hash = wyhash_string_buffer_hash(value, length);
+    const struct seen_key *original = hashtable_get_probe(parent->keys, hash, seen_key_probe, &(struct key_probe){value, length});
+    if(NULL == original)
+    {
+        struct seen_key *key = arena_alloc(parent->key_arena, sizeof(struct seen_key) + length);
+        if(NULL == key)
+        {
+            return !out_of_memory(context);
+        }
+        key->index = parent->index;
+        key->length = length;
+        memcpy(key->value, value, length);
+        hashtable_put(parent->keys, key, key);
+        return true;
+    }
+
+    if(DUPE_FAIL == context->options->strategy)
+    {
+        loader_debug("uh oh! found a duplicate mapping key, aborting...");
+        context->loader->code = ERR_DUPLICATE_KEY;
+        // N.B. - the loader reports the parser's mark, which by then is past the key's value, on the line after the key
+        context->loader->parser.mark = event->start_mark;
+        context->loader->parser.mark.line++;
+        return false;
+    }
+    if(DUPE_WARN == context->options->strategy)
+    {
+        char key_name[length + 1];
+        memcpy(key_name, value, length);
+        key_name[length] = '\0';
+        fprintf(stderr, "warning: duplicate mapping key found: '%s'\n", key_name);
+    }
+    parent->duplicate = true;
+    parent->original = original->index;
+    drop_matches(context, context->depth - 1, original->index);
+
+    return true;
+}
+
+static hashcode seen_key_hash(const void *key)
+{
+    const struct seen_key *each = (const struct seen_key *)key;
+    return wyhash_string_buffer_hash(each->value, each->length);
+}
+
+static bool seen_key_comparitor(const void *one, const void *two)
+{
+    const struct seen_key *first = (const struct seen_key *)one;
+    const struct seen_key *second = (const struct seen_key *)two;
+    return first->length == second->length && 0 == memcmp(first->value, second->value, first->length);
+}
+
+static bool seen_key_probe(const void *key, const void *probe)
+{
+    const struct seen_key *each = (const struct seen_key *)key;
+    const struct key_probe *value = (const struct key_probe *)probe;
+    return each->length == value->length && 0 == memcmp(each->value, value->value, each->length);
+}
+
+static bool add_alias(stream_context *context, const yaml_event_t *event)
+{
+    Frame *parent = top(context);
+    if(is_key_position(parent))
+    {
+        loader_debug("uh oh! found an alias as a mapping key, aborting...");
+        context->loader->code = ERR_NON_SCALAR_KEY;
+        return true;
+    }
+
+    Node *target = hashtable_get(context->loader->anchors, event->data.alias.anchor);
+    if(NULL == target)
+    {
+        loader_debug("uh oh! couldn't find anchor for alias '%s', aborting...", event->data.alias.anchor);
+        context->loader->code = ERR_NO_ANCHOR_FOR_ALIAS;
+        return true;
+    }
+    for(size_t i = 0; i < context->depth; i++)
+    {
+        if(context->frames[i].node == target)
+        {
+            loader_debug("uh oh! found an alias loop for '%s', aborting...", event->data.alias.anchor);
+            context->loader->code = ERR_ALIAS_LOOP;
+            return true;
+        }
+    }
+
+    Node *value = NULL;
+    if(NULL != parent->node)
+    {
+        value = node(make_alias_node_in(parent->arena, target));
+        if(NULL == value)
+        {
+            return out_of_memory(context);
+        }
+        if(!attach_node(context, parent, value))
+        {
+            return true;
+        }
+    }
+    loader_trace("added '%s' alias target (%p)", event->data.alias.anchor, target);
+    if(!visit_alias(context, parent, target, value))
+    {
+        return true;
+    }
+
+    return drain_matches(context);
+}
+
+static bool start_collection(stream_context *context, const yaml_event_t *event, NodeKind kind)
+{
+    Frame *parent = top(context);
+    if(is_key_position(parent))
+    {
+        loader_debug("uh oh! found a non scalar mapping key, aborting...");
+        context->loader->code = ERR_NON_SCALAR_KEY;
+        return true;
+    }
+
+    size_t mark = context->state_count;
+    size_t levels = context->level_count;
+    if(!select_seeds(context, parent, kind) || !enter_seeds(context, kind, SCALAR_STRING))
+    {
+        return out_of_memory(context);
+    }
+
+    const uint8_t *anchor = SEQUENCE == kind ? event->data.sequence_start.anchor : event->data.mapping_start.anchor;
+    Node *value = NULL;
+    Arena *arena = NULL;
+    size_t first_match = context->match_count;
+    size_t matched = context->hit_count;
+    if(NULL != parent->arena || 0 != matched || NULL != anchor)
+    {
+        arena = arena_for(context, parent, anchor);
+        value = build_collection(context, arena, event, kind);
+        if(NULL == value)
+        {
+            return true;
+        }
+        if(NULL != parent->node && !attach_node(context, parent, value))
+        {
+            return true;
+        }
+        if(!queue_matches(context, value, false))
+        {
+            return out_of_memory(context);
+        }
+    }
+    advance_frame(parent);
+
+    Frame *frame = push_frame(context, kind, mark);
+    if(NULL == frame)
+    {
+        return out_of_memory(context);
+    }
+    frame->node = value;
+    frame->arena = arena;
+    frame->levels = levels;
+    frame->first_match = first_match;
+    frame->match_count = matched;
+    frame->holds = holds_queue(context, frame);
+    context->holding += frame->holds ? 1 : 0;
+
+    return false;
+}
+
+static bool end_collection(stream_context *context)
+{
+    Frame *frame = top(context);
+    loader_trace("completed %s", SEQUENCE == frame->kind ? "sequence" : "mapping");
+    close_matches(context, frame->first_match, frame->match_count);
+    pop_frame(context);
+
+    return drain_matches(context);
+}
+
+/*
+ * The Automaton
+ * =============
+ */
+
+/*
+ * Collects the states that the next child of `parent' starts with, `kind'
+ * is the kind of the child, or of its target if it is an alias.  Only the
+ * name and index of the child are needed, so this is done as soon as it
+ * starts.
+ */
+static bool select_seeds(stream_context *context, Frame *parent, NodeKind kind)
+{
+    context->seed_count = 0;
+    parent->position = parent->duplicate ? parent->original : parent->index;
+    for(size_t i = 0; i < parent->count; i++)
+    {
+        State each = context->states[parent->states + i];
+        const Operation *operation = &context->program[each.pc];
+        bool result = true;
+        switch(each.kind)
+        {
+            case RECURSE:
+                result = push_seed(context, ARRIVAL, each.pc, each.levels);
+                break;
+            case ITEMS:
+                result = push_seed(context, ARRIVAL, each.pc + 1, each.levels);
+                break;
+            case CHILDREN:
+                switch(operation->code)
+                {
+                    case STREAM_NAME:
+                        if(name_matches(operation, parent))
+                        {
+                            result = push_seed(context, ARRIVAL, each.pc + 1, each.levels);
+                        }
+                        break;
+                    case STREAM_RECURSE_NAME:
+                        // N.B. - the evaluator orders the children that a recursive name test selects by their parents
+                        if(name_matches(operation, parent))
+                        {
+                            result = push_level(context, context->depth - 1, each.levels) &&
+                                push_seed(context, ARRIVAL, each.pc + 1, context->level_count - 1);
+                        }
+                        break;
+                    case STREAM_WILDCARD:
+                        // N.B. - the values of a mapping that are sequences are replaced by their items
+                        result = SEQUENCE == kind ? push_seed(context, ITEMS, each.pc, each.levels)
+                                                  : push_seed(context, ARRIVAL, each.pc + 1, each.levels);
+                        break;
+                    case STREAM_SUBSCRIPT:
+                        if(parent->index == operation->operand.index)
+                        {
+                            result = push_seed(context, INDEXED, each.pc + 1, each.levels);
+                        }
+                        break;
+                    case STREAM_SLICE:
+                        if(slice_selects(operation, parent->index))
+                        {
+                            result = push_seed(context, INDEXED, each.pc + 1, each.levels);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            default:
+                break;
+        }
+        if(!result)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Follows the seeds of a node that has just started, its own states are
+ * pushed onto the state stack, and the levels of each time that it is
+ * selected are added to the hits.
+ */
+static bool enter_seeds(stream_context *context, NodeKind kind, ScalarKind value_kind)
+{
+    for(size_t i = 0; i < context->seed_count; i++)
+    {
+        State each = context->seeds[i];
+        bool result = ITEMS == each.kind ? push_state(context, ITEMS, each.pc, each.levels)
+                                         : arrive(context, each.pc, each.levels, kind, value_kind);
+        if(!result)
+        {
+            return false;
+        }
+    }
+    context->seed_count = 0;
+    return true;
+}
+
+/*
+ * A node that a recursive wildcard or type test selects is ordered by its
+ * own depth, `context->depth' while it is starting.
+ */
+static bool arrive(stream_context *context, size_t pc, size_t levels, NodeKind kind, ScalarKind value_kind)
+{
+    const Operation *operation = &context->program[pc];
+    switch(operation->code)
+    {
+        case STREAM_HALT:
+            return push_hit(context, levels);
+        case STREAM_NAME:
+            return MAPPING != kind || push_state(context, CHILDREN, pc, levels);
+        case STREAM_WILDCARD:
+            if(MAPPING == kind)
+            {
+                return push_state(context, CHILDREN, pc, levels);
+            }
+            if(SEQUENCE == kind)
+            {
+                return push_state(context, ITEMS, pc, levels);
+            }
+            return arrive(context, pc + 1, levels, kind, value_kind);
+        case STREAM_TYPE:
+            return !type_matches(operation->operand.type, kind, value_kind) || arrive(context, pc + 1, levels, kind, value_kind);
+        case STREAM_RECURSE_NAME:
+            if(MAPPING == kind && !push_state(context, CHILDREN, pc, levels))
+            {
+                return false;
+            }
+            return !is_collection(kind) || push_state(context, RECURSE, pc, levels);
+        case STREAM_RECURSE_WILDCARD:
+            if(!push_level(context, context->depth, levels) || !arrive(context, pc + 1, context->level_count - 1, kind, value_kind))
+            {
+                return false;
+            }
+            return !is_collection(kind) || push_state(context, RECURSE, pc, levels);
+        case STREAM_RECURSE_TYPE:
+            if(type_matches(operation->operand.type, kind, value_kind) &&
+               (!push_level(context, context->depth, levels) || !arrive(context, pc + 1, context->level_count - 1, kind, value_kind)))
+            {
+                return false;
+            }
+            return !is_collection(kind) || push_state(context, RECURSE, pc, levels);
+        case STREAM_ALL:
+            if(SEQUENCE == kind)
+            {
+                return push_state(context, ITEMS, pc, levels);
+            }
+            return arrive(context, pc + 1, levels, kind, value_kind);
+        case STREAM_SUBSCRIPT:
+        case STREAM_SLICE:
+            return SEQUENCE != kind || push_state(context, CHILDREN, pc, levels);
+        case STREAM_ROOT:
+            break;
+    }
+    return true;
+}
+
+static bool type_matches(enum type_test_kind test, NodeKind kind, ScalarKind value_kind)
+{
+    switch(test)
+    {
+        case OBJECT_TEST:
+            return MAPPING == kind;
+        case ARRAY_TEST:
+            return SEQUENCE == kind;
+        case STRING_TEST:
+            return SCALAR == kind && SCALAR_STRING == value_kind;
+        case NUMBER_TEST:
+            return SCALAR == kind && (SCALAR_INTEGER == value_kind || SCALAR_REAL == value_kind);
+        case BOOLEAN_TEST:
+            return SCALAR == kind && SCALAR_BOOLEAN == value_kind;
+        case NULL_TEST:
+            return SCALAR == kind && SCALAR_NULL == value_kind;
+    }
+    return false;
+}
+
+static bool name_matches(const Operation *operation, const Frame *parent)
+{
+    return parent->key_length == operation->operand.name.length &&
+        0 == memcmp(parent->key, operation->operand.name.value, parent->key_length);
+}
+
+static bool slice_selects(const Operation *operation, size_t index)
+{
+    size_t from = operation->operand.slice.from;
+    return index >= from && index < operation->operand.slice.to &&
+        0 == (index - from) % operation->operand.slice.step;
+}
+
+/*
+ * Aliases
+ * =======
+ *
+ * An alias is resolved wherever the evaluator would resolve it, and its
+ * target is then replayed as though it appeared in place of the alias.  A
+ * subscript or slice selects the alias itself, which only a following
+ * wildcard, type or recursive step resolves.
+ */
+
+static bool visit_alias(stream_context *context, Frame *parent, Node *target, Node *value)
+{
+    size_t levels = context->level_count;
+    if(!select_seeds(context, parent, node_kind(target)))
+    {
+        return !out_of_memory(context);
+    }
+
+    size_t count = 0;
+    for(size_t i = 0; i < context->seed_count; i++)
+    {
+        State each = context->seeds[i];
+        if(INDEXED == each.kind)
+        {
+            switch(context->program[each.pc].code)
+            {
+                case STREAM_HALT:
+                    if(!push_hit(context, each.levels))
+                    {
+                        return !out_of_memory(context);
+                    }
+                    continue;
+                case STREAM_NAME:
+                case STREAM_SUBSCRIPT:
+                case STREAM_SLICE:
+                    continue;
+                default:
+                    each.kind = ARRIVAL;
+                    break;
+            }
+        }
+        context->seeds[count++] = each;
+    }
+    context->seed_count = count;
+    advance_frame(parent);
+
+    if(0 != context->hit_count)
+    {
+        if(NULL == value && NULL == (value = node(make_alias_node_in(context->selected, target))))
+        {
+            return !out_of_memory(context);
+        }
+        if(!queue_matches(context, value, true))
+        {
+            return !out_of_memory(context);
+        }
+    }
+    bool result = 0 == count || replay_node(context, target);
+    context->level_count = levels;
+
+    return result;
+}
+
+/*
+ * Runs the seeds waiting in the context on `each', a complete node, and
+ * then on its children in turn.
+ */
+static bool replay_node(stream_context *context, Node *each)
+{
+    NodeKind kind = node_kind(each);
+    ScalarKind value_kind = SCALAR == kind ? scalar_kind(scalar(each)) : SCALAR_STRING;
+    size_t mark = context->state_count;
+    if(!enter_seeds(context, kind, value_kind))
+    {
+        return !out_of_memory(context);
+    }
+    size_t first_match = context->match_count;
+    size_t matched = context->hit_count;
+    if(!queue_matches(context, each, false))
+    {
+        return !out_of_memory(context);
+    }
+
+    bool result = true;
+    // N.B. - nothing beneath a node without any states can be selected
+    if(is_collection(kind) && context->state_count != mark)
+    {
+        Frame *frame = push_frame(context, kind, mark);
+        if(NULL == frame)
+        {
+            return !out_of_memory(context);
+        }
+        frame->node = each;
+        frame->replay = true;
+        frame->has_key = true;
+        frame->levels = context->level_count;
+        result = SEQUENCE == kind ? sequence_iterate(sequence(each), replay_item, context)
+                                  : mapping_iterate(mapping(each), replay_value, context);
+        pop_frame(context);
+    }
+    context->state_count = mark;
+    close_matches(context, first_match, matched);
+
+    return result && LOADER_SUCCESS == context->loader->code && !context->done;
+}
+
+static bool replay_item(Node *each, void *argument)
+{
+    stream_context *context = (stream_context *)argument;
+    Frame *parent = top(context);
+    if(is_alias(each))
+    {
+        return visit_alias(context, parent, alias_target(alias(each)), each);
+    }
+    size_t levels = context->level_count;
+    if(!select_seeds(context, parent, node_kind(each)))
+    {
+        return !out_of_memory(context);
+    }
+    advance_frame(parent);
+    bool result = replay_node(context, each);
+    context->level_count = levels;
+
+    return result;
+}
+
+static bool replay_value(Node *key, Node *value, void *argument)
+{
+    stream_context *context = (stream_context *)argument;
+    Frame *parent = top(context);
+    parent->key = scalar_value(scalar(key));
+    parent->key_length = node_size(key);
+    return replay_item(value, argument);
+}
+
+/*
+ * Building Nodes
+ * ==============
+ */
+
+static Node *build_scalar(stream_context *context, Arena *arena, const yaml_event_t *event, ScalarKind kind)
+{
+    Scalar *result = make_scalar_node_in(arena, event->data.scalar.value, event->data.scalar.length, kind);
+    if(NULL == result)
+    {
+        loader_error("uh oh! couldn't create scalar node, aborting...");
+        context->loader->code = ERR_LOADER_OUT_OF_MEMORY;
+        return NULL;
+    }
+    if(NULL != event->data.scalar.tag)
+    {
+        node_set_tag_in(arena, result, event->data.scalar.tag, strlen((char *)event->data.scalar.tag));
+    }
+    set_anchor(context, arena, node(result), event->data.scalar.anchor);
+
+    return node(result);
+}
+
+static Node *build_collection(stream_context *context, Arena *arena, const yaml_event_t *event, NodeKind kind)
+{
+    Node *result = NULL;
+    const uint8_t *tag = NULL;
+    const uint8_t *anchor = NULL;
+    if(SEQUENCE == kind)
+    {
+        result = node(make_sequence_node_in(arena));
+        tag = event->data.sequence_start.tag;
+        anchor = event->data.sequence_start.anchor;
+    }
+    else
+    {
+        result = node(make_mapping_node_in(arena));
+        tag = event->data.mapping_start.tag;
+        anchor = event->data.mapping_start.anchor;
+    }
+    if(NULL == result)
+    {
+        loader_error("uh oh! couldn't create a collection node, aborting...");
+        context->loader->code = ERR_LOADER_OUT_OF_MEMORY;
+        return NULL;
+    }
+    if(NULL != tag)
+    {
+        node_set_tag_in(arena, result, tag, strlen((const char *)tag));
+    }
+    set_anchor(context, arena, result, anchor);
+
+    return result;
+}
+
+static void set_anchor(stream_context *context, Arena *arena, Node *target, const uint8_t *anchor)
+{
+    if(NULL == anchor)
+    {
+        return;
+    }
+    node_set_anchor_in(arena, target, anchor, strlen((const char *)anchor));
+
+    // N.B. - the event will be deleted, so key the table with the node's copy
+    hashtable_put(context->loader->anchors, target->anchor, target);
+}
+
+static bool attach_node(stream_context *context, Frame *parent, Node *value)
+{
+    if(SEQUENCE == parent->kind)
+    {
+        if(!sequence_add(sequence(parent->node), value))
+        {
+            return !out_of_memory(context);
+        }
+        return true;
+    }
+
+    // N.B. - duplicate keys are found as they are read, here the value of one replaces the original
+    if(!mapping_put_scalar(mapping(parent->node), parent->key_node, value))
+    {
+        return !out_of_memory(context);
+    }
+    return true;
+}
+
+/*
+ * Anchored nodes must outlive the selected nodes, as any later alias may
+ * refer to them, and the children of a node are built along with it.
+ */
+static Arena *arena_for(stream_context *context, const Frame *parent, const uint8_t *anchor)
+{
+    if(NULL != anchor)
+    {
+        return context->anchored;
+    }
+    return NULL == parent->arena ? context->selected : parent->arena;
+}
+
+/*
+ * The Match Queue
+ * ===============
+ */
+
+/*
+ * Queues the current node for each of its hits, with the position given by
+ * the stack.
+ */
+static bool queue_matches(stream_context *context, Node *each, bool closed)
+{
+    size_t depth = context->depth;
+    size_t recursions = context->recursions;
+    for(size_t i = 0; i < context->hit_count; i++)
+    {
+        if(context->match_count == context->match_capacity)
+        {
+            struct match *matches = grow(context->matches, &context->match_capacity, sizeof(struct match));
+            if(NULL == matches)
+            {
+                return false;
+            }
+            context->matches = matches;
+        }
+        MatchKey *key = arena_alloc(context->selected, sizeof(MatchKey) + (recursions + depth) * sizeof(size_t));
+        if(NULL == key)
+        {
+            return false;
+        }
+        key->recursions = recursions;
+        key->depth = depth;
+        size_t slot = recursions;
+        for(size_t level = context->hits[i]; NO_LEVEL != level && 0 != slot; level = context->levels[level].previous)
+        {
+            key->values[--slot] = context->levels[level].length;
+        }
+        for(size_t j = 0; j < depth; j++)
+        {
+            key->values[recursions + j] = context->frames[j].position;
+        }
+        context->matches[context->match_count] = (struct match){each, closed, false, context->match_count, key};
+        context->match_count++;
+    }
+    context->open_matches += closed ? 0 : context->hit_count;
+    context->hit_count = 0;
+
+    return true;
+}
+
+static void close_matches(stream_context *context, size_t first, size_t count)
+{
+    for(size_t i = first; i < first + count; i++)
+    {
+        context->matches[i].closed = true;
+    }
+    context->open_matches -= count;
+}
+
+/*
+ * Drops the matches inside the value at `original' of the mapping at
+ * `depth' of the stack, which a duplicate key has replaced.
+ */
+static void drop_matches(stream_context *context, size_t depth, size_t original)
+{
+    for(size_t i = context->head; i < context->match_count; i++)
+    {
+        const MatchKey *key = context->matches[i].key;
+        const size_t *position = key->values + key->recursions;
+        if(key->depth <= depth || original != position[depth])
+        {
+            continue;
+        }
+        bool inside = true;
+        for(size_t j = 0; j < depth && inside; j++)
+        {
+            inside = context->frames[j].position == position[j];
+        }
+        context->matches[i].dropped |= inside;
+    }
+    context->reordered = true;
+}
+
+/*
+ * Passes on the complete matches at the head of the queue, in order, the
+ * result is true once the query should stop.
+ */
+static bool drain_matches(stream_context *context)
+{
+    if(0 != context->holding)
+    {
+        return false;
+    }
+    if(0 != context->recursions || context->reordered)
+    {
+        if(0 != context->open_matches || context->head == context->match_count)
+        {
+            return false;
+        }
+        qsort(context->matches + context->head, context->match_count - context->head, sizeof(struct match), compare_matches);
+    }
+    while(context->head < context->match_count && context->matches[context->head].closed)
+    {
+        const struct match *each = &context->matches[context->head++];
+        if(each->dropped)
+        {
+            continue;
+        }
+        context->emitted++;
+        if(!context->callback(each->node, context->argument))
+        {
+            loader_debug("the callback stopped the query after %zd nodes", context->emitted);
+            context->done = true;
+            return true;
+        }
+    }
+    if(0 != context->match_count && context->head == context->match_count)
+    {
+        context->head = 0;
+        context->match_count = 0;
+        context->reordered = false;
+        arena_reset(context->selected);
+    }
+    return false;
+}
+
+/*
+ * Orders the matches as the evaluator would, by the levels of each recursive
+ * step in turn, then by position, and otherwise in the order they were
+ * queued.
+ */
+static int compare_matches(const void *one, const void *two)
+{
+    const struct match *first = (const struct match *)one;
+    const struct match *second = (const struct match *)two;
+    for(size_t i = 0; i < first->key->recursions; i++)
+    {
+        int result = compare_positions(first->key, first->key->values[i], second->key, second->key->values[i]);
+        if(0 != result)
+        {
+            return result;
+        }
+    }
+    int result = compare_positions(first->key, first->key->depth, second->key, second->key->depth);
+    if(0 != result)
+    {
+        return result;
+    }
+    return first->order < second->order ? -1 : first->order > second->order;
+}
+
+/*
+ * Compares the positions of the ancestors of two matches at the given
+ * lengths, in document order, so an ancestor comes before its descendants.
+ */
+static int compare_positions(const MatchKey *one, size_t one_length, const MatchKey *two, size_t two_length)
+{
+    const size_t *first = one->values + one->recursions;
+    const size_t *second = two->values + two->recursions;
+    size_t length = one_length < two_length ? one_length : two_length;
+    for(size_t i = 0; i < length; i++)
+    {
+        if(first[i] != second[i])
+        {
+            return first[i] < second[i] ? -1 : 1;
+        }
+    }
+    return one_length < two_length ? -1 : one_length > two_length;
+}
+
+/*
+ * Stacks
+ * ======
+ */
+
+static Frame *push_frame(stream_context *context, NodeKind kind, size_t states)
+{
+    if(context->depth == context->frame_capacity)
+    {
+        size_t old_capacity = context->frame_capacity;
+        Frame *frames = grow(context->frames, &context->frame_capacity, sizeof(Frame));
+        if(NULL == frames)
+        {
+            return NULL;
+        }
+        memset(frames + old_capacity, 0, (context->frame_capacity - old_capacity) * sizeof(Frame));
+        context->frames = frames;
+    }
+
+    Frame *frame = &context->frames[context->depth++];
+    // N.B. - the key buffer and the arena of the seen keys are kept for the next frame at this depth
+    uint8_t *buffer = frame->buffer;
+    size_t capacity = frame->capacity;
+    Arena *key_arena = frame->key_arena;
+    memset(frame, 0, sizeof(Frame));
+    frame->buffer = buffer;
+    frame->capacity = capacity;
+    frame->key_arena = key_arena;
+    frame->kind = kind;
+    frame->states = states;
+    frame->count = context->state_count - states;
+
+    return frame;
+}
+
+static void pop_frame(stream_context *context)
+{
+    Frame *frame = top(context);
+    context->state_count = frame->states;
+    context->level_count = frame->levels;
+    context->holding -= frame->holds ? 1 : 0;
+    context->depth--;
+}
+
+/*
+ * A mapping may yet replace the values that matches were selected inside,
+ * and a collection with states beyond the first recursive step may yet add
+ * matches that come before the ones queued, as it may have been selected by
+ * a recursive step itself.  Nothing more is selected beneath a collection
+ * without any states.
+ */
+static bool holds_queue(const stream_context *context, const Frame *frame)
+{
+    if(0 == frame->count)
+    {
+        return false;
+    }
+    if(MAPPING == frame->kind)
+    {
+        return true;
+    }
+    for(size_t i = 0; i < frame->count; i++)
+    {
+        if(context->states[frame->states + i].pc > context->first_recursion)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void advance_frame(Frame *frame)
+{
+    frame->index++;
+    frame->has_key = frame->replay;
+    frame->duplicate = false;
+}
+
+static bool push_state(stream_context *context, enum state_kind kind, size_t pc, size_t levels)
+{
+    if(context->state_count == context->state_capacity)
+    {
+        State *states = grow(context->states, &context->state_capacity, sizeof(State));
+        if(NULL == states)
+        {
+            return false;
+        }
+        context->states = states;
+    }
+    context->states[context->state_count++] = (State){kind, pc, levels};
+    return true;
+}
+
+static bool push_seed(stream_context *context, enum state_kind kind, size_t pc, size_t levels)
+{
+    if(context->seed_count == context->seed_capacity)
+    {
+        State *seeds = grow(context->seeds, &context->seed_capacity, sizeof(State));
+        if(NULL == seeds)
+        {
+            return false;
+        }
+        context->seeds = seeds;
+    }
+    context->seeds[context->seed_count++] = (State){kind, pc, levels};
+    return true;
+}
+
+static bool push_level(stream_context *context, size_t length, size_t previous)
+{
+    if(context->level_count == context->level_capacity)
+    {
+        struct level *levels = grow(context->levels, &context->level_capacity, sizeof(struct level));
+        if(NULL == levels)
+        {
+            return false;
+        }
+        context->levels = levels;
+    }
+    context->levels[context->level_count++] = (struct level){length, previous};
+    return true;
+}
+
+static bool push_hit(stream_context *context, size_t levels)
+{
+    if(context->hit_count == context->hit_capacity)
+    {
+        size_t *hits = grow(context->hits, &context->hit_capacity, sizeof(size_t));
+        if(NULL == hits)
+        {
+            return false;
+        }
+        context->hits = hits;
+    }
+    context->hits[context->hit_count++] = levels;
+    return true;
+}
+
+static void *grow(void *array, size_t *capacity, size_t size)
+{
+    size_t expanded = 0 == *capacity ? INITIAL_CAPACITY : *capacity * 2;
+    void *result = realloc(array, expanded * size);
+    if(NULL != result)
+    {
+        *capacity = expanded;
+    }
+    return result;
+}
+
+static bool out_of_memory(stream_context *context)
+{
+    if(LOADER_SUCCESS == context->loader->code)
+    {
+        loader_error("uh oh! out of memory, aborting the streaming query...");
+        context->loader->code = ERR_LOADER_OUT_OF_MEMORY;
+    }
+    return true;
+}
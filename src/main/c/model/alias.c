@@ -66,7 +66,12 @@ static const struct vtable_s alias_vtable =
 
 Alias *make_alias_node(Node *target)
 {
-    Alias *self = calloc(1, sizeof(Alias));
+    return make_alias_node_in(NULL, target);
+}
+
+Alias *make_alias_node_in(Arena *arena, Node *target)
+{
+    Alias *self = node_alloc(arena, sizeof(Alias));
     if(NULL != self)
     {
         node_init(self, ALIAS);
@@ -68,7 +68,12 @@ static const struct vtable_s document_vtable =
 
 Document *make_document_node(void)
 {
-    Document *self = calloc(1, sizeof(Document));
+    return make_document_node_in(NULL);
+}
+
+Document *make_document_node_in(Arena *arena)
+{
+    Document *self = node_alloc(arena, sizeof(Document));
     if(NULL != self)
     {
         node_init(self, DOCUMENT);
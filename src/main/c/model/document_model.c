@@ -35,13 +35,58 @@
  * [license]: http://www.opensource.org/licenses/ncsa
  */
 
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <string.h>
 #include <errno.h>
+#include <stdatomic.h>
+#include <sys/mman.h>         /* for munmap() */
 
 #include "model.h"
+#include "model/private.h"
 #include "vector.h"
 #include "conditions.h"
 
+static atomic_size_t generations = 1;
+
+
+DocumentModel *make_model(void)
+{
+    DocumentModel *self = calloc(1, sizeof(DocumentModel));
+    if(NULL != self)
+    {
+        self->documents = make_vector_with_capacity(1);
+        if(NULL == self->documents)
+        {
+            free(self);
+            self = NULL;
+        }
+        else
+        {
+            self->generation = atomic_fetch_add(&generations, 1);
+        }
+    }
+
+    return self;
+}
+
+DocumentModel *make_model_with_arena(void)
+{
+    DocumentModel *self = make_model();
+    if(NULL != self)
+    {
+        self->arena = make_arena();
+        if(NULL == self->arena)
+        {
+            model_free(self);
+            self = NULL;
+        }
+    }
+
+    return self;
+}
 
 static bool freedom_iterator(void *each, void *context __attribute__((unused)))
 {
@@ -56,8 +101,32 @@ void model_free(DocumentModel *self)
     {
         return;
     }
-    vector_iterate(self, freedom_iterator, NULL);
-    vector_free(self);
+    if(NULL == self->arena)
+    {
+        vector_iterate(self->documents, freedom_iterator, NULL);
+    }
+    vector_free(self->documents);
+    name_index_free(self->names);
+    arena_free(self->arena);
+    if(NULL != self->source.data)
+    {
+        munmap(self->source.data, self->source.length);
+    }
+    free(self);
+}
+
+size_t model_size(const DocumentModel *self)
+{
+    PRECOND_NONNULL_ELSE_ZERO(self);
+
+    return vector_length(self->documents);
+}
+
+Document *model_document(const DocumentModel *self, size_t index)
+{
+    PRECOND_NONNULL_ELSE_NULL(self);
+
+    return vector_get(self->documents, index);
 }
 
 Node *model_document_root(const DocumentModel *self, size_t index)
@@ -77,5 +146,21 @@ bool model_add(DocumentModel *self, Document *doc)
 {
     PRECOND_NONNULL_ELSE_FALSE(self, doc);
 
-    return vector_add(self, doc);
+    self->generation = atomic_fetch_add(&generations, 1);
+    return vector_add(self->documents, doc);
+}
+
+size_t model_generation(const DocumentModel *self)
+{
+    PRECOND_NONNULL_ELSE_ZERO(self);
+
+    return self->generation;
+}
+
+void model_set_source(DocumentModel *self, uint8_t *data, size_t length)
+{
+    PRECOND_NONNULL_ELSE_VOID(self, data);
+
+    self->source.data = data;
+    self->source.length = length;
 }
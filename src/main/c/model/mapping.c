@@ -36,10 +36,20 @@
  */
 
 
+#include <string.h>
+
 #include "model.h"
 #include "model/private.h"
 #include "conditions.h"
 
+struct key_probe_s
+{
+    const uint8_t *value;
+    size_t         length;
+};
+
+typedef struct key_probe_s key_probe;
+
 
 static bool mapping_equals(const Node *one, const Node *two)
 {
@@ -74,10 +84,29 @@ static void mapping_free(Node *value)
     map->values = NULL;
 }
 
+static inline hashcode key_hash(const uint8_t *value, size_t length)
+{
+    // N.B. - keys keep 32 bits of their hash, 0 is reserved to mean not yet hashed
+    hashcode hash = wyhash_string_buffer_hash(value, length) & UINT32_MAX;
+    return 0 == hash ? 1 : hash;
+}
+
+static inline void stamp_key(Scalar *key)
+{
+    if(0 == key->hash)
+    {
+        key->hash = (uint32_t)key_hash(scalar_value(key), node_size(key));
+    }
+}
+
 static hashcode scalar_hash(const void *key)
 {
     const Scalar *value = (const Scalar *)key;
-    return shift_add_xor_string_buffer_hash(scalar_value(value), node_size(key));
+    if(0 != value->hash)
+    {
+        return value->hash;
+    }
+    return key_hash(scalar_value(value), node_size(key));
 }
 
 static bool scalar_comparitor(const void *one, const void *two)
@@ -85,6 +114,17 @@ static bool scalar_comparitor(const void *one, const void *two)
     return node_equals(const_node(one), const_node(two));
 }
 
+static bool scalar_probe(const void *key, const void *probe)
+{
+    const Scalar *scalar = (const Scalar *)key;
+    const key_probe *name = (const key_probe *)probe;
+
+    // N.B. - this must agree with `node_equals' for an untagged string key
+    return SCALAR == node_kind(scalar) && NULL == node_name(scalar)
+        && name->length == scalar->length
+        && 0 == memcmp(scalar_value(scalar), name->value, name->length);
+}
+
 static const struct vtable_s mapping_vtable = 
 {
     mapping_free,
@@ -94,14 +134,30 @@ static const struct vtable_s mapping_vtable =
 
 Mapping *make_mapping_node(void)
 {
-    Mapping *self = calloc(1, sizeof(Mapping));
+    return make_mapping_node_in(NULL);
+}
+
+Mapping *make_mapping_node_in(Arena *arena)
+{
+    Mapping *self = node_alloc(arena, sizeof(Mapping));
     if(NULL != self)
     {
         node_init(self, MAPPING);
-        self->values = make_hashtable_with_function(scalar_comparitor, scalar_hash);
+        self->source = (SourceSpan){0, 0};
+        if(NULL == arena)
+        {
+            self->values = make_hashtable_with_function(scalar_comparitor, scalar_hash);
+        }
+        else
+        {
+            self->values = make_hashtable_in(arena, scalar_comparitor, scalar_hash);
+        }
         if(NULL == self->values)
         {
-            free(self);
+            if(NULL == arena)
+            {
+                free(self);
+            }
             self = NULL;
             return NULL;
         }
@@ -111,16 +167,25 @@ Mapping *make_mapping_node(void)
     return self;
 }
 
+hashcode mapping_hash_key(const uint8_t *value, size_t length)
+{
+    return key_hash(value, length);
+}
+
 Node *mapping_get(const Mapping *self, uint8_t *value, size_t length)
 {
     PRECOND_NONNULL_ELSE_NULL(self, value);
     PRECOND_ELSE_NULL(0 < length);
 
-    Scalar *key = make_scalar_node(value, length, SCALAR_STRING);
-    Node *result = hashtable_get(self->values, key);
-    node_free(key);
+    return mapping_get_with_hash(self, key_hash(value, length), value, length);
+}
+
+Node *mapping_get_with_hash(const Mapping *self, hashcode hash, uint8_t *value, size_t length)
+{
+    PRECOND_NONNULL_ELSE_NULL(self, value);
+    PRECOND_ELSE_NULL(0 < length);
 
-    return result;
+    return hashtable_get_probe(self->values, hash, scalar_probe, &(key_probe){value, length});
 }
 
 bool mapping_contains(const Mapping *self, uint8_t *value, size_t length)
@@ -128,11 +193,8 @@ bool mapping_contains(const Mapping *self, uint8_t *value, size_t length)
     PRECOND_NONNULL_ELSE_FALSE(self, value);
     PRECOND_ELSE_FALSE(0 < length);
 
-    Scalar *key = make_scalar_node(value, length, SCALAR_STRING);
-    bool result = hashtable_contains(self->values, key);
-    node_free(key);
-
-    return result;
+    hashcode hash = key_hash(value, length);
+    return hashtable_contains_probe(self->values, hash, scalar_probe, &(key_probe){value, length});
 }
 
 static bool mapping_iterator_adpater(void *key, void *value, void *context)
@@ -158,6 +220,22 @@ bool mapping_put(Mapping *map, uint8_t *key_name, size_t length, Node *value)
     {
         return false;
     }
+    return mapping_put_scalar(map, key, value);
+}
+
+bool mapping_contains_key(const Mapping *self, Scalar *key)
+{
+    PRECOND_NONNULL_ELSE_FALSE(self, key);
+
+    stamp_key(key);
+    return hashtable_contains(self->values, key);
+}
+
+bool mapping_put_scalar(Mapping *map, Scalar *key, Node *value)
+{
+    PRECOND_NONNULL_ELSE_FALSE(map, key, value);
+
+    stamp_key(key);
     errno = 0;
     hashtable_put(map->values, key, value);
     if(0 == errno)
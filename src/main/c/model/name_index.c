@@ -0,0 +1,359 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "model.h"
+#include "model/private.h"
+#include "conditions.h"
+
+/*
+ * The index numbers every mapping and sequence of the model in document
+ * order.  A container's interval spans its own number and the number of its
+ * last descendant container, so a node lies beneath another exactly when its
+ * number falls within the other's interval.  For each key name, the index
+ * holds a posting for every mapping that uses the key, sorted by the number
+ * of the mapping.
+ *
+ * Aliases would let a recursive walk visit a subtree more than once, which an
+ * interval can't express, so a model containing an alias is never indexed.
+ */
+
+struct interval_s
+{
+    uint32_t pre;
+    uint32_t end;
+};
+
+typedef struct interval_s Interval;
+
+struct posting_s
+{
+    uint32_t pre;
+    Node    *value;
+};
+
+typedef struct posting_s Posting;
+
+struct name_index_s
+{
+    Arena     *arena;
+    /** key scalar -> vector of postings */
+    Hashtable *names;
+    /** container node -> interval */
+    Hashtable *intervals;
+    /** the model contains an alias, so the index can't be used */
+    bool       aliased;
+};
+
+struct builder_s
+{
+    NameIndex *index;
+    uint32_t   count;
+    uint32_t   owner;
+};
+
+typedef struct builder_s Builder;
+
+struct name_probe_s
+{
+    const uint8_t *value;
+    size_t         length;
+};
+
+typedef struct name_probe_s name_probe;
+
+static bool build_index(NameIndex *index, const DocumentModel *model);
+static bool index_node(Builder *builder, Node *each);
+static bool index_document_iterator(void *each, void *context);
+static bool index_key_iterator(Node *key, Node *value, void *context);
+static bool index_value_iterator(Node *key, Node *value, void *context);
+static bool index_item_iterator(Node *each, void *context);
+
+
+static hashcode name_hash(const void *key)
+{
+    const Scalar *name = (const Scalar *)key;
+    if(0 != name->hash)
+    {
+        return name->hash;
+    }
+    return mapping_hash_key(name->value, name->length);
+}
+
+static bool name_comparitor(const void *one, const void *two)
+{
+    const Scalar *a = (const Scalar *)one;
+    const Scalar *b = (const Scalar *)two;
+    return a->length == b->length && 0 == memcmp(a->value, b->value, a->length);
+}
+
+static bool name_probe_match(const void *key, const void *probe)
+{
+    const Scalar *name = (const Scalar *)key;
+    const name_probe *value = (const name_probe *)probe;
+    return value->length == name->length && 0 == memcmp(name->value, value->value, value->length);
+}
+
+static bool identity_comparitor(const void *one, const void *two)
+{
+    return one == two;
+}
+
+bool model_use_name_index(DocumentModel *model, bool eager)
+{
+    PRECOND_NONNULL_ELSE_FALSE(model);
+
+    model->index_names = true;
+    if(eager)
+    {
+        model_name_index(model);
+        return NULL != model->names;
+    }
+    return true;
+}
+
+const NameIndex *model_name_index(DocumentModel *model)
+{
+    PRECOND_NONNULL_ELSE_NULL(model);
+
+    if(NULL == model->names)
+    {
+        if(!model->index_names)
+        {
+            return NULL;
+        }
+        NameIndex *index = calloc(1, sizeof(NameIndex));
+        if(NULL == index || !build_index(index, model))
+        {
+            name_index_free(index);
+            // N.B. - don't retry a failed build on every query
+            model->index_names = false;
+            return NULL;
+        }
+        model->names = index;
+    }
+
+    return model->names->aliased ? NULL : model->names;
+}
+
+void name_index_free(NameIndex *index)
+{
+    if(NULL == index)
+    {
+        return;
+    }
+    arena_free(index->arena);
+    free(index);
+}
+
+static bool build_index(NameIndex *index, const DocumentModel *model)
+{
+    index->arena = make_arena();
+    if(NULL == index->arena)
+    {
+        return false;
+    }
+    index->names = make_hashtable_in(index->arena, name_comparitor, name_hash);
+    index->intervals = make_hashtable_in(index->arena, identity_comparitor, identity_hash);
+    if(NULL == index->names || NULL == index->intervals)
+    {
+        return false;
+    }
+
+    Builder builder = {index, 0, 0};
+    if(vector_iterate(model->documents, index_document_iterator, &builder))
+    {
+        return true;
+    }
+    if(index->aliased)
+    {
+        // N.B. - keep the empty index, so that it isn't rebuilt on every query
+        arena_free(index->arena);
+        index->arena = NULL;
+        index->names = NULL;
+        index->intervals = NULL;
+        return true;
+    }
+    return false;
+}
+
+static bool index_document_iterator(void *each, void *context)
+{
+    Node *root = document_root(document(each));
+    return NULL == root ? true : index_node((Builder *)context, root);
+}
+
+static bool index_node(Builder *builder, Node *each)
+{
+    bool result = true;
+    switch(node_kind(each))
+    {
+        case SCALAR:
+            break;
+        case ALIAS:
+            builder->index->aliased = true;
+            result = false;
+            break;
+        case DOCUMENT:
+            result = false;
+            break;
+        case MAPPING:
+        case SEQUENCE:
+        {
+            Interval *interval = arena_alloc(builder->index->arena, sizeof(Interval));
+            if(NULL == interval || UINT32_MAX == builder->count)
+            {
+                return false;
+            }
+            interval->pre = builder->count++;
+            errno = 0;
+            hashtable_put(builder->index->intervals, each, interval);
+            if(0 != errno)
+            {
+                return false;
+            }
+            if(is_mapping(each))
+            {
+                // N.B. - post this mapping's keys before any of its descendants
+                builder->owner = interval->pre;
+                result = mapping_iterate(mapping(each), index_key_iterator, builder)
+                    && mapping_iterate(mapping(each), index_value_iterator, builder);
+            }
+            else
+            {
+                result = sequence_iterate(sequence(each), index_item_iterator, builder);
+            }
+            interval->end = builder->count - 1;
+            break;
+        }
+    }
+    return result;
+}
+
+static bool index_key_iterator(Node *key, Node *value, void *context)
+{
+    Builder *builder = (Builder *)context;
+    // N.B. - this must agree with the keys that `mapping_get' can match
+    if(!is_scalar(key) || NULL != node_name(key))
+    {
+        return true;
+    }
+    Vector *postings = hashtable_get(builder->index->names, key);
+    if(NULL == postings)
+    {
+        postings = make_vector_in(builder->index->arena, 1);
+        if(NULL == postings)
+        {
+            return false;
+        }
+        errno = 0;
+        hashtable_put(builder->index->names, key, postings);
+        if(0 != errno)
+        {
+            return false;
+        }
+    }
+    Posting *posting = arena_alloc(builder->index->arena, sizeof(Posting));
+    if(NULL == posting)
+    {
+        return false;
+    }
+    posting->pre = builder->owner;
+    posting->value = value;
+    return vector_add(postings, posting);
+}
+
+static bool index_value_iterator(Node *key __attribute__((unused)), Node *value, void *context)
+{
+    return index_node((Builder *)context, value);
+}
+
+static bool index_item_iterator(Node *each, void *context)
+{
+    return index_node((Builder *)context, each);
+}
+
+bool name_index_covers(const NameIndex *index, const Node *start)
+{
+    PRECOND_NONNULL_ELSE_FALSE(index, start);
+
+    return hashtable_contains(index->intervals, start);
+}
+
+bool name_index_lookup(const NameIndex *index, const Node *start, const uint8_t *key, size_t length, hashcode hash,
+                       name_index_iterator iterator, void *context)
+{
+    PRECOND_NONNULL_ELSE_FALSE(index, start, key, iterator);
+
+    const Interval *interval = hashtable_get(index->intervals, start);
+    const Vector *postings = hashtable_get_probe(index->names, hash, name_probe_match, &(name_probe){key, length});
+    if(NULL == interval || NULL == postings)
+    {
+        return true;
+    }
+
+    // find the first mapping at or beneath the start node, the rest follow in document order
+    size_t low = 0, high = vector_length(postings);
+    while(low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        const Posting *posting = vector_get(postings, middle);
+        if(posting->pre < interval->pre)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    for(size_t i = low; i < vector_length(postings); i++)
+    {
+        const Posting *posting = vector_get(postings, i);
+        if(posting->pre > interval->end)
+        {
+            break;
+        }
+        if(!iterator(posting->value, context))
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -67,6 +67,15 @@ Node *narrow(Node *instance, NodeKind kind)
     return instance;
 }
 
+void *node_alloc(Arena *arena, size_t size)
+{
+    if(NULL == arena)
+    {
+        return calloc(1, size);
+    }
+    return arena_alloc(arena, size);
+}
+
 void node_init_(Node *self, NodeKind kind)
 {
     if(NULL != self)
@@ -119,10 +128,51 @@ Node *node_parent_(const Node *self)
     return self->parent;
 }
 
+bool node_source_(const Node *self, SourceSpan *span)
+{
+    PRECOND_NONNULL_ELSE_FALSE(self, span);
+
+    switch(node_kind(self))
+    {
+        case SEQUENCE:
+            *span = ((const Sequence *)self)->source;
+            break;
+        case MAPPING:
+            *span = ((const Mapping *)self)->source;
+            break;
+        default:
+            return false;
+    }
+    return 0 != span->length;
+}
+
+void node_set_source_(Node *self, size_t offset, size_t length)
+{
+    PRECOND_NONNULL_ELSE_VOID(self);
+
+    SourceSpan span = {offset, length};
+    switch(node_kind(self))
+    {
+        case SEQUENCE:
+            sequence(self)->source = span;
+            break;
+        case MAPPING:
+            mapping(self)->source = span;
+            break;
+        default:
+            break;
+    }
+}
+
 void node_set_tag_(Node *self, const uint8_t *value, size_t length)
+{
+    node_set_tag_in_(NULL, self, value, length);
+}
+
+void node_set_tag_in_(Arena *arena, Node *self, const uint8_t *value, size_t length)
 {
     PRECOND_NONNULL_ELSE_VOID(self, value);
-    self->tag.name = (uint8_t *)calloc(1, length + 1);
+    self->tag.name = (uint8_t *)node_alloc(arena, length + 1);
     if(NULL != self->tag.name)
     {
         memcpy(self->tag.name, value, length);
@@ -131,9 +181,14 @@ void node_set_tag_(Node *self, const uint8_t *value, size_t length)
 }
 
 void node_set_anchor_(Node *self, const uint8_t *value, size_t length)
+{
+    node_set_anchor_in_(NULL, self, value, length);
+}
+
+void node_set_anchor_in_(Arena *arena, Node *self, const uint8_t *value, size_t length)
 {
     PRECOND_NONNULL_ELSE_VOID(self, value);
-    self->anchor = (uint8_t *)calloc(1, length + 1);
+    self->anchor = (uint8_t *)node_alloc(arena, length + 1);
     if(NULL != self->anchor)
     {
         memcpy(self->anchor, value, length);
@@ -67,6 +67,12 @@ static bool scalar_equals(const Node *one, const Node *two)
     {
         return false;
     }
+    uint32_t h1 = ((const Scalar *)one)->hash;
+    uint32_t h2 = ((const Scalar *)two)->hash;
+    if(0 != h1 && 0 != h2 && h1 != h2)
+    {
+        return false;
+    }
     return 0 == memcmp(scalar_value((const Scalar *)one),
                        scalar_value((const Scalar *)two), n1);
 }
@@ -83,6 +89,11 @@ static void scalar_free(Node *value)
     self->value = NULL;
 }
 
+static void borrowed_scalar_free(Node *value __attribute__((unused)))
+{
+    // N.B. - the value belongs to whoever lent it to us
+}
+
 static const struct vtable_s scalar_vtable = 
 {
     scalar_free,
@@ -90,6 +101,13 @@ static const struct vtable_s scalar_vtable =
     scalar_equals
 };
 
+static const struct vtable_s borrowed_scalar_vtable = 
+{
+    borrowed_scalar_free,
+    scalar_size,
+    scalar_equals
+};
+
 Scalar *make_scalar_node(const uint8_t *value, size_t length, ScalarKind kind)
 {
     if(NULL == value && 0 != length)
@@ -118,6 +136,62 @@ Scalar *make_scalar_node(const uint8_t *value, size_t length, ScalarKind kind)
     return result;
 }
 
+Scalar *make_scalar_node_in(Arena *arena, const uint8_t *value, size_t length, ScalarKind kind)
+{
+    if(NULL == arena)
+    {
+        return make_scalar_node(value, length, kind);
+    }
+    if(NULL == value && 0 != length)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // N.B. - the value is stored immediately after the node
+    Scalar *result = arena_alloc(arena, sizeof(Scalar) + length);
+    if(NULL != result)
+    {
+        node_init((Node *)result, SCALAR);
+        result->length = length;
+        result->kind = kind;
+        result->value = (uint8_t *)(result + 1);
+        if(0 != length)
+        {
+            memcpy(result->value, value, length);
+        }
+        result->base.vtable = &borrowed_scalar_vtable;
+    }
+
+    return result;
+}
+
+Scalar *make_borrowed_scalar_node(const uint8_t *value, size_t length, ScalarKind kind)
+{
+    return make_borrowed_scalar_node_in(NULL, value, length, kind);
+}
+
+Scalar *make_borrowed_scalar_node_in(Arena *arena, const uint8_t *value, size_t length, ScalarKind kind)
+{
+    if(NULL == value && 0 != length)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    Scalar *result = node_alloc(arena, sizeof(Scalar));
+    if(NULL != result)
+    {
+        node_init((Node *)result, SCALAR);
+        result->length = length;
+        result->kind = kind;
+        result->value = (uint8_t *)value;
+        result->base.vtable = &borrowed_scalar_vtable;
+    }
+
+    return result;
+}
+
 uint8_t *scalar_value(const Scalar *self)
 {
     PRECOND_NONNULL_ELSE_NULL(self);
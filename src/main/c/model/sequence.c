@@ -41,6 +41,8 @@
 #include "conditions.h"
 
 
+static const size_t DEFAULT_CAPACITY = 4;
+
 static bool sequence_equals(const Node *one, const Node *two)
 {
     return vector_equals(((Sequence *)one)->values,
@@ -81,14 +83,23 @@ static const struct vtable_s sequence_vtable =
 
 Sequence *make_sequence_node(void)
 {
-    Sequence *self = calloc(1, sizeof(Sequence));
+    return make_sequence_node_in(NULL);
+}
+
+Sequence *make_sequence_node_in(Arena *arena)
+{
+    Sequence *self = node_alloc(arena, sizeof(Sequence));
     if(NULL != self)
     {
         node_init(self, SEQUENCE);
-        self->values = make_vector();
+        self->source = (SourceSpan){0, 0};
+        self->values = NULL == arena ? make_vector() : make_vector_in(arena, DEFAULT_CAPACITY);
         if(NULL == self->values)
         {
-            free(self);
+            if(NULL == arena)
+            {
+                free(self);
+            }
             self = NULL;
             return NULL;
         }
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2013 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ *
+ * Distributed under an [MIT-style][license] license.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#ifdef __linux__
+#define _DEFAULT_SOURCE       /* for MAP_ANONYMOUS */
+#endif
+
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "arena.h"
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+static const size_t INITIAL_CHUNK_SIZE = 64ul * 1024ul;
+static const size_t MAXIMUM_CHUNK_SIZE = 64ul * 1024ul * 1024ul;
+
+#define ALIGNMENT sizeof(void *)
+#define align(SIZE) (((SIZE) + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1))
+
+struct chunk_s
+{
+    struct chunk_s *next;
+    size_t          size;
+};
+
+typedef struct chunk_s Chunk;
+
+struct arena_s
+{
+    /** the most recently mapped chunk, the others are linked from it */
+    Chunk   *chunks;
+    /** the size of the next chunk to be mapped */
+    size_t   chunk_size;
+    /** the total of all allocations */
+    size_t   allocated;
+
+    /** the unused region of the current chunk */
+    uint8_t *cursor;
+    uint8_t *limit;
+};
+
+static bool add_chunk(Arena *arena, size_t size);
+
+Arena *make_arena(void)
+{
+    Arena *result = calloc(1, sizeof(Arena));
+    if(NULL == result)
+    {
+        return NULL;
+    }
+    result->chunk_size = INITIAL_CHUNK_SIZE;
+
+    return result;
+}
+
+void arena_free(Arena *arena)
+{
+    if(NULL == arena)
+    {
+        return;
+    }
+
+    Chunk *chunk = arena->chunks;
+    while(NULL != chunk)
+    {
+        Chunk *next = chunk->next;
+        munmap(chunk, chunk->size);
+        chunk = next;
+    }
+    free(arena);
+}
+
+void arena_reset(Arena *arena)
+{
+    if(NULL == arena || NULL == arena->chunks)
+    {
+        return;
+    }
+
+    Chunk *kept = arena->chunks;
+    Chunk *chunk = kept->next;
+    while(NULL != chunk)
+    {
+        Chunk *next = chunk->next;
+        munmap(chunk, chunk->size);
+        chunk = next;
+    }
+    kept->next = NULL;
+
+    // N.B. - allocations are expected to be zero filled, so the used part is cleared again
+    uint8_t *start = (uint8_t *)kept + align(sizeof(Chunk));
+    memset(start, 0, (size_t)(arena->cursor - start));
+    arena->cursor = start;
+    arena->limit = (uint8_t *)kept + kept->size;
+    arena->allocated = 0;
+}
+
+static bool add_chunk(Arena *arena, size_t size)
+{
+    size_t needed = align(sizeof(Chunk)) + size;
+    size_t chunk_size = arena->chunk_size;
+    while(chunk_size < needed)
+    {
+        chunk_size <<= 1;
+    }
+
+    // N.B. - anonymous mappings are zero filled, so allocations never need clearing
+    void *region = mmap(NULL, chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(MAP_FAILED == region)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+
+    Chunk *chunk = (Chunk *)region;
+    chunk->size = chunk_size;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->cursor = (uint8_t *)region + align(sizeof(Chunk));
+    arena->limit = (uint8_t *)region + chunk_size;
+    if(MAXIMUM_CHUNK_SIZE > arena->chunk_size)
+    {
+        arena->chunk_size <<= 1;
+    }
+
+    return true;
+}
+
+void *arena_alloc(Arena *arena, size_t size)
+{
+    if(NULL == arena)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    size_t aligned = align(size);
+    if((size_t)(arena->limit - arena->cursor) < aligned && !add_chunk(arena, aligned))
+    {
+        return NULL;
+    }
+
+    void *result = arena->cursor;
+    arena->cursor += aligned;
+    arena->allocated += aligned;
+
+    return result;
+}
+
+void *arena_realloc(Arena *arena, void *value, size_t old_size, size_t new_size)
+{
+    if(NULL == arena)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    if(NULL == value)
+    {
+        return arena_alloc(arena, new_size);
+    }
+
+    size_t old_aligned = align(old_size);
+    size_t new_aligned = align(new_size);
+    if((uint8_t *)value + old_aligned == arena->cursor)
+    {
+        // N.B. - the most recent allocation can be resized in place
+        if(new_aligned <= old_aligned || (size_t)(arena->limit - (uint8_t *)value) >= new_aligned)
+        {
+            if(new_aligned < old_aligned)
+            {
+                memset((uint8_t *)value + new_aligned, 0, old_aligned - new_aligned);
+            }
+            arena->cursor = (uint8_t *)value + new_aligned;
+            arena->allocated = arena->allocated - old_aligned + new_aligned;
+            return value;
+        }
+    }
+    else if(new_aligned <= old_aligned)
+    {
+        return value;
+    }
+
+    void *result = arena_alloc(arena, new_size);
+    if(NULL != result)
+    {
+        memcpy(result, value, old_size < new_size ? old_size : new_size);
+    }
+
+    return result;
+}
+
+void *arena_copy(Arena *arena, const void *value, size_t size)
+{
+    if(NULL == value && 0 != size)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    void *result = arena_alloc(arena, size);
+    if(NULL != result && 0 != size)
+    {
+        memcpy(result, value, size);
+    }
+
+    return result;
+}
+
+size_t arena_allocated(const Arena *arena)
+{
+    if(NULL == arena)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+
+    return arena->allocated;
+}
@@ -29,10 +29,31 @@
  * [license]: http://www.opensource.org/licenses/ncsa
  */
 
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "hash.h"
 
+static const uint64_t WYHASH_SECRET[4] =
+{
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+};
+
+/* N.B. - chosen once per process, so inputs can't be crafted to collide in advance */
+static uint64_t wyhash_seed;
+
+static void seed_hash(void) __attribute__((constructor));
+static inline void wyhash_multiply(uint64_t *a, uint64_t *b);
+static inline uint64_t wyhash_mix(uint64_t a, uint64_t b);
+static inline uint64_t read64(const uint8_t *bytes);
+static inline uint64_t read32(const uint8_t *bytes);
+
 hashcode identity_hash(const void *key)
 {
     return (hashcode)key;
@@ -148,6 +169,145 @@ hashcode djb_string_buffer_hash(const uint8_t *key, size_t length)
     return result;
 }
 
+static void seed_hash(void)
+{
+    uint64_t seed = 0;
+    FILE *random = fopen("/dev/urandom", "rb");
+    if(NULL != random)
+    {
+        if(1 != fread(&seed, sizeof(seed), 1, random))
+        {
+            seed = 0;
+        }
+        fclose(random);
+    }
+    if(0 == seed)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        uint64_t time = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+        pid_t process = getpid();
+        uint64_t pid = (uint64_t)process;
+        uint64_t address = (uint64_t)(uintptr_t)&seed;
+        seed = wyhash_mix(time ^ WYHASH_SECRET[0], pid ^ address ^ WYHASH_SECRET[1]);
+    }
+    wyhash_seed = seed ^ wyhash_mix(seed ^ WYHASH_SECRET[0], WYHASH_SECRET[1]);
+}
+
+static inline void wyhash_multiply(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t product = *a;
+    product *= *b;
+    *a = (uint64_t)product;
+    *b = (uint64_t)(product >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    *a = lo;
+    *b = hi;
+#endif
+}
+
+static inline uint64_t wyhash_mix(uint64_t a, uint64_t b)
+{
+    wyhash_multiply(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t read64(const uint8_t *bytes)
+{
+    uint64_t result;
+    memcpy(&result, bytes, sizeof(result));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    result = __builtin_bswap64(result);
+#endif
+    return result;
+}
+
+static inline uint64_t read32(const uint8_t *bytes)
+{
+    uint32_t result;
+    memcpy(&result, bytes, sizeof(result));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    result = __builtin_bswap32(result);
+#endif
+    return result;
+}
+
+/**
+ * Wang Yi. wyhash, final version 4. https://github.com/wangyi-fudan/wyhash
+ *
+ * Reads the key eight bytes at a time, and short keys with a few overlapping
+ * loads, so there is no per byte loop.
+ */
+hashcode wyhash_string_hash(const void *key)
+{
+    uint8_t *string = (uint8_t *)key;
+    size_t length = strlen((char *)string);
+    return wyhash_string_buffer_hash(string, length);
+}
+
+hashcode wyhash_string_buffer_hash(const uint8_t *key, size_t length)
+{
+    const uint8_t *cursor = key;
+    uint64_t seed = wyhash_seed, a, b;
+    if(16 >= length)
+    {
+        if(4 <= length)
+        {
+            size_t offset = (length >> 3) << 2;
+            a = (read32(cursor) << 32) | read32(cursor + offset);
+            b = (read32(cursor + length - 4) << 32) | read32(cursor + length - 4 - offset);
+        }
+        else if(0 < length)
+        {
+            a = ((uint64_t)cursor[0] << 16) | ((uint64_t)cursor[length >> 1] << 8) | cursor[length - 1];
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        size_t remaining = length;
+        if(48 < remaining)
+        {
+            uint64_t seed1 = seed, seed2 = seed;
+            do
+            {
+                seed = wyhash_mix(read64(cursor) ^ WYHASH_SECRET[1], read64(cursor + 8) ^ seed);
+                seed1 = wyhash_mix(read64(cursor + 16) ^ WYHASH_SECRET[2], read64(cursor + 24) ^ seed1);
+                seed2 = wyhash_mix(read64(cursor + 32) ^ WYHASH_SECRET[3], read64(cursor + 40) ^ seed2);
+                cursor += 48;
+                remaining -= 48;
+            }
+            while(48 < remaining);
+            seed ^= seed1 ^ seed2;
+        }
+        while(16 < remaining)
+        {
+            seed = wyhash_mix(read64(cursor) ^ WYHASH_SECRET[1], read64(cursor + 8) ^ seed);
+            cursor += 16;
+            remaining -= 16;
+        }
+        a = read64(cursor + remaining - 16);
+        b = read64(cursor + remaining - 8);
+    }
+    a ^= WYHASH_SECRET[1];
+    b ^= seed;
+    wyhash_multiply(&a, &b);
+
+    uint64_t result = wyhash_mix(a ^ WYHASH_SECRET[0] ^ length, b ^ WYHASH_SECRET[1]);
+    return (hashcode)result;
+}
+
 bool string_comparitor(const void *key1, const void *key2)
 {
     return 0 == strcmp((char *)key1, (char *)key2);
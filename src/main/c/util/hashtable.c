@@ -30,6 +30,7 @@
  */
 
 #include <tgmath.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
@@ -37,10 +38,44 @@
 
 #include "hashtable.h"
 
+/*
+ * The table is split in two: the entries array holds the keys and values in
+ * the order they were added, and the index is an open addressed array of
+ * slots that refer into it. Slots are placed with Robin Hood hashing (a slot
+ * that has been displaced further from its home takes the place of one that
+ * has been displaced less) and carry a 32 bit fragment of the key's hash, so
+ * most mismatches are rejected without calling the comparison function, and
+ * growing the table never has to hash the keys again.
+ *
+ * Removing a key leaves a hole in the entries array, holes are squeezed out
+ * when the index is next rebuilt. Both arrays share one allocation, the
+ * entries follow the index.
+ */
+
 static const float  DEFAULT_LOAD_FACTOR = 0.75f;
 static const size_t DEFAULT_CAPACITY = 8ul;
 
-static const uint8_t * const CHAINED_KEY = (uint8_t *)"CHAINED_KEY_SENTINEL";
+static const size_t NOT_FOUND = SIZE_MAX;
+/* N.B. - entries are numbered from 1 in the index, 0 marks an empty slot */
+static const size_t MAXIMUM_ENTRIES = UINT32_MAX - 1ul;
+
+struct entry_s
+{
+    void *key;
+    void *value;
+};
+
+typedef struct entry_s Entry;
+
+struct slot_s
+{
+    /** the number of the entry stored here plus one, 0 if the slot is empty */
+    uint32_t entry;
+    /** a fragment of the entry key's hash */
+    uint32_t hash;
+};
+
+typedef struct slot_s Slot;
 
 struct hashtable_s
 {
@@ -58,20 +93,19 @@ struct hashtable_s
     /** the key comparison function */
     compare_function compare;
 
-    /** the length of the entries table */
+    /** the length of the entries table that is in use, including holes */
+    size_t    used;
+    /** the keys and values table, in insertion order */
+    Entry    *entries;
+    /** the number of slots in the index, always a power of 2 */
     size_t    length;
-    /** the keys and values table */
-    uint8_t **entries;
-};
+    /** the index of the entries table */
+    Slot     *index;
 
-struct chain_s
-{
-    size_t   length;
-    uint8_t *entries[];
+    /** the arena that owns the table, if any */
+    Arena    *arena;
 };
 
-typedef struct chain_s Chain;
-
 struct item_adapter_s
 {
     hashtable_item_iterator iterator;
@@ -88,28 +122,26 @@ struct equality_adapter_s
 
 typedef struct equality_adapter_s equality_adapter;
 
-static Hashtable *alloc(size_t size);
-static inline void alloc_table(Hashtable *hashtable, size_t size);
-static void init(Hashtable *hashtable, compare_function comparitor, size_t size, float load_factor, hash_function function);
+static Hashtable *alloc(Arena *arena, size_t length, float load_factor);
+static inline void *allocate(const Hashtable *hashtable, size_t size);
+static inline Slot *alloc_table(const Hashtable *hashtable, size_t length, size_t capacity);
+static inline void release(const Hashtable *hashtable, void *value);
+static void init(Hashtable *hashtable, compare_function comparitor, float load_factor, hash_function function);
 static inline size_t normalize_capacity(size_t hint);
+static inline size_t capacity_of(size_t length, float load_factor);
 
-static bool chained_contains(const Hashtable *hashtable, size_t index, const void *key);
-static void *chained_get(const Hashtable *hashtable, size_t index, const void *key);
-
-static void *add_to_chain(Hashtable *hashtable, size_t index, void *key, void *value);
-static void expand_chain(Hashtable *hashtable, size_t index, void *key, void *value);
-static void *chained_put(Hashtable *hashtable, size_t index, void *key, void *value);
-static void *chained_remove(Hashtable *hashtable, size_t index, void *key);
-
-static void rehash(Hashtable *hashtable);
+static inline uint32_t fragment(hashcode hash);
+static inline size_t distance(const Hashtable *hashtable, size_t index);
+static size_t locate(const Hashtable *hashtable, uint32_t hash, hashtable_probe match, const void *probe);
+static void place(Slot *index, size_t length, Slot slot);
+static bool make_room(Hashtable *hashtable);
+static bool rebuild(Hashtable *hashtable, size_t length);
 
 static bool key_item_iterator(void *key, void *value __attribute__((unused)), void *context);
 static bool value_item_iterator(void *key __attribute__((unused)), void *value, void *context);
 static bool map_into(void *key, void *value, void *context);
 static bool contains_key_value(void *key, void *value, void *context);
 
-static inline size_t hash_index(const Hashtable *hashtable, const void *key);
-
 Hashtable *make_hashtable(compare_function comparitor)
 {
     return make_hashtable_with_capacity_factor(comparitor, DEFAULT_CAPACITY, DEFAULT_LOAD_FACTOR);
@@ -152,13 +184,30 @@ Hashtable *make_hashtable_with_capacity_factor_function(compare_function compari
         return NULL;
     }
 
-    size_t capacity = normalize_capacity(capacity_hint);
-    Hashtable *result = alloc(capacity);
+    Hashtable *result = alloc(NULL, normalize_capacity(capacity_hint), load_factor);
+    if(NULL == result)
+    {
+        return NULL;
+    }
+    init(result, comparitor, load_factor, function);
+
+    return result;
+}
+
+Hashtable *make_hashtable_in(Arena *arena, compare_function comparitor, hash_function function)
+{
+    if(NULL == arena || NULL == comparitor || NULL == function)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    Hashtable *result = alloc(arena, DEFAULT_CAPACITY, DEFAULT_LOAD_FACTOR);
     if(NULL == result)
     {
         return NULL;
     }
-    init(result, comparitor, capacity, load_factor, function);
+    init(result, comparitor, DEFAULT_LOAD_FACTOR, function);
 
     return result;
 }
@@ -178,63 +227,94 @@ static inline size_t normalize_capacity(size_t hint)
     return capacity;
 }
 
-static Hashtable *alloc(size_t capacity)
+static inline size_t capacity_of(size_t length, float load_factor)
 {
-    Hashtable *result = (Hashtable *)calloc(1, sizeof(Hashtable));
+    size_t capacity = (size_t)lround((float)length * load_factor);
+    // N.B. - at least one slot is always left empty so that a probe for a missing key ends
+    if(length <= capacity)
+    {
+        capacity = length - 1;
+    }
+    return 0 == capacity ? 1 : capacity;
+}
+
+static Hashtable *alloc(Arena *arena, size_t length, float load_factor)
+{
+    Hashtable *result = NULL;
+    if(NULL == arena)
+    {
+        result = (Hashtable *)calloc(1, sizeof(Hashtable));
+    }
+    else
+    {
+        result = (Hashtable *)arena_alloc(arena, sizeof(Hashtable));
+    }
     if(NULL == result)
     {
+        errno = ENOMEM;
         return NULL;
     }
+    result->arena = arena;
+    result->length = length;
+    result->capacity = capacity_of(length, load_factor);
 
-    alloc_table(result, capacity);
-    if(NULL == result->entries)
+    result->index = alloc_table(result, length, result->capacity);
+    if(NULL == result->index)
     {
-        free(result);
+        release(result, result);
+        errno = ENOMEM;
         return NULL;
     }
+    result->entries = (Entry *)(result->index + length);
 
     return result;
 }
 
-static inline void alloc_table(Hashtable *hashtable, size_t capacity)
+static inline Slot *alloc_table(const Hashtable *hashtable, size_t length, size_t capacity)
+{
+    return allocate(hashtable, length * sizeof(Slot) + capacity * sizeof(Entry));
+}
+
+static inline void *allocate(const Hashtable *hashtable, size_t size)
 {
-    // the number of table cells allocated is 2x capacity to hold both keys and values
-    hashtable->entries = calloc(capacity << 1, sizeof(uint8_t *));
+    if(NULL == hashtable->arena)
+    {
+        return calloc(1, size);
+    }
+    return arena_alloc(hashtable->arena, size);
+}
+
+static inline void release(const Hashtable *hashtable, void *value)
+{
+    // N.B. - memory from an arena is only released with the arena
+    if(NULL == hashtable->arena)
+    {
+        free(value);
+    }
 }
 
 static void init(Hashtable *hashtable,
                  compare_function comparitor,
-                 size_t capacity,
                  float load_factor,
                  hash_function function)
 {
     hashtable->occupied = 0ul;
-    hashtable->capacity = (size_t)lround((float)capacity * load_factor);
+    hashtable->used = 0ul;
     hashtable->load_factor = load_factor;
     hashtable->mutable = true;
-    hashtable->length = capacity << 1;
     hashtable->hash = function;
     hashtable->compare = comparitor;
 }
 
 void hashtable_free(Hashtable *hashtable)
 {
-    if(NULL == hashtable)
+    if(NULL == hashtable || NULL != hashtable->arena)
     {
         return;
     }
 
-    for(size_t i = 0; i < hashtable->length; i += 2)
-    {
-        if(CHAINED_KEY == hashtable->entries[i])
-        {
-            Chain *chain = (Chain *)hashtable->entries[i + 1];
-            free(chain);
-            hashtable->entries[i] = NULL;
-            hashtable->entries[i + 1] = NULL;
-        }
-    }
-    free(hashtable->entries);
+    free(hashtable->index);
+    hashtable->index = NULL;
     hashtable->entries = NULL;
     free(hashtable);
 }
@@ -281,22 +361,15 @@ bool hashtable_is_empty(const Hashtable *hashtable)
 
 void hashtable_clear(Hashtable *hashtable)
 {
-    if(NULL == hashtable || 0 == hashtable->occupied)
+    if(NULL == hashtable || 0 == hashtable->used)
     {
         return;
     }
 
-    for(size_t i = 0; i < hashtable->length; i += 2)
-    {
-        if(CHAINED_KEY == hashtable->entries[i])
-        {
-            Chain *chain = (Chain *)hashtable->entries[i + 1];
-            free(chain);
-        }
-        hashtable->entries[i] = NULL;
-        hashtable->entries[i + 1] = NULL;
-    }
+    memset(hashtable->index, 0, hashtable->length * sizeof(Slot));
+    memset(hashtable->entries, 0, hashtable->used * sizeof(Entry));
     hashtable->occupied = 0;
+    hashtable->used = 0;
 }
 
 static bool contains_key_value(void *key, void *value, void *context)
@@ -333,110 +406,114 @@ bool hashtable_equals(const Hashtable *one, const Hashtable *two, compare_functi
     return hashtable_iterate(one, contains_key_value, &(equality_adapter){two, comparitor});
 }
 
-bool hashtable_contains(const Hashtable *hashtable, const void *key)
+static inline uint32_t fragment(hashcode hash)
 {
-    if(NULL == hashtable || NULL == key)
-    {
-        errno = EINVAL;
-        return false;
-    }
+    // N.B. - the slot is chosen by the low bits, mix in the high bits of weak hash functions (e.g. pointers)
+    uint64_t mixed = (uint64_t)hash;
+    mixed ^= mixed >> 32;
+    mixed *= 0x9e3779b97f4a7c15ull;
+    mixed ^= mixed >> 32;
+    return (uint32_t)mixed;
+}
+
+static inline size_t distance(const Hashtable *hashtable, size_t index)
+{
+    size_t mask = hashtable->length - 1;
+    return (index - (hashtable->index[index].hash & mask)) & mask;
+}
 
+static size_t locate(const Hashtable *hashtable, uint32_t hash, hashtable_probe match, const void *probe)
+{
     if(0 == hashtable->occupied)
     {
-        return false;
+        return NOT_FOUND;
     }
 
-    size_t index = hash_index(hashtable, key);
-    uint8_t *cur = hashtable->entries[index];
-    if(NULL != cur)
+    size_t mask = hashtable->length - 1;
+    for(size_t i = hash & mask, displacement = 0; ; i = (i + 1) & mask, displacement++)
     {
-        if(CHAINED_KEY != cur && hashtable->compare(key, cur))
+        Slot slot = hashtable->index[i];
+        if(0 == slot.entry)
         {
-            return true;
+            return NOT_FOUND;
         }
-        if(CHAINED_KEY == cur)
+        if(hash == slot.hash && match(hashtable->entries[slot.entry - 1].key, probe))
         {
-            return chained_contains(hashtable, index, key);
+            return i;
+        }
+        // N.B. - the key would have displaced any slot that is closer to its home
+        if(((i - (slot.hash & mask)) & mask) < displacement)
+        {
+            return NOT_FOUND;
         }
     }
-
-    return false;
 }
 
-static bool chained_contains(const Hashtable *hashtable, size_t index, const void *key)
+static void place(Slot *index, size_t length, Slot slot)
 {
-    Chain *chain = (Chain *)hashtable->entries[index + 1];
-    for(size_t i = 0; i < chain->length; i += 2)
+    size_t mask = length - 1;
+    for(size_t i = slot.hash & mask, displacement = 0; ; i = (i + 1) & mask, displacement++)
     {
-        if(NULL == chain->entries[i])
+        if(0 == index[i].entry)
         {
-            return false;
+            index[i] = slot;
+            return;
         }
-        if(hashtable->compare(chain->entries[i], key))
+        size_t resident = (i - (index[i].hash & mask)) & mask;
+        if(resident < displacement)
         {
-            return true;
+            Slot richer = index[i];
+            index[i] = slot;
+            slot = richer;
+            displacement = resident;
         }
     }
-    return false;
 }
 
-void *hashtable_get(const Hashtable *hashtable, const void *key)
+bool hashtable_contains(const Hashtable *hashtable, const void *key)
 {
     if(NULL == hashtable || NULL == key)
     {
         errno = EINVAL;
-        return NULL;
+        return false;
     }
 
-    if(0 == hashtable->occupied)
+    return NOT_FOUND != locate(hashtable, fragment(hashtable->hash(key)), hashtable->compare, key);
+}
+
+void *hashtable_get(const Hashtable *hashtable, const void *key)
+{
+    if(NULL == hashtable || NULL == key)
     {
+        errno = EINVAL;
         return NULL;
     }
 
-    size_t index = hash_index(hashtable, key);
-    uint8_t *cur = hashtable->entries[index];
-    if(NULL != cur)
+    size_t index = locate(hashtable, fragment(hashtable->hash(key)), hashtable->compare, key);
+    return NOT_FOUND == index ? NULL : hashtable->entries[hashtable->index[index].entry - 1].value;
+}
+
+bool hashtable_contains_probe(const Hashtable *hashtable, hashcode hash, hashtable_probe match, const void *probe)
+{
+    if(NULL == hashtable || NULL == match || NULL == probe)
     {
-        if(CHAINED_KEY != cur && hashtable->compare(key, cur))
-        {
-            void *result = hashtable->entries[index + 1];
-            return result;
-        }
-        if(CHAINED_KEY == cur)
-        {
-            return chained_get(hashtable, index, key);
-        }
+        errno = EINVAL;
+        return false;
     }
 
-    return NULL;
+    return NOT_FOUND != locate(hashtable, fragment(hash), match, probe);
 }
 
-static void *chained_get(const Hashtable *hashtable, size_t index, const void *key)
+void *hashtable_get_probe(const Hashtable *hashtable, hashcode hash, hashtable_probe match, const void *probe)
 {
-    Chain *chain = (Chain *)hashtable->entries[index + 1];
-    for(size_t i = 0; i < chain->length; i += 2)
+    if(NULL == hashtable || NULL == match || NULL == probe)
     {
-        if(NULL == chain->entries[i])
-        {
-            return NULL;
-        }
-        if(hashtable->compare(chain->entries[i], key))
-        {
-            void *result = chain->entries[i + 1];
-            if(0 != i)
-            {
-                // N.B. - move most recent fetch to front
-                uint8_t *tmp = chain->entries[0];
-                chain->entries[0] = chain->entries[i];
-                chain->entries[i] = tmp;
-                tmp = chain->entries[1];
-                chain->entries[1] = chain->entries[i + 1];
-                chain->entries[i + 1] = tmp;
-            }
-            return result;
-        }
+        errno = EINVAL;
+        return NULL;
     }
-    return NULL;
+
+    size_t index = locate(hashtable, fragment(hash), match, probe);
+    return NOT_FOUND == index ? NULL : hashtable->entries[hashtable->index[index].entry - 1].value;
 }
 
 void *hashtable_get_if_absent(Hashtable *hashtable, void *key, void *value)
@@ -509,103 +586,102 @@ void *hashtable_put(Hashtable *hashtable, void *key, void *value)
         return NULL;
     }
 
-    size_t index = hash_index(hashtable, key);
-    uint8_t *cur = hashtable->entries[index];
-    if(NULL == cur)
-    {
-        hashtable->entries[index] = key;
-        hashtable->entries[index + 1] = value;
-        if(++hashtable->occupied > hashtable->capacity)
-        {
-            rehash(hashtable);
-        }
-        return NULL;
-    }
-    if(CHAINED_KEY != cur && hashtable->compare(key, cur))
+    uint32_t hash = fragment(hashtable->hash(key));
+    size_t index = locate(hashtable, hash, hashtable->compare, key);
+    if(NOT_FOUND != index)
     {
-        void *previous = hashtable->entries[index + 1];
-        hashtable->entries[index + 1] = value;
+        Entry *entry = hashtable->entries + (hashtable->index[index].entry - 1);
+        void *previous = entry->value;
+        entry->value = value;
         return previous;
     }
-    if(CHAINED_KEY == hashtable->entries[index])
+
+    if(hashtable->used == hashtable->capacity && !make_room(hashtable))
     {
-        return add_to_chain(hashtable, index, key, value);
+        return NULL;
     }
-    return chained_put(hashtable, index, key, value);
+    hashtable->entries[hashtable->used] = (Entry){key, value};
+    hashtable->used++;
+    place(hashtable->index, hashtable->length, (Slot){(uint32_t)hashtable->used, hash});
+    hashtable->occupied++;
+
+    return NULL;
 }
 
-static void *add_to_chain(Hashtable *hashtable, size_t index, void *key, void *value)
+static bool make_room(Hashtable *hashtable)
 {
-    Chain *chain = (Chain *)hashtable->entries[index + 1];
-    for(size_t i = 0; i < chain->length; i += 2)
+    // N.B. - squeeze out the holes left by removals while they make up a quarter of the table
+    if(hashtable->used - hashtable->occupied >= (hashtable->capacity >> 2) + 1)
     {
-        if(NULL == chain->entries[i])
-        {
-            chain->entries[i] = chain->entries[0];
-            chain->entries[i + 1] = chain->entries[1];
-            chain->entries[0] = key;
-            chain->entries[1] = value;
-            if(++hashtable->occupied > hashtable->capacity)
-            {
-                rehash(hashtable);
-            }
-            return NULL;
-        }
-        if(hashtable->compare(chain->entries[i], key))
-        {
-            void *previous = chain->entries[i + 1];
-            uint8_t *tmp = chain->entries[0];
-            chain->entries[0] = chain->entries[i];
-            chain->entries[i] = tmp;
-            chain->entries[i + 1] = chain->entries[1];
-            chain->entries[1] = value;
-            return previous;
-        }
+        return rebuild(hashtable, hashtable->length);
     }
-    expand_chain(hashtable, index, key, value);
-    return NULL;
+    if(hashtable->capacity >= MAXIMUM_ENTRIES)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+    return rebuild(hashtable, hashtable->length << 1);
 }
 
-static void expand_chain(Hashtable *hashtable, size_t index, void *key, void *value)
+static bool rebuild(Hashtable *hashtable, size_t length)
 {
-    Chain *chain = (Chain *)hashtable->entries[index + 1];
-    Chain *expansion = calloc(1, sizeof(Chain) + (sizeof(uint8_t *) * (chain->length + 2)));
-    if(NULL == expansion)
+    size_t capacity = capacity_of(length, hashtable->load_factor);
+    Slot *index = alloc_table(hashtable, length, capacity);
+    uint32_t *numbers = NULL;
+    if(hashtable->used != hashtable->occupied)
     {
-        return;
+        numbers = malloc(hashtable->used * sizeof(uint32_t));
     }
-    expansion->length = chain->length + 2;
-    memcpy(expansion->entries + 2, chain->entries, sizeof(uint8_t *) * chain->length);
-    expansion->entries[0] = key;
-    expansion->entries[1] = value;
-    hashtable->entries[index + 1] = (uint8_t *)expansion;
-    free(chain);
-    if(++hashtable->occupied > hashtable->capacity)
+    if(NULL == index || (hashtable->used != hashtable->occupied && NULL == numbers))
     {
-        rehash(hashtable);
+        release(hashtable, index);
+        free(numbers);
+        errno = ENOMEM;
+        return false;
     }
-}
 
-static void *chained_put(Hashtable *hashtable, size_t index, void *key, void *value)
-{
-    Chain *chain = malloc(sizeof(Chain) + sizeof(uint8_t *) * 4);
-    if(NULL == chain)
+    Entry *entries = (Entry *)(index + length);
+    if(NULL == numbers)
     {
-        return NULL;
+        memcpy(entries, hashtable->entries, hashtable->used * sizeof(Entry));
     }
-    chain->length = 4;
-    // N.B. - last in is moved to the front
-    chain->entries[0] = key;
-    chain->entries[1] = value;
-    chain->entries[2] = hashtable->entries[index];
-    chain->entries[3] = hashtable->entries[index + 1];
-    hashtable->entries[index] = (uint8_t *)CHAINED_KEY;
-    hashtable->entries[index + 1] = (uint8_t *)chain;
-    if(++hashtable->occupied > hashtable->capacity)
+    else
     {
-        rehash(hashtable);
+        size_t count = 0;
+        for(size_t i = 0; i < hashtable->used; i++)
+        {
+            if(NULL != hashtable->entries[i].key)
+            {
+                numbers[i] = (uint32_t)count;
+                entries[count++] = hashtable->entries[i];
+            }
+        }
     }
-    return NULL;
+
+    // N.B. - the slots carry the hash fragments, so the keys are not hashed again
+    for(size_t i = 0; i < hashtable->length; i++)
+    {
+        Slot slot = hashtable->index[i];
+        if(0 == slot.entry)
+        {
+            continue;
+        }
+        if(NULL != numbers)
+        {
+            slot.entry = numbers[slot.entry - 1] + 1;
+        }
+        place(index, length, slot);
+    }
+
+    free(numbers);
+    release(hashtable, hashtable->index);
+    hashtable->index = index;
+    hashtable->length = length;
+    hashtable->entries = entries;
+    hashtable->capacity = capacity;
+    hashtable->used = hashtable->occupied;
+
+    return true;
 }
 
 static bool map_into(void *key, void *value, void *context)
@@ -641,7 +717,7 @@ Hashtable *hashtable_copy(const Hashtable *hashtable)
     }
 
     Hashtable *result = make_hashtable_with_capacity_factor_function(
-        hashtable->compare, hashtable->capacity, hashtable->load_factor, hashtable->hash);
+        hashtable->compare, hashtable->length, hashtable->load_factor, hashtable->hash);
     hashtable_put_all(result, hashtable);
     return result;
 }
@@ -654,75 +730,32 @@ void *hashtable_remove(Hashtable *hashtable, void *key)
         return NULL;
     }
 
-    if(0 == hashtable->occupied)
+    size_t index = locate(hashtable, fragment(hashtable->hash(key)), hashtable->compare, key);
+    if(NOT_FOUND == index)
     {
         return NULL;
     }
 
-    size_t index = hash_index(hashtable, key);
-    uint8_t *cur = hashtable->entries[index];
-    if(NULL != cur)
+    Entry *entry = hashtable->entries + (hashtable->index[index].entry - 1);
+    void *previous = entry->value;
+    *entry = (Entry){NULL, NULL};
+    while(0 < hashtable->used && NULL == hashtable->entries[hashtable->used - 1].key)
     {
-        if(CHAINED_KEY != cur && hashtable->compare(key, cur))
-        {
-            hashtable->entries[index] = NULL;
-            void *previous = hashtable->entries[index + 1];
-            hashtable->entries[index + 1] = NULL;
-            hashtable->occupied--;
-            return previous;
-        }
-        if(CHAINED_KEY == cur)
-        {
-            return chained_remove(hashtable, index, key);
-        }
+        hashtable->used--;
     }
 
-    return NULL;
-}
-
-static void *chained_remove(Hashtable *hashtable, size_t index, void *key)
-{
-    Chain *chain = (Chain *)hashtable->entries[index + 1];
-    for(size_t i = 0; i < chain->length; i += 2)
+    // N.B. - shift the rest of the cluster back a place, rather than leaving a tombstone
+    size_t mask = hashtable->length - 1;
+    for(size_t next = (index + 1) & mask;
+        0 != hashtable->index[next].entry && 0 != distance(hashtable, next);
+        index = next, next = (next + 1) & mask)
     {
-        if(NULL == chain->entries[i])
-        {
-            return NULL;
-        }
-        if(hashtable->compare(chain->entries[i], key))
-        {
-            void *previous = chain->entries[i + 1];
-            if(chain->length - 2 == i)
-            {
-                chain->entries[i] = NULL;
-                chain->entries[i + 1] = NULL;
-            }
-            else
-            {
-                // N.B. - preserve any move-to-front ordering
-                memcpy(chain->entries + i, chain->entries + i + 2, sizeof(uint8_t *) * (chain->length - (i + 2)));
-                chain->entries[chain->length - 1] = NULL;
-                chain->entries[chain->length - 2] = NULL;
-            }
-            if(NULL == chain->entries[0])
-            {
-                // N.B. - empty chains can be removed and the bucket can be freed
-                hashtable->entries[index] = NULL;
-                hashtable->entries[index + 1] = NULL;
-                free(chain);
-            }
-            else if(NULL == chain->entries[2])
-            {
-                // N.B. - chains with only one entry can be collapsed into a bucket
-                hashtable->entries[index] = chain->entries[0];
-                hashtable->entries[index + 1] = chain->entries[1];
-                free(chain);
-            }
-            hashtable->occupied--;
-            return previous;
-        }
+        hashtable->index[index] = hashtable->index[next];
     }
-    return NULL;
+    hashtable->index[index] = (Slot){0, 0};
+    hashtable->occupied--;
+
+    return previous;
 }
 
 bool hashtable_iterate(const Hashtable *hashtable, hashtable_iterator iterator, void *context)
@@ -733,25 +766,12 @@ bool hashtable_iterate(const Hashtable *hashtable, hashtable_iterator iterator,
         return false;
     }
 
-    for(size_t i = 0; i < hashtable->length; i += 2)
+    for(size_t i = 0; i < hashtable->used; i++)
     {
-        if(CHAINED_KEY == hashtable->entries[i])
+        Entry *entry = hashtable->entries + i;
+        if(NULL != entry->key && !iterator(entry->key, entry->value, context))
         {
-            Chain *chain = (Chain *)hashtable->entries[i + 1];
-            for(size_t j = 0; j < chain->length && NULL != chain->entries[j]; j += 2)
-            {
-                if(!iterator(chain->entries[j], chain->entries[j + 1], context))
-                {
-                    return false;
-                }
-            }
-        }
-        else if(NULL != hashtable->entries[i])
-        {
-            if(!iterator(hashtable->entries[i], hashtable->entries[i + 1], context))
-            {
-                return false;
-            }
+            return false;
         }
     }
 
@@ -780,81 +800,33 @@ bool hashtable_iterate_values(const Hashtable *hashtable, hashtable_item_iterato
     return hashtable_iterate(hashtable, value_item_iterator, &(item_adapter){iterator, context});
 }
 
-static inline size_t hash_index(const Hashtable *hashtable, const void * key)
-{
-    hashcode h = hashtable->hash(key);
-    return (h & ((hashtable->length >> 1) - 1)) << 1;
-}
-
-static void rehash(Hashtable *hashtable)
-{
-    size_t capacity = normalize_capacity((hashtable->length >> 1) + 1);
-    uint8_t **table = hashtable->entries;
-    size_t length = hashtable->length;
-    alloc_table(hashtable, capacity);
-    init(hashtable, hashtable->compare, capacity, hashtable->load_factor, hashtable->hash);
-    for(size_t i = 0; i < length; i += 2)
-    {
-        if(CHAINED_KEY == table[i])
-        {
-            Chain *chain = (Chain *)table[i + 1];
-            for(size_t j = 0; j < chain->length; j += 2)
-            {
-                if(NULL == chain->entries[j])
-                {
-                    break;
-                }
-                hashtable_put(hashtable, chain->entries[j], chain->entries[j + 1]);
-            }
-            free(chain);
-            table[i] = NULL;
-            table[i + 1] = NULL;
-        }
-        else if(NULL != table[i])
-        {
-            hashtable_put(hashtable, table[i], table[i + 1]);
-        }
-    }
-    free(table);
-}
-
 void hashtable_summary(const Hashtable *hashtable, FILE *stream)
 {
     fputs("hashtable summary:\n", stream);
     fprintf(stream, "mutable: %s\n", hashtable_is_mutable(hashtable) ? "yes" : "no");
     fprintf(stream, "occupied: %zd of %zd\n", hashtable->occupied, hashtable->capacity);
-    fprintf(stream, "capacity: %zd (%zd * %g)\n", hashtable->capacity, hashtable->length >> 1, hashtable->load_factor);
-    fprintf(stream, "table length: %zd\n", hashtable->length);
+    fprintf(stream, "capacity: %zd (%zd * %g)\n", hashtable->capacity, hashtable->length, hashtable->load_factor);
+    fprintf(stream, "entries: %zd (holes: %zd)\n", hashtable->used, hashtable->used - hashtable->occupied);
+    fprintf(stream, "index length: %zd\n", hashtable->length);
     fprintf(stream, "load factor: %g\n", hashtable->load_factor);
-    fputs("bucket report:\n", stream);
-    size_t count = 0ul, min = 0ul, max = 0ul, total = 0ul;
-    float avg = 0.0f;
-    for(size_t i = 0; i < hashtable->length; i += 2)
+    fputs("slot report:\n", stream);
+    size_t max = 0ul, total = 0ul;
+    for(size_t i = 0; i < hashtable->length; i++)
     {
-        if(CHAINED_KEY == hashtable->entries[i])
+        Slot slot = hashtable->index[i];
+        if(0 == slot.entry)
         {
-            count++;
-            Chain *chain = (Chain *)hashtable->entries[i + 1];
-            fprintf(stream, "[%zd]: chain (length: %zd, hash: 0x%zx)\n", i, chain->length, hashtable->hash(chain->entries[0]));
-            for(size_t j = 0; j < chain->length && NULL != chain->entries[j]; j += 2)
-            {
-                fprintf(stream, "  [%zd]: chained key: \"%s\"\n", j, chain->entries[j]);
-            }
-            if(max < chain->length)
-            {
-                max = chain->length;
-            }
-            if(0 == min || min > chain->length)
-            {
-                min = chain->length;
-            }
-            total += chain->length;
-            avg = (float)total / (float)count;
+            continue;
         }
-        else if(NULL != hashtable->entries[i])
+        size_t displacement = distance(hashtable, i);
+        fprintf(stream, "[%zd]: key: \"%s\" hash: 0x%08x distance: %zd\n", i,
+                (const char *)hashtable->entries[slot.entry - 1].key, slot.hash, displacement);
+        if(max < displacement)
         {
-            fprintf(stream, "[%zd]: key: \"%s\" hash: 0x%zx\n", i, hashtable->entries[i], hashtable->hash(hashtable->entries[i]));
+            max = displacement;
         }
+        total += displacement;
     }
-    fprintf(stream, "chains: %zd (length min: %zd, max: %zd, avg: %g)\n", count, min, max, avg);
+    float avg = 0 == hashtable->occupied ? 0.0f : (float)total / (float)hashtable->occupied;
+    fprintf(stream, "probe distance max: %zd, avg: %g\n", max, avg);
 }
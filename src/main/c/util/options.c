@@ -39,6 +39,9 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
 #include <sys/param.h>
 #include <getopt.h>
 
@@ -51,9 +54,18 @@ static const char * const EMIT_MODES [] =
     "bash",
     "zsh",
     "json",
-    "yaml"
+    "yaml",
+    "ndjson",
+    "msgpack",
+    "cbor",
+    "raw"
 };
 
+/* enough for the handful of queries that a coprocess client sends over and over */
+static const size_t DEFAULT_PATH_CACHE = 64;
+/* a million nodes costs only a few megabytes of pointers into the model */
+static const size_t DEFAULT_RESULT_CACHE = 1000000;
+
 static argument arguments[] =
 {
     // meta commands:
@@ -62,9 +74,23 @@ static argument arguments[] =
     {"help",        no_argument,       NULL, 'h'}, // print help and exit
     // operating modes:
     {"query",       required_argument, NULL, 'q'}, // evaluate given expression and exit
+    {"queries",     required_argument, NULL, 'Q'}, // evaluate every expression in the given file and exit
+    {"compile",     required_argument, NULL, 'c'}, // write a snapshot of the given file and exit
     // optional arguments:
     {"output",      required_argument, NULL, 'o'}, // emit expressions for the given shell
     {"duplicate",   required_argument, NULL, 'd'}, // how to respond to duplicate mapping keys
+    {"mmap",        no_argument,       NULL, 'm'}, // map the input file instead of reading it
+    {"input-format", required_argument, NULL, 'i'}, // the format of the input, or detect it
+    {"limit",       required_argument, NULL, 'l'}, // stop after selecting this many nodes
+    {"exists",      no_argument,       NULL, 'e'}, // only report if anything matched via the exit status
+    {"count",       no_argument,       NULL, 'n'}, // print the number of matching nodes
+    {"index",       no_argument,       NULL, 'x'}, // index mapping keys for recursive name queries
+    {"threads",     required_argument, NULL, 't'}, // split recursive queries over this many threads
+    {"documents",   required_argument, NULL, 'D'}, // only query this range of the input documents
+    {"stream",      no_argument,       NULL, 's'}, // query the input as it is parsed, without loading it
+    {"path-cache",  required_argument, NULL, 'p'}, // keep this many parsed queries in interactive mode
+    {"result-cache", required_argument, NULL, 'r'}, // keep this many selected nodes in interactive mode
+    {"framing",     no_argument,       NULL, 'f'}, // precede each interactive response with a length header
     {0, 0, 0, 0}
 };
 
@@ -94,29 +120,131 @@ inline int32_t parse_emit_mode(const char *value)
     {
         return YAML;
     }
+    else if(strncmp("ndjson", value, 6) == 0)
+    {
+        return NDJSON;
+    }
+    else if(strncmp("msgpack", value, 7) == 0)
+    {
+        return MSGPACK;
+    }
+    else if(strncmp("cbor", value, 4) == 0)
+    {
+        return CBOR;
+    }
+    else if(strncmp("raw", value, 3) == 0)
+    {
+        return RAW;
+    }
     else
     {
         return -1;
     }
 }
 
+bool parse_count(const char *value, size_t *count)
+{
+    if(NULL == value || !isdigit((unsigned char)value[0]))
+    {
+        return false;
+    }
+    char *end = NULL;
+    errno = 0;
+    unsigned long long result = strtoull(value, &end, 10);
+    if(0 != errno || '\0' != *end || SIZE_MAX < result)
+    {
+        return false;
+    }
+    *count = (size_t)result;
+    return true;
+}
+
+/*
+ * A range is written like a slice, `<first>:<last>', where either end may
+ * be left out to mean the start or the end of the input, or as a single
+ * `<index>'.  Documents are numbered from zero.
+ */
+bool parse_document_range(const char *value, size_t *first, size_t *last)
+{
+    if(NULL == value)
+    {
+        return false;
+    }
+    const char *colon = strchr(value, ':');
+    if(NULL == colon)
+    {
+        size_t index = 0;
+        if(!parse_count(value, &index) || SIZE_MAX == index)
+        {
+            return false;
+        }
+        *first = index;
+        *last = index + 1;
+        return true;
+    }
+
+    size_t from = 0, to = SIZE_MAX;
+    if(colon != value)
+    {
+        char start[32];
+        size_t length = (size_t)(colon - value);
+        if(sizeof(start) <= length)
+        {
+            return false;
+        }
+        memcpy(start, value, length);
+        start[length] = '\0';
+        if(!parse_count(start, &from))
+        {
+            return false;
+        }
+    }
+    if('\0' != colon[1] && !parse_count(colon + 1, &to))
+    {
+        return false;
+    }
+    *first = from;
+    *last = to;
+    return true;
+}
+
 inline const char * emit_mode_name(enum emit_mode value)
 {
     return EMIT_MODES[value];
 }
 
+inline bool is_binary_emit_mode(enum emit_mode value)
+{
+    return MSGPACK == value || CBOR == value;
+}
+
 enum command process_options(const int argc, char * const *argv, struct options *options)
 {
     int opt;
     bool done = false;
+    const char *output = NULL;
     enum command command = INTERACTIVE_MODE;
 
     options->emit_mode = BASH;
     options->duplicate_strategy = DUPE_CLOBBER;
     options->input_file_name = NULL;
+    options->queries_file_name = NULL;
     options->mode = INTERACTIVE_MODE;
+    options->input_format = INPUT_AUTO;
+    options->memory_map = false;
+    options->name_index = false;
+    options->output_file_name = NULL;
+    options->query_mode = QUERY_NODES;
+    options->limit = 0;
+    options->threads = 1;
+    options->first_document = 0;
+    options->last_document = SIZE_MAX;
+    options->stream = false;
+    options->path_cache = DEFAULT_PATH_CACHE;
+    options->result_cache = DEFAULT_RESULT_CACHE;
+    options->framing = false;
 
-    while(!done && (opt = getopt_long(argc, argv, "vwhq:o:d:", arguments, NULL)) != -1)
+    while(!done && (opt = getopt_long(argc, argv, "vwhq:Q:c:o:d:mi:l:enxt:D:sp:r:f", arguments, NULL)) != -1)
     {
         switch(opt)
         {
@@ -136,36 +264,119 @@ enum command process_options(const int argc, char * const *argv, struct options
                 done = true;
                 break;
             case 'q':
+                ENSURE_COMMAND_ORTHOGONALITY(COMPILE_MODE == command || BATCH_MODE == command);
                 command = EXPRESSION_MODE;
                 options->expression = optarg;
                 options->mode = EXPRESSION_MODE;
                 break;
+            case 'Q':
+                ENSURE_COMMAND_ORTHOGONALITY(COMPILE_MODE == command || EXPRESSION_MODE == command);
+                command = BATCH_MODE;
+                options->queries_file_name = optarg;
+                options->mode = BATCH_MODE;
+                break;
+            case 'c':
+                ENSURE_COMMAND_ORTHOGONALITY(EXPRESSION_MODE == command || BATCH_MODE == command);
+                command = COMPILE_MODE;
+                options->input_file_name = optarg;
+                options->mode = COMPILE_MODE;
+                break;
             case 'o':
+                // N.B. - this is the output format, or the snapshot file when compiling
+                output = optarg;
+                break;
+            case 'd':
             {
-                int32_t mode = parse_emit_mode(optarg);
-                if(-1 == mode)
+                int32_t strategy = parse_duplicate_strategy(optarg);
+                if(-1 == strategy)
                 {
-                    fprintf(stderr, "error: %s: unsupported output format `%s'\n", argv[0], optarg);
+                    fprintf(stderr, "error: %s: unsupported duplicate strategy `%s'\n", argv[0], optarg);
                     command = SHOW_HELP;
                     done = true;
                     break;
                 }
-                options->emit_mode = (enum emit_mode)mode;
+                options->duplicate_strategy = (enum loader_duplicate_key_strategy)strategy;
                 break;
             }
-            case 'd':
+            case 'm':
+                options->memory_map = true;
+                break;
+            case 'i':
             {
-                int32_t strategy = parse_duplicate_strategy(optarg);
-                if(-1 == strategy)
+                int32_t format = parse_input_format(optarg);
+                if(-1 == format)
                 {
-                    fprintf(stderr, "error: %s: unsupported duplicate strategy `%s'\n", argv[0], optarg);
+                    fprintf(stderr, "error: %s: unsupported input format `%s'\n", argv[0], optarg);
                     command = SHOW_HELP;
                     done = true;
                     break;
                 }
-                options->duplicate_strategy = (enum loader_duplicate_key_strategy)strategy;
+                options->input_format = (enum loader_input_format)format;
                 break;
             }
+            case 'l':
+                if(!parse_count(optarg, &options->limit))
+                {
+                    fprintf(stderr, "error: %s: invalid limit `%s'\n", argv[0], optarg);
+                    command = SHOW_HELP;
+                    done = true;
+                }
+                break;
+            case 'e':
+            case 'n':
+            {
+                enum query_mode mode = 'e' == opt ? QUERY_EXISTS : QUERY_COUNT;
+                if(QUERY_NODES != options->query_mode && mode != options->query_mode)
+                {
+                    fputs("error: only one of `--exists' and `--count' can be given\n", stderr);
+                    command = SHOW_HELP;
+                    done = true;
+                    break;
+                }
+                options->query_mode = mode;
+                break;
+            }
+            case 'x':
+                options->name_index = true;
+                break;
+            case 't':
+                if(!parse_count(optarg, &options->threads))
+                {
+                    fprintf(stderr, "error: %s: invalid thread count `%s'\n", argv[0], optarg);
+                    command = SHOW_HELP;
+                    done = true;
+                }
+                break;
+            case 'D':
+                if(!parse_document_range(optarg, &options->first_document, &options->last_document))
+                {
+                    fprintf(stderr, "error: %s: invalid document range `%s'\n", argv[0], optarg);
+                    command = SHOW_HELP;
+                    done = true;
+                }
+                break;
+            case 's':
+                options->stream = true;
+                break;
+            case 'p':
+                if(!parse_count(optarg, &options->path_cache))
+                {
+                    fprintf(stderr, "error: %s: invalid path cache size `%s'\n", argv[0], optarg);
+                    command = SHOW_HELP;
+                    done = true;
+                }
+                break;
+            case 'r':
+                if(!parse_count(optarg, &options->result_cache))
+                {
+                    fprintf(stderr, "error: %s: invalid result cache size `%s'\n", argv[0], optarg);
+                    command = SHOW_HELP;
+                    done = true;
+                }
+                break;
+            case 'f':
+                options->framing = true;
+                break;
             case ':':
             case '?':
             default:
@@ -179,6 +390,30 @@ enum command process_options(const int argc, char * const *argv, struct options
         fputs("uh oh! something went wrong handing arguments!\n", stderr);
         return SHOW_HELP;
     }
+    if(SHOW_HELP == command)
+    {
+        return command;
+    }
+    if(COMPILE_MODE == options->mode)
+    {
+        options->output_file_name = output;
+        if(argc - optind)
+        {
+            fputs("error: the file to compile is given with `--compile'\n", stderr);
+            command = SHOW_HELP;
+        }
+        return command;
+    }
+    if(NULL != output)
+    {
+        int32_t mode = parse_emit_mode(output);
+        if(-1 == mode)
+        {
+            fprintf(stderr, "error: %s: unsupported output format `%s'\n", argv[0], output);
+            return SHOW_HELP;
+        }
+        options->emit_mode = (enum emit_mode)mode;
+    }
     if(argc - optind)
     {
         options->input_file_name = argv[optind];
@@ -190,5 +425,18 @@ enum command process_options(const int argc, char * const *argv, struct options
         fputs("error: the standard in shortcut `-' can't be used with interactive evaluation\n", stderr);
         command = SHOW_HELP;
     }
+    if(BATCH_MODE == options->mode &&
+       0 == memcmp("-", options->queries_file_name, 1) &&
+       (NULL == options->input_file_name || 0 == memcmp("-", options->input_file_name, 1)))
+    {
+        fputs("error: the queries and the input can't both be read from standard in\n", stderr);
+        command = SHOW_HELP;
+    }
+    // N.B. - the `# <n>' line before the results of each query would corrupt a stream of binary values
+    if(BATCH_MODE == options->mode && QUERY_NODES == options->query_mode && is_binary_emit_mode(options->emit_mode))
+    {
+        fprintf(stderr, "error: the results of `--queries' can't be written as `%s'\n", emit_mode_name(options->emit_mode));
+        command = SHOW_HELP;
+    }
     return command;
 }
@@ -43,11 +43,14 @@ struct vector_s
     size_t    length;
     size_t    capacity;
     uint8_t **items;
+    /** the arena that owns the items, if any */
+    Arena    *arena;
 };
 
 static inline bool ensure_capacity(Vector *vector, size_t min_capacity);
 static inline size_t calculate_new_capacity(size_t capacity);
 static inline bool reallocate(Vector *vector, size_t capacity);
+static inline uint8_t **allocate_items(const Vector *vector, size_t capacity);
 
 
 static bool add_to_vector_iterator(void *each, void *context);
@@ -82,6 +85,31 @@ Vector *make_vector_with_capacity(size_t capacity)
     return result;
 }
 
+Vector *make_vector_in(Arena *arena, size_t capacity)
+{
+    if(NULL == arena || 0 == capacity)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    Vector *result = (Vector *)arena_alloc(arena, sizeof(Vector));
+    if(NULL == result)
+    {
+        return NULL;
+    }
+
+    result->arena = arena;
+    result->items = allocate_items(result, capacity);
+    if(NULL == result->items)
+    {
+        return NULL;
+    }
+
+    result->length = 0;
+    result->capacity = capacity;
+    return result;
+}
+
 Vector *make_vector_of(size_t count, ...)
 {
     if(0 == count)
@@ -173,7 +201,7 @@ Vector *vector_with_all(const Vector *vector, const Vector *from)
 
 void vector_free(Vector *vector)
 {
-    if(NULL == vector)
+    if(NULL == vector || NULL != vector->arena)
     {
         return;
     }
@@ -301,8 +329,8 @@ bool vector_insert(Vector *vector, void *value, size_t index)
     if(vector->capacity < vector->length + 1)
     {
         size_t new_capacity = calculate_new_capacity(vector->capacity);
-        target = calloc(1, sizeof(uint8_t *) * new_capacity);
-        if(NULL == vector->items)
+        target = allocate_items(vector, new_capacity);
+        if(NULL == target)
         {
             return false;
         }
@@ -327,7 +355,10 @@ bool vector_insert(Vector *vector, void *value, size_t index)
 
     if(target != vector->items)
     {
-        free(vector->items);
+        if(NULL == vector->arena)
+        {
+            free(vector->items);
+        }
         vector->items = target;
     }
     vector->length++;
@@ -714,10 +745,28 @@ static inline bool ensure_capacity(Vector *vector, size_t min_capacity)
     return true;
 }
 
+static inline uint8_t **allocate_items(const Vector *vector, size_t capacity)
+{
+    if(NULL == vector->arena)
+    {
+        return calloc(1, sizeof(uint8_t *) * capacity);
+    }
+    return arena_alloc(vector->arena, sizeof(uint8_t *) * capacity);
+}
+
 static inline bool reallocate(Vector *vector, size_t capacity)
 {
     uint8_t **cache = vector->items;
-    vector->items = realloc(vector->items, sizeof(uint8_t *) * capacity);
+    if(NULL == vector->arena)
+    {
+        vector->items = realloc(vector->items, sizeof(uint8_t *) * capacity);
+    }
+    else
+    {
+        vector->items = arena_realloc(vector->arena, vector->items,
+                                      sizeof(uint8_t *) * vector->capacity,
+                                      sizeof(uint8_t *) * capacity);
+    }
     if(NULL == vector->items)
     {
         vector->items = cache;
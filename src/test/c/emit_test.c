@@ -0,0 +1,822 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ * 
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <check.h>
+
+#include "emit.h"
+#include "emit/frame.h"
+#include "loader.h"
+#include "nodelist.h"
+#include "test.h"
+
+/* a value decoded from MessagePack or CBOR, strings point into the encoded data */
+enum item_kind
+{
+    ITEM_ARRAY,
+    ITEM_MAP,
+    ITEM_STRING,
+    ITEM_INTEGER,
+    ITEM_REAL,
+    ITEM_BOOLEAN,
+    ITEM_NULL
+};
+
+struct item
+{
+    enum item_kind  kind;
+    uint64_t        count;
+    const uint8_t  *string;
+    int64_t         integer;
+    double          real;
+    bool            boolean;
+};
+
+typedef const uint8_t *(*item_reader)(const uint8_t *data, struct item *item);
+
+static Writer *open_output(FILE **file);
+static char *read_output(Writer *output, FILE *file, size_t *size);
+static char *read_contents(FILE *file, size_t *size);
+static char *make_pattern(size_t length);
+static void assert_round_trip(DocumentModel *model, emit_function emit, item_reader read);
+static const uint8_t *assert_decodes(item_reader read, const uint8_t *data, Node *expected);
+static void assert_decoded_scalar(const struct item *item, const Scalar *expected);
+static const uint8_t *read_msgpack(const uint8_t *data, struct item *item);
+static const uint8_t *read_cbor(const uint8_t *data, struct item *item);
+static uint64_t read_big_endian(const uint8_t *data, size_t width);
+static DocumentModel *load_fixture(const char *filename);
+static DocumentModel *load_numbers(void);
+static char *escape(const char *value, size_t length);
+static char *expected_escape(const char *value, size_t length);
+
+START_TEST (escaped_strings)
+{
+    static const struct
+    {
+        const char *value;
+        const char *expected;
+    } strings[] =
+    {
+        {"", ""},
+        {"clean", "clean"},
+        {"\"quoted\"", "\\\"quoted\\\""},
+        {"back\\slash", "back\\\\slash"},
+        {"tab\tnew line\ncarriage\rfeed\fbell\b", "tab\\tnew line\\ncarriage\\rfeed\\fbell\\b"},
+        {"\x01\x1f\x7f", "\\u0001\\u001f\x7f"},
+        {"吾輩は猫である", "吾輩は猫である"},
+        {"a long clean run, longer than any vector, before the \"quote\" at its end", "a long clean run, longer than any vector, before the \\\"quote\\\" at its end"}
+    };
+
+    for(size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++)
+    {
+        char *actual = escape(strings[i].value, strlen(strings[i].value));
+        ck_assert_str_eq(strings[i].expected, actual);
+        free(actual);
+    }
+}
+END_TEST
+
+START_TEST (escaped_positions)
+{
+    // N.B. - every escape, at every offset across and between the vectors, is found
+    static const char specials[] = {'"', '\\', '\n', '\0', '\x1f', ' ', '\x80', '\xff'};
+    char value[97];
+    for(size_t i = 0; i < sizeof(specials); i++)
+    {
+        for(size_t offset = 0; offset < sizeof(value); offset++)
+        {
+            memset(value, 'x', sizeof(value));
+            value[offset] = specials[i];
+            char *expected = expected_escape(value, sizeof(value));
+            char *actual = escape(value, sizeof(value));
+            ck_assert_str_eq(expected, actual);
+            free(expected);
+            free(actual);
+        }
+    }
+}
+END_TEST
+
+START_TEST (ndjson_lines)
+{
+    static const char * const input = "[{\"a\": \"x\\\"y\", \"b\": [1, true, null]}, \"two\", 3]";
+    MaybeDocument maybe = load_string((const unsigned char *)input, strlen(input), DUPE_FAIL);
+    assert_int_eq(JUST, maybe.tag);
+    Sequence *items = sequence(model_document_root(maybe.just, 0));
+    nodelist *list = make_nodelist();
+    for(size_t i = 0; i < 3; i++)
+    {
+        assert_true(nodelist_add(list, sequence_get(items, i)));
+    }
+
+    FILE *file = NULL;
+    Writer *output = open_output(&file);
+    assert_true(emit_ndjson(list, output));
+    // N.B. - each line has already been flushed
+    assert_uint_eq(0, output->length);
+    char *actual = read_output(output, file, NULL);
+    ck_assert_str_eq("{\"a\":\"x\\\"y\",\"b\":[1,true,null]}\n\"two\"\n3\n", actual);
+
+    free(actual);
+    nodelist_free(list);
+    model_free(maybe.just);
+}
+END_TEST
+
+static Writer *open_output(FILE **file)
+{
+    *file = tmpfile();
+    ck_assert_ptr_ne(NULL, *file);
+    Writer *output = make_writer(fileno(*file));
+    assert_not_null(output);
+
+    return output;
+}
+
+START_TEST (msgpack_round_trip)
+{
+    const char *fixtures[] = {"inventory.json", "invoice.yaml"};
+    for(size_t i = 0; i < sizeof(fixtures) / sizeof(fixtures[0]); i++)
+    {
+        DocumentModel *model = load_fixture(fixtures[i]);
+        assert_round_trip(model, emit_msgpack, read_msgpack);
+        model_free(model);
+    }
+
+    DocumentModel *numbers = load_numbers();
+    assert_round_trip(numbers, emit_msgpack, read_msgpack);
+    model_free(numbers);
+}
+END_TEST
+
+START_TEST (cbor_round_trip)
+{
+    const char *fixtures[] = {"inventory.json", "invoice.yaml"};
+    for(size_t i = 0; i < sizeof(fixtures) / sizeof(fixtures[0]); i++)
+    {
+        DocumentModel *model = load_fixture(fixtures[i]);
+        assert_round_trip(model, emit_cbor, read_cbor);
+        model_free(model);
+    }
+
+    DocumentModel *numbers = load_numbers();
+    assert_round_trip(numbers, emit_cbor, read_cbor);
+    model_free(numbers);
+}
+END_TEST
+
+START_TEST (raw_from_source)
+{
+    MaybeDocument maybe = load_mapped("inventory.json", DUPE_CLOBBER);
+    assert_int_eq(JUST, maybe.tag);
+    DocumentModel *model = maybe.just;
+    Node *root = model_document_root(model, 0);
+    Node *store = mapping_get(mapping(root), (uint8_t *)"store", 5ul);
+    Node *book = mapping_get(mapping(store), (uint8_t *)"book", 4ul);
+    Node *title = mapping_get(mapping(sequence_get(sequence(book), 0)), (uint8_t *)"title", 5ul);
+    nodelist *list = make_nodelist();
+    assert_true(nodelist_add(list, node(model_document(model, 0))));
+    assert_true(nodelist_add(list, title));
+
+    FILE *file = NULL;
+    Writer *output = open_output(&file);
+    assert_true(emit_raw(list, output, model));
+    size_t length = 0;
+    char *actual = read_output(output, file, &length);
+
+    // N.B. - the document is its root mapping, the whole of the input but for the final newline
+    size_t source_length = model->source.length - 1;
+    static const char * const TITLE = ",\"Sayings of the Century\"]\n";
+    assert_uint_eq(1 + source_length + strlen(TITLE), length);
+    assert_int_eq('[', actual[0]);
+    assert_int_eq(0, memcmp(model->source.data, actual + 1, source_length));
+    ck_assert_str_eq(TITLE, actual + 1 + source_length);
+
+    free(actual);
+    nodelist_free(list);
+    model_free(model);
+}
+END_TEST
+
+START_TEST (raw_without_source)
+{
+    DocumentModel *model = load_fixture("inventory.json");
+    nodelist *list = make_nodelist();
+    assert_true(nodelist_add(list, model_document_root(model, 0)));
+
+    FILE *raw_file = NULL;
+    Writer *raw_output = open_output(&raw_file);
+    assert_true(emit_raw(list, raw_output, model));
+    char *raw = read_output(raw_output, raw_file, NULL);
+
+    FILE *json_file = NULL;
+    Writer *json_output = open_output(&json_file);
+    assert_true(emit_json(list, json_output));
+    char *json = read_output(json_output, json_file, NULL);
+
+    // N.B. - without the mapped input to copy from, the nodes are written as compact json
+    ck_assert_str_eq(json, raw);
+
+    free(raw);
+    free(json);
+    nodelist_free(list);
+    model_free(model);
+}
+END_TEST
+
+START_TEST (buffered_writes)
+{
+    FILE *file = NULL;
+    Writer *output = open_output(&file);
+    char *data = make_pattern(WRITER_BUFFER_SIZE + 1);
+
+    // N.B. - the buffer is filled to the last byte before anything is written
+    for(size_t i = 0; i < WRITER_BUFFER_SIZE; i += 1024)
+    {
+        assert_true(writer_write(output, (const uint8_t *)data + i, 1024));
+    }
+    assert_uint_eq(WRITER_BUFFER_SIZE, output->length);
+    assert_int_eq(0, lseek(fileno(file), 0, SEEK_END));
+
+    // N.B. - one more byte flushes the full buffer, and is buffered itself
+    assert_true(writer_write(output, (const uint8_t *)data + WRITER_BUFFER_SIZE, 1));
+    assert_uint_eq(1, output->length);
+    assert_int_eq(WRITER_BUFFER_SIZE, lseek(fileno(file), 0, SEEK_END));
+
+    size_t size = 0;
+    char *actual = read_output(output, file, &size);
+    assert_uint_eq(WRITER_BUFFER_SIZE + 1, size);
+    assert_int_eq(0, memcmp(data, actual, size));
+    free(actual);
+    free(data);
+}
+END_TEST
+
+START_TEST (write_through)
+{
+    FILE *file = NULL;
+    Writer *output = open_output(&file);
+    size_t length = WRITER_BUFFER_SIZE * 2;
+    char *data = make_pattern(length);
+
+    // N.B. - a write bigger than the buffer goes straight out, after the bytes already buffered
+    assert_true(writer_puts(output, "head"));
+    assert_true(writer_write(output, (const uint8_t *)data, length));
+    assert_uint_eq(0, output->length);
+    assert_int_eq((off_t)length + 4, lseek(fileno(file), 0, SEEK_END));
+
+    size_t size = 0;
+    char *actual = read_output(output, file, &size);
+    assert_uint_eq(length + 4, size);
+    assert_int_eq(0, memcmp("head", actual, 4));
+    assert_int_eq(0, memcmp(data, actual + 4, length));
+    free(actual);
+    free(data);
+}
+END_TEST
+
+START_TEST (failed_writes)
+{
+    int ends[2];
+    assert_int_eq(0, pipe(ends));
+    close(ends[0]);
+    signal(SIGPIPE, SIG_IGN);
+
+    Writer *output = make_writer(ends[1]);
+    assert_not_null(output);
+    assert_true(writer_puts(output, "buffered"));
+    assert_false(output->failed);
+
+    // N.B. - the first error sticks, later writes fail without trying again
+    errno = 0;
+    assert_false(writer_flush(output));
+    assert_int_eq(EPIPE, errno);
+    assert_true(output->failed);
+    assert_false(writer_puts(output, "more"));
+    char *data = make_pattern(WRITER_BUFFER_SIZE);
+    assert_false(writer_write(output, (const uint8_t *)data, WRITER_BUFFER_SIZE));
+    assert_false(writer_flush(output));
+
+    free(data);
+    writer_free(output);
+    close(ends[1]);
+}
+END_TEST
+
+START_TEST (framed_responses)
+{
+    // N.B. - a frame writes to whatever stdout is when it is opened, here a file
+    FILE *file = tmpfile();
+    assert_not_null(file);
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    assert_int_ne(-1, saved);
+    assert_int_ne(-1, dup2(fileno(file), STDOUT_FILENO));
+
+    struct frame response;
+    assert_true(open_frame(&response));
+    assert_true(begin_frame(&response));
+    fputs("[1,2]\n", stdout);
+    response.matches = 2;
+    assert_true(end_frame(&response));
+
+    // N.B. - what was written before the failure is discarded, and the count with it
+    assert_true(begin_frame(&response));
+    fputs("[3,", stdout);
+    response.matches = 1;
+    fail_frame(&response);
+    fputs("bad query\n", stdout);
+    assert_true(end_frame(&response));
+    close_frame(&response);
+
+    fflush(stdout);
+    assert_int_ne(-1, dup2(saved, STDOUT_FILENO));
+    close(saved);
+
+    char *actual = read_contents(file, NULL);
+    ck_assert_str_eq("OK 2 6\n[1,2]\nERR 0 10\nbad query\n", actual);
+    free(actual);
+}
+END_TEST
+
+START_TEST (copied_frames)
+{
+    // N.B. - longer than the buffer that the response is copied through
+    size_t length = 65536 * 2 + 100;
+    char *data = make_pattern(length);
+    FILE *from = tmpfile();
+    FILE *to = tmpfile();
+    assert_not_null(from);
+    assert_not_null(to);
+    assert_uint_eq(length, fwrite(data, 1, length, from));
+    fflush(from);
+    assert_int_eq(0, lseek(fileno(from), 0, SEEK_SET));
+
+    assert_true(copy_frame(fileno(from), fileno(to), (off_t)length));
+    // N.B. - a response shorter than its header says is an error
+    assert_false(copy_frame(fileno(from), fileno(to), 1));
+    fclose(from);
+
+    size_t size = 0;
+    char *actual = read_contents(to, &size);
+    assert_uint_eq(length, size);
+    assert_int_eq(0, memcmp(data, actual, length));
+    free(actual);
+    free(data);
+}
+END_TEST
+
+static DocumentModel *load_fixture(const char *filename)
+{
+    FILE *input = fopen(filename, "r");
+    assert_not_null(input);
+    MaybeDocument maybe = load_file(input, DUPE_CLOBBER);
+    fclose(input);
+    assert_int_eq(JUST, maybe.tag);
+
+    return maybe.just;
+}
+
+/* every width of integer, string, array and map in both formats */
+static DocumentModel *load_numbers(void)
+{
+    char text[1024];
+    memset(text, 'x', 300);
+    text[300] = '\0';
+    char input[2048];
+    snprintf(input, sizeof(input),
+             "{\"integers\": [0, 23, 24, 127, 128, 255, 256, 65535, 65536, 4294967295, 4294967296, 9223372036854775807,\n"
+             "               -1, -24, -25, -32, -33, -128, -129, -32768, -32769, -2147483648, -2147483649],\n"
+             " \"reals\": [0.5, -2.25e10, 1e-300, !!float .inf, !!float -.Inf],\n"
+             " \"hex\": !!int 0x1F,\n"
+             " \"strings\": [\"\", \"%.31s\", \"%.32s\", \"%.255s\", \"%s\"],\n"
+             " \"empty\": {}, \"small\": {\"a\": 1}, \"large\": {\"a\": 1, \"b\": 2, \"c\": 3, \"d\": 4, \"e\": 5, \"f\": 6, \"g\": 7,\n"
+             "  \"h\": 8, \"i\": 9, \"j\": 10, \"k\": 11, \"l\": 12, \"m\": 13, \"n\": 14, \"o\": 15, \"p\": 16, \"q\": 17},\n"
+             " \"others\": [true, false, null, 2001-12-14, 1.5, !!str 12]}",
+             text, text, text, text);
+    MaybeDocument maybe = load_string((const unsigned char *)input, strlen(input), DUPE_FAIL);
+    assert_int_eq(JUST, maybe.tag);
+
+    return maybe.just;
+}
+
+static void assert_round_trip(DocumentModel *model, emit_function emit, item_reader read)
+{
+    // N.B. - two nodes make two values, one after the other
+    Node *root = model_document_root(model, 0);
+    nodelist *list = make_nodelist();
+    assert_true(nodelist_add(list, root));
+    assert_true(nodelist_add(list, root));
+
+    FILE *file = NULL;
+    Writer *output = open_output(&file);
+    assert_true(emit(list, output));
+    size_t size = 0;
+    uint8_t *encoded = (uint8_t *)read_output(output, file, &size);
+
+    const uint8_t *end = assert_decodes(read, encoded, root);
+    end = assert_decodes(read, end, root);
+    assert_ptr_eq(encoded + size, end);
+
+    free(encoded);
+    nodelist_free(list);
+}
+
+static const uint8_t *assert_decodes(item_reader read, const uint8_t *data, Node *expected)
+{
+    if(ALIAS == node_kind(expected))
+    {
+        return assert_decodes(read, data, alias_target(alias(expected)));
+    }
+
+    struct item item;
+    data = read(data, &item);
+    switch(node_kind(expected))
+    {
+        case SEQUENCE:
+            assert_int_eq(ITEM_ARRAY, item.kind);
+            assert_uint_eq(node_size(expected), item.count);
+            for(size_t i = 0; i < item.count; i++)
+            {
+                data = assert_decodes(read, data, sequence_get(sequence(expected), i));
+            }
+            break;
+        case MAPPING:
+            assert_int_eq(ITEM_MAP, item.kind);
+            assert_uint_eq(node_size(expected), item.count);
+            for(size_t i = 0; i < item.count; i++)
+            {
+                struct item key;
+                data = read(data, &key);
+                assert_int_eq(ITEM_STRING, key.kind);
+                Node *value = mapping_get(mapping(expected), (uint8_t *)key.string, key.count);
+                assert_not_null(value);
+                data = assert_decodes(read, data, value);
+            }
+            break;
+        case SCALAR:
+            assert_decoded_scalar(&item, scalar(expected));
+            break;
+        case DOCUMENT:
+        case ALIAS:
+            ck_abort_msg("unexpected node kind");
+            break;
+    }
+
+    return data;
+}
+
+static void assert_decoded_scalar(const struct item *item, const Scalar *expected)
+{
+    char value[1024] = {0};
+    memcpy(value, scalar_value(expected), node_size(expected));
+    switch(scalar_kind(expected))
+    {
+        case SCALAR_STRING:
+        case SCALAR_TIMESTAMP:
+            assert_int_eq(ITEM_STRING, item->kind);
+            assert_uint_eq(node_size(expected), item->count);
+            assert_int_eq(0, memcmp(value, item->string, item->count));
+            break;
+        case SCALAR_INTEGER:
+            assert_int_eq(ITEM_INTEGER, item->kind);
+            assert_int_eq(strtoll(value, NULL, 0), item->integer);
+            break;
+        case SCALAR_REAL:
+            assert_int_eq(ITEM_REAL, item->kind);
+        {
+            // N.B. - the reals must be identical, bit for bit
+            double real = strtod(value, NULL);
+            if(NULL != strstr(value, "inf") || NULL != strstr(value, "Inf"))
+            {
+                real = '-' == value[0] ? -INFINITY : INFINITY;
+            }
+            assert_int_eq(0, memcmp(&real, &item->real, sizeof(double)));
+            break;
+        }
+        case SCALAR_BOOLEAN:
+            assert_int_eq(ITEM_BOOLEAN, item->kind);
+            assert_int_eq(scalar_boolean_is_true(expected), item->boolean);
+            break;
+        case SCALAR_NULL:
+            assert_int_eq(ITEM_NULL, item->kind);
+            break;
+    }
+}
+
+static const uint8_t *read_msgpack(const uint8_t *data, struct item *item)
+{
+    memset(item, 0, sizeof(struct item));
+    uint8_t type = *data++;
+    size_t width = 0;
+    if(0x80 > type || 0xE0 <= type)
+    {
+        item->kind = ITEM_INTEGER;
+        item->integer = (int8_t)type;
+        return data;
+    }
+    if(0x90 > type || 0xA0 > type)
+    {
+        item->kind = 0x90 > type ? ITEM_MAP : ITEM_ARRAY;
+        item->count = type & 0x0F;
+        return data;
+    }
+    if(0xC0 > type)
+    {
+        item->kind = ITEM_STRING;
+        item->count = type & 0x1F;
+        item->string = data;
+        return data + item->count;
+    }
+    switch(type)
+    {
+        case 0xC0:
+            item->kind = ITEM_NULL;
+            return data;
+        case 0xC2:
+        case 0xC3:
+            item->kind = ITEM_BOOLEAN;
+            item->boolean = 0xC3 == type;
+            return data;
+        case 0xCB:
+        {
+            item->kind = ITEM_REAL;
+            uint64_t bits = read_big_endian(data, 8);
+            memcpy(&item->real, &bits, sizeof(bits));
+            return data + 8;
+        }
+        case 0xCC:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF:
+            width = (size_t)1 << (type - 0xCC);
+            item->kind = ITEM_INTEGER;
+            item->integer = (int64_t)read_big_endian(data, width);
+            return data + width;
+        case 0xD0:
+        case 0xD1:
+        case 0xD2:
+        case 0xD3:
+        {
+            width = (size_t)1 << (type - 0xD0);
+            // N.B. - the value is sign extended from its width
+            unsigned int shift = (unsigned int)(64 - 8 * width);
+            item->kind = ITEM_INTEGER;
+            item->integer = (int64_t)(read_big_endian(data, width) << shift) >> shift;
+            return data + width;
+        }
+        case 0xD9:
+        case 0xDA:
+        case 0xDB:
+            width = (size_t)1 << (type - 0xD9);
+            item->kind = ITEM_STRING;
+            item->count = read_big_endian(data, width);
+            item->string = data + width;
+            return data + width + item->count;
+        case 0xDC:
+        case 0xDD:
+        case 0xDE:
+        case 0xDF:
+            width = 0 == (type & 1) ? 2 : 4;
+            item->kind = 0xDE > type ? ITEM_ARRAY : ITEM_MAP;
+            item->count = read_big_endian(data, width);
+            return data + width;
+        default:
+            ck_abort_msg("unexpected msgpack type 0x%02x", type);
+            return data;
+    }
+}
+
+static const uint8_t *read_cbor(const uint8_t *data, struct item *item)
+{
+    memset(item, 0, sizeof(struct item));
+    uint8_t head = *data++;
+    uint8_t major = head >> 5;
+    uint8_t info = head & 0x1F;
+    if(7 == major)
+    {
+        switch(info)
+        {
+            case 20:
+            case 21:
+                item->kind = ITEM_BOOLEAN;
+                item->boolean = 21 == info;
+                return data;
+            case 22:
+                item->kind = ITEM_NULL;
+                return data;
+            case 27:
+            {
+                item->kind = ITEM_REAL;
+                uint64_t bits = read_big_endian(data, 8);
+                memcpy(&item->real, &bits, sizeof(bits));
+                return data + 8;
+            }
+            default:
+                ck_abort_msg("unexpected cbor simple value %u", info);
+                return data;
+        }
+    }
+
+    uint64_t argument = info;
+    if(24 <= info)
+    {
+        assert_uint_lt(info, 28);
+        size_t width = (size_t)1 << (info - 24);
+        argument = read_big_endian(data, width);
+        data += width;
+    }
+    switch(major)
+    {
+        case 0:
+            item->kind = ITEM_INTEGER;
+            item->integer = (int64_t)argument;
+            break;
+        case 1:
+            item->kind = ITEM_INTEGER;
+            item->integer = -1 - (int64_t)argument;
+            break;
+        case 3:
+            item->kind = ITEM_STRING;
+            item->count = argument;
+            item->string = data;
+            data += argument;
+            break;
+        case 4:
+        case 5:
+            item->kind = 4 == major ? ITEM_ARRAY : ITEM_MAP;
+            item->count = argument;
+            break;
+        default:
+            ck_abort_msg("unexpected cbor major type %u", major);
+            break;
+    }
+
+    return data;
+}
+
+static uint64_t read_big_endian(const uint8_t *data, size_t width)
+{
+    uint64_t result = 0;
+    for(size_t i = 0; i < width; i++)
+    {
+        result = (result << 8) | data[i];
+    }
+
+    return result;
+}
+
+static char *read_output(Writer *output, FILE *file, size_t *size)
+{
+    assert_true(writer_flush(output));
+    writer_free(output);
+
+    return read_contents(file, size);
+}
+
+static char *read_contents(FILE *file, size_t *size)
+{
+    off_t length = lseek(fileno(file), 0, SEEK_END);
+    char *result = calloc(1, (size_t)length + 1);
+    assert_not_null(result);
+    rewind(file);
+    assert_uint_eq((size_t)length, fread(result, 1, (size_t)length, file));
+    fclose(file);
+    if(NULL != size)
+    {
+        *size = (size_t)length;
+    }
+
+    return result;
+}
+
+static char *make_pattern(size_t length)
+{
+    char *result = malloc(length);
+    assert_not_null(result);
+    for(size_t i = 0; i < length; i++)
+    {
+        result[i] = (char)('a' + i % 26);
+    }
+
+    return result;
+}
+
+static char *escape(const char *value, size_t length)
+{
+    FILE *file = NULL;
+    Writer *output = open_output(&file);
+    assert_true(emit_json_string((const uint8_t *)value, length, output));
+
+    return read_output(output, file, NULL);
+}
+
+static char *expected_escape(const char *value, size_t length)
+{
+    char *result = calloc(1, length * 6 + 1);
+    assert_not_null(result);
+    char *cursor = result;
+    for(size_t i = 0; i < length; i++)
+    {
+        unsigned char current = (unsigned char)value[i];
+        if('"' == current || '\\' == current)
+        {
+            *cursor++ = '\\';
+            *cursor++ = (char)current;
+        }
+        else if('\n' == current)
+        {
+            cursor = stpcpy(cursor, "\\n");
+        }
+        else if(0x20 > current)
+        {
+            cursor += sprintf(cursor, "\\u%04x", current);
+        }
+        else
+        {
+            *cursor++ = (char)current;
+        }
+    }
+
+    return result;
+}
+
+Suite *emit_suite(void)
+{
+    TCase *json_case = tcase_create("json");
+    tcase_add_test(json_case, escaped_strings);
+    tcase_add_test(json_case, escaped_positions);
+
+    TCase *ndjson_case = tcase_create("ndjson");
+    tcase_add_test(ndjson_case, ndjson_lines);
+
+    TCase *binary_case = tcase_create("binary");
+    tcase_add_test(binary_case, msgpack_round_trip);
+    tcase_add_test(binary_case, cbor_round_trip);
+
+    TCase *raw_case = tcase_create("raw");
+    tcase_add_test(raw_case, raw_from_source);
+    tcase_add_test(raw_case, raw_without_source);
+
+    TCase *writer_case = tcase_create("writer");
+    tcase_add_test(writer_case, buffered_writes);
+    tcase_add_test(writer_case, write_through);
+    tcase_add_test(writer_case, failed_writes);
+
+    TCase *frame_case = tcase_create("frame");
+    tcase_add_test(frame_case, framed_responses);
+    tcase_add_test(frame_case, copied_frames);
+
+    Suite *suite = suite_create("Emit");
+    suite_add_tcase(suite, json_case);
+    suite_add_tcase(suite, ndjson_case);
+    suite_add_tcase(suite, binary_case);
+    suite_add_tcase(suite, raw_case);
+    suite_add_tcase(suite, writer_case);
+    suite_add_tcase(suite, frame_case);
+
+    return suite;
+}
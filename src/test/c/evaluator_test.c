@@ -87,6 +87,11 @@ static void invoice_setup(void)
     model_fixture = load_document("invoice.yaml");
 }
 
+static void stream_setup(void)
+{
+    model_fixture = load_document("stream.yaml");
+}
+
 static void evaluator_teardown(void)
 {
     model_free(model_fixture);
@@ -227,7 +232,32 @@ START_TEST (empty_path)
 }
 END_TEST
 
-static nodelist *evaluate_expression(const char *expression)
+START_TEST (compiled_program)
+{
+    const char *expression = "$..book[1:3].author";
+    parser_context *parser = make_parser((const uint8_t *)expression, strlen(expression));
+    assert_not_null(parser);
+    jsonpath *path = parse(parser);
+    assert_not_null(path);
+    parser_free(parser);
+
+    Program *program = compile_path(path);
+    assert_not_null(program);
+    assert_uint_eq(5, program->length);
+    assert_int_eq(OP_ROOT, program->instructions[0].opcode);
+    assert_int_eq(OP_RECURSE_NAME, program->instructions[1].opcode);
+    assert_uint_eq(4, program->instructions[1].operand.name.length);
+    assert_int_eq(OP_SLICE, program->instructions[2].opcode);
+    assert_int_eq(OP_NAME, program->instructions[3].opcode);
+    assert_uint_eq(6, program->instructions[3].operand.name.length);
+    assert_int_eq(OP_HALT, program->instructions[4].opcode);
+
+    program_free(program);
+    path_free(path);
+}
+END_TEST
+
+static nodelist *evaluate_expression_with_threads(const char *expression, size_t limit, size_t threads)
 {
     parser_context *parser = make_parser((const uint8_t *)expression, strlen(expression));
     assert_not_null(parser);
@@ -238,7 +268,7 @@ static nodelist *evaluate_expression(const char *expression)
     parser_free(parser);
 
     reset_errno();
-    MaybeNodelist maybe = evaluate(model_fixture, path);
+    MaybeNodelist maybe = evaluate_with_threads(model_fixture, path, limit, threads);
     assert_noerr();
     assert_int_eq(JUST, maybe.tag);
     assert_not_null(maybe.just);
@@ -246,6 +276,16 @@ static nodelist *evaluate_expression(const char *expression)
     return maybe.just;
 }
 
+static nodelist *evaluate_expression_with_limit(const char *expression, size_t limit)
+{
+    return evaluate_expression_with_threads(expression, limit, 1);
+}
+
+static nodelist *evaluate_expression(const char *expression)
+{
+    return evaluate_expression_with_limit(expression, 0);
+}
+
 START_TEST (dollar_only)
 {
     nodelist *list = evaluate_expression("$");
@@ -481,6 +521,16 @@ START_TEST (recursive_subscript_predicate)
 }
 END_TEST
 
+START_TEST (subscript_predicate_past_end)
+{
+    nodelist *list = evaluate_expression("$.store.book[5]");
+
+    assert_nodelist_length(list, 0);
+
+    nodelist_free(list);
+}
+END_TEST
+
 START_TEST (slice_predicate)
 {
     nodelist *list = evaluate_expression("$.store.book[:2]");
@@ -753,6 +803,638 @@ START_TEST (recursive_wildcard_alias)
 }
 END_TEST
 
+START_TEST (limit_stops_early)
+{
+    nodelist *all = evaluate_expression("$..author");
+    nodelist *list = evaluate_expression_with_limit("$..author", 2);
+
+    assert_nodelist_length(all, 5);
+    assert_nodelist_length(list, 2);
+    assert_ptr_eq(nodelist_get(all, 0), nodelist_get(list, 0));
+    assert_ptr_eq(nodelist_get(all, 1), nodelist_get(list, 1));
+
+    nodelist_free(all);
+    nodelist_free(list);
+}
+END_TEST
+
+START_TEST (limit_after_predicate)
+{
+    nodelist *list = evaluate_expression_with_limit("$.store.book[1:4].title", 1);
+
+    assert_nodelist_length(list, 1);
+    assert_scalar_value(nodelist_get(list, 0), "Sword of Honour");
+
+    nodelist_free(list);
+}
+END_TEST
+
+START_TEST (limit_over_matches)
+{
+    nodelist *list = evaluate_expression_with_limit("$..author", 100);
+
+    assert_nodelist_length(list, 5);
+
+    nodelist_free(list);
+}
+END_TEST
+
+START_TEST (limit_without_matches)
+{
+    nodelist *list = evaluate_expression_with_limit("$..nothing", 1);
+
+    assert_nodelist_length(list, 0);
+
+    nodelist_free(list);
+}
+END_TEST
+
+static void assert_same_nodes(nodelist *expected, nodelist *actual)
+{
+    assert_nodelist_length(actual, nodelist_length(expected));
+    for(size_t i = 0; i < nodelist_length(expected); i++)
+    {
+        assert_ptr_eq(nodelist_get(expected, i), nodelist_get(actual, i));
+    }
+}
+
+START_TEST (name_index)
+{
+    static const char * const paths[] =
+    {
+        "$..author",
+        "$..price",
+        "$.store..price",
+        "$.store.book[*]..price",
+        "$..book[1:3]..title",
+        "$..nothing",
+    };
+    static const size_t count = sizeof(paths) / sizeof(paths[0]);
+
+    assert_null(model_name_index(model_fixture));
+    nodelist *walked[count];
+    for(size_t i = 0; i < count; i++)
+    {
+        walked[i] = evaluate_expression(paths[i]);
+    }
+
+    assert_true(model_use_name_index(model_fixture, true));
+    assert_not_null(model_name_index(model_fixture));
+    for(size_t i = 0; i < count; i++)
+    {
+        nodelist *indexed = evaluate_expression(paths[i]);
+        assert_same_nodes(walked[i], indexed);
+        nodelist_free(indexed);
+        nodelist_free(walked[i]);
+    }
+
+    nodelist *list = evaluate_expression_with_limit("$..price", 2);
+    assert_nodelist_length(list, 2);
+    assert_scalar_value(nodelist_get(list, 0), "8.95");
+    nodelist_free(list);
+}
+END_TEST
+
+START_TEST (name_index_with_aliases)
+{
+    nodelist *walked = evaluate_expression("$..city");
+    assert_nodelist_length(walked, 2);
+
+    assert_true(model_use_name_index(model_fixture, true));
+    assert_null(model_name_index(model_fixture));
+
+    nodelist *list = evaluate_expression("$..city");
+    assert_same_nodes(walked, list);
+
+    nodelist_free(walked);
+    nodelist_free(list);
+}
+END_TEST
+
+static void assert_threads_agree(const char * const *paths, size_t count)
+{
+    static const size_t threads[] = {2, 3, 4, 32};
+
+    for(size_t i = 0; i < count; i++)
+    {
+        nodelist *expected = evaluate_expression(paths[i]);
+        for(size_t j = 0; j < sizeof(threads) / sizeof(threads[0]); j++)
+        {
+            nodelist *actual = evaluate_expression_with_threads(paths[i], 0, threads[j]);
+            assert_same_nodes(expected, actual);
+            nodelist_free(actual);
+        }
+        nodelist_free(expected);
+    }
+}
+
+START_TEST (parallel_recursion)
+{
+    static const char * const paths[] =
+    {
+        "$..*",
+        "$..price",
+        "$.store..price",
+        "$..book[*]..title",
+        "$..number()",
+        "$..*..*",
+        "$.store.book[*]..price",
+        "$..nothing",
+    };
+    assert_threads_agree(paths, sizeof(paths) / sizeof(paths[0]));
+
+    nodelist *list = evaluate_expression_with_threads("$..price", 2, 4);
+    assert_nodelist_length(list, 2);
+    assert_scalar_value(nodelist_get(list, 0), "8.95");
+    nodelist_free(list);
+}
+END_TEST
+
+START_TEST (parallel_recursion_with_aliases)
+{
+    static const char * const paths[] =
+    {
+        "$..*",
+        "$..city",
+        "$..string()",
+    };
+    assert_threads_agree(paths, sizeof(paths) / sizeof(paths[0]));
+}
+END_TEST
+
+static nodelist *evaluate_expression_with_options(const char *expression, const evaluator_options *options)
+{
+    parser_context *parser = make_parser((const uint8_t *)expression, strlen(expression));
+    assert_not_null(parser);
+    jsonpath *path = parse(parser);
+    assert_not_null(path);
+    parser_free(parser);
+
+    reset_errno();
+    MaybeNodelist maybe = evaluate_with_options(model_fixture, path, options);
+    assert_noerr();
+    assert_int_eq(JUST, maybe.tag);
+    path_free(path);
+    return maybe.just;
+}
+
+START_TEST (every_document)
+{
+    assert_uint_eq(4, model_size(model_fixture));
+
+    nodelist *list = evaluate_expression("$.level");
+    assert_nodelist_length(list, 4);
+    assert_scalar_value(nodelist_get(list, 0), "info");
+    assert_scalar_value(nodelist_get(list, 1), "warn");
+    assert_scalar_value(nodelist_get(list, 2), "info");
+    assert_scalar_value(nodelist_get(list, 3), "error");
+    nodelist_free(list);
+
+    list = evaluate_expression("$..status");
+    assert_nodelist_length(list, 2);
+    assert_scalar_value(nodelist_get(list, 0), "200");
+    assert_scalar_value(nodelist_get(list, 1), "404");
+    nodelist_free(list);
+
+    list = evaluate_expression_with_limit("$.host", 3);
+    assert_nodelist_length(list, 3);
+    assert_scalar_value(nodelist_get(list, 2), "alpha");
+    nodelist_free(list);
+}
+END_TEST
+
+START_TEST (document_range)
+{
+    evaluator_options options = EVALUATOR_DEFAULTS;
+    options.first_document = 1;
+    options.last_document = 3;
+    nodelist *list = evaluate_expression_with_options("$.message", &options);
+    assert_nodelist_length(list, 2);
+    assert_scalar_value(nodelist_get(list, 0), "disk nearly full");
+    assert_scalar_value(nodelist_get(list, 1), "request served");
+    nodelist_free(list);
+
+    options.first_document = 3;
+    options.last_document = 100;
+    list = evaluate_expression_with_options("$.level", &options);
+    assert_nodelist_length(list, 1);
+    assert_scalar_value(nodelist_get(list, 0), "error");
+    nodelist_free(list);
+
+    options.first_document = 4;
+    options.last_document = SIZE_MAX;
+    list = evaluate_expression_with_options("$.level", &options);
+    assert_nodelist_length(list, 0);
+    nodelist_free(list);
+}
+END_TEST
+
+START_TEST (parallel_documents)
+{
+    static const char * const paths[] =
+    {
+        "$.level",
+        "$..*",
+        "$..path",
+        "$.request.status",
+        "$.tags[1]",
+    };
+    assert_threads_agree(paths, sizeof(paths) / sizeof(paths[0]));
+
+    evaluator_options options = EVALUATOR_DEFAULTS;
+    options.threads = 3;
+    options.first_document = 1;
+    nodelist *list = evaluate_expression_with_options("$.host", &options);
+    assert_nodelist_length(list, 3);
+    assert_scalar_value(nodelist_get(list, 0), "beta");
+    assert_scalar_value(nodelist_get(list, 1), "alpha");
+    assert_scalar_value(nodelist_get(list, 2), "gamma");
+    nodelist_free(list);
+}
+END_TEST
+
+struct stream_expectation
+{
+    nodelist *expected;
+    size_t    index;
+    size_t    limit;
+};
+
+static bool match_streamed_node(Node *each, void *context)
+{
+    struct stream_expectation *expectation = (struct stream_expectation *)context;
+    assert_uint_lt(expectation->index, nodelist_length(expectation->expected));
+    Node *expected = nodelist_get(expectation->expected, expectation->index++);
+    assert_true(node_equals(expected, each));
+
+    return expectation->index != expectation->limit;
+}
+
+static bool count_streamed_node(Node *each, void *context)
+{
+    assert_not_null(each);
+    (*(size_t *)context)++;
+    return true;
+}
+
+static jsonpath *parse_test_path(const char *expression)
+{
+    parser_context *parser = make_parser((const uint8_t *)expression, strlen(expression));
+    assert_not_null(parser);
+    jsonpath *path = parse(parser);
+    assert_not_null(path);
+    assert_int_eq(JSONPATH_SUCCESS, parser_status(parser));
+    parser_free(parser);
+
+    return path;
+}
+
+static MaybeCount stream_expression(const char *filename, const char *expression, const stream_options *options, stream_callback callback, void *context)
+{
+    jsonpath *path = parse_test_path(expression);
+    FILE *input = fopen(filename, "r");
+    assert_not_null(input);
+
+    reset_errno();
+    MaybeCount maybe = stream_file(input, path, options, callback, context);
+    assert_int_eq(0, fclose(input));
+    path_free(path);
+
+    return maybe;
+}
+
+static void assert_stream_agrees(const char *filename, const char *expression, size_t limit)
+{
+    nodelist *expected = evaluate_expression_with_limit(expression, limit);
+    struct stream_expectation expectation = {expected, 0, limit};
+
+    stream_options options = STREAM_DEFAULTS;
+    MaybeCount maybe = stream_expression(filename, expression, &options, match_streamed_node, &expectation);
+    assert_noerr();
+    assert_int_eq(JUST, maybe.tag);
+    assert_uint_eq(nodelist_length(expected), maybe.just);
+    assert_uint_eq(nodelist_length(expected), expectation.index);
+
+    nodelist_free(expected);
+}
+
+START_TEST (streamed_paths)
+{
+    static const char * const paths[] =
+    {
+        "$",
+        "$.store",
+        "$.store.book[*].author",
+        "$.store.book[1:]",
+        "$.store.book[0:4:2].title",
+        "$.store.book[2]",
+        "$.store.bicycle.*",
+        "$.store.*.number()",
+        "$..author",
+        "$..book[1:3]..title",
+        "$..price",
+        "$.store..isbn",
+        "$..nothing",
+    };
+    for(size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++)
+    {
+        assert_stream_agrees("inventory.json", paths[i], 0);
+    }
+    assert_stream_agrees("inventory.json", "$..price", 2);
+    assert_stream_agrees("inventory.json", "$.store.book[*]", 1);
+    assert_stream_agrees("inventory.json", "$..*", 0);
+    assert_stream_agrees("inventory.json", "$..*[*]", 0);
+    assert_stream_agrees("inventory.json", "$..*.*", 0);
+    assert_stream_agrees("inventory.json", "$..book..*", 3);
+}
+END_TEST
+
+START_TEST (streamed_aliases)
+{
+    static const char * const paths[] =
+    {
+        "$.bill-to",
+        "$.ship-to.*",
+        "$..city",
+        "$..address.lines",
+        "$.*.address.string()",
+    };
+    for(size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++)
+    {
+        assert_stream_agrees("invoice.yaml", paths[i], 0);
+    }
+    assert_stream_agrees("invoice.yaml", "$..*", 0);
+}
+END_TEST
+
+START_TEST (streamed_documents)
+{
+    assert_stream_agrees("stream.yaml", "$.level", 0);
+    assert_stream_agrees("stream.yaml", "$..status", 0);
+    assert_stream_agrees("stream.yaml", "$.host", 3);
+
+    size_t count = 0;
+    stream_options options = STREAM_DEFAULTS;
+    options.first_document = 1;
+    options.last_document = 3;
+    MaybeCount maybe = stream_expression("stream.yaml", "$.message", &options, count_streamed_node, &count);
+    assert_int_eq(JUST, maybe.tag);
+    assert_uint_eq(2, maybe.just);
+    assert_uint_eq(2, count);
+
+    count = 0;
+    options.first_document = 4;
+    options.last_document = SIZE_MAX;
+    maybe = stream_expression("stream.yaml", "$.level", &options, count_streamed_node, &count);
+    assert_int_eq(JUST, maybe.tag);
+    assert_uint_eq(0, maybe.just);
+    assert_uint_eq(0, count);
+}
+END_TEST
+
+START_TEST (unstreamable_paths)
+{
+    static const char * const streamable[] =
+    {
+        "$",
+        "$..*",
+        "$.a[0:2].b",
+        "$.a[*]..object()",
+    };
+    for(size_t i = 0; i < sizeof(streamable) / sizeof(streamable[0]); i++)
+    {
+        jsonpath *path = parse_test_path(streamable[i]);
+        assert_true(path_is_streamable(path));
+        path_free(path);
+    }
+
+    static const char * const unstreamable[] =
+    {
+        "$.a[-1:]",
+        "$.a[::-1]",
+        "a.b",
+    };
+    for(size_t i = 0; i < sizeof(unstreamable) / sizeof(unstreamable[0]); i++)
+    {
+        jsonpath *path = parse_test_path(unstreamable[i]);
+        assert_false(path_is_streamable(path));
+        path_free(path);
+    }
+    assert_false(path_is_streamable(NULL));
+
+    size_t count = 0;
+    stream_options options = STREAM_DEFAULTS;
+    MaybeCount maybe = stream_expression("inventory.json", "$.store.book[-1:]", &options, count_streamed_node, &count);
+    assert_int_eq(NOTHING, maybe.tag);
+    assert_int_eq(ERR_UNSTREAMABLE_PATH, maybe.nothing.code);
+    assert_not_null(maybe.nothing.message);
+    free(maybe.nothing.message);
+    assert_uint_eq(0, count);
+}
+END_TEST
+
+static void parse_test_paths(const char * const *expressions, size_t count, jsonpath **paths)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        paths[i] = parse_test_path(expressions[i]);
+    }
+}
+
+static void free_test_paths(jsonpath **paths, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        path_free(paths[i]);
+    }
+}
+
+static void assert_batch_agrees(const char * const *expressions, size_t count, size_t limit)
+{
+    jsonpath *paths[count];
+    parse_test_paths(expressions, count, paths);
+
+    evaluator_options options = EVALUATOR_DEFAULTS;
+    options.limit = limit;
+    reset_errno();
+    MaybeBatch maybe = evaluate_batch(model_fixture, paths, count, &options);
+    assert_noerr();
+    assert_int_eq(JUST, maybe.tag);
+    assert_uint_eq(count, maybe.just->count);
+
+    for(size_t i = 0; i < count; i++)
+    {
+        nodelist *expected = evaluate_expression_with_limit(expressions[i], limit);
+        assert_same_nodes(expected, maybe.just->results[i]);
+        nodelist_free(expected);
+    }
+
+    batch_free(maybe.just);
+    free_test_paths(paths, count);
+}
+
+START_TEST (compiled_batch)
+{
+    static const char * const expressions[] =
+    {
+        "$.store.book[*].author",
+        "$.store.book[*].title",
+        "$.store.book[*].author",
+        "$.store.bicycle",
+    };
+    static const size_t count = sizeof(expressions) / sizeof(expressions[0]);
+    jsonpath *paths[count];
+    parse_test_paths(expressions, count, paths);
+
+    Program *program = compile_batch(paths, count);
+    assert_not_null(program);
+    // N.B. - $ .store (.book [*] (.author (halt halt) .title halt) .bicycle halt)
+    assert_uint_eq(11, program->length);
+    assert_int_eq(OP_ROOT, program->instructions[0].opcode);
+    assert_uint_eq(1, program->instructions[0].branches);
+    assert_int_eq(OP_NAME, program->instructions[1].opcode);
+    assert_uint_eq(2, program->instructions[1].branches);
+    assert_int_eq(OP_ALL, program->instructions[3].opcode);
+    assert_uint_eq(2, program->instructions[3].branches);
+    assert_int_eq(OP_NAME, program->instructions[4].opcode);
+    assert_uint_eq(2, program->instructions[4].branches);
+    assert_int_eq(OP_HALT, program->instructions[5].opcode);
+    assert_uint_eq(0, program->instructions[5].operand.query);
+    assert_int_eq(OP_HALT, program->instructions[6].opcode);
+    assert_uint_eq(2, program->instructions[6].operand.query);
+    assert_int_eq(OP_NAME, program->instructions[7].opcode);
+    assert_uint_eq(5, program->instructions[7].operand.name.length);
+    assert_int_eq(OP_HALT, program->instructions[8].opcode);
+    assert_uint_eq(1, program->instructions[8].operand.query);
+    assert_int_eq(OP_NAME, program->instructions[9].opcode);
+    assert_uint_eq(7, program->instructions[9].operand.name.length);
+    assert_uint_eq(2, program->instructions[9].extent);
+    assert_int_eq(OP_HALT, program->instructions[10].opcode);
+    assert_uint_eq(3, program->instructions[10].operand.query);
+
+    program_free(program);
+    free_test_paths(paths, count);
+}
+END_TEST
+
+START_TEST (batch_paths)
+{
+    static const char * const expressions[] =
+    {
+        "$",
+        "$.store.book[*].author",
+        "$.store.book[1:3].price",
+        "$.store.book[1:3].title",
+        "$.store.book[1]",
+        "$.store.book[0:4:2].title",
+        "$.store.*",
+        "$.store.*.price",
+        "$..price",
+        "$.store..price",
+        "$..book[1:3]..title",
+        "$..*",
+        "$.store.book[*].author",
+        "$.store.object()",
+        "$.store.book[*].isbn.string()",
+        "$.nothing.at.all",
+    };
+    assert_batch_agrees(expressions, sizeof(expressions) / sizeof(expressions[0]), 0);
+    assert_batch_agrees(expressions, sizeof(expressions) / sizeof(expressions[0]), 2);
+}
+END_TEST
+
+START_TEST (batch_aliases)
+{
+    static const char * const expressions[] =
+    {
+        "$.bill-to",
+        "$.ship-to.*",
+        "$..city",
+        "$..address.lines",
+        "$.*.address.string()",
+        "$..*",
+    };
+    assert_batch_agrees(expressions, sizeof(expressions) / sizeof(expressions[0]), 0);
+}
+END_TEST
+
+START_TEST (bad_batch)
+{
+    jsonpath *paths[] = {parse_test_path("$.store"), parse_test_path("store.book")};
+
+    reset_errno();
+    MaybeBatch maybe = evaluate_batch(model_fixture, paths, 2, &EVALUATOR_DEFAULTS);
+    assert_errno(EINVAL);
+    assert_int_eq(NOTHING, maybe.tag);
+    assert_int_eq(ERR_PATH_IS_NOT_ABSOLUTE, maybe.nothing.code);
+
+    reset_errno();
+    maybe = evaluate_batch(model_fixture, paths, 0, &EVALUATOR_DEFAULTS);
+    assert_noerr();
+    assert_int_eq(JUST, maybe.tag);
+    assert_uint_eq(0, maybe.just->count);
+    batch_free(maybe.just);
+
+    free_test_paths(paths, 2);
+}
+END_TEST
+
+START_TEST (result_cache)
+{
+    reset_errno();
+    ResultCache *cache = make_result_cache(7);
+    assert_noerr();
+    assert_not_null(cache);
+
+    evaluator_options options = EVALUATOR_DEFAULTS;
+    jsonpath *path = parse_test_path("$.store.book[*].price");
+    nodelist *prices = evaluate_expression("$.store.book[*].price");
+    assert_null(result_cache_get(cache, model_fixture, path, &options));
+    assert_true(result_cache_put(cache, model_fixture, path, &options, prices));
+    assert_uint_eq(6, result_cache_cost(cache));
+
+    // N.B. - the same path spelled differently
+    jsonpath *spaced = parse_test_path("$.'store'.book[ * ].price");
+    assert_ptr_eq(prices, result_cache_get(cache, model_fixture, spaced, &options));
+    assert_uint_eq(1, result_cache_hits(cache));
+
+    options.limit = 2;
+    assert_null(result_cache_get(cache, model_fixture, path, &options));
+    options.limit = 0;
+    options.first_document = 1;
+    assert_null(result_cache_get(cache, model_fixture, path, &options));
+    assert_uint_eq(3, result_cache_misses(cache));
+    options.first_document = 0;
+
+    // N.B. - the least recently used result is evicted to make room
+    jsonpath *bicycle = parse_test_path("$.store.bicycle");
+    nodelist *bicycles = evaluate_expression("$.store.bicycle");
+    assert_true(result_cache_put(cache, model_fixture, bicycle, &options, bicycles));
+    assert_uint_eq(1, result_cache_size(cache));
+    assert_uint_eq(1, result_cache_evictions(cache));
+    assert_null(result_cache_get(cache, model_fixture, path, &options));
+    assert_ptr_eq(bicycles, result_cache_get(cache, model_fixture, bicycle, &options));
+
+    nodelist *books = evaluate_expression("$..book[*]");
+    jsonpath *all_books = parse_test_path("$..book[*]");
+    result_cache_resize(cache, 4);
+    assert_false(result_cache_put(cache, model_fixture, all_books, &options, books));
+    nodelist_free(books);
+
+    // N.B. - the results of another model are never returned
+    DocumentModel *other = load_document("inventory.json");
+    assert_null(result_cache_get(cache, other, bicycle, &options));
+    assert_uint_eq(0, result_cache_size(cache));
+    model_free(other);
+
+    result_cache_free(cache);
+    path_free(path);
+    path_free(spaced);
+    path_free(bicycle);
+    path_free(all_books);
+}
+END_TEST
+
 Suite *evaluator_suite(void)
 {
     TCase *bad_input_case = tcase_create("bad input");
@@ -772,6 +1454,7 @@ Suite *evaluator_suite(void)
     tcase_add_test(basic_case, object_test);
     tcase_add_test(basic_case, array_test);
     tcase_add_test(basic_case, number_test);
+    tcase_add_test(basic_case, compiled_program);
 
     TCase *predicate_case = tcase_create("predicate");
     tcase_add_unchecked_fixture(predicate_case, inventory_setup, evaluator_teardown);
@@ -781,6 +1464,7 @@ Suite *evaluator_suite(void)
     tcase_add_test(predicate_case, subscript_predicate);
     tcase_add_test(predicate_case, slice_predicate);
     tcase_add_test(predicate_case, subscript_predicate);
+    tcase_add_test(predicate_case, subscript_predicate_past_end);
     tcase_add_test(predicate_case, slice_predicate_with_step);
     tcase_add_test(predicate_case, slice_predicate_negative_from);
     tcase_add_test(predicate_case, slice_predicate_copy);
@@ -804,12 +1488,80 @@ Suite *evaluator_suite(void)
     tcase_add_test(alias_case, wildcard_predicate_alias);
     tcase_add_test(alias_case, recursive_wildcard_alias);
 
+    TCase *limit_case = tcase_create("limit");
+    tcase_add_unchecked_fixture(limit_case, inventory_setup, evaluator_teardown);
+    tcase_add_test(limit_case, limit_stops_early);
+    tcase_add_test(limit_case, limit_after_predicate);
+    tcase_add_test(limit_case, limit_over_matches);
+    tcase_add_test(limit_case, limit_without_matches);
+
+    TCase *index_case = tcase_create("index");
+    tcase_add_checked_fixture(index_case, inventory_setup, evaluator_teardown);
+    tcase_add_test(index_case, name_index);
+
+    TCase *index_alias_case = tcase_create("index alias");
+    tcase_add_checked_fixture(index_alias_case, invoice_setup, evaluator_teardown);
+    tcase_add_test(index_alias_case, name_index_with_aliases);
+
     Suite *evaluator = suite_create("Evaluator");
+    TCase *parallel_case = tcase_create("parallel");
+    tcase_add_unchecked_fixture(parallel_case, inventory_setup, evaluator_teardown);
+    tcase_add_test(parallel_case, parallel_recursion);
+
+    TCase *parallel_alias_case = tcase_create("parallel alias");
+    tcase_add_unchecked_fixture(parallel_alias_case, invoice_setup, evaluator_teardown);
+    tcase_add_test(parallel_alias_case, parallel_recursion_with_aliases);
+
+    TCase *stream_case = tcase_create("stream");
+    tcase_add_unchecked_fixture(stream_case, stream_setup, evaluator_teardown);
+    tcase_add_test(stream_case, every_document);
+    tcase_add_test(stream_case, document_range);
+    tcase_add_test(stream_case, parallel_documents);
+
+    TCase *streamed_case = tcase_create("streamed");
+    tcase_add_checked_fixture(streamed_case, inventory_setup, evaluator_teardown);
+    tcase_add_test(streamed_case, streamed_paths);
+    tcase_add_test(streamed_case, unstreamable_paths);
+
+    TCase *streamed_alias_case = tcase_create("streamed alias");
+    tcase_add_checked_fixture(streamed_alias_case, invoice_setup, evaluator_teardown);
+    tcase_add_test(streamed_alias_case, streamed_aliases);
+
+    TCase *streamed_documents_case = tcase_create("streamed documents");
+    tcase_add_checked_fixture(streamed_documents_case, stream_setup, evaluator_teardown);
+    tcase_add_test(streamed_documents_case, streamed_documents);
+
+    TCase *batch_case = tcase_create("batch");
+    tcase_add_checked_fixture(batch_case, inventory_setup, evaluator_teardown);
+    tcase_add_test(batch_case, compiled_batch);
+    tcase_add_test(batch_case, batch_paths);
+    tcase_add_test(batch_case, bad_batch);
+
+    TCase *cache_case = tcase_create("cache");
+    tcase_add_checked_fixture(cache_case, inventory_setup, evaluator_teardown);
+    tcase_add_test(cache_case, result_cache);
+
+    TCase *batch_alias_case = tcase_create("batch alias");
+    tcase_add_checked_fixture(batch_alias_case, invoice_setup, evaluator_teardown);
+    tcase_add_test(batch_alias_case, batch_aliases);
+
     suite_add_tcase(evaluator, bad_input_case);
     suite_add_tcase(evaluator, basic_case);
     suite_add_tcase(evaluator, predicate_case);
     suite_add_tcase(evaluator, recursive_case);
     suite_add_tcase(evaluator, alias_case);
+    suite_add_tcase(evaluator, limit_case);
+    suite_add_tcase(evaluator, index_case);
+    suite_add_tcase(evaluator, index_alias_case);
+    suite_add_tcase(evaluator, parallel_case);
+    suite_add_tcase(evaluator, parallel_alias_case);
+    suite_add_tcase(evaluator, stream_case);
+    suite_add_tcase(evaluator, streamed_case);
+    suite_add_tcase(evaluator, streamed_alias_case);
+    suite_add_tcase(evaluator, streamed_documents_case);
+    suite_add_tcase(evaluator, batch_case);
+    suite_add_tcase(evaluator, batch_alias_case);
+    suite_add_tcase(evaluator, cache_case);
 
     return evaluator;
 }
@@ -0,0 +1,360 @@
+/*
+ * 金棒 (kanabō)
+ * Copyright (c) 2012 Kevin Birch <kmb@pobox.com>.  All rights reserved.
+ * 
+ * 金棒 is a tool to bludgeon YAML and JSON files from the shell: the strong
+ * made stronger.
+ *
+ * For more information, consult the README file in the project root.
+ *
+ * Distributed under an [MIT-style][license] license.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal with
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimers in the documentation and/or
+ *   other materials provided with the distribution.
+ * - Neither the names of the copyright holders, nor the names of the authors, nor
+ *   the names of other contributors may be used to endorse or promote products
+ *   derived from this Software without specific prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE SOFTWARE.
+ *
+ * [license]: http://www.opensource.org/licenses/ncsa
+ */
+
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+#include "hashtable.h"
+#include "test.h"
+
+static const size_t NAME_SIZE = 32;
+
+struct order_context_s
+{
+    const char *names;
+    size_t      next;
+    size_t      step;
+};
+
+typedef struct order_context_s order_context;
+
+static char *make_names(size_t count);
+static Hashtable *make_table(void);
+static bool check_order(void *key, void *value, void *context);
+static bool stop_iteration(void *key, void *value, void *context);
+static bool match_prefix(const void *key, const void *probe);
+
+#define name_at(NAMES, INDEX) ((NAMES) + (INDEX) * NAME_SIZE)
+
+static char *make_names(size_t count)
+{
+    char *names = calloc(count, NAME_SIZE);
+    ck_assert_msg(NULL != names, "out of memory");
+    for(size_t i = 0; i < count; i++)
+    {
+        snprintf(name_at(names, i), NAME_SIZE, "key-%zu", i);
+    }
+    return names;
+}
+
+static Hashtable *make_table(void)
+{
+    reset_errno();
+    Hashtable *table = make_hashtable_with_function(string_comparitor, shift_add_xor_string_hash);
+    assert_not_null(table);
+    assert_noerr();
+    return table;
+}
+
+static bool check_order(void *key, void *value, void *context)
+{
+    order_context *order = (order_context *)context;
+    const char *expected = name_at(order->names, order->next);
+    ck_assert_str_eq(expected, key);
+    ck_assert_str_eq(expected, value);
+    order->next += order->step;
+    return true;
+}
+
+static bool stop_iteration(void *key __attribute__((unused)), void *value __attribute__((unused)), void *context)
+{
+    size_t *count = (size_t *)context;
+    return 0 != --(*count);
+}
+
+static bool match_prefix(const void *key, const void *probe)
+{
+    return 0 == strncmp((const char *)key, (const char *)probe, strlen((const char *)key));
+}
+
+START_TEST (bad_input)
+{
+    reset_errno();
+    assert_null(make_hashtable(NULL));
+    assert_errno(EINVAL);
+
+    reset_errno();
+    assert_null(make_hashtable_with_capacity_factor(string_comparitor, 8, 1.5f));
+    assert_errno(EINVAL);
+
+    Hashtable *table = make_table();
+
+    reset_errno();
+    assert_null(hashtable_put(table, NULL, "value"));
+    assert_errno(EINVAL);
+
+    reset_errno();
+    assert_null(hashtable_get(table, NULL));
+    assert_errno(EINVAL);
+
+    reset_errno();
+    assert_null(hashtable_remove(NULL, "key"));
+    assert_errno(EINVAL);
+
+    hashtable_set_immutable(table);
+    reset_errno();
+    assert_null(hashtable_put(table, "key", "value"));
+    assert_errno(EINVAL);
+    assert_true(hashtable_is_empty(table));
+
+    hashtable_free(table);
+}
+END_TEST
+
+START_TEST (put_get)
+{
+    Hashtable *table = make_table();
+    char first[] = "key", second[] = "key";
+
+    reset_errno();
+    assert_null(hashtable_put(table, first, "one"));
+    assert_noerr();
+    assert_uint_eq(1, hashtable_size(table));
+    assert_true(hashtable_contains(table, "key"));
+    assert_false(hashtable_contains(table, "other"));
+    ck_assert_str_eq("one", hashtable_get(table, "key"));
+    assert_null(hashtable_get(table, "other"));
+
+    // N.B. - replacing a value keeps the original key
+    ck_assert_str_eq("one", hashtable_put(table, second, "two"));
+    assert_uint_eq(1, hashtable_size(table));
+    ck_assert_str_eq("two", hashtable_get(table, "key"));
+    size_t count = 1;
+    hashtable_iterate(table, stop_iteration, &count);
+
+    Hashtable *copy = hashtable_copy(table);
+    assert_not_null(copy);
+    assert_true(hashtable_equals(table, copy, string_comparitor));
+    hashtable_put(copy, "another", "three");
+    assert_false(hashtable_equals(table, copy, string_comparitor));
+
+    hashtable_free(copy);
+    hashtable_free(table);
+}
+END_TEST
+
+START_TEST (probe)
+{
+    Hashtable *table = make_table();
+    hashtable_put(table, "key", "value");
+
+    const char *buffer = "key and more";
+    hashcode hash = shift_add_xor_string_buffer_hash((const uint8_t *)buffer, 3);
+    assert_true(hashtable_contains_probe(table, hash, match_prefix, buffer));
+    ck_assert_str_eq("value", hashtable_get_probe(table, hash, match_prefix, buffer));
+
+    hash = shift_add_xor_string_buffer_hash((const uint8_t *)buffer, 4);
+    assert_null(hashtable_get_probe(table, hash, match_prefix, buffer));
+
+    hashtable_free(table);
+}
+END_TEST
+
+START_TEST (growth)
+{
+    size_t count = 100000;
+    char *names = make_names(count);
+    Hashtable *table = make_table();
+
+    for(size_t i = 0; i < count; i++)
+    {
+        reset_errno();
+        assert_null(hashtable_put(table, name_at(names, i), name_at(names, i)));
+        assert_noerr();
+    }
+    assert_uint_eq(count, hashtable_size(table));
+    assert_uint_ge(hashtable_capacity(table), count);
+    for(size_t i = 0; i < count; i++)
+    {
+        assert_ptr_eq(name_at(names, i), hashtable_get(table, name_at(names, i)));
+    }
+    assert_null(hashtable_get(table, "key-100000"));
+
+    order_context order = {names, 0, 1};
+    assert_true(hashtable_iterate(table, check_order, &order));
+    assert_uint_eq(count, order.next);
+
+    size_t stop = 10;
+    assert_false(hashtable_iterate(table, stop_iteration, &stop));
+
+    hashtable_clear(table);
+    assert_true(hashtable_is_empty(table));
+    assert_null(hashtable_get(table, name_at(names, 0)));
+
+    hashtable_free(table);
+    free(names);
+}
+END_TEST
+
+START_TEST (remove_entries)
+{
+    size_t count = 1000;
+    char *names = make_names(count);
+    Hashtable *table = make_table();
+
+    for(size_t i = 0; i < count; i++)
+    {
+        hashtable_put(table, name_at(names, i), name_at(names, i));
+    }
+    for(size_t i = 1; i < count; i += 2)
+    {
+        assert_ptr_eq(name_at(names, i), hashtable_remove(table, name_at(names, i)));
+    }
+    assert_null(hashtable_remove(table, name_at(names, 1)));
+    assert_uint_eq(count / 2, hashtable_size(table));
+    for(size_t i = 0; i < count; i++)
+    {
+        if(0 == i % 2)
+        {
+            assert_ptr_eq(name_at(names, i), hashtable_get(table, name_at(names, i)));
+        }
+        else
+        {
+            assert_false(hashtable_contains(table, name_at(names, i)));
+        }
+    }
+
+    order_context order = {names, 0, 2};
+    hashtable_iterate(table, check_order, &order);
+    assert_uint_eq(count, order.next);
+
+    // N.B. - cycling keys through the table squeezes out the holes left by removal
+    size_t capacity = hashtable_capacity(table);
+    for(size_t round = 0; round < 10; round++)
+    {
+        for(size_t i = 1; i < count; i += 2)
+        {
+            hashtable_put(table, name_at(names, i), name_at(names, i));
+        }
+        for(size_t i = 1; i < count; i += 2)
+        {
+            hashtable_remove(table, name_at(names, i));
+        }
+    }
+    assert_uint_eq(capacity, hashtable_capacity(table));
+    order = (order_context){names, 0, 2};
+    hashtable_iterate(table, check_order, &order);
+    assert_uint_eq(count, order.next);
+
+    hashtable_free(table);
+    free(names);
+}
+END_TEST
+
+START_TEST (arena_table)
+{
+    Arena *arena = make_arena();
+    assert_not_null(arena);
+    char *names = make_names(100);
+
+    reset_errno();
+    Hashtable *table = make_hashtable_in(arena, string_comparitor, shift_add_xor_string_hash);
+    assert_not_null(table);
+    for(size_t i = 0; i < 100; i++)
+    {
+        hashtable_put(table, name_at(names, i), name_at(names, i));
+    }
+    assert_noerr();
+    assert_uint_eq(100, hashtable_size(table));
+    ck_assert_str_eq("key-42", hashtable_get(table, "key-42"));
+    hashtable_free(table);
+
+    arena_free(arena);
+    free(names);
+}
+END_TEST
+
+START_TEST (seeded_hash)
+{
+    uint8_t buffer[128];
+    for(size_t i = 0; i < sizeof(buffer); i++)
+    {
+        buffer[i] = (uint8_t)('a' + i % 26);
+    }
+
+    const char *key = "https://example.com/a/key/that/is/longer/than/forty/eight/bytes";
+    assert_uint_eq(wyhash_string_hash(key), wyhash_string_buffer_hash((const uint8_t *)key, strlen(key)));
+
+    // N.B. - every prefix length takes a different path through the short and long key reads
+    hashcode seen[sizeof(buffer) + 1];
+    for(size_t length = 0; length <= sizeof(buffer); length++)
+    {
+        seen[length] = wyhash_string_buffer_hash(buffer, length);
+        for(size_t i = 0; i < length; i++)
+        {
+            ck_assert_msg(seen[i] != seen[length], "prefixes of length %zu and %zu collide", i, length);
+        }
+    }
+    for(size_t i = 0; i < sizeof(buffer); i++)
+    {
+        buffer[i] ^= 1;
+        ck_assert_msg(seen[sizeof(buffer)] != wyhash_string_buffer_hash(buffer, sizeof(buffer)), "byte %zu is ignored", i);
+        buffer[i] ^= 1;
+    }
+}
+END_TEST
+
+Suite *hashtable_suite(void)
+{
+    TCase *bad_input_case = tcase_create("bad input");
+    tcase_add_test(bad_input_case, bad_input);
+
+    TCase *basic_case = tcase_create("basic");
+    tcase_add_test(basic_case, put_get);
+    tcase_add_test(basic_case, probe);
+    tcase_add_test(basic_case, arena_table);
+
+    TCase *resize_case = tcase_create("resize");
+    tcase_add_test(resize_case, growth);
+    tcase_add_test(resize_case, remove_entries);
+
+    TCase *hash_case = tcase_create("hash");
+    tcase_add_test(hash_case, seeded_hash);
+
+    Suite *suite = suite_create("Hashtable");
+    suite_add_tcase(suite, bad_input_case);
+    suite_add_tcase(suite, basic_case);
+    suite_add_tcase(suite, resize_case);
+    suite_add_tcase(suite, hash_case);
+
+    return suite;
+}
@@ -100,5 +100,7 @@ Suite *loader_suite(void);
 Suite *jsonpath_suite(void);
 Suite *model_suite(void);
 Suite *nodelist_suite(void);
+Suite *hashtable_suite(void);
 Suite *evaluator_suite(void);
+Suite *emit_suite(void);
 
@@ -35,9 +35,18 @@
  * [license]: http://www.opensource.org/licenses/ncsa
  */
 
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <regex.h>
+#include <sys/stat.h>
 
 #include <check.h>
 
@@ -122,6 +131,15 @@ static const unsigned char * const DUPLICATE_KEY_YAML = (unsigned char *)
     "one: bar\n"
     "three: baz\n";
 
+static const unsigned char * const STREAMED_DUPLICATE_YAML = (unsigned char *)
+    "a:\n"
+    "  x: 1\n"
+    "b: 0\n"
+    "a: 2\n";
+
+static const unsigned char * const STREAMED_RECURSION_JSON = (unsigned char *)
+    "{\"m\": {\"x\": {\"a\": 1}, \"a\": 2}}";
+
 
 static DocumentModel *model_fixture = NULL;
 static Node *root_node_fixture = NULL;
@@ -203,6 +221,26 @@ START_TEST (eof_file_input)
 }
 END_TEST
 
+START_TEST (null_mapped_input)
+{
+    reset_errno();
+    MaybeDocument maybe = load_mapped(NULL, DUPE_CLOBBER);
+    assert_errno(EINVAL);
+
+    assert_loader_failure(maybe, ERR_INPUT_IS_NULL);
+}
+END_TEST
+
+START_TEST (missing_mapped_input)
+{
+    reset_errno();
+    MaybeDocument maybe = load_mapped("no-such-file.yaml", DUPE_CLOBBER);
+    assert_errno(ENOENT);
+
+    assert_loader_failure(maybe, ERR_READER_FAILED);
+}
+END_TEST
+
 START_TEST (non_scalar_key)
 {
     size_t yaml_size = strlen((char *)NON_SCALAR_KEY_YAML);
@@ -350,6 +388,81 @@ START_TEST (load_from_file)
 }
 END_TEST
 
+static bool is_mapped(const DocumentModel *model, Node *value)
+{
+    const uint8_t *data = scalar_value(scalar(value));
+    return data >= model->source.data && data < model->source.data + model->source.length;
+}
+
+START_TEST (load_from_mapped_file)
+{
+    size_t yaml_size = strlen((char *)YAML);
+    char path[] = "kanabo-mapped-XXXXXX";
+    int descriptor = mkstemp(path);
+    assert_int_ne(-1, descriptor);
+    FILE *output = fdopen(descriptor, "w");
+    size_t written = fwrite(YAML, sizeof(char), yaml_size, output);
+    assert_uint_eq(written, yaml_size);
+    fclose(output);
+
+    MaybeDocument maybe = load_mapped(path, DUPE_CLOBBER);
+    unlink(path);
+    assert_int_eq(JUST, maybe.tag);
+    assert_not_null(maybe.just);
+    assert_not_null(maybe.just->source.data);
+    assert_uint_eq(yaml_size, maybe.just->source.length);
+
+    assert_model_state(maybe.just);
+
+    Node *root = model_document_root(maybe.just, 0);
+    assert_true(is_mapped(maybe.just, mapping_get(mapping(root), (uint8_t *)"two", 3ul)));
+    Node *five = mapping_get(mapping(root), (uint8_t *)"five", 4ul);
+    assert_true(is_mapped(maybe.just, sequence_get(sequence(five), 2)));
+
+    model_free(maybe.just);
+}
+END_TEST
+
+START_TEST (load_from_mapped_file_with_escapes)
+{
+    static const char * const ESCAPED_YAML = "{\"caf\\u00e9\": \"one\\ttwo\", \"caf\\u00e9s\": [\"\\u00e9\", \"plain\"]}";
+    size_t yaml_size = strlen(ESCAPED_YAML);
+    char path[] = "kanabo-mapped-XXXXXX";
+    int descriptor = mkstemp(path);
+    assert_int_ne(-1, descriptor);
+    FILE *output = fdopen(descriptor, "w");
+    size_t written = fwrite(ESCAPED_YAML, sizeof(char), yaml_size, output);
+    assert_uint_eq(written, yaml_size);
+    fclose(output);
+
+    MaybeDocument maybe = load_mapped(path, DUPE_CLOBBER);
+    unlink(path);
+    assert_int_eq(JUST, maybe.tag);
+
+    Node *root = model_document_root(maybe.just, 0);
+    assert_node_kind(root, MAPPING);
+
+    reset_errno();
+    Node *one = mapping_get(mapping(root), (uint8_t *)"caf\xc3\xa9", 5ul);
+    assert_noerr();
+    assert_not_null(one);
+    assert_scalar_value(one, "one\ttwo");
+    assert_false(is_mapped(maybe.just, one));
+
+    reset_errno();
+    Node *two = mapping_get(mapping(root), (uint8_t *)"caf\xc3\xa9s", 6ul);
+    assert_noerr();
+    assert_not_null(two);
+    assert_node_size(two, 2);
+    assert_scalar_value(sequence_get(sequence(two), 0), "\xc3\xa9");
+    assert_false(is_mapped(maybe.just, sequence_get(sequence(two), 0)));
+    assert_scalar_value(sequence_get(sequence(two), 1), "plain");
+    assert_true(is_mapped(maybe.just, sequence_get(sequence(two), 1)));
+
+    model_free(maybe.just);
+}
+END_TEST
+
 START_TEST (load_from_string)
 {
     size_t yaml_size = strlen((char *)YAML);
@@ -571,11 +684,803 @@ START_TEST (duplicate_fail)
 }
 END_TEST
 
+struct streamed_values
+{
+    size_t count;
+    char   values[4][8];
+};
+
+static bool collect_streamed_value(Node *each, void *context)
+{
+    struct streamed_values *result = (struct streamed_values *)context;
+    assert_uint_lt(result->count, 4);
+    assert_node_kind(each, SCALAR);
+    assert_uint_lt(node_size(each), 8);
+    memcpy(result->values[result->count], scalar_value(scalar(each)), node_size(each));
+    result->values[result->count][node_size(each)] = '\0';
+    result->count++;
+
+    return true;
+}
+
+static MaybeCount stream_string(const unsigned char *input, const char *expression, enum loader_duplicate_key_strategy strategy,
+                                struct streamed_values *result)
+{
+    FILE *file = tmpfile();
+    assert_not_null(file);
+    size_t length = strlen((const char *)input);
+    assert_uint_eq(length, fwrite(input, 1, length, file));
+    rewind(file);
+
+    parser_context *parser = make_parser((const uint8_t *)expression, strlen(expression));
+    assert_not_null(parser);
+    jsonpath *path = parse(parser);
+    assert_not_null(path);
+    parser_free(parser);
+
+    stream_options options = STREAM_DEFAULTS;
+    options.strategy = strategy;
+    memset(result, 0, sizeof(struct streamed_values));
+    MaybeCount maybe = stream_file(file, path, &options, collect_streamed_value, result);
+    path_free(path);
+    fclose(file);
+
+    return maybe;
+}
+
+START_TEST (streamed_duplicate)
+{
+    struct streamed_values result;
+    MaybeCount maybe = stream_string(STREAMED_DUPLICATE_YAML, "$.a", DUPE_CLOBBER, &result);
+    assert_int_eq(JUST, maybe.tag);
+    assert_uint_eq(1, maybe.just);
+    ck_assert_str_eq("2", result.values[0]);
+
+    // N.B. - the duplicate takes the place of the original, and what was selected inside the original is dropped
+    maybe = stream_string(STREAMED_DUPLICATE_YAML, "$.*", DUPE_WARN, &result);
+    assert_int_eq(JUST, maybe.tag);
+    assert_uint_eq(2, maybe.just);
+    ck_assert_str_eq("2", result.values[0]);
+    ck_assert_str_eq("0", result.values[1]);
+
+    maybe = stream_string(STREAMED_DUPLICATE_YAML, "$..x", DUPE_CLOBBER, &result);
+    assert_int_eq(JUST, maybe.tag);
+    assert_uint_eq(0, maybe.just);
+    assert_uint_eq(0, result.count);
+
+    maybe = stream_string(STREAMED_DUPLICATE_YAML, "$.a", DUPE_FAIL, &result);
+    assert_int_eq(NOTHING, maybe.tag);
+    assert_int_eq(ERR_DUPLICATE_KEY, maybe.nothing.code);
+    assert_uint_eq(0, result.count);
+
+    // N.B. - the duplicate is reported on the same line as when the input is loaded
+    MaybeDocument loaded = load_string(STREAMED_DUPLICATE_YAML, strlen((const char *)STREAMED_DUPLICATE_YAML), DUPE_FAIL);
+    assert_int_eq(NOTHING, loaded.tag);
+    assert_int_eq(ERR_DUPLICATE_KEY, loaded.nothing.code);
+    assert_not_null(maybe.nothing.message);
+    assert_not_null(loaded.nothing.message);
+    ck_assert_str_eq(loaded.nothing.message, maybe.nothing.message);
+    ck_assert_str_eq("A duplicate mapping key was found on line 4", maybe.nothing.message);
+    free(loaded.nothing.message);
+    free(maybe.nothing.message);
+}
+END_TEST
+
+START_TEST (streamed_recursion)
+{
+    // N.B. - a recursive name test orders the nodes by their parents, as the evaluator does
+    struct streamed_values result;
+    MaybeCount maybe = stream_string(STREAMED_RECURSION_JSON, "$..a", DUPE_CLOBBER, &result);
+    assert_int_eq(JUST, maybe.tag);
+    assert_uint_eq(2, maybe.just);
+    ck_assert_str_eq("2", result.values[0]);
+    ck_assert_str_eq("1", result.values[1]);
+}
+END_TEST
+
+/*
+ * The patterns the loader used to classify plain scalars with, kept here
+ * as the reference for the hand written classifier.
+ */
+static const char * const DECIMAL_PATTERN = "^-?(0|([1-9][[:digit:]]*))([.][[:digit:]]+)?([eE][+-]?[[:digit:]]+)?$";
+static const char * const INTEGER_PATTERN = "^-?(0|([1-9][[:digit:]]*))$";
+static const char * const TIMESTAMP_PATTERN = "^[0-9][0-9][0-9][0-9]-[0-9][0-9]?-[0-9][0-9]?(([Tt]|[ \t]+)[0-9][0-9]?:[0-9][0-9](:[0-9][0-9])?([.][0-9]+)?([ \t]*(Z|([-+][0-9][0-9]?(:[0-9][0-9])?)))?)?$";
+
+static const char * const CLASSIFIER_SEEDS[] =
+{
+    "0", "-0", "7", "-42", "1234567890", "00", "01", "-", "",
+    "0.5", "-0.5", "1.", ".5", "1e5", "1E+5", "1e-5", "-2.5e10", "1.5e", "1e+", "0e0", "01.5",
+    "2001-12-14", "2001-1-1", "2001-12-14t21:59:43.10-05:00", "2001-12-14 21:59:43.10 -5",
+    "2001-12-15T02:59:43.1Z", "2001-12-15 2:59:43.10", "2002-12-14", "2001-12-14\t\t1:00",
+    "2001-12-14T21:59Z", "2001-12-14T21:59 +05:30", "2001-12-14T21:59:43.", "2001-12-14 ",
+    "2001-12-14T21:59:43.10 ", "12001-12-14", "201-12-14", "2001-123-14", "-2001-12-14",
+    "1.0.0", "0x1f", "1_000", "+1", "1e5.5", "2001-12-14T21:59:43+5:3",
+};
+
+static const char CLASSIFIER_ALPHABET[] = "0123456789-+.eEtTZ: \tx";
+
+static uint64_t classifier_state = 0x9e3779b97f4a7c15ull;
+
+static uint64_t classifier_random(void)
+{
+    classifier_state ^= classifier_state << 13;
+    classifier_state ^= classifier_state >> 7;
+    classifier_state ^= classifier_state << 17;
+    return classifier_state;
+}
+
+static ScalarKind classify_with_patterns(const regex_t *patterns, const char *value)
+{
+    if(0 == regexec(&patterns[0], value, 0, NULL, 0))
+    {
+        return SCALAR_INTEGER;
+    }
+    if(0 == regexec(&patterns[1], value, 0, NULL, 0))
+    {
+        return SCALAR_REAL;
+    }
+    if(0 == regexec(&patterns[2], value, 0, NULL, 0))
+    {
+        return SCALAR_TIMESTAMP;
+    }
+    return SCALAR_STRING;
+}
+
+static void assert_classified_like_patterns(const regex_t *patterns, const char *value)
+{
+    ScalarKind expected = classify_with_patterns(patterns, value);
+    ScalarKind actual = classify_plain_scalar((const uint8_t *)value, strlen(value));
+    ck_assert_msg(expected == actual, "classifier disagrees with the patterns for \"%s\": expected %d, was %d", value, expected, actual);
+}
+
+static void assert_mutations_classified_like_patterns(const regex_t *patterns, const char *seed)
+{
+    char buffer[64];
+    size_t length = strlen(seed);
+    size_t alphabet = sizeof(CLASSIFIER_ALPHABET) - 1;
+
+    assert_classified_like_patterns(patterns, seed);
+    for(size_t i = 0; i <= length; i++)
+    {
+        for(size_t j = 0; j < alphabet; j++)
+        {
+            // insertion at i
+            memcpy(buffer, seed, i);
+            buffer[i] = CLASSIFIER_ALPHABET[j];
+            memcpy(buffer + i + 1, seed + i, length - i + 1);
+            assert_classified_like_patterns(patterns, buffer);
+            if(i < length)
+            {
+                // substitution at i
+                memcpy(buffer, seed, length + 1);
+                buffer[i] = CLASSIFIER_ALPHABET[j];
+                assert_classified_like_patterns(patterns, buffer);
+            }
+        }
+        if(i < length)
+        {
+            // deletion at i
+            memcpy(buffer, seed, i);
+            memcpy(buffer + i, seed + i + 1, length - i);
+            assert_classified_like_patterns(patterns, buffer);
+        }
+    }
+}
+
+START_TEST (classifier_matches_patterns)
+{
+    regex_t patterns[3];
+    ck_assert_int_eq(0, regcomp(&patterns[0], INTEGER_PATTERN, REG_EXTENDED | REG_NOSUB));
+    ck_assert_int_eq(0, regcomp(&patterns[1], DECIMAL_PATTERN, REG_EXTENDED | REG_NOSUB));
+    ck_assert_int_eq(0, regcomp(&patterns[2], TIMESTAMP_PATTERN, REG_EXTENDED | REG_NOSUB));
+
+    for(size_t i = 0; i < sizeof(CLASSIFIER_SEEDS) / sizeof(char *); i++)
+    {
+        assert_mutations_classified_like_patterns(patterns, CLASSIFIER_SEEDS[i]);
+    }
+
+    char buffer[32];
+    size_t alphabet = sizeof(CLASSIFIER_ALPHABET) - 1;
+    for(size_t i = 0; i < 100000; i++)
+    {
+        size_t length = (size_t)(classifier_random() % (sizeof(buffer) - 1));
+        for(size_t j = 0; j < length; j++)
+        {
+            uint64_t pick = classifier_random();
+            // N.B. - favor digits so that the longer shapes are reached
+            buffer[j] = 0 == (pick & 1) ? (char)('0' + (pick >> 1) % 10) : CLASSIFIER_ALPHABET[(pick >> 1) % alphabet];
+        }
+        buffer[length] = '\0';
+        assert_classified_like_patterns(patterns, buffer);
+    }
+
+    regfree(&patterns[0]);
+    regfree(&patterns[1]);
+    regfree(&patterns[2]);
+}
+END_TEST
+
+static void assert_same_node(Node *expected, Node *actual);
+
+struct entry_match_s
+{
+    Node *key;
+    Node *value;
+};
+
+static bool find_entry(Node *key, Node *value, void *context)
+{
+    struct entry_match_s *match = (struct entry_match_s *)context;
+    if(node_equals(key, match->key))
+    {
+        match->value = value;
+        return false;
+    }
+    return true;
+}
+
+static bool assert_same_entry(Node *key, Node *value, void *context)
+{
+    // N.B. - `mapping_get' can't look up the empty key
+    struct entry_match_s match = {key, NULL};
+    mapping_iterate((Mapping *)context, find_entry, &match);
+    assert_same_node(value, match.value);
+    return true;
+}
+
+static void assert_same_string(const uint8_t *expected, const uint8_t *actual)
+{
+    if(NULL == expected)
+    {
+        assert_null(actual);
+        return;
+    }
+    assert_not_null(actual);
+    ck_assert_str_eq((const char *)expected, (const char *)actual);
+}
+
+static void assert_same_node(Node *expected, Node *actual)
+{
+    assert_not_null(actual);
+    assert_node_kind(actual, node_kind(expected));
+    assert_node_size(actual, node_size(expected));
+    assert_same_string(node_name(expected), node_name(actual));
+    assert_same_string(expected->anchor, actual->anchor);
+    switch(node_kind(expected))
+    {
+        case SCALAR:
+            assert_scalar_kind(actual, scalar_kind(scalar(expected)));
+            assert_buf_eq(scalar_value(scalar(expected)), node_size(expected), scalar_value(scalar(actual)), node_size(actual));
+            break;
+        case SEQUENCE:
+            for(size_t i = 0; i < node_size(expected); i++)
+            {
+                assert_same_node(sequence_get(sequence(expected), i), sequence_get(sequence(actual), i));
+            }
+            break;
+        case MAPPING:
+            mapping_iterate(mapping(expected), assert_same_entry, mapping(actual));
+            break;
+        case ALIAS:
+            assert_same_node(alias_target(alias(expected)), alias_target(alias(actual)));
+            break;
+        default:
+            ck_abort_msg("unexpected node kind: %s", node_kind_name(expected));
+    }
+}
+
+static void assert_json_loads_like_yaml(const char *input)
+{
+    size_t length = strlen(input);
+    MaybeDocument yaml = load_string_with_format((const unsigned char *)input, length, DUPE_CLOBBER, INPUT_YAML);
+    ck_assert_msg(JUST == yaml.tag, "libyaml couldn't load: %s", input);
+    MaybeDocument json = load_string_with_format((const unsigned char *)input, length, DUPE_CLOBBER, INPUT_JSON);
+    ck_assert_msg(JUST == json.tag, "the json loader couldn't load: %s", input);
+
+    assert_uint_eq(1, model_size(json.just));
+    assert_same_node(model_document_root(yaml.just, 0), model_document_root(json.just, 0));
+
+    model_free(yaml.just);
+    model_free(json.just);
+}
+
+static const char * const JSON_INPUTS[] =
+{
+    "{}",
+    "[]",
+    " \n[ ]\n ",
+    "{\"one\": 1, \"two\": -2.5, \"three\": 3e10, \"four\": -0, \"five\": 1.5E-3}",
+    "[true, false, null, \"true\", \"null\", \"\"]",
+    "{\"a\":{\"b\":{\"c\":[[[]],{}]}}}",
+    "{\"escapes\": \"\\\"\\\\\\/\\b\\f\\n\\r\\t\", \"unicode\": \"caf\\u00e9 \\u20AC\"}",
+    "{\"raw\": \"caf\xc3\xa9 \xf0\x9f\x98\x80\", \"k\xc3\xa9y\": [\"\xe2\x82\xac\"]}",
+    "{\"dupe\": 1, \"dupe\": 2}",
+    "[\"a string long enough to cross a sixteen byte boundary with a \\\"quote\\\" in it\",\r\n\t\"x\"]",
+    "[\"backslashes \\\\\\\\\", \"\\\\\", \"end\\\\\"]",
+    "{\"numbers\": [0, 10, 123456789012345678901234567890, 0.0, 1e0, 1E+2, -1e-2]}",
+};
+
+START_TEST (json_loads_like_yaml)
+{
+    for(size_t i = 0; i < sizeof(JSON_INPUTS) / sizeof(char *); i++)
+    {
+        assert_json_loads_like_yaml(JSON_INPUTS[i]);
+    }
+}
+END_TEST
+
+static void generate_json_value(char **cursor, size_t depth);
+
+static void generate_json_string(char **cursor)
+{
+    static const char * const PIECES[] =
+    {
+        "a", "key", "value", " ", "\\n", "\\\"", "\\\\", "\\/", "\\t", "\\u00e9",
+        "\xc3\xa9", "\xe2\x82\xac", "{", "}", "[", "]", ":", ",", "0123456789abcdef"
+    };
+    *(*cursor)++ = '"';
+    size_t count = (size_t)(classifier_random() % 8);
+    for(size_t i = 0; i < count; i++)
+    {
+        const char *piece = PIECES[classifier_random() % (sizeof(PIECES) / sizeof(char *))];
+        size_t length = strlen(piece);
+        memcpy(*cursor, piece, length);
+        *cursor += length;
+    }
+    *(*cursor)++ = '"';
+}
+
+static void generate_json_space(char **cursor, bool inline_only)
+{
+    static const char SPACE[] = {' ', '\t', '\n', '\r'};
+    uint64_t pick = classifier_random() % 8;
+    // N.B. - YAML requires an implicit key and its `:' to be on the same line
+    if(pick < (inline_only ? 2 : sizeof(SPACE)))
+    {
+        *(*cursor)++ = SPACE[pick];
+    }
+}
+
+static void generate_json_value(char **cursor, size_t depth)
+{
+    static const char * const SCALARS[] =
+    {
+        "0", "-1", "42", "3.25", "-0.5e3", "1E-7", "true", "false", "null"
+    };
+    uint64_t pick = classifier_random() % (0 == depth ? 3 : 4);
+    size_t count = (size_t)(classifier_random() % 6);
+    switch(pick)
+    {
+        case 0:
+        {
+            const char *scalar = SCALARS[classifier_random() % (sizeof(SCALARS) / sizeof(char *))];
+            size_t length = strlen(scalar);
+            memcpy(*cursor, scalar, length);
+            *cursor += length;
+            break;
+        }
+        case 1:
+            generate_json_string(cursor);
+            break;
+        case 2:
+            *(*cursor)++ = '[';
+            for(size_t i = 0; i < count && 0 < depth; i++)
+            {
+                generate_json_space(cursor, false);
+                generate_json_value(cursor, depth - 1);
+                generate_json_space(cursor, false);
+                if(i + 1 < count)
+                {
+                    *(*cursor)++ = ',';
+                }
+            }
+            *(*cursor)++ = ']';
+            break;
+        default:
+            *(*cursor)++ = '{';
+            for(size_t i = 0; i < count; i++)
+            {
+                generate_json_space(cursor, false);
+                generate_json_string(cursor);
+                generate_json_space(cursor, true);
+                *(*cursor)++ = ':';
+                generate_json_space(cursor, false);
+                generate_json_value(cursor, depth - 1);
+                if(i + 1 < count)
+                {
+                    *(*cursor)++ = ',';
+                }
+            }
+            *(*cursor)++ = '}';
+            break;
+    }
+}
+
+START_TEST (generated_json_loads_like_yaml)
+{
+    static char buffer[1 << 20];
+    for(size_t i = 0; i < 200; i++)
+    {
+        char *cursor = buffer;
+        *cursor++ = 0 == i % 2 ? '[' : '{';
+        if(0 == i % 2)
+        {
+            generate_json_value(&cursor, 4);
+        }
+        else
+        {
+            generate_json_string(&cursor);
+            *cursor++ = ':';
+            generate_json_value(&cursor, 4);
+        }
+        *cursor++ = 0 == i % 2 ? ']' : '}';
+        *cursor = '\0';
+        assert_json_loads_like_yaml(buffer);
+    }
+}
+END_TEST
+
+START_TEST (json_input_format)
+{
+    static const char * const FLOW_YAML = "{one: 1, two: [a, b]} # not json";
+    MaybeDocument maybe = load_string_with_format((const unsigned char *)FLOW_YAML, strlen(FLOW_YAML), DUPE_CLOBBER, INPUT_JSON);
+    assert_loader_failure(maybe, ERR_PARSER_FAILED);
+
+    maybe = load_string((const unsigned char *)FLOW_YAML, strlen(FLOW_YAML), DUPE_CLOBBER);
+    assert_int_eq(JUST, maybe.tag);
+    Node *root = model_document_root(maybe.just, 0);
+    assert_node_kind(root, MAPPING);
+    assert_node_size(root, 2);
+    model_free(maybe.just);
+
+    static const char * const BAD_JSON[] =
+    {
+        "[1, 2", "[1 2]", "{\"a\" 1}", "{\"a\": 1,}", "[01]", "[\"\\x41\"]", "[\"\\ud83d\"]",
+        "[\"tab\there\"]", "[\"\xc3\"]", "[\"\xc2\x80\"]", "[tru]", "[] []", "[\"unterminated]"
+    };
+    for(size_t i = 0; i < sizeof(BAD_JSON) / sizeof(char *); i++)
+    {
+        maybe = load_string_with_format((const unsigned char *)BAD_JSON[i], strlen(BAD_JSON[i]), DUPE_CLOBBER, INPUT_JSON);
+        ck_assert_msg(NOTHING == maybe.tag, "the json loader accepted: %s", BAD_JSON[i]);
+        ck_assert_msg(ERR_SCANNER_FAILED == maybe.nothing.code || ERR_PARSER_FAILED == maybe.nothing.code, "unexpected failure for: %s", BAD_JSON[i]);
+        free(maybe.nothing.message);
+    }
+
+    // N.B. - libyaml rejects all surrogate escapes, the json loader decodes pairs
+    static const char * const SURROGATE_JSON = "[\"\\ud83d\\ude00\"]";
+    maybe = load_string_with_format((const unsigned char *)SURROGATE_JSON, strlen(SURROGATE_JSON), DUPE_CLOBBER, INPUT_JSON);
+    assert_int_eq(JUST, maybe.tag);
+    assert_scalar_value(sequence_get(sequence(model_document_root(maybe.just, 0)), 0), "\xf0\x9f\x98\x80");
+    model_free(maybe.just);
+
+    static const char * const DUPLICATE_JSON = "{\"one\": 1, \"one\": 2}";
+    maybe = load_string_with_format((const unsigned char *)DUPLICATE_JSON, strlen(DUPLICATE_JSON), DUPE_FAIL, INPUT_JSON);
+    assert_loader_failure(maybe, ERR_DUPLICATE_KEY);
+}
+END_TEST
+
+static void assert_source(const char *input, Node *value, const char *expected)
+{
+    SourceSpan span;
+    assert_true(node_source(value, &span));
+    assert_uint_eq(strlen(expected), span.length);
+    assert_int_eq(0, memcmp(input + span.offset, expected, span.length));
+}
+
+START_TEST (json_source_spans)
+{
+    static const char * const INPUT = " {\"a\": [1, {\"b\": []}], \"c\": {\"d\": 1, \"d\": 2}, \"e\": {\"f\" : \"]\"}}\n";
+    MaybeDocument maybe = load_string_with_format((const unsigned char *)INPUT, strlen(INPUT), DUPE_CLOBBER, INPUT_JSON);
+    assert_int_eq(JUST, maybe.tag);
+    Mapping *root = mapping(model_document_root(maybe.just, 0));
+    Sequence *a = sequence(mapping_get(root, (uint8_t *)"a", 1ul));
+
+    assert_source(INPUT, node(a), "[1, {\"b\": []}]");
+    assert_source(INPUT, sequence_get(a, 1), "{\"b\": []}");
+    assert_source(INPUT, mapping_get(mapping(sequence_get(a, 1)), (uint8_t *)"b", 1ul), "[]");
+    assert_source(INPUT, mapping_get(root, (uint8_t *)"e", 1ul), "{\"f\" : \"]\"}");
+
+    // N.B. - the text of a mapping with a replaced key, and of the mappings around it, no longer matches the model
+    SourceSpan span;
+    assert_false(node_source(mapping_get(root, (uint8_t *)"c", 1ul), &span));
+    assert_false(node_source(root, &span));
+    assert_false(node_source(sequence_get(a, 0), &span));
+    model_free(maybe.just);
+
+    static const char * const YAML_INPUT = "{a: [1, 2]}";
+    maybe = load_string_with_format((const unsigned char *)YAML_INPUT, strlen(YAML_INPUT), DUPE_CLOBBER, INPUT_YAML);
+    assert_int_eq(JUST, maybe.tag);
+    assert_false(node_source(model_document_root(maybe.just, 0), &span));
+    model_free(maybe.just);
+}
+END_TEST
+
+static const unsigned char * const SNAPSHOT_YAML = (unsigned char *)
+    "--- !!map\n"
+    "base: &base {x: 1, y: [1, 2.5, 2001-12-14, true, ~, \"str\", '']}\n"
+    "ref: *base\n"
+    "tagged: &tagged !custom value\n"
+    "&key key: *tagged\n"
+    "...\n"
+    "--- !!seq\n"
+    "- second\n"
+    "- \"\"\n"
+    "- {}\n"
+    "- []\n";
+
+static void make_temporary(char *path, const void *data, size_t length)
+{
+    int descriptor = mkstemp(path);
+    assert_int_ne(-1, descriptor);
+    FILE *output = fdopen(descriptor, "w");
+    assert_not_null(output);
+    assert_uint_eq(length, fwrite(data, 1, length, output));
+    assert_int_eq(0, fclose(output));
+}
+
+static uint8_t *read_temporary(const char *path, size_t *length)
+{
+    FILE *input = fopen(path, "r");
+    assert_not_null(input);
+    assert_int_eq(0, fseek(input, 0, SEEK_END));
+    *length = (size_t)ftell(input);
+    rewind(input);
+    uint8_t *data = malloc(*length);
+    assert_not_null(data);
+    assert_uint_eq(*length, fread(data, 1, *length, input));
+    fclose(input);
+
+    return data;
+}
+
+/* the same checksum as the snapshot writer, so that a test can forge a snapshot that is intact */
+static uint64_t snapshot_checksum(const uint8_t *data, size_t length)
+{
+    static const uint64_t SEED = 0x9e3779b97f4a7c15ull;
+    static const uint64_t PRIME = 0xff51afd7ed558ccdull;
+    uint64_t lanes[4] = {SEED, SEED + 1, SEED + 2, SEED + 3};
+    size_t offset = 0;
+    for(; offset + 32 <= length; offset += 32)
+    {
+        uint64_t words[4];
+        memcpy(words, data + offset, sizeof(words));
+        for(size_t i = 0; i < 4; i++)
+        {
+            lanes[i] = (lanes[i] ^ words[i]) * PRIME;
+            lanes[i] ^= lanes[i] >> 29;
+        }
+    }
+    for(size_t i = 0; offset < length; offset += 8, i++)
+    {
+        uint64_t word = 0;
+        memcpy(&word, data + offset, length - offset < 8 ? length - offset : 8);
+        lanes[i] = (lanes[i] ^ word) * PRIME;
+        lanes[i] ^= lanes[i] >> 29;
+    }
+
+    uint64_t result = length;
+    for(size_t i = 0; i < 4; i++)
+    {
+        result = (result ^ lanes[i]) * PRIME;
+        result ^= result >> 32;
+    }
+    return result;
+}
+
+/* `count' sequences, each nested in the one before */
+static char *nested_sequences(size_t count)
+{
+    char *result = malloc(count * 2 + 1);
+    assert_not_null(result);
+    memset(result, '[', count);
+    memset(result + count, ']', count);
+    result[count * 2] = '\0';
+
+    return result;
+}
+
+static void assert_same_model(const DocumentModel *expected, const DocumentModel *actual)
+{
+    assert_uint_eq(model_size(expected), model_size(actual));
+    for(size_t i = 0; i < model_size(expected); i++)
+    {
+        assert_same_node(model_document_root(expected, i), model_document_root(actual, i));
+    }
+}
+
+START_TEST (snapshot_round_trip)
+{
+    MaybeDocument expected = load_string(SNAPSHOT_YAML, strlen((char *)SNAPSHOT_YAML), DUPE_CLOBBER);
+    assert_int_eq(JUST, expected.tag);
+
+    char path[] = "kanabo-snapshot-XXXXXX";
+    make_temporary(path, "", 0);
+    reset_errno();
+    assert_true(write_snapshot(expected.just, NULL, path));
+    assert_noerr();
+
+    MaybeDocument mapped = load_mapped(path, DUPE_CLOBBER);
+    assert_int_eq(JUST, mapped.tag);
+    assert_same_model(expected.just, mapped.just);
+
+    Node *root = model_document_root(mapped.just, 0);
+    Node *base = mapping_get(mapping(root), (uint8_t *)"base", 4ul);
+    Node *ref = mapping_get(mapping(root), (uint8_t *)"ref", 3ul);
+    assert_node_kind(ref, ALIAS);
+    assert_ptr_eq(base, alias_target(alias(ref)));
+    Node *tagged = mapping_get(mapping(root), (uint8_t *)"tagged", 6ul);
+    assert_ptr_eq(tagged, alias_target(alias(mapping_get(mapping(root), (uint8_t *)"key", 3ul))));
+    assert_true(is_mapped(mapped.just, tagged));
+
+    FILE *input = fopen(path, "r");
+    assert_not_null(input);
+    MaybeDocument read = load_file(input, DUPE_CLOBBER);
+    fclose(input);
+    assert_int_eq(JUST, read.tag);
+    assert_null(read.just->source.data);
+    assert_same_model(expected.just, read.just);
+
+    unlink(path);
+    model_free(expected.just);
+    model_free(mapped.just);
+    model_free(read.just);
+}
+END_TEST
+
+START_TEST (stale_snapshot)
+{
+    static const char * const BEFORE = "{one: 1}";
+    static const char * const AFTER = "{two: 2}";
+
+    char source[] = "kanabo-source-XXXXXX";
+    make_temporary(source, BEFORE, strlen(BEFORE));
+    MaybeDocument original = load_mapped(source, DUPE_CLOBBER);
+    assert_int_eq(JUST, original.tag);
+
+    char path[] = "kanabo-snapshot-XXXXXX";
+    make_temporary(path, "", 0);
+    assert_true(write_snapshot(original.just, source, path));
+    model_free(original.just);
+
+    MaybeDocument current = load_mapped(path, DUPE_CLOBBER);
+    assert_int_eq(JUST, current.tag);
+    assert_mapping_has_key(mapping(model_document_root(current.just, 0)), "one");
+    model_free(current.just);
+
+    // N.B. - the same size, so only the modification time gives the change away
+    FILE *output = fopen(source, "w");
+    assert_not_null(output);
+    fputs(AFTER, output);
+    fclose(output);
+    struct timespec times[2] = {{0, UTIME_OMIT}, {1, 0}};
+    assert_int_eq(0, utimensat(AT_FDCWD, source, times, 0));
+
+    MaybeDocument stale = load_mapped(path, DUPE_CLOBBER);
+    assert_int_eq(JUST, stale.tag);
+    assert_mapping_has_key(mapping(model_document_root(stale.just, 0)), "two");
+    assert_mapping_has_no_key(mapping(model_document_root(stale.just, 0)), "one");
+    model_free(stale.just);
+
+    unlink(source);
+    MaybeDocument orphan = load_mapped(path, DUPE_CLOBBER);
+    assert_int_eq(JUST, orphan.tag);
+    assert_mapping_has_key(mapping(model_document_root(orphan.just, 0)), "one");
+    model_free(orphan.just);
+
+    unlink(path);
+}
+END_TEST
+
+static void assert_invalid_snapshot(const uint8_t *data, size_t length)
+{
+    MaybeDocument maybe = load_string(data, length, DUPE_CLOBBER);
+    assert_int_eq(NOTHING, maybe.tag);
+    assert_int_eq(ERR_INVALID_SNAPSHOT, maybe.nothing.code);
+    free(maybe.nothing.message);
+}
+
+START_TEST (damaged_snapshot)
+{
+    MaybeDocument model = load_string(SNAPSHOT_YAML, strlen((char *)SNAPSHOT_YAML), DUPE_CLOBBER);
+    assert_int_eq(JUST, model.tag);
+    char path[] = "kanabo-snapshot-XXXXXX";
+    make_temporary(path, "", 0);
+    assert_true(write_snapshot(model.just, NULL, path));
+
+    reset_errno();
+    assert_false(write_snapshot(model.just, path, path));
+    assert_errno(EINVAL);
+    model_free(model.just);
+
+    size_t length = 0;
+    uint8_t *data = read_temporary(path, &length);
+    MaybeDocument intact = load_string(data, length, DUPE_CLOBBER);
+    assert_int_eq(JUST, intact.tag);
+    model_free(intact.just);
+
+    assert_invalid_snapshot(data, length - 8);
+    assert_invalid_snapshot(data, 16);
+
+    for(size_t i = 16; i < length; i += 37)
+    {
+        data[i] ^= 0x20;
+        assert_invalid_snapshot(data, length);
+        data[i] ^= 0x20;
+    }
+
+    // the format version follows the magic number
+    data[8]++;
+    assert_invalid_snapshot(data, length);
+    data[8]--;
+
+    free(data);
+    unlink(path);
+}
+END_TEST
+
+START_TEST (deep_snapshot)
+{
+    // N.B. - the document is the first level, so the innermost sequence is as deep as a snapshot may be
+    char *input = nested_sequences(SNAPSHOT_MAX_DEPTH - 1);
+    MaybeDocument deepest = load_string_with_format((const unsigned char *)input, strlen(input), DUPE_CLOBBER, INPUT_JSON);
+    assert_int_eq(JUST, deepest.tag);
+    free(input);
+    char path[] = "kanabo-snapshot-XXXXXX";
+    make_temporary(path, "", 0);
+    assert_true(write_snapshot(deepest.just, NULL, path));
+    model_free(deepest.just);
+
+    size_t length = 0;
+    uint8_t *data = read_temporary(path, &length);
+    MaybeDocument loaded = load_string(data, length, DUPE_CLOBBER);
+    assert_int_eq(JUST, loaded.tag);
+    model_free(loaded.just);
+
+    input = nested_sequences(SNAPSHOT_MAX_DEPTH);
+    MaybeDocument deeper = load_string_with_format((const unsigned char *)input, strlen(input), DUPE_CLOBBER, INPUT_JSON);
+    assert_int_eq(JUST, deeper.tag);
+    free(input);
+    reset_errno();
+    assert_false(write_snapshot(deeper.just, NULL, path));
+    assert_errno(EOVERFLOW);
+    model_free(deeper.just);
+
+    // a hostile snapshot one level deeper, with a length and checksum that are intact
+    static const size_t CHECKSUM = 16;
+    static const size_t LENGTH = 24;
+    uint8_t *forged = malloc(length + 2);
+    assert_not_null(forged);
+    size_t innermost = length - 2;
+    memcpy(forged, data, innermost);
+    memcpy(forged + innermost, "\x01\x01\x01\x00", 4);
+    uint64_t forged_length = length + 2;
+    memcpy(forged + LENGTH, &forged_length, sizeof(forged_length));
+    uint64_t forged_checksum = snapshot_checksum(forged + LENGTH, length + 2 - LENGTH);
+    memcpy(forged + CHECKSUM, &forged_checksum, sizeof(forged_checksum));
+    assert_invalid_snapshot(forged, length + 2);
+
+    // and the same bytes at the deepest level allowed are accepted
+    memcpy(forged + innermost, "\x01\x00", 2);
+    memcpy(forged + LENGTH, &(uint64_t){length}, sizeof(uint64_t));
+    forged_checksum = snapshot_checksum(forged + LENGTH, length - LENGTH);
+    memcpy(forged + CHECKSUM, &forged_checksum, sizeof(forged_checksum));
+    loaded = load_string(forged, length, DUPE_CLOBBER);
+    assert_int_eq(JUST, loaded.tag);
+    model_free(loaded.just);
+
+    free(forged);
+    free(data);
+    unlink(path);
+}
+END_TEST
+
 Suite *loader_suite(void)
 {
     TCase *bad_input_case = tcase_create("bad input");
     tcase_add_test(bad_input_case, null_string_input);
     tcase_add_test(bad_input_case, zero_string_input_length);
+    tcase_add_test(bad_input_case, null_mapped_input);
+    tcase_add_test(bad_input_case, missing_mapped_input);
     tcase_add_test(bad_input_case, null_file_input);
     tcase_add_test(bad_input_case, eof_file_input);
     tcase_add_test(bad_input_case, non_scalar_key);
@@ -584,10 +1489,27 @@ Suite *loader_suite(void)
 
     TCase *file_case = tcase_create("file");
     tcase_add_test(file_case, load_from_file);
+    tcase_add_test(file_case, load_from_mapped_file);
+    tcase_add_test(file_case, load_from_mapped_file_with_escapes);
 
     TCase *string_case = tcase_create("string");
     tcase_add_test(string_case, load_from_string);
 
+    TCase *classifier_case = tcase_create("classifier");
+    tcase_add_test(classifier_case, classifier_matches_patterns);
+
+    TCase *json_case = tcase_create("json");
+    tcase_add_test(json_case, json_loads_like_yaml);
+    tcase_add_test(json_case, generated_json_loads_like_yaml);
+    tcase_add_test(json_case, json_input_format);
+    tcase_add_test(json_case, json_source_spans);
+
+    TCase *snapshot_case = tcase_create("snapshot");
+    tcase_add_test(snapshot_case, snapshot_round_trip);
+    tcase_add_test(snapshot_case, stale_snapshot);
+    tcase_add_test(snapshot_case, damaged_snapshot);
+    tcase_add_test(snapshot_case, deep_snapshot);
+
     TCase *tag_case = tcase_create("tag");
     tcase_add_unchecked_fixture(tag_case, tagged_yaml_setup, model_teardown);
     tcase_add_test(tag_case, shorthand_tags);
@@ -612,15 +1534,23 @@ Suite *loader_suite(void)
     TCase *duplicate_fail_case = tcase_create("duplicate_fail_clobber");
     tcase_add_test(duplicate_fail_case, duplicate_fail);
 
+    TCase *stream_case = tcase_create("stream");
+    tcase_add_test(stream_case, streamed_duplicate);
+    tcase_add_test(stream_case, streamed_recursion);
+
     Suite *loader = suite_create("Loader");
     suite_add_tcase(loader, bad_input_case);
     suite_add_tcase(loader, file_case);
     suite_add_tcase(loader, string_case);
+    suite_add_tcase(loader, classifier_case);
+    suite_add_tcase(loader, json_case);
+    suite_add_tcase(loader, snapshot_case);
     suite_add_tcase(loader, tag_case);
     suite_add_tcase(loader, anchor_case);
     suite_add_tcase(loader, duplicate_clobber_case);
     suite_add_tcase(loader, duplicate_warn_case);
     suite_add_tcase(loader, duplicate_fail_case);
+    suite_add_tcase(loader, stream_case);
 
     return loader;
 }
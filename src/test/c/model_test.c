@@ -219,6 +219,86 @@ START_TEST (constructors)
 }
 END_TEST
 
+START_TEST (arena_constructors)
+{
+    reset_errno();
+    DocumentModel *arena_model = make_model_with_arena();
+    assert_noerr();
+    assert_not_null(arena_model);
+    assert_not_null(arena_model->arena);
+
+    Arena *arena = arena_model->arena;
+    reset_errno();
+    Mapping *root = make_mapping_node_in(arena);
+    assert_noerr();
+    assert_not_null(root);
+    node_set_tag_in(arena, root, (uint8_t *)"!!map", 5);
+    assert_node_tag(node(root), "!!map");
+
+    Sequence *items = make_sequence_node_in(arena);
+    assert_not_null(items);
+    for(size_t i = 0; i < 100; i++)
+    {
+        Scalar *item = make_scalar_node_in(arena, (uint8_t *)"item", 4, SCALAR_STRING);
+        assert_not_null(item);
+        assert_true(sequence_add(items, node(item)));
+    }
+    Scalar *key = make_scalar_node_in(arena, (uint8_t *)"items", 5, SCALAR_STRING);
+    assert_not_null(key);
+    assert_true(mapping_put_scalar(root, key, node(items)));
+    assert_node_size(items, 100);
+    assert_scalar_value(sequence_get(items, 99), "item");
+
+    Alias *alias = make_alias_node_in(arena, node(items));
+    assert_not_null(alias);
+    Scalar *alias_key = make_borrowed_scalar_node_in(arena, (uint8_t *)"alias", 5, SCALAR_STRING);
+    assert_not_null(alias_key);
+    assert_true(mapping_put_scalar(root, alias_key, node(alias)));
+    assert_node_size(root, 2);
+
+    Document *doc = make_document_node_in(arena);
+    assert_not_null(doc);
+    document_set_root(doc, node(root));
+    assert_true(model_add(arena_model, doc));
+
+    reset_errno();
+    Node *found = mapping_get(mapping(model_document_root(arena_model, 0)), (uint8_t *)"items", 5);
+    assert_noerr();
+    assert_ptr_eq(node(items), found);
+    assert_uint_ne(0, arena_allocated(arena));
+
+    model_free(arena_model);
+}
+END_TEST
+
+START_TEST (arena_reuse)
+{
+    reset_errno();
+    Arena *arena = make_arena();
+    assert_noerr();
+    assert_not_null(arena);
+
+    for(size_t i = 0; i < 1024; i++)
+    {
+        assert_not_null(arena_alloc(arena, 1000));
+    }
+    assert_uint_ne(0, arena_allocated(arena));
+
+    arena_reset(arena);
+    assert_uint_eq(0, arena_allocated(arena));
+
+    uint8_t *value = arena_alloc(arena, 64);
+    assert_not_null(value);
+    for(size_t i = 0; i < 64; i++)
+    {
+        assert_uint_eq(0, value[i]);
+    }
+    assert_uint_eq(64, arena_allocated(arena));
+
+    arena_free(arena);
+}
+END_TEST
+
 START_TEST (document_type)
 {
     reset_errno();
@@ -232,7 +312,7 @@ START_TEST (document_type)
     assert_not_null(d);
     
     reset_errno();
-    Node *bogus = model_document(model, 1);
+    Document *bogus = model_document(model, 1);
     assert_errno(EINVAL);
     assert_null(bogus);
     
@@ -397,6 +477,37 @@ START_TEST (mapping_type)
 }
 END_TEST
 
+START_TEST (mapping_key_hash)
+{
+    Mapping *map = make_mapping_node();
+    assert_not_null(map);
+    Scalar *key = make_scalar_node((uint8_t *)"key", 3, SCALAR_STRING);
+    Scalar *same = make_scalar_node((uint8_t *)"key", 3, SCALAR_STRING);
+    Scalar *other = make_scalar_node((uint8_t *)"kez", 3, SCALAR_STRING);
+    assert_not_null(key);
+    assert_not_null(same);
+    assert_not_null(other);
+    assert_uint_eq(0, key->hash);
+
+    Scalar *value = make_scalar_node((uint8_t *)"value", 5, SCALAR_STRING);
+    assert_true(mapping_put_scalar(map, key, node(value)));
+    assert_uint_ne(0, key->hash);
+
+    // N.B. - an unhashed key, and one hashed by a lookup, both find the stored key
+    assert_true(node_equals(node(key), node(same)));
+    assert_true(mapping_contains_key(map, same));
+    assert_uint_eq(key->hash, same->hash);
+    assert_false(mapping_contains_key(map, other));
+    assert_uint_ne(0, other->hash);
+    assert_false(node_equals(node(key), node(other)));
+    assert_true(mapping_contains(map, (uint8_t *)"key", 3));
+
+    node_free(node(same));
+    node_free(node(other));
+    node_free(node(map));
+}
+END_TEST
+
 START_TEST (sequence_iteration)
 {
     reset_errno();
@@ -535,12 +646,15 @@ Suite *model_suite(void)
     TCase *basic = tcase_create("basic");
     tcase_add_checked_fixture(basic, model_setup, model_teardown);
     tcase_add_test(basic, constructors);
+    tcase_add_test(basic, arena_constructors);
+    tcase_add_test(basic, arena_reuse);
     tcase_add_test(basic, document_type);
     tcase_add_test(basic, nodes);
     tcase_add_test(basic, scalar_type);
     tcase_add_test(basic, scalar_boolean);
     tcase_add_test(basic, sequence_type);
     tcase_add_test(basic, mapping_type);
+    tcase_add_test(basic, mapping_key_hash);
 
     TCase *iteration = tcase_create("iteration");
     tcase_add_checked_fixture(iteration, model_setup, model_teardown);
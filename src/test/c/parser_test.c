@@ -1401,6 +1401,92 @@ START_TEST (bad_predicate_input)
 }
 END_TEST
 
+static jsonpath *parse_cached(PathCache *cache, const char *expression)
+{
+    parser_context *context = make_parser((uint8_t *)expression, strlen(expression));
+    jsonpath *path = parse(context);
+    assert_parser_success(expression, context, path, ABSOLUTE_PATH, path_length(path));
+    parser_free(context);
+
+    assert_true(path_cache_put(cache, path));
+    return path;
+}
+
+START_TEST (canonical_form)
+{
+    static const char * const expressions[][2] =
+    {
+        {"$", "$"},
+        {"$.foo . bar", "$.foo.bar"},
+        {"$.'foo'..'bar baz'", "$.foo..'bar baz'"},
+        {"$.foo[ 1 ].*", "$.foo[1].*"},
+        {"$..foo[*]..object()", "$..foo[*]..object()"},
+        {"$.foo[1:]", "$.foo[1::1]"},
+        {"$.foo[:-2:2]", "$.foo[:-2:2]"},
+        {"foo.bar", "foo.bar"},
+    };
+    for(size_t i = 0; i < sizeof(expressions) / sizeof(expressions[0]); i++)
+    {
+        parser_context *context = make_parser((uint8_t *)expressions[i][0], strlen(expressions[i][0]));
+        jsonpath *path = parse(context);
+        assert_int_eq(JSONPATH_SUCCESS, parser_status(context));
+        parser_free(context);
+
+        char *canonical = path_canonical_form(path);
+        assert_not_null(canonical);
+        ck_assert_str_eq(expressions[i][1], canonical);
+        free(canonical);
+        path_free(path);
+    }
+}
+END_TEST
+
+START_TEST (path_cache)
+{
+    reset_errno();
+    PathCache *cache = make_path_cache(2);
+    assert_noerr();
+    assert_not_null(cache);
+
+    jsonpath *first = parse_cached(cache, "$.foo.bar");
+    parse_cached(cache, "$..baz");
+    assert_uint_eq(2, path_cache_size(cache));
+
+    assert_ptr_eq(first, path_cache_get(cache, (uint8_t *)"$.foo.bar", 9));
+    assert_null(path_cache_get(cache, (uint8_t *)"$.foo", 5));
+    assert_uint_eq(1, path_cache_hits(cache));
+    assert_uint_eq(1, path_cache_misses(cache));
+
+    // N.B. - the second path is now the least recently used
+    jsonpath *third = parse_cached(cache, "$.quux[1:]");
+    assert_uint_eq(2, path_cache_size(cache));
+    assert_uint_eq(1, path_cache_evictions(cache));
+    assert_null(path_cache_get(cache, (uint8_t *)"$..baz", 6));
+    assert_ptr_eq(first, path_cache_get(cache, (uint8_t *)"$.foo.bar", 9));
+    assert_ptr_eq(third, path_cache_get(cache, (uint8_t *)"$.quux[1:]", 10));
+    assert_uint_eq(3, path_cache_hits(cache));
+    assert_uint_eq(2, path_cache_misses(cache));
+
+    // N.B. - an expression that is already cached isn't taken again
+    assert_false(path_cache_put(cache, third));
+
+    path_cache_resize(cache, 1);
+    assert_uint_eq(1, path_cache_size(cache));
+    assert_uint_eq(1, path_cache_capacity(cache));
+    assert_ptr_eq(third, path_cache_get(cache, (uint8_t *)"$.quux[1:]", 10));
+
+    path_cache_resize(cache, 0);
+    assert_uint_eq(0, path_cache_size(cache));
+    parser_context *context = make_parser((uint8_t *)"$", 1);
+    jsonpath *path = parse(context);
+    parser_free(context);
+    assert_false(path_cache_put(cache, path));
+    path_free(path);
+
+    path_cache_free(cache);
+}
+END_TEST
+
 Suite *jsonpath_suite(void)
 {
     TCase *bad_input_case = tcase_create("bad input");
@@ -1473,6 +1559,10 @@ Suite *jsonpath_suite(void)
     tcase_add_test(api_case, bad_predicate_input);
     tcase_add_test(api_case, iteration);
     tcase_add_test(api_case, fail_iteration);
+    tcase_add_test(api_case, canonical_form);
+
+    TCase *cache_case = tcase_create("cache");
+    tcase_add_test(cache_case, path_cache);
 
     Suite *suite = suite_create("Parser");
     suite_add_tcase(suite, bad_input_case);
@@ -1480,6 +1570,7 @@ Suite *jsonpath_suite(void)
     suite_add_tcase(suite, node_type_case);
     suite_add_tcase(suite, predicate_case);
     suite_add_tcase(suite, api_case);
+    suite_add_tcase(suite, cache_case);
 
     return suite;
 }
@@ -88,7 +88,9 @@ int main(int argc, char **argv)
     srunner_add_suite(runner, jsonpath_suite());
     srunner_add_suite(runner, model_suite());
     srunner_add_suite(runner, nodelist_suite());
+    srunner_add_suite(runner, hashtable_suite());
     srunner_add_suite(runner, evaluator_suite());
+    srunner_add_suite(runner, emit_suite());
 
     switch(argc)
     {